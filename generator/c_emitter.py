@@ -4,9 +4,9 @@ C 端 dispatch 代码生成 - 解析二进制 payload，调用服务实现，序
 """
 
 try:
-    from .parser import RpcSchema, ServiceDef, MethodDef, StructDef, StructField
+    from .parser import RpcSchema, ServiceDef, MethodDef, StructDef, StructField, map_key_value, delta_keyframe_interval, fieldmask_enabled, paged_page_items
 except ImportError:
-    from parser import RpcSchema, ServiceDef, MethodDef, StructDef, StructField
+    from parser import RpcSchema, ServiceDef, MethodDef, StructDef, StructField, map_key_value, delta_keyframe_interval, fieldmask_enabled, paged_page_items
 
 
 def _c_primitive(type_str: str) -> bool:
@@ -40,12 +40,17 @@ def _is_string_type(type_str: str) -> bool:
     return base == 'string'
 
 
+def _is_strview_type(type_str: str) -> bool:
+    """是否为 strview 类型：线上同 string，C 端为指向接收帧的 {ptr, len}"""
+    return _unwrap_type(type_str) == 'strview'
+
+
 def _is_struct_param(type_str: str, schema: RpcSchema) -> bool:
     """是否为 struct 类型参数（非 primitive、非 LIST/STREAM）"""
     t = type_str.strip()
     if t.startswith('LIST(') or t.startswith('STREAM(') or t.startswith('OPTIONAL('):
         inner = _unwrap_type(t)
-        if _c_primitive(inner) or inner == 'string':
+        if _c_primitive(inner) or inner in ('string', 'strview'):
             return False
         return _get_struct(schema, inner) is not None
     return _get_struct(schema, t) is not None
@@ -57,210 +62,75 @@ def _is_enum_type(type_str: str, schema: RpcSchema) -> bool:
     return any(e.name == base for e in schema.enums)
 
 
-def _emit_parse_struct_bin(schema: RpcSchema, struct: StructDef) -> str:
-    """生成 struct 的二进制解析函数，从 (*p, end) 读取"""
-    fn = f'bin_read_{struct.name}'
-    lines = [
-        f'static int {fn}(const uint8_t **p, const uint8_t *end, {struct.name} *out) {{',
-        f'    memset(out, 0, sizeof(*out));',
-    ]
-    for f in struct.fields:
-        if not f.name:
-            continue
-        base = _unwrap_type(f.type_str)
-        is_opt = f.type_str.strip().startswith('OPTIONAL(')
-        if _is_string_type(f.type_str):
-            lines.append(f'    {{')
-            lines.append(f'        static char {f.name}_buf[128];')
-            if is_opt:
-                lines.append(f'        bool {f.name}_present = false;')
-                lines.append(f'        if (esprpc_bin_read_optional_tag(p, end, &{f.name}_present) != 0) return -1;')
-                lines.append(f'        if ({f.name}_present) {{')
-                lines.append(f'            if (esprpc_bin_read_str(p, end, {f.name}_buf, sizeof({f.name}_buf)) != 0) return -1;')
-                lines.append(f'            out->{f.name}.present = true; out->{f.name}.value = {f.name}_buf;')
-                lines.append(f'        }} else {{ out->{f.name}.present = false; }}')
-            else:
-                lines.append(f'        if (esprpc_bin_read_str(p, end, {f.name}_buf, sizeof({f.name}_buf)) != 0) return -1;')
-                lines.append(f'        out->{f.name} = {f.name}_buf;')
-            lines.append(f'    }}')
-        elif _c_primitive(base) or _is_enum_type(f.type_str, schema):
-            if is_opt:
-                lines.append(f'    {{')
-                lines.append(f'        bool {f.name}_present = false;')
-                lines.append(f'        if (esprpc_bin_read_optional_tag(p, end, &{f.name}_present) != 0) return -1;')
-                lines.append(f'        if ({f.name}_present) {{')
-                lines.append(f'            int v = 0;')
-                lines.append(f'            if (esprpc_bin_read_i32(p, end, &v) != 0) return -1;')
-                lines.append(f'            out->{f.name}.present = true; out->{f.name}.value = v;')
-                lines.append(f'        }} else {{ out->{f.name}.present = false; }}')
-                lines.append(f'    }}')
-            else:
-                lines.append(f'    if (esprpc_bin_read_i32(p, end, &out->{f.name}) != 0) return -1;')
-        elif f.type_str.strip().startswith('LIST('):
-            # LIST(T): [4B count][elem0][elem1]...
-            elem_type = base
-            elem_struct = _get_struct(schema, elem_type)
-            if _is_string_type(f.type_str):
-                lines.append(f'    {{')
-                lines.append(f'        uint32_t {f.name}_count = 0;')
-                lines.append(f'        if (esprpc_bin_read_u32(p, end, &{f.name}_count) != 0) return -1;')
-                lines.append(f'        #define {f.name.upper()}_MAX 8')
-                lines.append(f'        static char {f.name}_buf[{f.name.upper()}_MAX][64];')
-                lines.append(f'        static char *{f.name}_ptrs[{f.name.upper()}_MAX];')
-                lines.append(f'        size_t {f.name}_n = ({f.name}_count < {f.name.upper()}_MAX) ? {f.name}_count : {f.name.upper()}_MAX;')
-                lines.append(f'        for (size_t i = 0; i < {f.name}_n; i++) {{')
-                lines.append(f'            if (esprpc_bin_read_str(p, end, {f.name}_buf[i], sizeof({f.name}_buf[i])) != 0) return -1;')
-                lines.append(f'            {f.name}_ptrs[i] = {f.name}_buf[i];')
-                lines.append(f'        }}')
-                lines.append(f'        out->{f.name}.items = {f.name}_ptrs;')
-                lines.append(f'        out->{f.name}.len = {f.name}_n;')
-                lines.append(f'        for (size_t i = {f.name}_n; i < {f.name}_count; i++) {{')
-                lines.append(f'            if (esprpc_bin_read_str(p, end, {f.name}_buf[0], sizeof({f.name}_buf[0])) != 0) return -1;')
-                lines.append(f'        }}')
-                lines.append(f'        #undef {f.name.upper()}_MAX')
-                lines.append(f'    }}')
-            elif elem_struct:
-                lines.append(f'    {{')
-                lines.append(f'        uint32_t {f.name}_count = 0;')
-                lines.append(f'        if (esprpc_bin_read_u32(p, end, &{f.name}_count) != 0) return -1;')
-                lines.append(f'        #define {f.name.upper()}_MAX 8')
-                lines.append(f'        static {elem_struct.name} {f.name}_arr[{f.name.upper()}_MAX];')
-                lines.append(f'        size_t {f.name}_n = ({f.name}_count < {f.name.upper()}_MAX) ? {f.name}_count : {f.name.upper()}_MAX;')
-                lines.append(f'        for (size_t i = 0; i < {f.name}_n; i++) {{')
-                lines.append(f'            if (bin_read_{elem_struct.name}(p, end, &{f.name}_arr[i]) != 0) return -1;')
-                lines.append(f'        }}')
-                lines.append(f'        out->{f.name}.items = {f.name}_arr;')
-                lines.append(f'        out->{f.name}.len = {f.name}_n;')
-                lines.append(f'        for (size_t i = {f.name}_n; i < {f.name}_count; i++) {{')
-                lines.append(f'            {elem_struct.name} _skip;')
-                lines.append(f'            if (bin_read_{elem_struct.name}(p, end, &_skip) != 0) return -1;')
-                lines.append(f'        }}')
-                lines.append(f'        #undef {f.name.upper()}_MAX')
-                lines.append(f'    }}')
-            else:
-                elem_c = _type_str_to_c(elem_type)
-                lines.append(f'    {{')
-                lines.append(f'        uint32_t {f.name}_count = 0;')
-                lines.append(f'        if (esprpc_bin_read_u32(p, end, &{f.name}_count) != 0) return -1;')
-                lines.append(f'        #define {f.name.upper()}_MAX 8')
-                lines.append(f'        static {elem_c} {f.name}_arr[{f.name.upper()}_MAX];')
-                lines.append(f'        size_t {f.name}_n = ({f.name}_count < {f.name.upper()}_MAX) ? {f.name}_count : {f.name.upper()}_MAX;')
-                lines.append(f'        for (size_t i = 0; i < {f.name}_n; i++) {{')
-                lines.append(f'            if (esprpc_bin_read_i32(p, end, (int *)&{f.name}_arr[i]) != 0) return -1;')
-                lines.append(f'        }}')
-                lines.append(f'        out->{f.name}.items = {f.name}_arr;')
-                lines.append(f'        out->{f.name}.len = {f.name}_n;')
-                lines.append(f'        for (size_t i = {f.name}_n; i < {f.name}_count; i++) {{')
-                lines.append(f'            int _skip;')
-                lines.append(f'            if (esprpc_bin_read_i32(p, end, &_skip) != 0) return -1;')
-                lines.append(f'        }}')
-                lines.append(f'        #undef {f.name.upper()}_MAX')
-                lines.append(f'    }}')
-        else:
-            lines.append(f'    if (esprpc_bin_read_i32(p, end, (int *)&out->{f.name}) != 0) return -1;')
-    lines.append(f'    return 0;')
-    lines.append(f'}}')
-    return '\n'.join(lines)
+def _wire(schema: RpcSchema) -> str:
+    """RPC_INT_ENCODING 对应的 esprpc_codec.hpp 编码策略"""
+    return 'esprpc::wire_varint' if schema.int_encoding == 'varint' else 'esprpc::wire_fixed'
 
 
-def _emit_serialize_struct_bin(schema: RpcSchema, struct: StructDef, var_name: str = 'r', skip_complex: bool = False) -> list[str]:
-    """生成结构体二进制序列化代码块，写入到 (*wp, end)。skip_complex 仅用于兼容，LIST 已支持"""
+def _emit_param_reads(schema: RpcSchema, m: MethodDef) -> tuple[list[str], list[str]]:
+    """按声明顺序从 (p, end) 解析方法参数，返回 (代码行, 调用实参)"""
+    wire = _wire(schema)
     lines = []
-    for f in struct.fields:
-        if not f.name:
-            continue
-        base = _unwrap_type(f.type_str)
-        is_opt = f.type_str.strip().startswith('OPTIONAL(')
-        if f.type_str.strip().startswith('LIST('):
-            # LIST(T): [4B count][elem0][elem1]...
-            elem_type = base
-            elem_struct = _get_struct(schema, elem_type)
-            if _is_string_type(f.type_str):
-                lines.append(f'    if (esprpc_bin_write_u32(&wp, wend, (uint32_t)({var_name}.{f.name}.len)) != 0) return -1;')
-                lines.append(f'    if ({var_name}.{f.name}.items && {var_name}.{f.name}.len > 0) {{')
-                lines.append(f'        for (size_t j = 0; j < {var_name}.{f.name}.len; j++) {{')
-                lines.append(f'            if (esprpc_bin_write_str(&wp, wend, {var_name}.{f.name}.items[j] ? {var_name}.{f.name}.items[j] : "") != 0) return -1;')
-                lines.append(f'        }}')
-                lines.append(f'    }}')
-            elif elem_struct:
-                lines.append(f'    if (esprpc_bin_write_u32(&wp, wend, (uint32_t)({var_name}.{f.name}.len)) != 0) return -1;')
-                lines.append(f'    if ({var_name}.{f.name}.items && {var_name}.{f.name}.len > 0) {{')
-                lines.append(f'        for (size_t j = 0; j < {var_name}.{f.name}.len; j++) {{')
-                for line in _emit_serialize_struct_bin(schema, elem_struct, f'{var_name}.{f.name}.items[j]', skip_complex=True):
-                    lines.append(f'            {line}')
-                lines.append(f'        }}')
-                lines.append(f'    }}')
-            else:
-                # LIST(primitive)
-                lines.append(f'    if (esprpc_bin_write_u32(&wp, wend, (uint32_t)({var_name}.{f.name}.len)) != 0) return -1;')
-                lines.append(f'    if ({var_name}.{f.name}.items && {var_name}.{f.name}.len > 0) {{')
-                lines.append(f'        for (size_t j = 0; j < {var_name}.{f.name}.len; j++) {{')
-                lines.append(f'            if (esprpc_bin_write_i32(&wp, wend, (int){var_name}.{f.name}.items[j]) != 0) return -1;')
-                lines.append(f'        }}')
-                lines.append(f'    }}')
-        elif _is_string_type(f.type_str):
-            if is_opt:
-                lines.append(f'    if (esprpc_bin_write_optional_tag(&wp, wend, {var_name}.{f.name}.present) != 0) return -1;')
-                lines.append(f'    if ({var_name}.{f.name}.present && esprpc_bin_write_str(&wp, wend, {var_name}.{f.name}.value) != 0) return -1;')
-            else:
-                lines.append(f'    if (esprpc_bin_write_str(&wp, wend, {var_name}.{f.name} ? {var_name}.{f.name} : "") != 0) return -1;')
-        elif _c_primitive(base) or _is_enum_type(f.type_str, schema):
-            if is_opt:
-                lines.append(f'    if (esprpc_bin_write_optional_tag(&wp, wend, {var_name}.{f.name}.present) != 0) return -1;')
-                lines.append(f'    if ({var_name}.{f.name}.present && esprpc_bin_write_i32(&wp, wend, {var_name}.{f.name}.value) != 0) return -1;')
-            else:
-                lines.append(f'    if (esprpc_bin_write_i32(&wp, wend, {var_name}.{f.name}) != 0) return -1;')
-        else:
-            lines.append(f'    if (esprpc_bin_write_i32(&wp, wend, (int){var_name}.{f.name}) != 0) return -1;')
-    return lines
-
-
-def _field_is_serializable(type_str: str) -> bool:
-    """字段是否可简单序列化（LIST 已支持，MAP 已移除）"""
-    return True
-
-
-def _emit_method_dispatch(schema: RpcSchema, svc: ServiceDef, m: MethodDef, method_idx: int) -> list[str]:
-    """为单个方法生成 dispatch 分支（二进制协议）"""
-    lines = []
-    # 1. 参数解析（从 p 顺序读取）
-    lines.append(f'        const uint8_t *p = req_buf;')
-    lines.append(f'        const uint8_t *end = req_buf + req_len;')
     call_args = []
     for p in m.params:
         base = _unwrap_type(p.type_str)
         is_opt = p.type_str.strip().startswith('OPTIONAL(')
         c_type = _type_str_to_c(p.type_str)
-        if _c_primitive(p.type_str):
-            lines.append(f'        int {p.name}_val = 0;')
-            lines.append(f'        if (esprpc_bin_read_i32((const uint8_t **)&p, end, &{p.name}_val) != 0) return -1;')
-            call_args.append(f'{p.name}_val')
-        elif p.type_str.strip() == 'bool':
-            lines.append(f'        bool {p.name}_val = false;')
-            lines.append(f'        if (esprpc_bin_read_bool((const uint8_t **)&p, end, &{p.name}_val) != 0) return -1;')
+        if _c_primitive(p.type_str) or (_is_enum_type(p.type_str, schema) and not is_opt):
+            lines.append(f'        {c_type} {p.name}_val = {{}};')
+            lines.append(f'        if (esprpc::decode<{wire}>(&p, end, &{p.name}_val, arena) != 0) return -1;')
             call_args.append(f'{p.name}_val')
-        elif is_opt and _c_primitive(base):
-            lines.append(f'        {c_type} {p.name} = {{ false, 0 }};')
-            lines.append(f'        {{ bool pr = false; if (esprpc_bin_read_optional_tag((const uint8_t **)&p, end, &pr) != 0) return -1;')
-            lines.append(f'          if (pr) {{ int v = 0; if (esprpc_bin_read_i32((const uint8_t **)&p, end, &v) != 0) return -1;')
-            lines.append(f'            {p.name}.present = true; {p.name}.value = v; }} }}')
+        elif _get_struct(schema, p.type_str.strip()):
+            lines.append(f'        {c_type} {p.name} = {{}};')
+            lines.append(f'        if (bin_read_{base}(&p, end, &{p.name}, arena) != 0) return -1;')
             call_args.append(p.name)
-        elif _is_struct_param(p.type_str, schema):
-            struct = _get_struct(schema, base)
-            if struct:
-                lines.append(f'        {c_type} {p.name} = {{}};')
-                lines.append(f'        if (bin_read_{struct.name}((const uint8_t **)&p, end, &{p.name}) != 0) return -1;')
-                call_args.append(p.name)
-            else:
-                lines.append(f'        {c_type} {p.name} = {{}};')
-                call_args.append(p.name)
         else:
+            # 其余类型（OPTIONAL、LIST、MAP、字符串等）都由 esprpc::codec 按 C 类型解码，保证后续参数偏移正确
             lines.append(f'        {c_type} {p.name} = {{}};')
+            lines.append(f'        if (esprpc::decode<{wire}>(&p, end, &{p.name}, arena) != 0) return -1;')
             call_args.append(p.name)
+    return lines, call_args
+
+
+def _fieldmask_struct(schema: RpcSchema, svc: ServiceDef, m: MethodDef) -> StructDef | None:
+    """开启 "fieldmask" 的方法：掩码作用的 struct（返回值本身或 LIST 元素），未开启返回 None"""
+    if not fieldmask_enabled(m):
+        return None
+    struct = _get_struct(schema, _unwrap_type(m.ret_type))
+    if m.ret_type.strip().startswith(('OPTIONAL(', 'REQUIRED(')) or not struct:
+        raise ValueError(f'{svc.name}.{m.name}: "fieldmask" requires an RPC_STRUCT or LIST(RPC_STRUCT) return, got {m.ret_type!r}')
+    return struct
+
+
+def _ret_c(m: MethodDef) -> str:
+    """方法实现的 C 返回类型：STREAM(T) -> rpc_stream<T>，PAGED(T) -> rpc_cursor<T>"""
+    if m.is_stream:
+        return f'rpc_stream<{m.ret_type}>'
+    if m.is_paged:
+        return f'rpc_cursor<{_unwrap_type(m.ret_type)}>'
+    return _type_str_to_c(m.ret_type)
+
+
+def _page_items_macro(svc: ServiceDef, m: MethodDef) -> str:
+    return f'{_method_to_snake(svc.name).upper()}_{_method_to_snake(m.name).upper()}_PAGE_ITEMS'
+
+
+def _emit_method_dispatch(schema: RpcSchema, svc: ServiceDef, m: MethodDef, method_idx: int) -> list[str]:
+    """为单个方法生成 dispatch 分支（二进制协议）"""
+    lines = []
+    masked = _fieldmask_struct(schema, svc, m) is not None
+    ret_c = _ret_c(m)
+    # 1. 参数解析（从 p 顺序读取）；"fieldmask" 方法的请求以字段掩码开头
+    lines.append(f'        const uint8_t *p = req_buf;')
+    lines.append(f'        const uint8_t *end = req_buf + req_len;')
+    if masked:
+        lines.append(f'        const uint8_t *mask = NULL;')
+        lines.append(f'        if (esprpc::read_fieldmask<{ret_c}>(&p, end, &mask) != 0) return -1;')
+    param_lines, call_args = _emit_param_reads(schema, m)
+    lines.extend(param_lines)
 
     # 2. 调用服务
     args_str = ', '.join(call_args)
-    ret_c = _type_str_to_c(m.ret_type)
 
     # 处理 void 返回类型
     if m.ret_type == 'void' or m.ret_type == 'VOID':
@@ -272,38 +142,24 @@ def _emit_method_dispatch(schema: RpcSchema, svc: ServiceDef, m: MethodDef, meth
 
     lines.append(f'        {ret_c} r = svc->{m.name}({args_str});')
 
-    # 3. 响应序列化（二进制）
-    lines.append(f'        *resp_len = 1024;')
+    # 3. 响应序列化（二进制）：先算精确字节数，再一次性分配；PAGED 按页编码，中间页直接发出
+    wire = _wire(schema)
+    if m.is_paged:
+        mask_arg = 'mask' if masked else 'NULL'
+        lines.append(f'        return esprpc::encode_paged<{wire}>(r, {_page_items_macro(svc, m)}, {mask_arg}, arena, resp_buf, resp_len);')
+        return lines
+    if masked:
+        size_expr = f'esprpc::masked_size<{wire}>(r, mask)'
+        encode_expr = f'esprpc::encode_masked<{wire}>(&wp, *resp_buf + *resp_len, r, mask)'
+    else:
+        size_expr = f'esprpc::size<{wire}>(r)'
+        encode_expr = f'esprpc::encode<{wire}>(&wp, *resp_buf + *resp_len, r)'
+    lines.append(f'        *resp_len = {size_expr};')
     lines.append(f'        *resp_buf = (uint8_t *)malloc(*resp_len);')
     lines.append(f'        if (!*resp_buf) return -1;')
     lines.append(f'        uint8_t *wp = *resp_buf;')
-    lines.append(f'        const uint8_t *wend = *resp_buf + *resp_len;')
-
-    if m.ret_type == 'bool':
-        lines.append(f'        if (esprpc_bin_write_bool(&wp, wend, r) != 0) {{ free(*resp_buf); *resp_buf = NULL; return -1; }}')
-        lines.append(f'        *resp_len = (size_t)(wp - *resp_buf);')
-        lines.append(f'        return 0;')
-    elif m.ret_type.startswith('LIST('):
-        elem_type = _unwrap_type(m.ret_type)
-        elem_struct = _get_struct(schema, elem_type)
-        lines.append(f'        if (esprpc_bin_write_u32(&wp, wend, (uint32_t)(r.len)) != 0) {{ free(*resp_buf); *resp_buf = NULL; return -1; }}')
-        lines.append(f'        if (r.items && r.len > 0) {{')
-        if elem_struct:
-            lines.append(f'            for (size_t i = 0; i < r.len; i++) {{')
-            for line in _emit_serialize_struct_bin(schema, elem_struct, 'r.items[i]', skip_complex=True):
-                lines.append(f'                {line}')
-            lines.append(f'            }}')
-        lines.append(f'        }}')
-        lines.append(f'        *resp_len = (size_t)(wp - *resp_buf);')
-        lines.append(f'        return 0;')
-    else:
-        ret_struct = _get_struct(schema, m.ret_type)
-        if ret_struct:
-            for line in _emit_serialize_struct_bin(schema, ret_struct, 'r'):
-                lines.append(f'        {line}')
-        lines.append(f'        *resp_len = (size_t)(wp - *resp_buf);')
-        lines.append(f'        return 0;')
-
+    lines.append(f'        if ({encode_expr} != 0) {{ free(*resp_buf); *resp_buf = NULL; return -1; }}')
+    lines.append(f'        return 0;')
     return lines
 
 
@@ -312,37 +168,8 @@ def _emit_stream_dispatch(schema: RpcSchema, svc: ServiceDef, m: MethodDef, meth
     lines = []
     lines.append(f'        const uint8_t *p = req_buf;')
     lines.append(f'        const uint8_t *end = req_buf + req_len;')
-    call_args = []
-    for p in m.params:
-        base = _unwrap_type(p.type_str)
-        is_opt = p.type_str.strip().startswith('OPTIONAL(')
-        c_type = _type_str_to_c(p.type_str)
-        if _c_primitive(p.type_str):
-            lines.append(f'        int {p.name}_val = 0;')
-            lines.append(f'        if (esprpc_bin_read_i32((const uint8_t **)&p, end, &{p.name}_val) != 0) return -1;')
-            call_args.append(f'{p.name}_val')
-        elif p.type_str.strip() == 'bool':
-            lines.append(f'        bool {p.name}_val = false;')
-            lines.append(f'        if (esprpc_bin_read_bool((const uint8_t **)&p, end, &{p.name}_val) != 0) return -1;')
-            call_args.append(f'{p.name}_val')
-        elif is_opt and _c_primitive(base):
-            lines.append(f'        {c_type} {p.name} = {{ false, 0 }};')
-            lines.append(f'        {{ bool pr = false; if (esprpc_bin_read_optional_tag((const uint8_t **)&p, end, &pr) != 0) return -1;')
-            lines.append(f'          if (pr) {{ int v = 0; if (esprpc_bin_read_i32((const uint8_t **)&p, end, &v) != 0) return -1;')
-            lines.append(f'            {p.name}.present = true; {p.name}.value = v; }} }}')
-            call_args.append(p.name)
-        elif _is_struct_param(p.type_str, schema):
-            struct = _get_struct(schema, base)
-            if struct:
-                lines.append(f'        {c_type} {p.name} = {{}};')
-                lines.append(f'        if (bin_read_{struct.name}((const uint8_t **)&p, end, &{p.name}) != 0) return -1;')
-                call_args.append(p.name)
-            else:
-                lines.append(f'        {c_type} {p.name} = {{}};')
-                call_args.append(p.name)
-        else:
-            lines.append(f'        {c_type} {p.name} = {{}};')
-            call_args.append(p.name)
+    param_lines, call_args = _emit_param_reads(schema, m)
+    lines.extend(param_lines)
 
     lines.append(f'        esprpc_set_stream_method_id(method_id);')
     args_str = ', '.join(call_args)
@@ -360,7 +187,8 @@ def _emit_bin_dispatch(schema: RpcSchema, svc: ServiceDef) -> str:
     """生成二进制 payload 的 dispatch 函数"""
     lines = [
         f'int {svc.name}_dispatch(uint16_t method_id, const uint8_t *req_buf, size_t req_len,',
-        f'                      uint8_t **resp_buf, size_t *resp_len, void *svc_ctx) {{',
+        f'                      uint8_t **resp_buf, size_t *resp_len, void *svc_ctx,',
+        f'                      esprpc_arena_t *arena) {{',
         f'    {svc.name} *svc = ({svc.name} *)svc_ctx;',
         f'    uint8_t mth = method_id & 0x1F;',
         f'',
@@ -383,26 +211,6 @@ def _emit_bin_dispatch(schema: RpcSchema, svc: ServiceDef) -> str:
     return '\n'.join(lines)
 
 
-def emit_dispatch_header(schema: RpcSchema, rpc_h_basename: str) -> str:
-    """生成 dispatch 函数声明头文件"""
-    guard = rpc_h_basename.replace('.', '_').upper().replace('_RPC_H', '_RPC_DISPATCH_H')
-    lines = [
-        f'/* Auto-generated - do not edit */',
-        f'#ifndef {guard}',
-        f'#define {guard}',
-        f'#include <stdint.h>',
-        f'#include <stddef.h>',
-        f'#include <stdbool.h>',
-        f'',
-    ]
-    for svc in schema.services:
-        lines.append(f'int {svc.name}_dispatch(uint16_t method_id, const uint8_t *req_buf, size_t req_len,')
-        lines.append(f'                      uint8_t **resp_buf, size_t *resp_len, void *svc_ctx);')
-        lines.append(f'')
-    lines.append(f'#endif')
-    return '\n'.join(lines)
-
-
 def _type_str_to_c(type_str: str) -> str:
     """将解析器的 type_str 转为 C 类型名"""
     t = type_str.strip()
@@ -415,6 +223,9 @@ def _type_str_to_c(type_str: str) -> str:
     if t.startswith('STREAM(') and t.endswith(')'):
         inner = t[7:-1].strip()
         return f'rpc_stream<{inner}>'
+    kv = map_key_value(t)
+    if kv:
+        return f'rpc_map<{_type_str_to_c(kv[0])}, {_type_str_to_c(kv[1])}>'
     return t
 
 
@@ -428,13 +239,15 @@ def _method_to_snake(name: str) -> str:
     return ''.join(s)
 
 
-def _default_return_expr(ret_type: str, is_stream: bool = False) -> str:
+def _default_return_expr(ret_type: str, is_stream: bool = False, is_paged: bool = False) -> str:
     """根据返回类型生成占位返回值表达式"""
     if ret_type == 'void' or ret_type == 'VOID':
         return 'return;'
     if is_stream:
         c_type = f'rpc_stream<{ret_type}>'
         return f'return ({c_type}){{ nullptr }};'
+    if is_paged:
+        return f'return (rpc_cursor<{_unwrap_type(ret_type)}>){{ nullptr, nullptr }};'
     c_type = _type_str_to_c(ret_type)
     if c_type == 'bool':
         return 'return false;'
@@ -456,7 +269,7 @@ def _emit_impl_extern_and_vtable(svc: ServiceDef) -> str:
             params_str = ', '.join(f'{_type_str_to_c(p.type_str)} {p.name}' for p in m.params)
         else:
             params_str = 'void'
-        ret_c = f'rpc_stream<{m.ret_type}>' if m.is_stream else _type_str_to_c(m.ret_type)
+        ret_c = _ret_c(m)
         fn_name = f'{_method_to_snake(m.name)}_impl'
         lines.append(f'extern {ret_c} {fn_name}({params_str});')
     lines.append(f'')
@@ -480,14 +293,14 @@ def _emit_service_impl_user_stubs(svc: ServiceDef) -> str:
             params_str = ', '.join(f'{_type_str_to_c(p.type_str)} {p.name}' for p in m.params)
         else:
             params_str = 'void'
-        ret_c = f'rpc_stream<{m.ret_type}>' if m.is_stream else _type_str_to_c(m.ret_type)
+        ret_c = _ret_c(m)
         fn_name = f'{_method_to_snake(m.name)}_impl'
         lines.append(f'{ret_c} {fn_name}({params_str})')
         lines.append(f'{{')
         for p in m.params:
             lines.append(f'    (void){p.name};')
         lines.append(f'    // TODO: 实现业务逻辑')
-        lines.append(f'    {_default_return_expr(m.ret_type, m.is_stream)}')
+        lines.append(f'    {_default_return_expr(m.ret_type, m.is_stream, m.is_paged)}')
         lines.append(f'}}')
         lines.append(f'')
     return '\n'.join(lines)
@@ -552,54 +365,164 @@ def _collect_struct_params(schema: RpcSchema) -> set[str]:
     return needed
 
 
-def emit_c_dispatch(schema: RpcSchema, rpc_h_basename: str) -> str:
-    """为 schema 中的每个 service 生成 C dispatch，返回完整文件内容（二进制协议）
-    序列化/反序列化逻辑复用 esprpc_binary.c，生成代码仅含调用逻辑"""
-    lines = [
-        f'/* Auto-generated - do not edit */',
-        f'#include "{rpc_h_basename}"',
-        f'#include "esprpc.h"',
-        f'#include "esprpc_service.h"',
-        f'#include "esprpc_binary.h"',
-        f'#include <stdlib.h>',
-        f'#include <string.h>',
-        f'',
-    ]
-    # 动态生成各 struct 的解析函数
-    for struct_name in sorted(_collect_struct_params(schema)):
-        struct = _get_struct(schema, struct_name)
-        if struct:
-            lines.append(_emit_parse_struct_bin(schema, struct))
-            lines.append('')
+def _stream_struct_types(schema: RpcSchema) -> list[str]:
+    """STREAM(T) 方法的元素 struct，按声明顺序去重"""
+    names: list[str] = []
     for svc in schema.services:
-        lines.append(_emit_bin_dispatch(schema, svc))
+        for m in svc.methods:
+            if m.is_stream and _get_struct(schema, m.ret_type) and m.ret_type not in names:
+                names.append(m.ret_type)
+    return names
+
+
+def _delta_streams(schema: RpcSchema) -> list[tuple[ServiceDef, MethodDef, int]]:
+    """开启 "delta[:N]" 的 STREAM 方法及其关键帧间隔"""
+    out = []
+    for svc in schema.services:
+        for m in svc.methods:
+            interval = delta_keyframe_interval(m)
+            if interval is None:
+                continue
+            if not _get_struct(schema, m.ret_type):
+                raise ValueError(f'{svc.name}.{m.name}: "delta" requires a STREAM of RPC_STRUCT, got {m.ret_type!r}')
+            out.append((svc, m, interval))
+    return out
+
+
+def _delta_struct_types(schema: RpcSchema) -> list[str]:
+    """增量流的元素 struct，按声明顺序去重"""
+    names: list[str] = []
+    for _, m, _ in _delta_streams(schema):
+        if m.ret_type not in names:
+            names.append(m.ret_type)
+    return names
+
+
+def _delta_interval_macro(svc: ServiceDef, m: MethodDef) -> str:
+    return f'{_method_to_snake(svc.name).upper()}_{_method_to_snake(m.name).upper()}_KEYFRAME_INTERVAL'
+
+
+def _emit_reflect(struct: StructDef) -> str:
+    """生成 ESPRPC_REFLECT：字段按线上顺序，LIST_MAX 字段带解码上限"""
+    fields = []
+    for f in struct.fields:
+        if not f.name:
+            continue
+        if f.max_items:
+            fields.append(f'ESPRPC_FIELD_MAX({struct.name}, {f.name}, {f.max_items})')
+        else:
+            fields.append(f'ESPRPC_FIELD({struct.name}, {f.name})')
+    lines = [f'ESPRPC_REFLECT({struct.name}']
+    for field in fields:
+        lines[-1] += ','
+        lines.append(f'    {field}')
+    lines[-1] += ')'
     return '\n'.join(lines)
 
 
+def _emit_struct_reader(schema: RpcSchema, struct: StructDef) -> str:
+    """参数 struct 的解码入口；字符串与数组分配自 arena"""
+    return '\n'.join([
+        f'static int bin_read_{struct.name}(const uint8_t **p, const uint8_t *end, {struct.name} *out, esprpc_arena_t *arena) {{',
+        f'    return esprpc::decode<{_wire(schema)}>(p, end, out, arena);',
+        f'}}',
+    ])
+
+
+def _emit_stream_writer_decl(struct_name: str) -> str:
+    return (f'size_t bin_size_{struct_name}(const {struct_name} *v);\n'
+            f'int bin_write_{struct_name}(const {struct_name} *v, uint8_t *buf, size_t buf_size);')
+
+
+def _emit_stream_writer(schema: RpcSchema, struct: StructDef) -> str:
+    """生成流元素的大小计算与序列化函数，供 impl 中 esprpc_stream_emit 使用，编码与 dispatch 响应一致"""
+    wire = _wire(schema)
+    return '\n'.join([
+        f'/** {struct.name} 的精确编码字节数 */',
+        f'size_t bin_size_{struct.name}(const {struct.name} *v) {{',
+        f'    return esprpc::size<{wire}>(*v);',
+        f'}}',
+        f'',
+        f'/** 序列化单个 {struct.name} 到 buf，返回写入字节数，失败返回 -1 */',
+        f'int bin_write_{struct.name}(const {struct.name} *v, uint8_t *buf, size_t buf_size) {{',
+        f'    uint8_t *wp = buf;',
+        f'    if (esprpc::encode<{wire}>(&wp, buf + buf_size, *v) != 0) return -1;',
+        f'    return (int)(wp - buf);',
+        f'}}',
+    ])
+
+
+def _emit_delta_writer_decl(struct_name: str) -> str:
+    return (f'size_t bin_size_{struct_name}_delta(const {struct_name} *v);\n'
+            f'int bin_write_{struct_name}_delta(esprpc_delta_t *d, const {struct_name} *v, uint8_t *buf, size_t buf_size);')
+
+
+def _emit_delta_writer(schema: RpcSchema, struct: StructDef) -> str:
+    """增量流帧编码（格式见 esprpc_delta.h），供 impl 中 esprpc_stream_emit 使用"""
+    wire = _wire(schema)
+    return '\n'.join([
+        f'/** {struct.name} 增量帧的最大编码字节数 */',
+        f'size_t bin_size_{struct.name}_delta(const {struct.name} *v) {{',
+        f'    return esprpc::delta_size<{wire}>(*v);',
+        f'}}',
+        f'',
+        f'/** 按 d 的状态编码一帧 {struct.name}（关键帧或仅变化字段），返回写入字节数，失败返回 -1 */',
+        f'int bin_write_{struct.name}_delta(esprpc_delta_t *d, const {struct.name} *v, uint8_t *buf, size_t buf_size) {{',
+        f'    uint8_t *wp = buf;',
+        f'    if (esprpc::encode_delta<{wire}>(d, &wp, buf + buf_size, *v) != 0) return -1;',
+        f'    return (int)(wp - buf);',
+        f'}}',
+    ])
+
+
 def emit_cpp_gen_header(schema: RpcSchema, rpc_h_basename: str) -> str:
-    """生成合并头文件 .rpc.gen.hpp：dispatch 声明 + impl_instance 声明"""
+    """生成合并头文件 .rpc.gen.hpp：字段反射 + dispatch 声明 + impl_instance 声明"""
     rpc_base = rpc_h_basename.replace('.rpc.hpp', '')
     guard = f'{rpc_base.upper().replace("-", "_")}_RPC_GEN_HPP'
     lines = [
         '/* Auto-generated - do not edit */',
         f'#ifndef {guard}',
         f'#define {guard}',
+        f'#include "esprpc_codec.hpp"',
         f'#include "{rpc_h_basename}"',
         f'#include <cstdint>',
         f'#include <cstddef>',
         f'',
+    ]
+    for struct in schema.structs:
+        lines.append(_emit_reflect(struct))
+        lines.append(f'')
+    for svc in schema.services:
+        for m in svc.methods:
+            page_items = paged_page_items(m)
+            if page_items is not None:
+                lines.append(f'/* {svc.name}.{m.name} 为分页列表："paged:{page_items}" */')
+                lines.append(f'#define {_page_items_macro(svc, m)} {page_items}')
+                lines.append(f'')
+    for svc, m, interval in _delta_streams(schema):
+        lines.append(f'/* {svc.name}.{m.name} 为增量流："delta:{interval}" */')
+        lines.append(f'#define {_delta_interval_macro(svc, m)} {interval}')
+        lines.append(f'')
+    lines.extend([
         f'#ifdef __cplusplus',
         f'extern "C" {{',
         f'#endif',
         f'',
-    ]
+    ])
     for svc in schema.services:
         lines.append(f'int {svc.name}_dispatch(uint16_t method_id, const uint8_t *req_buf, size_t req_len,')
-        lines.append(f'                      uint8_t **resp_buf, size_t *resp_len, void *svc_ctx);')
+        lines.append(f'                      uint8_t **resp_buf, size_t *resp_len, void *svc_ctx,')
+        lines.append(f'                      esprpc_arena_t *arena);')
         lines.append(f'')
         var_name = f'{_method_to_snake(svc.name)}_impl_instance'
         lines.append(f'extern {svc.name} {var_name};')
         lines.append(f'')
+    for struct_name in _stream_struct_types(schema):
+        lines.append(_emit_stream_writer_decl(struct_name))
+        lines.append(f'')
+    for struct_name in _delta_struct_types(schema):
+        lines.append(_emit_delta_writer_decl(struct_name))
+        lines.append(f'')
     lines.append(f'#ifdef __cplusplus')
     lines.append(f'}}')
     lines.append(f'#endif')
@@ -609,22 +532,24 @@ def emit_cpp_gen_header(schema: RpcSchema, rpc_h_basename: str) -> str:
 
 
 def emit_cpp_gen_impl(schema: RpcSchema, rpc_h_basename: str) -> str:
-    """生成合并实现 .rpc.gen.cpp：dispatch + vtable（extern impl 在 impl_user.cpp）"""
+    """生成合并实现 .rpc.gen.cpp：dispatch + vtable（extern impl 在 impl_user.cpp）；编解码由 esprpc_codec.hpp 模板完成"""
     lines = [
         '/* Auto-generated - do not edit */',
         f'#include "{rpc_h_basename.replace(".rpc.hpp", ".rpc.gen.hpp")}"',
         f'#include "esprpc.h"',
         f'#include "esprpc_service.h"',
-        f'#include "esprpc_binary.h"',
         f'#include <cstdlib>',
-        f'#include <cstring>',
         f'',
     ]
     for struct_name in sorted(_collect_struct_params(schema)):
-        struct = _get_struct(schema, struct_name)
-        if struct:
-            lines.append(_emit_parse_struct_bin(schema, struct))
-            lines.append('')
+        lines.append(_emit_struct_reader(schema, _get_struct(schema, struct_name)))
+        lines.append('')
+    for struct_name in _stream_struct_types(schema):
+        lines.append(_emit_stream_writer(schema, _get_struct(schema, struct_name)))
+        lines.append('')
+    for struct_name in _delta_struct_types(schema):
+        lines.append(_emit_delta_writer(schema, _get_struct(schema, struct_name)))
+        lines.append('')
     for svc in schema.services:
         lines.append(_emit_impl_extern_and_vtable(svc))
         lines.append(_emit_bin_dispatch(schema, svc))
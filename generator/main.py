@@ -14,7 +14,7 @@ import sys
 # 支持直接运行或作为模块
 _gen_dir = os.path.dirname(os.path.abspath(__file__))
 sys.path.insert(0, _gen_dir)
-from parser import parse_file, RpcSchema  # noqa: E402
+from parser import parse_file, RpcSchema, INT_ENCODINGS  # noqa: E402
 from ts_emitter import emit_all  # noqa: E402
 from ts_binary_emitter import emit_binary_codec, emit_transport_ws_binary, emit_transport_ble_binary, emit_transport_serial_binary  # noqa: E402
 from c_emitter import emit_cpp_gen_header, emit_cpp_gen_impl, emit_c_service_impl_user  # noqa: E402
@@ -23,6 +23,11 @@ from c_emitter import emit_cpp_gen_header, emit_cpp_gen_impl, emit_c_service_imp
 def merge_schemas(schemas: list[RpcSchema]) -> RpcSchema:
     """合并多个文件的 schema"""
     merged = RpcSchema()
+    encodings = {s.int_encoding for s in schemas}
+    if len(encodings) > 1:
+        raise ValueError(f'RPC_INT_ENCODING differs between schemas: {sorted(encodings)}')
+    if encodings:
+        merged.int_encoding = encodings.pop()
     seen_enums = set()
     seen_structs = set()
     seen_services = set()
@@ -50,6 +55,8 @@ def main():
                        help='Directory with transport.ts, transport-ws.ts to copy (default: ts/src)')
     parser.add_argument('-t', '--timeout', type=int, default=2000,
                        help='RPC call default timeout in ms (default: 2000)')
+    parser.add_argument('--int-encoding', choices=INT_ENCODINGS, default=None,
+                       help='Override RPC_INT_ENCODING for all schemas (fixed=4B LE, varint=zigzag LEB128)')
     parser.add_argument('files', nargs='+', help='.rpc.hpp files to process')
     args = parser.parse_args()
 
@@ -75,6 +82,8 @@ def main():
             continue
         try:
             schema = parse_file(f)
+            if args.int_encoding:
+                schema.int_encoding = args.int_encoding
             schemas.append((f, schema))
         except Exception as e:
             print(f'Error parsing {f}: {e}', file=sys.stderr)
@@ -23,6 +23,7 @@ class EnumDef:
 class StructField:
     type_str: str  # 原始类型字符串，如 "int", "REQUIRED(string)", "OPTIONAL(int) page"
     name: str
+    max_items: Optional[int] = None  # LIST_MAX(T, N) 的 N；type_str 规范化为 LIST(T)
 
 
 @dataclass
@@ -44,6 +45,60 @@ class MethodDef:
     params: list[MethodParam]
     options: Optional[str] = None  # RPC_METHOD_EX 的 options 字符串
     is_stream: bool = False
+    is_paged: bool = False  # PAGED(T)：ret_type 记为 LIST(T)，线上按页发送
+
+
+
+DELTA_DEFAULT_KEYFRAME_INTERVAL = 16
+
+
+def method_options(m: MethodDef) -> dict[str, Optional[str]]:
+    """RPC_METHOD_EX 的 options："timeout:5000,delta:16" -> {'timeout': '5000', 'delta': '16'}"""
+    opts: dict[str, Optional[str]] = {}
+    for part in (m.options or '').split(','):
+        part = part.strip()
+        if not part:
+            continue
+        key, sep, val = part.partition(':')
+        opts[key.strip()] = val.strip() if sep else None
+    return opts
+
+
+def delta_keyframe_interval(m: MethodDef) -> Optional[int]:
+    """STREAM 方法的 "delta[:N]" 选项：返回关键帧间隔 N（缺省 16），未开启返回 None"""
+    opts = method_options(m)
+    if 'delta' not in opts:
+        return None
+    if not m.is_stream:
+        raise ValueError(f'{m.name}: "delta" option requires a STREAM method')
+    val = opts['delta']
+    return int(val) if val else DELTA_DEFAULT_KEYFRAME_INTERVAL
+
+
+PAGED_DEFAULT_PAGE_ITEMS = 16
+
+
+def paged_page_items(m: MethodDef) -> Optional[int]:
+    """PAGED(T) 方法每页元素数（"paged:N"，缺省 16）；非分页方法返回 None"""
+    opts = method_options(m)
+    if not m.is_paged:
+        if 'paged' in opts:
+            raise ValueError(f'{m.name}: "paged" option requires a PAGED(T) return type')
+        return None
+    val = opts.get('paged')
+    n = int(val) if val else PAGED_DEFAULT_PAGE_ITEMS
+    if n < 1:
+        raise ValueError(f'{m.name}: "paged" page size must be >= 1, got {n}')
+    return n
+
+
+def fieldmask_enabled(m: MethodDef) -> bool:
+    """"fieldmask" 选项：调用方可按字段掩码只取返回 struct（或 LIST 元素）的部分顶层字段"""
+    if 'fieldmask' not in method_options(m):
+        return False
+    if m.is_stream:
+        raise ValueError(f'{m.name}: "fieldmask" option is not supported on STREAM methods')
+    return True
 
 
 @dataclass
@@ -52,11 +107,69 @@ class ServiceDef:
     methods: list[MethodDef]
 
 
+INT_ENCODINGS = ('fixed', 'varint')
+
+
 @dataclass
 class RpcSchema:
     enums: list[EnumDef] = field(default_factory=list)
     structs: list[StructDef] = field(default_factory=list)
     services: list[ServiceDef] = field(default_factory=list)
+    int_encoding: str = 'fixed'  # RPC_INT_ENCODING(...)：fixed=4B LE, varint=zigzag LEB128
+
+
+# 类型别名 -> 规范类型字符串（rpc_macros.hpp 中的 typedef）
+_TYPE_ALIASES = {
+    'map_string_string': 'MAP(string, string)',
+}
+
+
+def _split_top_level(s: str) -> list[str]:
+    """按不在括号/尖括号/字符串内的逗号切分，如 'a, MAP(string, int) b' -> ['a', 'MAP(string, int) b']"""
+    parts = []
+    depth = 0
+    in_str = False
+    cur = []
+    for c in s:
+        if c == '"':
+            in_str = not in_str
+        elif in_str:
+            pass
+        elif c in '(<':
+            depth += 1
+        elif c in ')>':
+            depth -= 1
+        if c == ',' and depth == 0 and not in_str:
+            parts.append(''.join(cur).strip())
+            cur = []
+        else:
+            cur.append(c)
+    tail = ''.join(cur).strip()
+    if tail or parts:
+        parts.append(tail)
+    return parts
+
+
+def normalize_type(type_str: str) -> str:
+    """规范化类型字符串：MAP(K,V) -> 'MAP(K, V)'，别名展开"""
+    t = type_str.strip()
+    t = _TYPE_ALIASES.get(t, t)
+    m = re.match(r'^MAP\s*\((.*)\)$', t, re.DOTALL)
+    if m:
+        kv = _split_top_level(m.group(1))
+        if len(kv) != 2 or not kv[0] or not kv[1]:
+            raise ValueError(f'MAP: expected MAP(key, value), got {type_str!r}')
+        return f'MAP({normalize_type(kv[0])}, {normalize_type(kv[1])})'
+    return t
+
+
+def map_key_value(type_str: str) -> Optional[tuple[str, str]]:
+    """MAP(K, V) -> (K, V)；非 MAP 返回 None"""
+    t = normalize_type(type_str)
+    if not t.startswith('MAP('):
+        return None
+    k, v = _split_top_level(t[4:-1])
+    return k, v
 
 
 def _parse_enum(content: str) -> Optional[EnumDef]:
@@ -113,24 +226,30 @@ def _parse_struct(content: str) -> Optional[StructDef]:
         # 类型可能含括号如 OPTIONAL(string), LIST(string)，最后一词为字段名
         mf = re.match(r'^(.+?)\s+(\w+)\s*$', line)
         if mf:
-            fields.append(StructField(type_str=mf.group(1).strip(), name=mf.group(2)))
+            type_str = mf.group(1).strip()
+            lm = re.match(r'^LIST_MAX\s*\(\s*(.+?)\s*,\s*(\d+)\s*\)$', type_str)
+            if lm:
+                fields.append(StructField(type_str=f'LIST({lm.group(1)})', name=mf.group(2),
+                                          max_items=int(lm.group(2))))
+            else:
+                fields.append(StructField(type_str=normalize_type(type_str), name=mf.group(2)))
         else:
             fields.append(StructField(type_str=line, name=''))
     return StructDef(name=name, fields=fields)
 
 
-def _parse_method_params(params_str: str) -> list[MethodParam]:
-    """解析方法参数，如 'int id' 或 'CreateUserRequest request'"""
+def _parse_method_params(parts: list[str]) -> list[MethodParam]:
+    """解析方法参数，如 ['int id', 'MAP(string, int) limits']；最后一个标识符为参数名"""
     params = []
-    for part in re.split(r',\s*(?![^<>]*>)', params_str):
+    for part in parts:
         part = part.strip()
         if not part or part == 'void':
             continue
-        tokens = part.split()
-        if len(tokens) >= 2:
-            params.append(MethodParam(type_str=tokens[0], name=tokens[-1]))
-        elif len(tokens) == 1:
-            params.append(MethodParam(type_str=tokens[0], name='arg'))
+        mp = re.match(r'^(.+?)\s*\b(\w+)$', part, re.DOTALL)
+        if mp and mp.group(1).strip():
+            params.append(MethodParam(type_str=normalize_type(mp.group(1)), name=mp.group(2)))
+        else:
+            params.append(MethodParam(type_str=normalize_type(part), name='arg'))
     return params
 
 
@@ -141,42 +260,41 @@ def _parse_service(content: str) -> Optional[ServiceDef]:
         return None
     name = m.group(1)
     body = m.group(2).strip()
-    # 收集 (start_pos, MethodDef)，最后按 start_pos 排序以保持与 struct 成员顺序一致
-    ordered: list[tuple[int, MethodDef]] = []
-
-    # RPC_METHOD(name, STREAM(Type), params)
-    for mth in re.finditer(r'RPC_METHOD\s*\(\s*(\w+)\s*,\s*STREAM\s*\(\s*(\w+)\s*\)\s*,\s*(.*?)\s*\)', body, re.DOTALL):
-        ordered.append((mth.start(), MethodDef(
-            name=mth.group(1),
-            ret_type=mth.group(2),
-            params=_parse_method_params(mth.group(3)),
-            is_stream=True
-        )))
-
-    # RPC_METHOD(name, ret_type, params) - 非 STREAM
-    for mth in re.finditer(r'RPC_METHOD\s*\(\s*(\w+)\s*,\s*(\w+)\s*,\s*(.*?)\s*\)', body, re.DOTALL):
-        if mth.group(2) == 'STREAM':
-            continue  # 已由上面处理
-        ordered.append((mth.start(), MethodDef(
-            name=mth.group(1),
-            ret_type=mth.group(2),
-            params=_parse_method_params(mth.group(3)),
-            is_stream=False
-        )))
-
-    # RPC_METHOD_EX(name, ret_type, params, "options")
-    for mth in re.finditer(r'RPC_METHOD_EX\s*\(\s*(\w+)\s*,\s*(\S+)\s*,\s*(.+?)\s*,\s*"([^"]*)"\s*\)', body, re.DOTALL):
-        params_str = mth.group(3).strip()
-        ordered.append((mth.start(), MethodDef(
-            name=mth.group(1),
-            ret_type=mth.group(2),
-            params=_parse_method_params(params_str),
-            options=mth.group(4),
-            is_stream=False
-        )))
-
-    ordered.sort(key=lambda x: x[0])
-    methods = [defn for _, defn in ordered]
+    methods = []
+
+    # RPC_METHOD(name, ret_type, params...) / RPC_METHOD_EX(name, ret_type, params, "options")
+    # 按括号配对取实参，ret_type 与参数类型可含逗号，如 MAP(string, int)
+    for mth in re.finditer(r'RPC_METHOD(_EX)?\s*\(', body):
+        close = _find_matching_paren(body, mth.end())
+        if close < 0:
+            continue
+        args = _split_top_level(body[mth.end():close])
+        if len(args) < 2:
+            continue
+        options = None
+        rest = args[2:]
+        if mth.group(1):
+            if not rest or not re.match(r'^"[^"]*"$', rest[-1]):
+                continue
+            options = rest[-1][1:-1]
+            rest = rest[:-1]
+        ret = args[1]
+        sm = re.match(r'^STREAM\s*\(\s*(\w+)\s*\)$', ret)
+        pm = re.match(r'^PAGED\s*\(\s*(\w+)\s*\)$', ret)
+        if sm:
+            ret_type = sm.group(1)
+        elif pm:
+            ret_type = f'LIST({pm.group(1)})'
+        else:
+            ret_type = normalize_type(ret)
+        methods.append(MethodDef(
+            name=args[0],
+            ret_type=ret_type,
+            params=_parse_method_params(rest),
+            options=options,
+            is_stream=bool(sm),
+            is_paged=bool(pm),
+        ))
     return ServiceDef(name=name, methods=methods)
 
 
@@ -201,6 +319,12 @@ def parse_file(path: str) -> RpcSchema:
         if s:
             schema.structs.append(s)
 
+    enc = re.search(r'RPC_INT_ENCODING\s*\(\s*(\w+)\s*\)', content)
+    if enc:
+        if enc.group(1) not in INT_ENCODINGS:
+            raise ValueError(f'RPC_INT_ENCODING: unknown mode {enc.group(1)!r}')
+        schema.int_encoding = enc.group(1)
+
     for svc in re.finditer(r'RPC_SERVICE\s*\([^)]+\)\s*.*?RPC_SERVICE_END\s*\(\s*\w+\s*\)', content, re.DOTALL):
         s = _parse_service(svc.group(0))
         if s:
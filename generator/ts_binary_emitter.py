@@ -4,9 +4,9 @@ TypeScript 二进制编解码生成器
 """
 
 try:
-    from .parser import RpcSchema, ServiceDef, MethodDef, StructDef, StructField
+    from .parser import RpcSchema, ServiceDef, MethodDef, StructDef, StructField, map_key_value, delta_keyframe_interval, fieldmask_enabled
 except ImportError:
-    from parser import RpcSchema, ServiceDef, MethodDef, StructDef, StructField
+    from parser import RpcSchema, ServiceDef, MethodDef, StructDef, StructField, map_key_value, delta_keyframe_interval, fieldmask_enabled
 
 
 def _unwrap_type(type_str: str) -> str:
@@ -33,14 +33,15 @@ def _get_struct(schema: RpcSchema, name: str) -> StructDef | None:
 
 
 def _is_string_type(type_str: str) -> bool:
-    return _unwrap_type(type_str) == 'string'
+    """string 与 strview 线上编码相同，TS 端均为 string"""
+    return _unwrap_type(type_str) in ('string', 'strview')
 
 
 def _is_struct_param(type_str: str, schema: RpcSchema) -> bool:
     t = type_str.strip()
     if t.startswith('LIST(') or t.startswith('STREAM(') or t.startswith('OPTIONAL('):
         inner = _unwrap_type(t)
-        if _c_primitive(inner) or inner == 'string':
+        if _c_primitive(inner) or _is_string_type(inner):
             return False
         return _get_struct(schema, inner) is not None
     return _get_struct(schema, t) is not None
@@ -52,23 +53,204 @@ def _is_enum_type(type_str: str, schema: RpcSchema) -> bool:
 
 
 def _field_is_serializable(type_str: str) -> bool:
-    """LIST 已支持序列化，MAP 已移除"""
+    """LIST、MAP 均已支持序列化"""
     return True
 
 
+def _map_kv(schema: RpcSchema, type_str: str) -> tuple[str, str] | None:
+    """MAP(K, V) -> (K, V)；TS 端映射为 Record，键限 string/strview/32 位整数/enum"""
+    kv = map_key_value(type_str)
+    if not kv:
+        return None
+    k, v = kv
+    if not (k in ('string', 'strview', 'int', 'int32', 'uint32') or _is_enum_type(k, schema)):
+        raise ValueError(f'MAP key type {k!r} is not supported (string, strview, int, int32, uint32 or enum)')
+    if v.startswith(('LIST(', 'OPTIONAL(', 'MAP(')):
+        raise ValueError(f'MAP value type {v!r} is not supported')
+    return k, v
+
+
+# 定长编码: 基础类型 -> (DataView 访问器后缀, 字节数)；int/enum 走 Int32
+_TS_FIXED = {
+    'bool': ('Uint8', 1),
+    'int': ('Int32', 4),
+    'int32': ('Int32', 4),
+    'uint32': ('Uint32', 4),
+    'int64': ('BigInt64', 8),
+    'uint64': ('BigUint64', 8),
+    'float': ('Float32', 4),
+    'double': ('Float64', 8),
+}
+
+# varint 模式: 整数类型 -> (辅助函数后缀, 最大字节数)
+_TS_VARINT = {
+    'int': ('VarI32', 5),
+    'int32': ('VarI32', 5),
+    'uint32': ('VarU32', 5),
+    'int64': ('VarI64', 10),
+    'uint64': ('VarU64', 10),
+}
+
+
+def _ts_prim_key(schema: RpcSchema, base: str) -> str:
+    """enum 按 int 编码"""
+    return 'int' if _is_enum_type(base, schema) else base
+
+
+def _ts_put_prim(schema: RpcSchema, base: str, val: str, dv: str = 'dv', off: str = 'off') -> str:
+    """基础类型/enum 编码语句（整数随 RPC_INT_ENCODING 切换）"""
+    key = _ts_prim_key(schema, base)
+    if schema.int_encoding == 'varint' and key in _TS_VARINT:
+        return f'{off} = put{_TS_VARINT[key][0]}({dv}, {off}, {val});'
+    acc, size = _TS_FIXED[key]
+    if key == 'bool':
+        return f'{dv}.setUint8({off}, {val} ? 1 : 0); {off} += 1;'
+    if key in ('int', 'int32'):
+        return f'{dv}.setInt32({off}, {val} | 0, true); {off} += 4;'
+    if key == 'uint32':
+        return f'{dv}.setUint32({off}, {val} >>> 0, true); {off} += 4;'
+    if acc.startswith('Big'):
+        return f'{dv}.set{acc}({off}, BigInt({val}), true); {off} += {size};'
+    return f'{dv}.set{acc}({off}, {val}, true); {off} += {size};'
+
+
+def _ts_get_prim(schema: RpcSchema, base: str, ret: str, dv: str = 'dv', off: str = 'off') -> str:
+    """基础类型/enum 解码语句"""
+    key = _ts_prim_key(schema, base)
+    if schema.int_encoding == 'varint' and key in _TS_VARINT:
+        return f'[{ret}, {off}] = get{_TS_VARINT[key][0]}({dv}, {off});'
+    acc, size = _TS_FIXED[key]
+    if key == 'bool':
+        return f'{ret} = {dv}.getUint8({off}) !== 0; {off} += 1;'
+    return f'{ret} = {dv}.get{acc}({off}, true); {off} += {size};'
+
+
+def _ts_prim_max(schema: RpcSchema, base: str) -> int:
+    """基础类型/enum 编码的最大字节数"""
+    key = _ts_prim_key(schema, base)
+    if schema.int_encoding == 'varint' and key in _TS_VARINT:
+        return _TS_VARINT[key][1]
+    return _TS_FIXED[key][1]
+
+
+_TS_VARINT_HELPERS = [
+    "/** LEB128 / zigzag + LEB128，与 esprpc_bin_write_varint_* 一致 */",
+    "function putVarU32(dv: DataView, off: number, v: number): number {",
+    "  let u = v >>> 0;",
+    "  while (u >= 0x80) {",
+    "    dv.setUint8(off++, (u & 0x7f) | 0x80);",
+    "    u >>>= 7;",
+    "  }",
+    "  dv.setUint8(off++, u);",
+    "  return off;",
+    "}",
+    "",
+    "function putVarI32(dv: DataView, off: number, v: number): number {",
+    "  return putVarU32(dv, off, ((v | 0) << 1) ^ ((v | 0) >> 31));",
+    "}",
+    "",
+    "function getVarU32(dv: DataView, off: number): [number, number] {",
+    "  let u = 0;",
+    "  let b = 0;",
+    "  let shift = 0;",
+    "  do {",
+    "    if (shift > 28) throw new Error('varint too long');",
+    "    b = dv.getUint8(off++);",
+    "    u |= (b & 0x7f) << shift;",
+    "    shift += 7;",
+    "  } while (b & 0x80);",
+    "  return [u >>> 0, off];",
+    "}",
+    "",
+    "function getVarI32(dv: DataView, off: number): [number, number] {",
+    "  const [u, next] = getVarU32(dv, off);",
+    "  return [(u >>> 1) ^ -(u & 1), next];",
+    "}",
+    "",
+    "function putVarU64(dv: DataView, off: number, v: bigint | number): number {",
+    "  let u = BigInt.asUintN(64, BigInt(v));",
+    "  while (u >= 0x80n) {",
+    "    dv.setUint8(off++, Number(u & 0x7fn) | 0x80);",
+    "    u >>= 7n;",
+    "  }",
+    "  dv.setUint8(off++, Number(u));",
+    "  return off;",
+    "}",
+    "",
+    "function putVarI64(dv: DataView, off: number, v: bigint | number): number {",
+    "  const s = BigInt.asIntN(64, BigInt(v));",
+    "  return putVarU64(dv, off, (s << 1n) ^ (s >> 63n));",
+    "}",
+    "",
+    "function getVarU64(dv: DataView, off: number): [bigint, number] {",
+    "  let u = 0n;",
+    "  let b = 0;",
+    "  let shift = 0n;",
+    "  do {",
+    "    if (shift > 63n) throw new Error('varint too long');",
+    "    b = dv.getUint8(off++);",
+    "    u |= BigInt(b & 0x7f) << shift;",
+    "    shift += 7n;",
+    "  } while (b & 0x80);",
+    "  return [BigInt.asUintN(64, u), off];",
+    "}",
+    "",
+    "function getVarI64(dv: DataView, off: number): [bigint, number] {",
+    "  const [u, next] = getVarU64(dv, off);",
+    "  return [(u >> 1n) ^ -(u & 1n), next];",
+    "}",
+    "",
+]
+
+
+_TS_PAGE_CLASS = [
+    "/** 分页列表（PAGED(T)）的一页：more 为 true 时同一 invokeId 还有后续页，传输层拼成 { items, len } 后 resolve；",
+    " *  aborted 为 true 时设备中途放弃了调用（本页为空且是最后一页），传输层以错误 reject */",
+    "export class RpcPage<T = unknown> {",
+    "  readonly items: T[];",
+    "  readonly more: boolean;",
+    "  readonly aborted: boolean;",
+    "  constructor(items: T[], more: boolean, aborted = false) {",
+    "    this.items = items;",
+    "    this.more = more;",
+    "    this.aborted = aborted;",
+    "  }",
+    "}",
+    "",
+]
+
+
+_TS_FIELDMASK_HELPER = [
+    "/** \"fieldmask\" 方法的请求掩码：names 为 struct 字段的声明顺序，fields 缺省时请求全部字段 */",
+    "function fieldMask(fields: readonly string[] | undefined, names: readonly string[]): Uint8Array {",
+    "  const mask = new Uint8Array((names.length + 7) >> 3);",
+    "  names.forEach((name, i) => {",
+    "    if (!fields || fields.includes(name)) mask[i >> 3] |= 1 << (i & 7);",
+    "  });",
+    "  return mask;",
+    "}",
+    "",
+]
+
+
 def _emit_encode_value(schema: RpcSchema, type_str: str, val_expr: str, out_var: str) -> list[str]:
     """生成编码单个值的代码，追加到 out_var (DataView)"""
     lines = []
     base = _unwrap_type(type_str)
     is_opt = type_str.strip().startswith('OPTIONAL(')
+    kv = _map_kv(schema, type_str)
+    if kv:
+        return _emit_encode_map(schema, kv, val_expr)
     if type_str.strip().startswith('LIST('):
-        # LIST(T): [4B count][elem0][elem1]...
+        # LIST(T): [4B count][elem0][elem1]...，独立块避免多个 LIST 字段的 _list 重复声明
+        lines.append(f'  {{')
         lines.append(f'  const _list = {val_expr} ?? [];')
         lines.append(f'  dv.setUint32(off, _list.length, true); off += 4;')
         lines.append(f'  for (let i = 0; i < _list.length; i++) {{')
         for line in _emit_encode_value_inner(schema, base, '_list[i]', 'dv', 'off', indent=1):
             lines.append(f'    {line}')
         lines.append(f'  }}')
+        lines.append(f'  }}')
         return lines
     if is_opt:
         lines.append(f'  if ({val_expr} !== undefined && {val_expr} !== null) {{')
@@ -83,15 +265,41 @@ def _emit_encode_value(schema: RpcSchema, type_str: str, val_expr: str, out_var:
     return _emit_encode_value_inner(schema, base, val_expr, 'dv', 'off', indent=0)
 
 
+def _emit_encode_map(schema: RpcSchema, kv: tuple[str, str], val_expr: str) -> list[str]:
+    """MAP(K, V): [4B count][k0][v0][k1][v1]...，按 Object.entries 顺序写出"""
+    k, v = kv
+    lines = [
+        f'  {{',
+        f'  const _entries = Object.entries({val_expr} ?? {{}});',
+        f'  ensure(4); dv.setUint32(off, _entries.length, true); off += 4;',
+        f'  for (const [_k, _v] of _entries) {{',
+    ]
+    if _is_string_type(k):
+        lines.append(f'    const _kb = new TextEncoder().encode(_k);')
+        lines.append(f'    ensure(2 + _kb.length); dv.setUint16(off, _kb.length, true); off += 2;')
+        lines.append(f'    new Uint8Array(dv.buffer).set(_kb, off); off += _kb.length;')
+    else:
+        lines.append(f'    ensure({_ts_prim_max(schema, k)}); {_ts_put_prim(schema, k, "Number(_k)")}')
+    if _is_string_type(v):
+        lines.append(f'    const _vb = new TextEncoder().encode((_v as string) ?? "");')
+        lines.append(f'    ensure(2 + _vb.length); dv.setUint16(off, _vb.length, true); off += 2;')
+        lines.append(f'    new Uint8Array(dv.buffer).set(_vb, off); off += _vb.length;')
+    elif _c_primitive(v) or _is_enum_type(v, schema):
+        lines.append(f'    ensure({_ts_prim_max(schema, v)}); {_ts_put_prim(schema, v, "(_v as any)")}')
+    else:
+        for line in _emit_encode_value_inner(schema, v, '(_v as any)', 'dv', 'off', indent=2):
+            lines.append(line)
+    lines.append(f'  }}')
+    lines.append(f'  }}')
+    return lines
+
+
 def _emit_encode_value_inner(schema: RpcSchema, base: str, val_expr: str, dv: str, off: str, indent: int = 0) -> list[str]:
     pad = '  ' * indent
     lines = []
     if _c_primitive(base) or _is_enum_type(base, schema):
-        if base == 'bool':
-            lines.append(f'{pad}{dv}.setUint8({off}, {val_expr} ? 1 : 0); {off} += 1;')
-        else:
-            lines.append(f'{pad}{dv}.setInt32({off}, {val_expr} | 0, true); {off} += 4;')
-    elif base == 'string':
+        lines.append(f'{pad}{_ts_put_prim(schema, base, val_expr, dv, off)}')
+    elif _is_string_type(base):
         lines.append(f'{pad}const _s = {val_expr} ?? "";')
         lines.append(f'{pad}const _sb = new TextEncoder().encode(_s);')
         lines.append(f'{pad}{dv}.setUint16({off}, _sb.length, true); {off} += 2;')
@@ -113,8 +321,27 @@ def _emit_decode_value(schema: RpcSchema, type_str: str, ret_var: str, dv: str,
     lines = []
     base = _unwrap_type(type_str)
     is_opt = type_str.strip().startswith('OPTIONAL(')
+    kv = _map_kv(schema, type_str)
+    if kv:
+        # MAP(K, V): [4B count][k0][v0]...，键值各自一个块以免临时变量重名
+        lines.append(f'  {{')
+        lines.append(f'  const _count = dv.getUint32(off, true); off += 4;')
+        lines.append(f'  {ret_var} = {{}};')
+        lines.append(f'  for (let i = 0; i < _count; i++) {{')
+        lines.append(f'    let _key: any;')
+        lines.append(f'    let _val: any;')
+        for var, t in (('_key', kv[0]), ('_val', kv[1])):
+            lines.append(f'    {{')
+            for line in _emit_decode_value_inner(schema, t, var, dv, off):
+                lines.append(f'    {line}')
+            lines.append(f'    }}')
+        lines.append(f'    {ret_var}[_key] = _val;')
+        lines.append(f'  }}')
+        lines.append(f'  }}')
+        return lines
     if type_str.strip().startswith('LIST('):
         # LIST(T): [4B count][elem0][elem1]...
+        lines.append(f'  {{')
         lines.append(f'  const _count = dv.getUint32(off, true); off += 4;')
         lines.append(f'  {ret_var} = [];')
         lines.append(f'  for (let i = 0; i < _count; i++) {{')
@@ -123,6 +350,7 @@ def _emit_decode_value(schema: RpcSchema, type_str: str, ret_var: str, dv: str,
             lines.append(f'    {line}')
         lines.append(f'    {ret_var}.push(_item);')
         lines.append(f'  }}')
+        lines.append(f'  }}')
         return lines
     if is_opt:
         lines.append(f'  const _present = {dv}.getUint8({off}); {off} += 1;')
@@ -139,11 +367,8 @@ def _emit_decode_value(schema: RpcSchema, type_str: str, ret_var: str, dv: str,
 def _emit_decode_value_inner(schema: RpcSchema, base: str, ret_var: str, dv: str, off: str, in_opt: bool = False) -> list[str]:
     lines = []
     if _c_primitive(base) or _is_enum_type(base, schema):
-        if base == 'bool':
-            lines.append(f'{ret_var} = {dv}.getUint8({off}) !== 0; {off} += 1;')
-        else:
-            lines.append(f'{ret_var} = {dv}.getInt32({off}, true); {off} += 4;')
-    elif base == 'string':
+        lines.append(_ts_get_prim(schema, base, ret_var, dv, off))
+    elif _is_string_type(base):
         lines.append(f'const _len = {dv}.getUint16({off}, true); {off} += 2;')
         lines.append(f'{ret_var} = new TextDecoder().decode(new Uint8Array({dv}.buffer, {dv}.byteOffset + {off}, _len)); {off} += _len;')
     else:
@@ -198,21 +423,28 @@ def _emit_encode_request_method(schema: RpcSchema, svc: ServiceDef, m: MethodDef
     lines.append(f'          buf = newBuf; dv = new DataView(buf);')
     lines.append(f'        }}')
     lines.append(f'      }};')
+    masked = _fieldmask_struct(schema, m)
+    if masked:
+        names = ', '.join(f"'{f.name}'" for f in masked.fields if f.name)
+        lines.append(f'      const _fm = fieldMask(args[{len(m.params)}], [{names}]);')
+        lines.append(f'      ensure(_fm.length); new Uint8Array(buf).set(_fm, off); off += _fm.length;')
     for i, p in enumerate(m.params):
         base = _unwrap_type(p.type_str)
         arg_expr = f'args[{i}]'
-        if _c_primitive(p.type_str):
-            if p.type_str.strip() == 'bool':
-                lines.append(f'      ensure(1); dv.setUint8(off, {arg_expr} ? 1 : 0); off += 1;')
-            else:
-                lines.append(f'      ensure(4); dv.setInt32(off, {arg_expr} | 0, true); off += 4;')
-        elif p.type_str.strip() == 'bool':
-            lines.append(f'      ensure(1); dv.setUint8(off, {arg_expr} ? 1 : 0); off += 1;')
-        elif p.type_str.strip().startswith('OPTIONAL(') and _c_primitive(base):
+        if _c_primitive(p.type_str) or _is_enum_type(p.type_str, schema) and not p.type_str.strip().startswith('OPTIONAL('):
+            lines.append(f'      ensure({_ts_prim_max(schema, base)}); {_ts_put_prim(schema, base, arg_expr)}')
+        elif p.type_str.strip().startswith('OPTIONAL(') and (_c_primitive(base) or _is_enum_type(base, schema)):
             lines.append(f'      ensure(1);')
             lines.append(f'      if ({arg_expr} !== undefined && {arg_expr} !== null) {{')
-            lines.append(f'        dv.setUint8(off, 1); off += 1; ensure(4); dv.setInt32(off, {arg_expr} | 0, true); off += 4;')
+            lines.append(f'        dv.setUint8(off, 1); off += 1; ensure({_ts_prim_max(schema, base)}); {_ts_put_prim(schema, base, arg_expr)}')
             lines.append(f'      }} else {{ dv.setUint8(off, 0); off += 1; }}')
+        elif map_key_value(p.type_str):
+            for line in _emit_encode_value(schema, p.type_str, arg_expr, ''):
+                lines.append(f'      {line}')
+        elif p.type_str.strip() == 'strview':
+            lines.append(f'      const _sb{i} = new TextEncoder().encode({arg_expr} ?? "");')
+            lines.append(f'      ensure(2 + _sb{i}.length); dv.setUint16(off, _sb{i}.length, true); off += 2;')
+            lines.append(f'      new Uint8Array(buf).set(_sb{i}, off); off += _sb{i}.length;')
         elif _is_struct_param(p.type_str, schema):
             struct = _get_struct(schema, base)
             if struct:
@@ -236,14 +468,15 @@ def _emit_encode_request_method(schema: RpcSchema, svc: ServiceDef, m: MethodDef
                             lines.append(f'      new Uint8Array(buf).set(_sb{f.name}, off); off += _sb{f.name}.length;')
                     elif _c_primitive(_unwrap_type(f.type_str)) or _is_enum_type(f.type_str, schema):
                         is_opt = f.type_str.strip().startswith('OPTIONAL(')
+                        f_base = _unwrap_type(f.type_str)
                         if is_opt:
                             lines.append(f'      ensure(1);')
                             lines.append(f'      if ({f_val} !== undefined && {f_val} !== null) {{')
-                            lines.append(f'        dv.setUint8(off, 1); off += 1; ensure(4); dv.setInt32(off, {f_val} | 0, true); off += 4;')
+                            lines.append(f'        dv.setUint8(off, 1); off += 1; ensure({_ts_prim_max(schema, f_base)}); {_ts_put_prim(schema, f_base, f_val)}')
                             lines.append(f'      }} else {{ dv.setUint8(off, 0); off += 1; }}')
                         else:
-                            lines.append(f'      ensure(4); dv.setInt32(off, {f_val} | 0, true); off += 4;')
-                    elif f.type_str.strip().startswith('LIST('):
+                            lines.append(f'      ensure({_ts_prim_max(schema, f_base)}); {_ts_put_prim(schema, f_base, f_val)}')
+                    elif f.type_str.strip().startswith('LIST(') or map_key_value(f.type_str):
                         for line in _emit_encode_value(schema, f.type_str, f_val, ''):
                             lines.append(f'      {line}')
     lines.append(f'      return new Uint8Array(buf, 0, off);')
@@ -251,16 +484,102 @@ def _emit_encode_request_method(schema: RpcSchema, svc: ServiceDef, m: MethodDef
     return lines
 
 
+def _emit_field_block(schema: RpcSchema, f: StructField, head: str, pad: str = '        ') -> list[str]:
+    """解码单个字段到 result.<name>，包在一个块里：_len/_present 等临时变量不重名；统一缩进到块内"""
+    body = _emit_decode_value(schema, f.type_str, f'result.{f.name}', 'dv', 'off')
+    strip = min(len(b) - len(b.lstrip()) for b in body if b.strip())
+    return [f'{pad}{head}{{'] + [f'{pad}  {b[strip:]}' for b in body] + [f'{pad}}}']
+
+
+def _emit_decode_delta_stream(schema: RpcSchema, struct: StructDef, method_id: int) -> list[str]:
+    """增量流帧 [1B flags][1B seq][bitmap][字段]（见 esprpc_delta.h）：与上一帧合并为完整对象；
+    无基准或序号不连续时返回 undefined，等待下一个关键帧"""
+    fields = [f for f in struct.fields if f.name]
+    bitmap_size = (len(fields) + 7) // 8
+
+    def field_block(f: StructField, head: str) -> list[str]:
+        return _emit_field_block(schema, f, head)
+
+    lines = [
+        f'      const _flags = dv.getUint8(off); off += 1;',
+        f'      const _seq = dv.getUint8(off); off += 1;',
+        f'      const _base = _deltaBase.get({method_id});',
+        f'      const result: any = {{}};',
+        f'      if (_flags & 1) {{',
+    ]
+    for f in fields:
+        lines.extend(field_block(f, ''))
+    lines.append(f'      }} else {{')
+    lines.append(f'        if (!_base || _base.seq !== _seq) {{ _deltaBase.delete({method_id}); return undefined as T; }}')
+    lines.append(f'        const _bm = payload.subarray(off, off + {bitmap_size}); off += {bitmap_size};')
+    lines.append(f'        Object.assign(result, _base.value);')
+    for i, f in enumerate(fields):
+        lines.extend(field_block(f, f'if (_bm[{i // 8}] & {1 << (i % 8)}) '))
+    lines.append(f'      }}')
+    lines.append(f'      _deltaBase.set({method_id}, {{ seq: (_seq + 1) & 0xff, value: result }});')
+    lines.append(f'      return result;')
+    return lines
+
+
+def _fieldmask_struct(schema: RpcSchema, m: MethodDef) -> StructDef | None:
+    """"fieldmask" 方法的掩码 struct（返回 struct 或 LIST 元素）；校验由 c_emitter 完成"""
+    if not fieldmask_enabled(m):
+        return None
+    return _get_struct(schema, _unwrap_type(m.ret_type))
+
+
+def _emit_decode_masked(schema: RpcSchema, struct: StructDef, is_list: bool,
+                        list_ret: str = 'return { items, len: items.length };') -> list[str]:
+    """掩码响应 [bitmap][值]：只解码掩码中置位的字段，其余字段不出现在结果对象中"""
+    fields = [f for f in struct.fields if f.name]
+    bitmap_size = (len(fields) + 7) // 8
+    lines = [f'      const _fm = payload.subarray(off, off + {bitmap_size}); off += {bitmap_size};']
+    pad = '        '
+    if is_list:
+        lines.append(f'      const count = dv.getUint32(off, true); off += 4;')
+        lines.append(f'      const items: any[] = [];')
+        lines.append(f'      for (let i = 0; i < count; i++) {{')
+        pad = '          '
+        lines.append(f'{pad[:-2]}const result: any = {{}};')
+    else:
+        lines.append(f'      const result: any = {{}};')
+    for i, f in enumerate(fields):
+        lines.extend(_emit_field_block(schema, f, f'if (_fm[{i // 8}] & {1 << (i % 8)}) ', pad[:-2]))
+    if is_list:
+        lines.append(f'        items.push(result);')
+        lines.append(f'      }}')
+        lines.append(f'      {list_ret}')
+    else:
+        lines.append(f'      return result;')
+    return lines
+
+
 def _emit_decode_response_method(schema: RpcSchema, svc: ServiceDef, m: MethodDef, method_id: int) -> list[str]:
     """生成单个方法的响应解码分支"""
     lines = []
     lines.append(f'    if (methodId === {method_id}) {{')
     lines.append(f'      const dv = new DataView(payload.buffer, payload.byteOffset, payload.byteLength);')
     lines.append(f'      let off = 0;')
-    if m.ret_type in ('void', 'VOID'):
+    list_ret = 'return { items, len: items.length };'
+    if m.is_paged:
+        # PAGED(T)：每页 [1B flags][LIST 编码]，由传输层按 invokeId 拼成完整列表
+        lines.append(f'      const _pageFlags = dv.getUint8(off); off += 1;')
+        list_ret = 'return new RpcPage(items, (_pageFlags & 1) !== 0, (_pageFlags & 2) !== 0) as T;'
+    if delta_keyframe_interval(m) is not None and _get_struct(schema, m.ret_type):
+        lines.extend(_emit_decode_delta_stream(schema, _get_struct(schema, m.ret_type), method_id))
+    elif _fieldmask_struct(schema, m):
+        lines.extend(_emit_decode_masked(schema, _fieldmask_struct(schema, m), m.ret_type.startswith('LIST('), list_ret))
+    elif m.ret_type in ('void', 'VOID'):
         lines.append(f'      return undefined;')
-    elif m.ret_type == 'bool':
-        lines.append(f'      return dv.getUint8(off) !== 0;')
+    elif _c_primitive(m.ret_type) or _is_enum_type(m.ret_type, schema):
+        lines.append(f'      let ret: any;')
+        lines.append(f'      {_ts_get_prim(schema, m.ret_type, "ret")}')
+        lines.append(f'      return ret;')
+    elif map_key_value(m.ret_type):
+        lines.append(f'      let ret: any;')
+        for line in _emit_decode_value(schema, m.ret_type, 'ret', 'dv', 'off'):
+            lines.append(f'    {line}')
+        lines.append(f'      return ret;')
     elif m.ret_type.startswith('LIST('):
         elem_type = _unwrap_type(m.ret_type)
         elem_struct = _get_struct(schema, elem_type)
@@ -273,7 +592,7 @@ def _emit_decode_response_method(schema: RpcSchema, svc: ServiceDef, m: MethodDe
                 if not f.name or not _field_is_serializable(f.type_str):
                     continue
                 f_ret = 'item.' + f.name
-                if f.type_str.strip().startswith('LIST('):
+                if f.type_str.strip().startswith('LIST(') or map_key_value(f.type_str):
                     for line in _emit_decode_value(schema, f.type_str, f_ret, 'dv', 'off'):
                         lines.append(f'        {line}')
                 elif _is_string_type(f.type_str):
@@ -289,12 +608,12 @@ def _emit_decode_response_method(schema: RpcSchema, svc: ServiceDef, m: MethodDe
                     is_opt = f.type_str.strip().startswith('OPTIONAL(')
                     if is_opt:
                         lines.append(f'        const _p{f.name} = dv.getUint8(off); off += 1;')
-                        lines.append(f'        if (_p{f.name}) {{ {f_ret} = dv.getInt32(off, true); off += 4; }}')
+                        lines.append(f'        if (_p{f.name}) {{ {_ts_get_prim(schema, _unwrap_type(f.type_str), f_ret)} }}')
                     else:
-                        lines.append(f'        {f_ret} = dv.getInt32(off, true); off += 4;')
+                        lines.append(f'        {_ts_get_prim(schema, _unwrap_type(f.type_str), f_ret)}')
             lines.append(f'        items.push(item);')
             lines.append(f'      }}')
-        lines.append(f'      return {{ items, len: items.length }};')
+        lines.append(f'      {list_ret}')
     else:
         ret_struct = _get_struct(schema, m.ret_type)
         if ret_struct:
@@ -305,7 +624,7 @@ def _emit_decode_response_method(schema: RpcSchema, svc: ServiceDef, m: MethodDe
                 f_ret = 'result.' + f.name
                 base = _unwrap_type(f.type_str)
                 is_opt = f.type_str.strip().startswith('OPTIONAL(')
-                if f.type_str.strip().startswith('LIST('):
+                if f.type_str.strip().startswith('LIST(') or map_key_value(f.type_str):
                     for line in _emit_decode_value(schema, f.type_str, f_ret, 'dv', 'off'):
                         lines.append(f'      {line}')
                 elif _is_string_type(f.type_str):
@@ -319,9 +638,9 @@ def _emit_decode_response_method(schema: RpcSchema, svc: ServiceDef, m: MethodDe
                 elif _c_primitive(base) or _is_enum_type(f.type_str, schema):
                     if is_opt:
                         lines.append(f'      const _p{f.name} = dv.getUint8(off); off += 1;')
-                        lines.append(f'      if (_p{f.name}) {{ {f_ret} = dv.getInt32(off, true); off += 4; }}')
+                        lines.append(f'      if (_p{f.name}) {{ {_ts_get_prim(schema, base, f_ret)} }}')
                     else:
-                        lines.append(f'      {f_ret} = dv.getInt32(off, true); off += 4;')
+                        lines.append(f'      {_ts_get_prim(schema, base, f_ret)}')
             lines.append(f'      return result;')
         else:
             lines.append(f'      return undefined;')
@@ -339,6 +658,11 @@ def emit_binary_codec(schema: RpcSchema, types_path: str = './rpc_types') -> str
     if struct_names:
         lines.append(f"import type {{ {', '.join(struct_names)} }} from '{types_path}';")
         lines.append("")
+    if schema.int_encoding == 'varint':
+        lines.extend(_TS_VARINT_HELPERS)
+    if any(fieldmask_enabled(m) for svc in schema.services for m in svc.methods):
+        lines.extend(_TS_FIELDMASK_HELPER)
+    lines.extend(_TS_PAGE_CLASS)
     lines.extend([
         "export function encodeRequest(methodId: number, args: IArguments | unknown[]): Uint8Array {",
         "  const argsOrArray = args.length !== undefined ? Array.from(args as IArguments) : (args as unknown[]);",
@@ -349,13 +673,17 @@ def emit_binary_codec(schema: RpcSchema, types_path: str = './rpc_types') -> str
             method_id = (svc_idx << 4) | mth_idx
             if m.is_stream:
                 lines.append(f'  if (methodId === {method_id}) return new Uint8Array(0);')
-            elif not m.params:
+            elif not m.params and not fieldmask_enabled(m):
                 lines.append(f'  if (methodId === {method_id}) return new Uint8Array(0);')
             else:
                 lines.extend(_emit_encode_request_method(schema, svc, m, method_id))
     lines.append("  throw new Error(`Unknown methodId: ${methodId}`);")
     lines.append("}")
     lines.append("")
+    if any(delta_keyframe_interval(m) is not None for svc in schema.services for m in svc.methods):
+        lines.append("/** 增量流（\"delta\"）每个 methodId 的上一帧完整对象与期望的下一帧序号 */")
+        lines.append("const _deltaBase = new Map<number, { seq: number; value: any }>();")
+        lines.append("")
     lines.append("export function decodeResponse<T = unknown>(methodId: number, payload: Uint8Array): T {")
     lines.append("")
     for svc_idx, svc in enumerate(schema.services):
@@ -375,7 +703,7 @@ def emit_transport_ws_binary(schema: RpcSchema, codec_path: str = './rpc_binary_
  */
 
 import type {{ EsprpcTransport }} from './transport';
-import {{ encodeRequest, decodeResponse }} from '{codec_path}';
+import {{ encodeRequest, decodeResponse, RpcPage }} from '{codec_path}';
 
 function closeCodeMessage(code: number): string {{
   const map: Record<number, string> = {{
@@ -391,11 +719,11 @@ function closeCodeMessage(code: number): string {{
 export function createWebSocketTransport(url: string): EsprpcTransport {{
   let ws: WebSocket | null = null;
   let invokeIdCounter = 1;
-  const pending = new Map<number, {{ resolve: (v: unknown) => void; reject: (e: Error) => void; timeoutId: ReturnType<typeof setTimeout> }}>();
+  const pending = new Map<number, {{ resolve: (v: unknown) => void; reject: (e: Error) => void; rearm: () => void; pages: unknown[]; onPage?: (items: unknown[]) => void }}>();
   const streamSubs = new Map<number, (data: unknown) => void>();
 
   return {{
-    async call<T = unknown>(methodId: number, args: IArguments, options?: {{ timeout?: number }}): Promise<T> {{
+    async call<T = unknown>(methodId: number, args: IArguments, options?: {{ timeout?: number; onPage?: (items: unknown[]) => void }}): Promise<T> {{
       return new Promise((resolve, reject) => {{
         if (!ws || ws.readyState !== WebSocket.OPEN) {{
           reject(new Error('Not connected'));
@@ -404,17 +732,20 @@ export function createWebSocketTransport(url: string): EsprpcTransport {{
         const invokeId = invokeIdCounter++;
         if (invokeIdCounter > 0xfffe) invokeIdCounter = 1;
         const timeoutMs = options?.timeout ?? {default_timeout_ms};
-        const timeoutId = setTimeout(() => {{
+        const expire = () => {{
           const h = pending.get(invokeId);
           if (h) {{
             pending.delete(invokeId);
             reject(new Error(`RPC 超时 (${{timeoutMs}}ms)`));
           }}
-        }}, timeoutMs);
+        }};
+        let timeoutId = setTimeout(expire, timeoutMs);
         pending.set(invokeId, {{
           resolve: (v) => {{ clearTimeout(timeoutId); (resolve as (v: unknown) => void)(v); }},
           reject: (e) => {{ clearTimeout(timeoutId); reject(e); }},
-          timeoutId,
+          rearm: () => {{ clearTimeout(timeoutId); timeoutId = setTimeout(expire, timeoutMs); }},
+          pages: [],
+          onPage: options?.onPage,
         }});
         const payload = encodeRequest(methodId, args);
         const frame = new Uint8Array(5 + payload.length);
@@ -484,20 +815,32 @@ export function createWebSocketTransport(url: string): EsprpcTransport {{
           const result = decodeResponse(methodId, payload);
           if (invokeId !== 0) {{
             const h = pending.get(invokeId);
-            if (h) {{
+            if (h && result instanceof RpcPage && result.aborted) {{
+              pending.delete(invokeId);
+              h.reject(new Error('RPC 分页响应被设备中止'));
+            }} else if (h && result instanceof RpcPage) {{
+              h.onPage?.(result.items);
+              h.pages.push(...result.items);
+              if (result.more) {{
+                h.rearm();  /* 每收到一页重新计时 */
+              }} else {{
+                pending.delete(invokeId);
+                h.resolve({{ items: h.pages, len: h.pages.length }});
+              }}
+            }} else if (h) {{
               pending.delete(invokeId);
               h.resolve(result);
             }}
           }} else {{
             const cb = streamSubs.get(methodId);
-            if (cb) cb(result);
+            if (cb && result !== undefined) cb(result);
           }}
         }} catch (_) {{}}
       }};
     }},
     disconnect(): void {{
       if (ws) {{ ws.close(); ws = null; }}
-      pending.forEach((h) => {{ clearTimeout(h.timeoutId); h.reject(new Error('Disconnected')); }});
+      pending.forEach((h) => {{ h.reject(new Error('Disconnected')); }});
       pending.clear();
     }},
     }};
@@ -513,31 +856,72 @@ def emit_transport_ble_binary(schema: RpcSchema, codec_path: str = './rpc_binary
  * BLE 传输实现（Web Bluetooth API，二进制协议）
  *
  * 服务 UUID: 0000E530-1212-EFDE-1523-785FEABCD123
- * TX 特征 (写): 0000E531-...  RX 特征 (通知): 0000E532-...
+ * TX 特征 (写): 0000E531-...  RX 特征 (通知): 0000E532-...，读取得到设备端的 ATT MTU
+ *
+ * 分段（与 transport_ble.c 一致）：每次写/通知为 [1B 段头][帧的一段]，段头 bit7=后面还有段，
+ * bit0-6=段序号（首段为 0），每段不超过 ATT MTU - 3 字节。
  */
 
 import type {{ EsprpcTransport }} from './transport';
-import {{ encodeRequest, decodeResponse }} from '{codec_path}';
+import {{ encodeRequest, decodeResponse, RpcPage }} from '{codec_path}';
 
 const ESPRPC_SERVICE_UUID = '0000e530-1212-efde-1523-785feabcd123';
 const ESPRPC_CHR_TX_UUID = '0000e531-1212-efde-1523-785feabcd123';
 const ESPRPC_CHR_RX_UUID = '0000e532-1212-efde-1523-785feabcd123';
+const SEG_MORE = 0x80;
+const SEG_SEQ_MASK = 0x7f;
 
 export function createBleTransport(): EsprpcTransport {{
   let device: BluetoothDevice | null = null;
   let txChar: BluetoothRemoteGATTCharacteristic | null = null;
   let rxChar: BluetoothRemoteGATTCharacteristic | null = null;
   let invokeIdCounter = 1;
-  const pending = new Map<number, {{ resolve: (v: unknown) => void; reject: (e: Error) => void; timeoutId: ReturnType<typeof setTimeout> }}>();
+  const pending = new Map<number, {{ resolve: (v: unknown) => void; reject: (e: Error) => void; rearm: () => void; pages: unknown[]; onPage?: (items: unknown[]) => void }}>();
   const streamSubs = new Map<number, (data: unknown) => void>();
+  let segSize = 20;  /* 每段属性值字节数（含段头）= ATT MTU - 3，连接后从 RX 特征读取 */
+  let writeChain: Promise<void> = Promise.resolve();  /* Web Bluetooth 不允许并发写，逐段串行 */
+  let rxParts: Uint8Array[] | null = null;
+  let rxSeq = 0;
 
   function sendFrame(frame: Uint8Array): void {{
     if (!txChar) return;
-    txChar.writeValueWithoutResponse(frame);
+    const chunk = segSize - 1;
+    for (let off = 0, seq = 0; off < frame.length; off += chunk, seq++) {{
+      const end = Math.min(off + chunk, frame.length);
+      const seg = new Uint8Array(1 + end - off);
+      seg[0] = (seq & SEG_SEQ_MASK) | (end < frame.length ? SEG_MORE : 0);
+      seg.set(frame.subarray(off, end), 1);
+      writeChain = writeChain.then(() => txChar?.writeValueWithoutResponse(seg)).catch(() => {{}});
+    }}
+  }}
+
+  /** 拼接一个通知段，拼满整帧后返回，否则返回 null；序号不连续时丢弃当前帧 */
+  function onSegment(seg: Uint8Array): Uint8Array | null {{
+    if (seg.length < 1) return null;
+    const seq = seg[0] & SEG_SEQ_MASK;
+    if (seq === 0) {{
+      rxParts = [];
+    }} else if (!rxParts || seq !== rxSeq) {{
+      rxParts = null;
+      return null;
+    }}
+    rxParts.push(seg.slice(1));
+    rxSeq = (seq + 1) & SEG_SEQ_MASK;
+    if (seg[0] & SEG_MORE) return null;
+    const parts = rxParts;
+    rxParts = null;
+    if (parts.length === 1) return parts[0];
+    const frame = new Uint8Array(parts.reduce((n, p) => n + p.length, 0));
+    let off = 0;
+    for (const p of parts) {{
+      frame.set(p, off);
+      off += p.length;
+    }}
+    return frame;
   }}
 
   return {{
-    async call<T = unknown>(methodId: number, args: IArguments, options?: {{ timeout?: number }}): Promise<T> {{
+    async call<T = unknown>(methodId: number, args: IArguments, options?: {{ timeout?: number; onPage?: (items: unknown[]) => void }}): Promise<T> {{
       return new Promise((resolve, reject) => {{
         if (!txChar) {{
           reject(new Error('Not connected'));
@@ -546,17 +930,20 @@ export function createBleTransport(): EsprpcTransport {{
         const invokeId = invokeIdCounter++;
         if (invokeIdCounter > 0xfffe) invokeIdCounter = 1;
         const timeoutMs = options?.timeout ?? {default_timeout_ms};
-        const timeoutId = setTimeout(() => {{
+        const expire = () => {{
           const h = pending.get(invokeId);
           if (h) {{
             pending.delete(invokeId);
             reject(new Error(`RPC 超时 (${{timeoutMs}}ms)`));
           }}
-        }}, timeoutMs);
+        }};
+        let timeoutId = setTimeout(expire, timeoutMs);
         pending.set(invokeId, {{
           resolve: (v) => {{ clearTimeout(timeoutId); (resolve as (v: unknown) => void)(v); }},
           reject: (e) => {{ clearTimeout(timeoutId); reject(e); }},
-          timeoutId,
+          rearm: () => {{ clearTimeout(timeoutId); timeoutId = setTimeout(expire, timeoutMs); }},
+          pages: [],
+          onPage: options?.onPage,
         }});
         const payload = encodeRequest(methodId, args);
         const frame = new Uint8Array(5 + payload.length);
@@ -599,13 +986,20 @@ export function createBleTransport(): EsprpcTransport {{
       const service = await server.getPrimaryService(ESPRPC_SERVICE_UUID);
       txChar = await service.getCharacteristic(ESPRPC_CHR_TX_UUID);
       rxChar = await service.getCharacteristic(ESPRPC_CHR_RX_UUID);
+      try {{
+        const mtu = (await rxChar.readValue()).getUint16(0, true);
+        segSize = Math.min(512, Math.max(23, mtu) - 3);
+      }} catch (_) {{
+        segSize = 20;
+      }}
       await rxChar.startNotifications();
       rxChar.addEventListener('characteristicvaluechanged', (ev: Event) => {{
         const target = ev.target as BluetoothRemoteGATTCharacteristic;
         const value = target?.value;
-        if (!value || value.byteLength < 5) return;
+        if (!value) return;
         try {{
-          const data = new Uint8Array(value.buffer, value.byteOffset, value.byteLength);
+          const data = onSegment(new Uint8Array(value.buffer, value.byteOffset, value.byteLength));
+          if (!data || data.length < 5) return;
           const methodId = data[0];
           const invokeId = data[1] | (data[2] << 8);
           const payloadLen = data[3] | (data[4] << 8);
@@ -614,13 +1008,25 @@ export function createBleTransport(): EsprpcTransport {{
           const result = decodeResponse(methodId, payload);
           if (invokeId !== 0) {{
             const h = pending.get(invokeId);
-            if (h) {{
+            if (h && result instanceof RpcPage && result.aborted) {{
+              pending.delete(invokeId);
+              h.reject(new Error('RPC 分页响应被设备中止'));
+            }} else if (h && result instanceof RpcPage) {{
+              h.onPage?.(result.items);
+              h.pages.push(...result.items);
+              if (result.more) {{
+                h.rearm();  /* 每收到一页重新计时 */
+              }} else {{
+                pending.delete(invokeId);
+                h.resolve({{ items: h.pages, len: h.pages.length }});
+              }}
+            }} else if (h) {{
               pending.delete(invokeId);
               h.resolve(result);
             }}
           }} else {{
             const cb = streamSubs.get(methodId);
-            if (cb) cb(result);
+            if (cb && result !== undefined) cb(result);
           }}
         }} catch (_) {{}}
       }});
@@ -632,7 +1038,9 @@ export function createBleTransport(): EsprpcTransport {{
       device = null;
       txChar = null;
       rxChar = null;
-      pending.forEach((h) => {{ clearTimeout(h.timeoutId); h.reject(new Error('Disconnected')); }});
+      rxParts = null;
+      writeChain = Promise.resolve();
+      pending.forEach((h) => {{ h.reject(new Error('Disconnected')); }});
       pending.clear();
     }},
   }};
@@ -642,17 +1050,20 @@ export function createBleTransport(): EsprpcTransport {{
 
 def emit_transport_serial_binary(schema: RpcSchema, codec_path: str = './rpc_binary_codec',
                                 default_timeout_ms: int = 2000) -> str:
-    """生成使用二进制协议的 transport-serial.ts（Web Serial API，与 C 端串口传输帧格式一致，支持前后缀）"""
+    """生成使用二进制协议的 transport-serial.ts（Web Serial API，与 C 端串口传输帧格式一致，支持前后缀、COBS 成帧或 ARQ 可靠链路）"""
     return f'''/**
  * 串口传输实现（Web Serial API，二进制协议）
  *
  * 与 ESP32 transport_serial.c 使用相同帧格式: [1B method_id][2B invoke_id LE][2B payload_len LE][payload]
  * 若指定 prefix/suffix，收发时自动插入与剥离，与 ESP 端 Kconfig 前后缀一致即可复用串口。
+ * framing: 'cobs' 对应 ESP 端 CONFIG_ESPRPC_SERIAL_COBS：每包为 0x00 + COBS(帧 + CRC-16 LE) + 0x00，
+ * 损坏的包在下一个 0x00 处丢弃，不影响后续包。
+ * framing: 'arq' 对应 CONFIG_ESPRPC_SERIAL_ARQ：在 COBS 之上加序号、累计确认与滑动窗口重传，丢包与损坏的包自动重发。
  * 需在 HTTPS 或 localhost 下使用；用户需在浏览器弹窗中选择串口设备。
  */
 
 import type {{ EsprpcTransport }} from './transport';
-import {{ encodeRequest, decodeResponse }} from '{codec_path}';
+import {{ encodeRequest, decodeResponse, RpcPage }} from '{codec_path}';
 
 function toMarkerBytes(v: string | number[] | Uint8Array | undefined): Uint8Array {{
   if (v === undefined || v === null) return new Uint8Array(0);
@@ -661,32 +1072,310 @@ function toMarkerBytes(v: string | number[] | Uint8Array | undefined): Uint8Arra
   return new Uint8Array(v as number[]);
 }}
 
-export function createSerialTransport(options?: {{ baudRate?: number; prefix?: string | number[] | Uint8Array; suffix?: string | number[] | Uint8Array }}): EsprpcTransport {{
+export type SerialFraming = 'marker' | 'cobs' | 'arq';
+
+/** CRC-16/CCITT-FALSE（多项式 0x1021，初值 0xFFFF），与 C 端 COBS 模式一致 */
+function crc16(data: Uint8Array): number {{
+  let crc = 0xffff;
+  for (let i = 0; i < data.length; i++) {{
+    crc ^= data[i]! << 8;
+    for (let b = 0; b < 8; b++) crc = crc & 0x8000 ? ((crc << 1) ^ 0x1021) & 0xffff : (crc << 1) & 0xffff;
+  }}
+  return crc;
+}}
+
+/** 编码为 0x00 + COBS(帧 + CRC-16 LE) + 0x00 */
+function cobsEncodePacket(frame: Uint8Array): Uint8Array {{
+  const crc = crc16(frame);
+  const src = new Uint8Array(frame.length + 2);
+  src.set(frame);
+  src[frame.length] = crc & 0xff;
+  src[frame.length + 1] = crc >> 8;
+  const out = new Uint8Array(src.length + Math.floor(src.length / 254) + 3);
+  let len = 2, codePos = 1, code = 1;
+  for (let i = 0; i < src.length; i++) {{
+    const b = src[i]!;
+    if (b !== 0) {{
+      out[len++] = b;
+      if (++code !== 0xff) continue;
+    }}
+    out[codePos] = code;
+    codePos = len++;
+    code = 1;
+  }}
+  out[codePos] = code;
+  out[len++] = 0;
+  return out.subarray(0, len);
+}}
+
+/** 解码两个 0x00 之间的 COBS 包并校验 CRC，返回去掉 CRC 的内容，失败返回 null */
+function cobsDecodePacket(enc: number[]): Uint8Array | null {{
+  const out = new Uint8Array(enc.length);
+  let n = 0, i = 0;
+  while (i < enc.length) {{
+    const code = enc[i++]!;
+    if (i + code - 1 > enc.length) return null;
+    for (let k = 1; k < code; k++) out[n++] = enc[i++]!;
+    if (code !== 0xff && i < enc.length) out[n++] = 0;
+  }}
+  if (n < 3) return null;
+  const packet = out.subarray(0, n - 2);
+  if (crc16(packet) !== (out[n - 2]! | (out[n - 1]! << 8))) return null;
+  return packet;
+}}
+
+/** 帧头中的负载长度与帧长一致 */
+function rpcFrameOk(frame: Uint8Array): boolean {{
+  return frame.length >= 5 && 5 + (frame[3]! | (frame[4]! << 8)) === frame.length;
+}}
+
+/** COBS 模式收包：buf 为两次调用间未结束的包，按 0x00 切包，CRC 校验通过的内容交给 onPacket */
+function feedCobs(buf: number[], chunk: Uint8Array, onPacket: (packet: Uint8Array) => void): void {{
+  for (let i = 0; i < chunk.length; i++) {{
+    const b = chunk[i]!;
+    if (b !== 0) {{
+      buf.push(b);
+      continue;
+    }}
+    if (buf.length === 0) continue;
+    const packet = cobsDecodePacket(buf);
+    buf.length = 0;
+    if (packet) onPacket(packet);
+  }}
+}}
+
+export interface SerialArqOptions {{
+  /** 在途帧数上限，默认 4 */
+  window?: number;
+  /** 重传超时（ms），连续超时时加倍，最多 8 倍，默认 200 */
+  rtoMs?: number;
+}}
+
+const ARQ_DATA = 0x01;
+const ARQ_REJ = 0x02;
+
+interface ArqLink {{
+  send(frame: Uint8Array): void;
+  onPacket(packet: Uint8Array): void;
+  close(): void;
+}}
+
+/**
+ * 可靠链路（framing: 'arq'）：COBS 包内为 [ctl][epoch][seq][ack] + 帧，Go-Back-N 滑动窗口，与 C 端一致。
+ * ack 为期望对端的下一个 seq；出现缺口时回一次 REJ，收到 REJ 立即重发窗口，否则超时重发。
+ * epoch 为本端会话号：对端会话号变化（重启）时两个方向都从 seq 0 重新编号。
+ */
+function createArqLink(write: (packet: Uint8Array) => void, deliver: (frame: Uint8Array) => void, opts?: SerialArqOptions): ArqLink {{
+  const window = opts?.window ?? 4;
+  const rtoMs = opts?.rtoMs ?? 200;
+  let epoch = Math.floor(Math.random() * 256);
+  let peerEpoch = -1;
+  let rxExpect = 0;
+  let rejSent = false;
+  let ackPending = false;
+  let ackScheduled = false;
+  let base = 0;
+  const inflight: Uint8Array[] = [];
+  const queue: Uint8Array[] = [];
+  let rto = rtoMs;
+  let stalls = 0;
+  let timer: ReturnType<typeof setTimeout> | null = null;
+
+  function emit(ctl: number, seq: number, frame?: Uint8Array): void {{
+    const p = new Uint8Array(4 + (frame ? frame.length : 0));
+    p[0] = ctl;
+    p[1] = epoch;
+    p[2] = seq & 0xff;
+    p[3] = rxExpect;
+    if (frame) p.set(frame, 4);
+    ackPending = false;
+    write(cobsEncodePacket(p));
+  }}
+
+  function arm(): void {{
+    if (timer) clearTimeout(timer);
+    timer = inflight.length ? setTimeout(onTimeout, rto) : null;
+  }}
+
+  function resend(): void {{
+    inflight.forEach((f, i) => emit(ARQ_DATA, base + i, f));
+    arm();
+  }}
+
+  function onTimeout(): void {{
+    timer = null;
+    if (++stalls >= 8) {{
+      /* 长时间没有进展：换会话号，两个方向都从 seq 0 开始 */
+      epoch = (epoch + 1 + Math.floor(Math.random() * 255)) & 0xff;
+      base = 0;
+      rxExpect = 0;
+      rejSent = false;
+      stalls = 0;
+      rto = rtoMs;
+    }} else {{
+      rto = Math.min(rto * 2, rtoMs * 8);
+    }}
+    resend();
+  }}
+
+  function fill(): void {{
+    const idle = inflight.length === 0;
+    while (inflight.length < window && queue.length) {{
+      const f = queue.shift()!;
+      emit(ARQ_DATA, base + inflight.length, f);
+      inflight.push(f);
+    }}
+    if (idle && inflight.length) arm();
+  }}
+
+  function flushAck(): void {{
+    ackScheduled = false;
+    if (ackPending) emit(0, 0);
+  }}
+
+  return {{
+    send(frame: Uint8Array): void {{
+      queue.push(frame);
+      fill();
+    }},
+    onPacket(p: Uint8Array): void {{
+      if (p.length < 4) return;
+      const ctl = p[0]!;
+      const data = (ctl & ARQ_DATA) !== 0;
+      if (data ? !rpcFrameOk(p.subarray(4)) : p.length !== 4) return;
+      if (p[1] !== peerEpoch) {{
+        const known = peerEpoch >= 0;
+        peerEpoch = p[1]!;
+        rxExpect = 0;
+        rejSent = false;
+        if (known) {{
+          base = 0;
+          rto = rtoMs;
+          stalls = 0;
+          if (inflight.length) resend();
+        }}
+      }}
+      const ack = p[3]!;
+      const acked = (ack - base) & 0xff;
+      if (acked > 0 && acked <= inflight.length) {{
+        inflight.splice(0, acked);
+        base = ack;
+        rto = rtoMs;
+        stalls = 0;
+        arm();
+      }}
+      if (ctl & ARQ_REJ && ack === base && inflight.length) resend();
+      if (data) {{
+        const ahead = (p[2]! - rxExpect) & 0xff;
+        if (ahead === 0) {{
+          rxExpect = (rxExpect + 1) & 0xff;
+          rejSent = false;
+          deliver(p.subarray(4));
+        }} else if (ahead < 128 && !rejSent) {{
+          rejSent = true;
+          emit(ARQ_REJ, 0);
+        }}
+        ackPending = true;
+        if (!ackScheduled) {{
+          ackScheduled = true;
+          queueMicrotask(flushAck);
+        }}
+      }}
+      fill();
+    }},
+    close(): void {{
+      if (timer) clearTimeout(timer);
+      timer = null;
+      ackPending = false;
+      inflight.length = 0;
+      queue.length = 0;
+    }},
+  }};
+}}
+
+export function createSerialTransport(options?: {{ baudRate?: number; prefix?: string | number[] | Uint8Array; suffix?: string | number[] | Uint8Array; framing?: SerialFraming; arq?: SerialArqOptions }}): EsprpcTransport {{
   const baudRate = options?.baudRate ?? 115200;
+  const cobs = options?.framing === 'cobs' || options?.framing === 'arq';
   const prefixBytes = toMarkerBytes(options?.prefix);
   const suffixBytes = toMarkerBytes(options?.suffix);
   const prefixLen = prefixBytes.length;
   const suffixLen = suffixBytes.length;
   let port: SerialPort | null = null;
   let reader: ReadableStreamDefaultReader<Uint8Array> | null = null;
+  let link: ArqLink | null = null;
+  let writeChain: Promise<void> = Promise.resolve();
   let invokeIdCounter = 1;
-  const pending = new Map<number, {{ resolve: (v: unknown) => void; reject: (e: Error) => void; timeoutId: ReturnType<typeof setTimeout> }}>();
+  const pending = new Map<number, {{ resolve: (v: unknown) => void; reject: (e: Error) => void; rearm: () => void; pages: unknown[]; onPage?: (items: unknown[]) => void }}>();
   const streamSubs = new Map<number, (data: unknown) => void>();
 
+  /** 写操作串行排队：同一时刻只能有一个 writer（ARQ 重传会连续写多包） */
+  function writePacket(packet: Uint8Array): Promise<void> {{
+    writeChain = writeChain.then(async () => {{
+      if (!port?.writable) return;
+      const writer = port.writable.getWriter();
+      try {{
+        await writer.write(packet);
+      }} finally {{
+        writer.releaseLock();
+      }}
+    }}).catch(() => {{}});
+    return writeChain;
+  }}
+
   async function sendFrame(frame: Uint8Array): Promise<void> {{
     if (!port?.writable) return;
+    if (link) {{
+      link.send(frame);
+      return;
+    }}
+    await writePacket(cobs ? cobsEncodePacket(frame) : withMarkers(frame));
+  }}
+
+  function onCobsPacket(packet: Uint8Array): void {{
+    if (link) link.onPacket(packet);
+    else if (rpcFrameOk(packet)) handleFrame(packet);
+  }}
+
+  function withMarkers(frame: Uint8Array): Uint8Array {{
     const total = prefixLen + frame.length + suffixLen;
     const packet = new Uint8Array(total);
     let off = 0;
     if (prefixLen) {{ packet.set(prefixBytes, off); off += prefixLen; }}
     packet.set(frame, off); off += frame.length;
     if (suffixLen) packet.set(suffixBytes, off);
-    const writer = port.writable.getWriter();
+    return packet;
+  }}
+
+  function handleFrame(frame: Uint8Array): void {{
+    const methodId = frame[0]!;
+    const invokeId = frame[1]! | (frame[2]! << 8);
+    const payloadLen = frame[3]! | (frame[4]! << 8);
+    const payload = frame.subarray(5, 5 + payloadLen);
     try {{
-      await writer.write(packet);
-    }} finally {{
-      writer.releaseLock();
-    }}
+      const result = decodeResponse(methodId, payload);
+      if (invokeId !== 0) {{
+        const h = pending.get(invokeId);
+        if (h && result instanceof RpcPage && result.aborted) {{
+          pending.delete(invokeId);
+          h.reject(new Error('RPC 分页响应被设备中止'));
+        }} else if (h && result instanceof RpcPage) {{
+          h.onPage?.(result.items);
+          h.pages.push(...result.items);
+          if (result.more) {{
+            h.rearm();  /* 每收到一页重新计时 */
+          }} else {{
+            pending.delete(invokeId);
+            h.resolve({{ items: h.pages, len: h.pages.length }});
+          }}
+        }} else if (h) {{
+          pending.delete(invokeId);
+          h.resolve(result);
+        }}
+      }} else {{
+        const cb = streamSubs.get(methodId);
+        if (cb && result !== undefined) cb(result);
+      }}
+    }} catch (_) {{}}
   }}
 
   function findPrefix(buf: number[], prefix: Uint8Array): number {{
@@ -708,6 +1397,10 @@ export function createSerialTransport(options?: {{ baudRate?: number; prefix?: s
       while (true) {{
         const {{ value, done }} = await reader!.read();
         if (done) break;
+        if (cobs) {{
+          feedCobs(buf, value!, onCobsPacket);
+          continue;
+        }}
         for (let i = 0; i < value!.length; i++) buf.push(value![i]);
         if (prefixLen > 0) {{
           const idx = findPrefix(buf, prefixBytes);
@@ -727,30 +1420,14 @@ export function createSerialTransport(options?: {{ baudRate?: number; prefix?: s
           need = 5;
           if (frame.length < 5) continue;
           if (suffixLen > 0 && buf.length >= suffixLen) buf.splice(0, suffixLen);
-          const methodId = frame[0]!;
-          const invokeId = frame[1]! | (frame[2]! << 8);
-          const payloadLen = frame[3]! | (frame[4]! << 8);
-          const payload = frame.subarray(5, 5 + payloadLen);
-          try {{
-            const result = decodeResponse(methodId, payload);
-            if (invokeId !== 0) {{
-              const h = pending.get(invokeId);
-              if (h) {{
-                pending.delete(invokeId);
-                h.resolve(result);
-              }}
-            }} else {{
-              const cb = streamSubs.get(methodId);
-              if (cb) cb(result);
-            }}
-          }} catch (_) {{}}
+          handleFrame(frame);
         }}
       }}
     }})();
   }}
 
   return {{
-    async call<T = unknown>(methodId: number, args: IArguments, options?: {{ timeout?: number }}): Promise<T> {{
+    async call<T = unknown>(methodId: number, args: IArguments, options?: {{ timeout?: number; onPage?: (items: unknown[]) => void }}): Promise<T> {{
       return new Promise((resolve, reject) => {{
         if (!port) {{
           reject(new Error('Not connected'));
@@ -759,17 +1436,20 @@ export function createSerialTransport(options?: {{ baudRate?: number; prefix?: s
         const invokeId = invokeIdCounter++;
         if (invokeIdCounter > 0xfffe) invokeIdCounter = 1;
         const timeoutMs = options?.timeout ?? {default_timeout_ms};
-        const timeoutId = setTimeout(() => {{
+        const expire = () => {{
           const h = pending.get(invokeId);
           if (h) {{
             pending.delete(invokeId);
             reject(new Error(`RPC 超时 (${{timeoutMs}}ms)`));
           }}
-        }}, timeoutMs);
+        }};
+        let timeoutId = setTimeout(expire, timeoutMs);
         pending.set(invokeId, {{
           resolve: (v) => {{ clearTimeout(timeoutId); (resolve as (v: unknown) => void)(v); }},
           reject: (e) => {{ clearTimeout(timeoutId); reject(e); }},
-          timeoutId,
+          rearm: () => {{ clearTimeout(timeoutId); timeoutId = setTimeout(expire, timeoutMs); }},
+          pages: [],
+          onPage: options?.onPage,
         }});
         const payload = encodeRequest(methodId, args);
         const frame = new Uint8Array(5 + payload.length);
@@ -807,10 +1487,13 @@ export function createSerialTransport(options?: {{ baudRate?: number; prefix?: s
       const nav = navigator as unknown as {{ serial: {{ requestPort: () => Promise<SerialPort> }} }};
       port = await nav.serial.requestPort();
       await port.open({{ baudRate }});
+      if (options?.framing === 'arq') link = createArqLink((p) => {{ void writePacket(p); }}, handleFrame, options.arq);
       reader = port.readable!.getReader();
       runReadLoop();
     }},
     disconnect(): void {{
+      link?.close();
+      link = null;
       if (reader) {{
         reader.cancel();
         reader = null;
@@ -819,7 +1502,7 @@ export function createSerialTransport(options?: {{ baudRate?: number; prefix?: s
         try {{ port.close(); }} catch (_) {{}}
         port = null;
       }}
-      pending.forEach((h) => {{ clearTimeout(h.timeoutId); h.reject(new Error('Disconnected')); }});
+      pending.forEach((h) => {{ h.reject(new Error('Disconnected')); }});
       pending.clear();
     }},
   }};
@@ -840,16 +1523,50 @@ export interface NodeSerialPortLike {{
  */
 export function createSerialTransportFromPort(
   port: NodeSerialPortLike,
-  options?: {{ prefix?: string | number[] | Uint8Array; suffix?: string | number[] | Uint8Array }}
+  options?: {{ prefix?: string | number[] | Uint8Array; suffix?: string | number[] | Uint8Array; framing?: SerialFraming; arq?: SerialArqOptions }}
 ): EsprpcTransport {{
+  const cobs = options?.framing === 'cobs' || options?.framing === 'arq';
   const prefixBytes = toMarkerBytes(options?.prefix);
   const suffixBytes = toMarkerBytes(options?.suffix);
   const prefixLen = prefixBytes.length;
   const suffixLen = suffixBytes.length;
+  let link: ArqLink | null = null;
   let invokeIdCounter = 1;
-  const pending = new Map<number, {{ resolve: (v: unknown) => void; reject: (e: Error) => void; timeoutId: ReturnType<typeof setTimeout> }}>();
+  const pending = new Map<number, {{ resolve: (v: unknown) => void; reject: (e: Error) => void; rearm: () => void; pages: unknown[]; onPage?: (items: unknown[]) => void }}>();
   const streamSubs = new Map<number, (data: unknown) => void>();
 
+  function handleFrame(frame: Uint8Array): void {{
+    const methodId = frame[0]!;
+    const invokeId = frame[1]! | (frame[2]! << 8);
+    const payloadLen = frame[3]! | (frame[4]! << 8);
+    const payload = frame.subarray(5, 5 + payloadLen);
+    try {{
+      const result = decodeResponse(methodId, payload);
+      if (invokeId !== 0) {{
+        const h = pending.get(invokeId);
+        if (h && result instanceof RpcPage && result.aborted) {{
+          pending.delete(invokeId);
+          h.reject(new Error('RPC 分页响应被设备中止'));
+        }} else if (h && result instanceof RpcPage) {{
+          h.onPage?.(result.items);
+          h.pages.push(...result.items);
+          if (result.more) {{
+            h.rearm();  /* 每收到一页重新计时 */
+          }} else {{
+            pending.delete(invokeId);
+            h.resolve({{ items: h.pages, len: h.pages.length }});
+          }}
+        }} else if (h) {{
+          pending.delete(invokeId);
+          h.resolve(result);
+        }}
+      }} else {{
+        const cb = streamSubs.get(methodId);
+        if (cb && result !== undefined) cb(result);
+      }}
+    }} catch (_) {{}}
+  }}
+
   function findPrefix(buf: number[], prefix: Uint8Array): number {{
     const plen = prefix.length;
     if (buf.length < plen) return buf.length;
@@ -865,6 +1582,13 @@ export function createSerialTransportFromPort(
   let need = 5;
 
   function onData(chunk: Uint8Array): void {{
+    if (cobs) {{
+      feedCobs(buf, chunk, (packet) => {{
+        if (link) link.onPacket(packet);
+        else if (rpcFrameOk(packet)) handleFrame(packet);
+      }});
+      return;
+    }}
     for (let i = 0; i < chunk.length; i++) buf.push(chunk[i]!);
     if (prefixLen > 0) {{
       const idx = findPrefix(buf, prefixBytes);
@@ -884,28 +1608,20 @@ export function createSerialTransportFromPort(
       need = 5;
       if (frame.length < 5) continue;
       if (suffixLen > 0 && buf.length >= suffixLen) buf.splice(0, suffixLen);
-      const methodId = frame[0]!;
-      const invokeId = frame[1]! | (frame[2]! << 8);
-      const payloadLen = frame[3]! | (frame[4]! << 8);
-      const payload = frame.subarray(5, 5 + payloadLen);
-      try {{
-        const result = decodeResponse(methodId, payload);
-        if (invokeId !== 0) {{
-          const h = pending.get(invokeId);
-          if (h) {{
-            pending.delete(invokeId);
-            h.resolve(result);
-          }}
-        }} else {{
-          const cb = streamSubs.get(methodId);
-          if (cb) cb(result);
-        }}
-      }} catch (_) {{}}
+      handleFrame(frame);
     }}
   }}
 
   function sendFrame(frame: Uint8Array): void {{
     if (!port.isOpen) return;
+    if (link) {{
+      link.send(frame);
+      return;
+    }}
+    if (cobs) {{
+      port.write(cobsEncodePacket(frame));
+      return;
+    }}
     const total = prefixLen + frame.length + suffixLen;
     const packet = new Uint8Array(total);
     let off = 0;
@@ -921,7 +1637,7 @@ export function createSerialTransportFromPort(
   }}
 
   return {{
-    async call<T = unknown>(methodId: number, args: IArguments, options?: {{ timeout?: number }}): Promise<T> {{
+    async call<T = unknown>(methodId: number, args: IArguments, options?: {{ timeout?: number; onPage?: (items: unknown[]) => void }}): Promise<T> {{
       return new Promise((resolve, reject) => {{
         if (!port.isOpen) {{
           reject(new Error('Port is not open'));
@@ -930,17 +1646,20 @@ export function createSerialTransportFromPort(
         const invokeId = invokeIdCounter++;
         if (invokeIdCounter > 0xfffe) invokeIdCounter = 1;
         const timeoutMs = options?.timeout ?? {default_timeout_ms};
-        const timeoutId = setTimeout(() => {{
+        const expire = () => {{
           const h = pending.get(invokeId);
           if (h) {{
             pending.delete(invokeId);
             reject(new Error(`RPC 超时 (${{timeoutMs}}ms)`));
           }}
-        }}, timeoutMs);
+        }};
+        let timeoutId = setTimeout(expire, timeoutMs);
         pending.set(invokeId, {{
           resolve: (v) => {{ clearTimeout(timeoutId); (resolve as (v: unknown) => void)(v); }},
           reject: (e) => {{ clearTimeout(timeoutId); reject(e); }},
-          timeoutId,
+          rearm: () => {{ clearTimeout(timeoutId); timeoutId = setTimeout(expire, timeoutMs); }},
+          pages: [],
+          onPage: options?.onPage,
         }});
         const payload = encodeRequest(methodId, args);
         const frame = new Uint8Array(5 + payload.length);
@@ -975,11 +1694,14 @@ export function createSerialTransportFromPort(
       if (!port.isOpen) {{
         throw new Error('Port is not open. Open the serialport before calling connect().');
       }}
+      if (options?.framing === 'arq') link = createArqLink((p) => {{ port.write(p); }}, handleFrame, options.arq);
       port.on('data', onData);
     }},
     disconnect(): void {{
       removeDataListener();
-      pending.forEach((h) => {{ clearTimeout(h.timeoutId); h.reject(new Error('Disconnected')); }});
+      link?.close();
+      link = null;
+      pending.forEach((h) => {{ h.reject(new Error('Disconnected')); }});
       pending.clear();
       buf.length = 0;
       need = 5;
@@ -3,14 +3,14 @@ TypeScript 代码生成器
 """
 
 try:
-    from .parser import RpcSchema, EnumDef, StructDef, ServiceDef, MethodDef, StructField
+    from .parser import RpcSchema, EnumDef, StructDef, ServiceDef, MethodDef, StructField, map_key_value, fieldmask_enabled
 except ImportError:
-    from parser import RpcSchema, EnumDef, StructDef, ServiceDef, MethodDef, StructField
+    from parser import RpcSchema, EnumDef, StructDef, ServiceDef, MethodDef, StructField, map_key_value, fieldmask_enabled
 
 
 def _extract_custom_type_names(type_str: str) -> set[str]:
     """从类型字符串中提取自定义类型名（用于按需导入）"""
-    builtin = {'int', 'int32', 'int64', 'uint32', 'uint64', 'bool', 'float', 'double', 'string'}
+    builtin = {'int', 'int32', 'int64', 'uint32', 'uint64', 'bool', 'float', 'double', 'string', 'strview'}
     t = type_str.strip()
     if t in builtin:
         return set()
@@ -20,17 +20,22 @@ def _extract_custom_type_names(type_str: str) -> set[str]:
         return _extract_custom_type_names(t[5:-1])
     if t.startswith('REQUIRED('):
         return _extract_custom_type_names(t[9:-1])
+    kv = map_key_value(t)
+    if kv:
+        return _extract_custom_type_names(kv[0]) | _extract_custom_type_names(kv[1])
     return {t}
 
 
 def c_type_to_ts(c_type: str) -> str:
     """C 类型映射到 TypeScript"""
     t = c_type.strip()
-    if t in ('int', 'int32', 'int64', 'uint32', 'uint64', 'float', 'double'):
+    if t in ('int', 'int32', 'uint32', 'float', 'double'):
         return 'number'
+    if t in ('int64', 'uint64'):
+        return 'bigint'  # 超出 Number 安全整数范围，编解码使用 BigInt
     if t == 'bool':
         return 'boolean'
-    if t == 'string':
+    if t in ('string', 'strview'):
         return 'string'
     if t in ('void', 'VOID'):
         return 'void'
@@ -43,6 +48,11 @@ def c_type_to_ts(c_type: str) -> str:
     if t.startswith('REQUIRED('):
         inner = t[9:-1].strip()
         return c_type_to_ts(inner)
+    kv = map_key_value(t)
+    if kv:
+        # 字符串键为 string，整数/enum 键为 number（JS 对象键）
+        key_ts = 'string' if c_type_to_ts(kv[0]) == 'string' else 'number'
+        return f'Record<{key_ts}, {c_type_to_ts(kv[1])}>'
     return t  # 自定义类型如 User, UserResponse
 
 
@@ -129,15 +139,63 @@ def emit_service(svc: ServiceDef, transport_var: str = 'transport', include_impo
                 lines.append(f'  }}')
             else:
                 opts = ', { timeout: 5000 }' if m.options and 'timeout' in str(m.options) else ''
-                lines.append(f'  async {m.name}({params}): {emit_method_ret_type(m)} {{')
+                type_params = ''
+                if fieldmask_enabled(m):
+                    # "fieldmask"：末尾可选的字段名数组，结果类型只含所选字段
+                    is_list = m.ret_type.startswith('LIST(')
+                    struct = m.ret_type[5:-1].strip() if is_list else m.ret_type
+                    type_params = f'<K extends keyof {struct} = keyof {struct}>'
+                    params = ', '.join(x for x in (params, '_fields?: K[]') if x)
+                    ret_ts = f'Pick<{struct}, K>[]' if is_list else f'Pick<{struct}, K>'
+                    ret_sig = f'Promise<{ret_ts}>'
+                else:
+                    ret_sig = emit_method_ret_type(m)
+                lines.append(f'  async {m.name}{type_params}({params}): {ret_sig} {{')
                 lines.append(f'    return this.#{transport_var}.call<{ret_ts}>({method_id}, arguments{opts});')
                 lines.append(f'  }}')
+                if m.is_paged:
+                    # PAGED(T)：同参数的按页异步迭代版本，每收到一页产出一次
+                    page_ts = ret_ts[:-2] if ret_ts.endswith('[]') else ret_ts
+                    timeout = 'timeout: 5000, ' if opts else ''
+                    lines.append(f'')
+                    lines.append(f'  {m.name}Pages{type_params}({params}): AsyncIterable<{page_ts}[]> {{')
+                    lines.append(f'    const args = arguments;')
+                    lines.append(f'    return pagesOf<{page_ts}>((onPage) => this.#{transport_var}.call({method_id}, args, {{ {timeout}onPage }}));')
+                    lines.append(f'  }}')
         lines.append('')
 
     lines.append('}')
     return '\n'.join(lines)
 
 
+_TS_PAGES_OF = [
+    "/** 把分页调用的 onPage 回调转为按页产出的异步迭代器；调用失败时在迭代中抛出 */",
+    "function pagesOf<T>(start: (onPage: (items: unknown[]) => void) => Promise<unknown>): AsyncIterable<T[]> {",
+    "  return {",
+    "    async *[Symbol.asyncIterator]() {",
+    "      const queue: T[][] = [];",
+    "      let wake: (() => void) | null = null;",
+    "      let done = false;",
+    "      let error: unknown = null;",
+    "      start((items) => { queue.push(items as T[]); wake?.(); }).then(",
+    "        () => { done = true; wake?.(); },",
+    "        (e) => { error = e; done = true; wake?.(); },",
+    "      );",
+    "      for (;;) {",
+    "        const page = queue.shift();",
+    "        if (page) { yield page; continue; }",
+    "        if (done) break;",
+    "        await new Promise<void>((r) => { wake = r; });",
+    "        wake = null;",
+    "      }",
+    "      if (error) throw error;",
+    "    },",
+    "  };",
+    "}",
+    "",
+]
+
+
 def emit_all(schema: RpcSchema, base_name: str = 'rpc', transport_path: str = '../src/transport') -> tuple[str, str]:
     """
     生成 TS 代码，返回 (types_content, client_content)
@@ -170,6 +228,8 @@ def emit_all(schema: RpcSchema, base_name: str = 'rpc', transport_path: str = '.
         f"import type {{ EsprpcTransport }} from '{transport_path}';",
         "",
     ]
+    if any(m.is_paged for svc in schema.services for m in svc.methods):
+        client_lines.extend(_TS_PAGES_OF)
     for i, svc in enumerate[ServiceDef](schema.services):
         client_lines.append(emit_service(svc, transport_path=transport_path, include_import=False, svc_idx=i))
         client_lines.append('')
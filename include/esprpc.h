@@ -6,8 +6,8 @@
  * 1. esprpc_init()
  * 2. esprpc_register_service() 注册服务
  * 3. esprpc_transport_add() 添加传输层（WebSocket/BLE）
- * 4. transport->start(ctx, esprpc_handle_request, NULL) 设置接收回调
- * 5. 传输层收到数据时调用 esprpc_handle_request() 处理
+ * 4. transport->start(ctx, on_recv, transport) 设置接收回调
+ * 5. 传输层收到数据时调用 esprpc_handle_request_from(transport, ...) 处理，响应只发回该传输
  */
 
 #ifndef ESPRPC_H
@@ -16,6 +16,7 @@
 #include <stddef.h>
 #include <stdint.h>
 #include "esp_err.h"
+#include "esprpc_arena.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -57,18 +58,63 @@ esp_err_t esprpc_register_service(const char *name, void *svc_impl, void *dispat
  */
 esp_err_t esprpc_send(const uint8_t *data, size_t len);
 
+/** 分散/聚集发送的一段数据（帧头、payload、前后缀等），各段按顺序构成一帧 */
+typedef struct esprpc_iovec {
+    const void *base;
+    size_t len;
+} esprpc_iovec_t;
+
+/**
+ * @brief 分段发送一帧（不拼接）：支持 sendv 的传输直接拿到各段，其余传输在池块中拼接一次后 send
+ * @param iov 数据段数组
+ * @param iovcnt 段数
+ * @return ESP_OK 成功
+ */
+esp_err_t esprpc_sendv(const esprpc_iovec_t *iov, size_t iovcnt);
+
+/**
+ * @brief 分配一个引用计数帧缓冲（初始引用为 1）：len 不超过 CONFIG_ESPRPC_POOL_BLOCK_SIZE 时取自帧池，
+ *        否则直接 malloc。传输层接收帧、异步发送时用它代替 malloc/拷贝，多方共享同一帧时各自 ref
+ * @param len 所需字节数
+ * @return 缓冲区，失败返回 NULL
+ */
+void *esprpc_buf_alloc(size_t len);
+
+/** @brief 增加一个引用 */
+void esprpc_buf_ref(void *buf);
+
+/** @brief 释放一个引用，归零时归还帧池（或 free） */
+void esprpc_buf_unref(void *buf);
+
 /**
  * @brief 设置接收回调（由传输层在收到数据时调用）
  */
 void esprpc_set_recv_callback(esprpc_on_recv_fn fn, void *user_ctx);
 
 /**
- * @brief 处理收到的 RPC 请求（由接收回调调用）
+ * @brief 处理收到的 RPC 请求（由接收回调调用）；不知道来源传输，响应广播给全部传输，
+ *        多传输时用 esprpc_handle_request_from
  * @param data 完整帧数据
  * @param len 帧长度
  */
 void esprpc_handle_request(const uint8_t *data, size_t len);
 
+/** 分页响应（PAGED(T) 方法）payload 首字节 flags：置位表示同一 invoke_id 还有后续页 */
+#define ESPRPC_PAGE_MORE 0x01
+/** 分页响应 flags：调用中途放弃（元素超出一页、编码或发送中间页失败），本页为空且是最后一页，客户端以错误结束调用 */
+#define ESPRPC_PAGE_ERROR 0x02
+
+/**
+ * @brief 向 arena 所属的请求发送一帧中间响应（回显其 method_id/invoke_id），仅在该请求 dispatch 期间有效；
+ *        最后一帧仍由 dispatch 的 resp_buf 返回。各传输任务可同时 dispatch，请求上下文随 arena 传递；
+ *        请求经 esprpc_handle_request_from 进入时只发回来源传输与对端，其他传输拒收不影响本次调用
+ * @param req dispatch 收到的 arena
+ * @param data payload 数据（不含帧头）
+ * @param len 长度
+ * @return ESP_OK 成功；arena 不属于任何请求时 ESP_ERR_INVALID_STATE
+ */
+esp_err_t esprpc_send_partial(const esprpc_arena_t *req, const uint8_t *data, size_t len);
+
 /** 清除 stream 上下文时使用的 sentinel 值（避免与 method_id 0 冲突） */
 #define ESPRPC_STREAM_METHOD_ID_NONE 0xFFFF
 
@@ -0,0 +1,64 @@
+/**
+ * @file esprpc_arena.h
+ * @brief 单次请求的 bump 分配器（供生成的解码代码分配字符串与数组）
+ *
+ * esprpc_handle_request 为每个请求从固定块池取一块作为 arena，dispatch 结束、响应发出后整体归还（O(1)）。
+ * 解码结果（char *、LIST 的 items 等）只在 handler 执行期间有效，需保留请自行拷贝。
+ * 每个请求独占一个 arena，解码因此可重入，且不经过通用堆。arena 同时携带所属请求的 method_id/invoke_id
+ * 与来源传输，分页响应的中间页（esprpc_send_partial）据此回显帧头、只发回来源，不依赖全局状态。
+ */
+
+#ifndef ESPRPC_ARENA_H
+#define ESPRPC_ARENA_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** 所有分配按此对齐（覆盖 int64/double/指针） */
+#define ESPRPC_ARENA_ALIGN 8
+
+struct esprpc_transport;
+
+typedef struct esprpc_arena {
+    uint8_t *base;  /* 缓冲区起始 */
+    size_t cap;     /* 缓冲区字节数 */
+    size_t used;    /* 已分配字节数 */
+    bool has_req;            /* 由 esprpc_handle_request 设置：以下为所属请求 */
+    uint8_t req_method_id;
+    uint16_t req_invoke_id;
+    struct esprpc_transport *req_transport;  /* 收到请求的传输，NULL 表示未知（广播给全部传输） */
+    bool req_routed;         /* req_route 有效：来源传输的 reply_route 取得的对端 */
+    uint32_t req_route;
+} esprpc_arena_t;
+
+/** 以调用方提供的缓冲区初始化 arena（不拥有 buf，不关联请求） */
+void esprpc_arena_init(esprpc_arena_t *a, void *buf, size_t cap);
+
+/** 分配 size 字节（按 ESPRPC_ARENA_ALIGN 对齐，内容未初始化），空间不足返回 NULL */
+static inline void *esprpc_arena_alloc(esprpc_arena_t *a, size_t size)
+{
+    size_t start = (a->used + (ESPRPC_ARENA_ALIGN - 1)) & ~(size_t)(ESPRPC_ARENA_ALIGN - 1);
+    if (start > a->cap || size > a->cap - start) return NULL;
+    a->used = start + size;
+    return a->base + start;
+}
+
+/** 释放全部分配（仅重置游标） */
+static inline void esprpc_arena_reset(esprpc_arena_t *a)
+{
+    a->used = 0;
+}
+
+/** 从 *p 读取 string 到 arena（含 NUL），成功时推进 p 并令 *out 指向副本，返回 0 */
+int esprpc_arena_read_str(esprpc_arena_t *a, const uint8_t **p, const uint8_t *end, char **out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ESPRPC_ARENA_H */
@@ -4,7 +4,10 @@
  *
  * 帧格式: [1B method_id][2B invoke_id LE][2B payload_len LE][binary payload]
  * invoke_id: 0=流式, 非0=请求-响应匹配
- * 编码规则: int=4B LE, bool=1B, string=[2B len LE][utf8], optional=[1B tag][value?]
+ * 编码规则: int/uint32=4B LE, int64/uint64=8B LE, float=4B / double=8B IEEE754 LE, bool=1B,
+ *           string=[2B len LE][utf8], optional=[1B tag][value?], list=[4B count LE][elem...]
+ * varint 模式（schema 中 RPC_INT_ENCODING(varint)）: 整数改为 LEB128（有符号先 zigzag），
+ *           float/double、list count、string 长度与帧头仍为定长
  */
 
 #ifndef ESPRPC_BINARY_H
@@ -13,41 +16,177 @@
 #include <stdint.h>
 #include <stddef.h>
 #include <stdbool.h>
+#include <string.h>
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+/* ---------- 读取：成功时推进 *p，返回 0；越界返回 -1 ---------- */
+
 /** 从 *p 读取 int32，成功时推进 p，返回 0 */
 int esprpc_bin_read_i32(const uint8_t **p, const uint8_t *end, int *out);
 
 /** 从 *p 读取 uint32 */
 int esprpc_bin_read_u32(const uint8_t **p, const uint8_t *end, uint32_t *out);
 
+/** 从 *p 读取 int64 */
+int esprpc_bin_read_i64(const uint8_t **p, const uint8_t *end, int64_t *out);
+
+/** 从 *p 读取 uint64 */
+int esprpc_bin_read_u64(const uint8_t **p, const uint8_t *end, uint64_t *out);
+
+/** 从 *p 读取 float */
+int esprpc_bin_read_f32(const uint8_t **p, const uint8_t *end, float *out);
+
+/** 从 *p 读取 double */
+int esprpc_bin_read_f64(const uint8_t **p, const uint8_t *end, double *out);
+
 /** 从 *p 读取 bool */
 int esprpc_bin_read_bool(const uint8_t **p, const uint8_t *end, bool *out);
 
 /** 从 *p 读取 string 到 buf，buf_size 含 NUL */
 int esprpc_bin_read_str(const uint8_t **p, const uint8_t *end, char *buf, size_t buf_size);
 
+/**
+ * 从 *p 读取 string 为视图（不拷贝）：*out 指向 *p 所在缓冲区内的 UTF-8 字节，不以 NUL 结尾，
+ * 仅在该缓冲区有效期间可用（dispatch 中即 handler 执行期间）
+ */
+int esprpc_bin_read_str_view(const uint8_t **p, const uint8_t *end, const char **out, size_t *out_len);
+
 /** 从 *p 读取 optional 标记 */
 int esprpc_bin_read_optional_tag(const uint8_t **p, const uint8_t *end, bool *present);
 
+/** 从 *p 读取 LEB128 varint（最多 5 字节）为 uint32 */
+int esprpc_bin_read_varint_u32(const uint8_t **p, const uint8_t *end, uint32_t *out);
+
+/** 从 *p 读取 zigzag varint 为 int32 */
+int esprpc_bin_read_varint_i32(const uint8_t **p, const uint8_t *end, int *out);
+
+/** 从 *p 读取 LEB128 varint（最多 10 字节）为 uint64 */
+int esprpc_bin_read_varint_u64(const uint8_t **p, const uint8_t *end, uint64_t *out);
+
+/** 从 *p 读取 zigzag varint 为 int64 */
+int esprpc_bin_read_varint_i64(const uint8_t **p, const uint8_t *end, int64_t *out);
+
+/** 从 *p 读取 n 个连续 int32 到 out（长度只校验一次，小端平台整体 memcpy） */
+int esprpc_bin_read_i32_array(const uint8_t **p, const uint8_t *end, int *out, size_t n);
+
+/** 从 *p 读取 n 个连续 uint32 到 out */
+int esprpc_bin_read_u32_array(const uint8_t **p, const uint8_t *end, uint32_t *out, size_t n);
+
+/** 从 *p 读取 n 个连续 int64 到 out */
+int esprpc_bin_read_i64_array(const uint8_t **p, const uint8_t *end, int64_t *out, size_t n);
+
+/** 从 *p 读取 n 个连续 uint64 到 out */
+int esprpc_bin_read_u64_array(const uint8_t **p, const uint8_t *end, uint64_t *out, size_t n);
+
+/** 从 *p 读取 n 个连续 float 到 out */
+int esprpc_bin_read_f32_array(const uint8_t **p, const uint8_t *end, float *out, size_t n);
+
+/** 从 *p 读取 n 个连续 double 到 out */
+int esprpc_bin_read_f64_array(const uint8_t **p, const uint8_t *end, double *out, size_t n);
+
+/** 跳过 *p 处 n 个 elem_size 字节的定长元素 */
+int esprpc_bin_skip(const uint8_t **p, const uint8_t *end, size_t n, size_t elem_size);
+
+/* ---------- 写入：成功时推进 *p，返回 0；空间不足返回 -1 ---------- */
+
 /** 写入 int32 到 *p */
 int esprpc_bin_write_i32(uint8_t **p, const uint8_t *end, int v);
 
 /** 写入 uint32 到 *p */
 int esprpc_bin_write_u32(uint8_t **p, const uint8_t *end, uint32_t v);
 
+/** 写入 int64 到 *p */
+int esprpc_bin_write_i64(uint8_t **p, const uint8_t *end, int64_t v);
+
+/** 写入 uint64 到 *p */
+int esprpc_bin_write_u64(uint8_t **p, const uint8_t *end, uint64_t v);
+
+/** 写入 float 到 *p */
+int esprpc_bin_write_f32(uint8_t **p, const uint8_t *end, float v);
+
+/** 写入 double 到 *p */
+int esprpc_bin_write_f64(uint8_t **p, const uint8_t *end, double v);
+
 /** 写入 bool 到 *p */
 int esprpc_bin_write_bool(uint8_t **p, const uint8_t *end, bool v);
 
 /** 写入 string 到 *p，s 可为 NULL 视为空串 */
 int esprpc_bin_write_str(uint8_t **p, const uint8_t *end, const char *s);
 
+/** 写入长度已知的 string（不做 strlen），s 可为 NULL（仅当 len 为 0） */
+int esprpc_bin_write_strn(uint8_t **p, const uint8_t *end, const char *s, size_t len);
+
 /** 写入 optional 标记 */
 int esprpc_bin_write_optional_tag(uint8_t **p, const uint8_t *end, bool present);
 
+/** 写入 n 个连续 int32 到 *p，v 可为 NULL（仅当 n 为 0） */
+int esprpc_bin_write_i32_array(uint8_t **p, const uint8_t *end, const int *v, size_t n);
+
+/** 写入 n 个连续 uint32 到 *p */
+int esprpc_bin_write_u32_array(uint8_t **p, const uint8_t *end, const uint32_t *v, size_t n);
+
+/** 写入 n 个连续 int64 到 *p */
+int esprpc_bin_write_i64_array(uint8_t **p, const uint8_t *end, const int64_t *v, size_t n);
+
+/** 写入 n 个连续 uint64 到 *p */
+int esprpc_bin_write_u64_array(uint8_t **p, const uint8_t *end, const uint64_t *v, size_t n);
+
+/** 写入 n 个连续 float 到 *p */
+int esprpc_bin_write_f32_array(uint8_t **p, const uint8_t *end, const float *v, size_t n);
+
+/** 写入 n 个连续 double 到 *p */
+int esprpc_bin_write_f64_array(uint8_t **p, const uint8_t *end, const double *v, size_t n);
+
+/** 写入 uint32 为 LEB128 varint */
+int esprpc_bin_write_varint_u32(uint8_t **p, const uint8_t *end, uint32_t v);
+
+/** 写入 int32 为 zigzag varint */
+int esprpc_bin_write_varint_i32(uint8_t **p, const uint8_t *end, int v);
+
+/** 写入 uint64 为 LEB128 varint */
+int esprpc_bin_write_varint_u64(uint8_t **p, const uint8_t *end, uint64_t v);
+
+/** 写入 int64 为 zigzag varint */
+int esprpc_bin_write_varint_i64(uint8_t **p, const uint8_t *end, int64_t v);
+
+/** uint32 的 LEB128 编码字节数（1~5） */
+static inline size_t esprpc_bin_varint_u32_size(uint32_t v)
+{
+    return v < (1u << 7) ? 1 : v < (1u << 14) ? 2 : v < (1u << 21) ? 3 : v < (1u << 28) ? 4 : 5;
+}
+
+/** uint64 的 LEB128 编码字节数（1~10） */
+static inline size_t esprpc_bin_varint_u64_size(uint64_t v)
+{
+    size_t n = 1;
+    while (v >= 0x80) {
+        v >>= 7;
+        n++;
+    }
+    return n;
+}
+
+/** string 的编码字节数（2B 长度 + 内容），s 可为 NULL 视为空串 */
+static inline size_t esprpc_bin_str_size(const char *s)
+{
+    return 2 + (s ? strlen(s) : 0);
+}
+
+/** int32 的 zigzag 映射：0,-1,1,-2... -> 0,1,2,3... */
+static inline uint32_t esprpc_bin_zigzag32(int v)
+{
+    return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31);
+}
+
+/** int64 的 zigzag 映射 */
+static inline uint64_t esprpc_bin_zigzag64(int64_t v)
+{
+    return ((uint64_t)v << 1) ^ (uint64_t)(v >> 63);
+}
+
 #ifdef __cplusplus
 }
 #endif
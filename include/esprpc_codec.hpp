@@ -0,0 +1,806 @@
+/**
+ * @file esprpc_codec.hpp
+ * @brief 头文件模板编解码：esprpc::size/encode/decode<Wire>(...)
+ *
+ * 按 C++ 类型在编译期选择编码：数值、bool、enum、string（char *）、strview，
+ * rpc_macros.hpp 的 rpc_optional<T>/rpc_list<T>/rpc_map<K,V>，以及用 ESPRPC_REFLECT 描述字段的 struct。
+ * 线上格式与 generator/binary_protocol.py 一致；生成的 .rpc.gen.cpp 只调用这些模板。
+ * Wire 为 wire_fixed（定长小端）或 wire_varint（整数 zigzag/LEB128），对应 RPC_INT_ENCODING。
+ */
+
+#ifndef ESPRPC_CODEC_HPP
+#define ESPRPC_CODEC_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <tuple>
+#include <type_traits>
+
+#include "esprpc_binary.h"
+#include "esprpc_arena.h"
+#include "esprpc_delta.h"
+#include "esprpc_service.h"
+#include "rpc_macros.hpp"
+
+namespace esprpc {
+
+/** 整数定长小端（默认） */
+struct wire_fixed {
+    static constexpr bool varint = false;
+};
+
+/** 整数 zigzag/LEB128；float/double/bool、string 长度、list count 仍为定长 */
+struct wire_varint {
+    static constexpr bool varint = true;
+};
+
+/** struct 字段描述：成员指针 + LIST/MAP 元素上限（0 表示 CONFIG_ESPRPC_LIST_MAX_ITEMS） */
+template<auto Member, uint32_t MaxItems = 0>
+struct field {
+    static constexpr auto member = Member;
+    static constexpr uint32_t max_items = MaxItems;
+};
+
+/** 由 ESPRPC_REFLECT 特化：using fields = std::tuple<field<...>, ...>，按线上顺序 */
+template<typename T>
+struct reflect;
+
+/** 类型编解码，按 T 特化；每个特化提供 size/encode/decode 三个以 Wire 为参数的静态函数 */
+template<typename T, typename Enable = void>
+struct codec;
+
+template<typename Wire, typename T>
+inline size_t size(const T &v)
+{
+    return codec<T>::template size<Wire>(v);
+}
+
+template<typename Wire, typename T>
+inline int encode(uint8_t **p, const uint8_t *end, const T &v)
+{
+    return codec<T>::template encode<Wire>(p, end, v);
+}
+
+/** 解码到 *out；字符串与 LIST 数组从 arena 分配 */
+template<typename Wire, typename T>
+inline int decode(const uint8_t **p, const uint8_t *end, T *out, esprpc_arena_t *arena)
+{
+    return codec<T>::template decode<Wire>(p, end, out, arena);
+}
+
+namespace detail {
+
+template<typename T, typename = void>
+struct is_reflected : std::false_type {};
+template<typename T>
+struct is_reflected<T, std::void_t<typename reflect<T>::fields>> : std::true_type {};
+
+template<typename M>
+struct member_of;
+template<typename C, typename M>
+struct member_of<M C::*> {
+    using type = M;
+};
+
+/** 带 count 前缀、解码受 max_items 限制的容器：LIST / MAP */
+template<typename T>
+struct is_counted : std::false_type {};
+template<typename T>
+struct is_counted<rpc_list<T>> : std::true_type {};
+template<typename K, typename V>
+struct is_counted<rpc_map<K, V>> : std::true_type {};
+
+/** 定长编码字节数；0 表示长度随值变化 */
+template<typename Wire, typename T>
+constexpr size_t fixed_size()
+{
+    if constexpr (std::is_enum_v<T>) {
+        return fixed_size<Wire, int>();
+    } else if constexpr (std::is_same_v<T, bool>) {
+        return 1;
+    } else if constexpr (std::is_same_v<T, float>) {
+        return 4;
+    } else if constexpr (std::is_same_v<T, double>) {
+        return 8;
+    } else if constexpr (std::is_integral_v<T>) {
+        return Wire::varint ? 0 : sizeof(T);
+    } else {
+        return 0;
+    }
+}
+
+} // namespace detail
+
+/* ---------- 数值：Wire 决定定长或 varint，定长时 LIST 整体拷贝 ---------- */
+
+#define ESPRPC_CODEC_NUMBER(T, FIXED, VARINT, VARINT_SIZE)                                          \
+    template<>                                                                                      \
+    struct codec<T> {                                                                               \
+        template<typename Wire>                                                                     \
+        static size_t size(T v)                                                                     \
+        {                                                                                           \
+            if constexpr (Wire::varint) return VARINT_SIZE;                                         \
+            else return sizeof(T);                                                                  \
+        }                                                                                           \
+        template<typename Wire>                                                                     \
+        static int encode(uint8_t **p, const uint8_t *end, T v)                                     \
+        {                                                                                           \
+            if constexpr (Wire::varint) return esprpc_bin_write_##VARINT(p, end, v);                \
+            else return esprpc_bin_write_##FIXED(p, end, v);                                        \
+        }                                                                                           \
+        template<typename Wire>                                                                     \
+        static int decode(const uint8_t **p, const uint8_t *end, T *out, esprpc_arena_t *)          \
+        {                                                                                           \
+            if constexpr (Wire::varint) return esprpc_bin_read_##VARINT(p, end, out);               \
+            else return esprpc_bin_read_##FIXED(p, end, out);                                       \
+        }                                                                                           \
+        static int read_array(const uint8_t **p, const uint8_t *end, T *out, size_t n)              \
+        {                                                                                           \
+            return esprpc_bin_read_##FIXED##_array(p, end, out, n);                                 \
+        }                                                                                           \
+        static int write_array(uint8_t **p, const uint8_t *end, const T *v, size_t n)               \
+        {                                                                                           \
+            return esprpc_bin_write_##FIXED##_array(p, end, v, n);                                  \
+        }                                                                                           \
+    };
+
+ESPRPC_CODEC_NUMBER(int, i32, varint_i32, esprpc_bin_varint_u32_size(esprpc_bin_zigzag32(v)))
+ESPRPC_CODEC_NUMBER(uint32_t, u32, varint_u32, esprpc_bin_varint_u32_size(v))
+ESPRPC_CODEC_NUMBER(int64_t, i64, varint_i64, esprpc_bin_varint_u64_size(esprpc_bin_zigzag64(v)))
+ESPRPC_CODEC_NUMBER(uint64_t, u64, varint_u64, esprpc_bin_varint_u64_size(v))
+ESPRPC_CODEC_NUMBER(float, f32, f32, 4)
+ESPRPC_CODEC_NUMBER(double, f64, f64, 8)
+
+#undef ESPRPC_CODEC_NUMBER
+
+template<>
+struct codec<bool> {
+    template<typename Wire>
+    static size_t size(bool)
+    {
+        return 1;
+    }
+    template<typename Wire>
+    static int encode(uint8_t **p, const uint8_t *end, bool v)
+    {
+        return esprpc_bin_write_bool(p, end, v);
+    }
+    template<typename Wire>
+    static int decode(const uint8_t **p, const uint8_t *end, bool *out, esprpc_arena_t *)
+    {
+        return esprpc_bin_read_bool(p, end, out);
+    }
+};
+
+/** enum 按 int 编码；定长时 LIST 整体拷贝，要求枚举底层为 4 字节 */
+template<typename T>
+struct codec<T, std::enable_if_t<std::is_enum_v<T>>> {
+    template<typename Wire>
+    static size_t size(T v)
+    {
+        return codec<int>::size<Wire>((int)v);
+    }
+    template<typename Wire>
+    static int encode(uint8_t **p, const uint8_t *end, T v)
+    {
+        return codec<int>::encode<Wire>(p, end, (int)v);
+    }
+    template<typename Wire>
+    static int decode(const uint8_t **p, const uint8_t *end, T *out, esprpc_arena_t *arena)
+    {
+        int v = 0;
+        if (codec<int>::decode<Wire>(p, end, &v, arena) != 0) return -1;
+        *out = (T)v;
+        return 0;
+    }
+    static int read_array(const uint8_t **p, const uint8_t *end, T *out, size_t n)
+    {
+        static_assert(sizeof(T) == sizeof(int), "LIST(enum) 批量编解码要求 4 字节枚举");
+        return esprpc_bin_read_i32_array(p, end, (int *)out, n);
+    }
+    static int write_array(uint8_t **p, const uint8_t *end, const T *v, size_t n)
+    {
+        static_assert(sizeof(T) == sizeof(int), "LIST(enum) 批量编解码要求 4 字节枚举");
+        return esprpc_bin_write_i32_array(p, end, (const int *)v, n);
+    }
+};
+
+/* ---------- 字符串 ---------- */
+
+/** string：解码时拷贝到 arena 并补 NUL；编码时 NULL 视为空串 */
+template<>
+struct codec<char *> {
+    template<typename Wire>
+    static size_t size(const char *v)
+    {
+        return esprpc_bin_str_size(v);
+    }
+    template<typename Wire>
+    static int encode(uint8_t **p, const uint8_t *end, const char *v)
+    {
+        return esprpc_bin_write_str(p, end, v);
+    }
+    template<typename Wire>
+    static int decode(const uint8_t **p, const uint8_t *end, char **out, esprpc_arena_t *arena)
+    {
+        return esprpc_arena_read_str(arena, p, end, out);
+    }
+};
+
+/** strview：解码指向接收帧，不拷贝；编码按 len 写入 */
+template<>
+struct codec<rpc_strview> {
+    template<typename Wire>
+    static size_t size(const rpc_strview &v)
+    {
+        return 2 + v.len;
+    }
+    template<typename Wire>
+    static int encode(uint8_t **p, const uint8_t *end, const rpc_strview &v)
+    {
+        return esprpc_bin_write_strn(p, end, v.ptr, v.len);
+    }
+    template<typename Wire>
+    static int decode(const uint8_t **p, const uint8_t *end, rpc_strview *out, esprpc_arena_t *)
+    {
+        return esprpc_bin_read_str_view(p, end, &out->ptr, &out->len);
+    }
+};
+
+/* ---------- 包装类型 ---------- */
+
+/** OPTIONAL(T)：[1B present][T] */
+template<typename T>
+struct codec<rpc_optional<T>> {
+    template<typename Wire>
+    static size_t size(const rpc_optional<T> &v)
+    {
+        return 1 + (v.present ? esprpc::size<Wire>(v.value) : 0);
+    }
+    template<typename Wire>
+    static int encode(uint8_t **p, const uint8_t *end, const rpc_optional<T> &v)
+    {
+        if (esprpc_bin_write_optional_tag(p, end, v.present) != 0) return -1;
+        return v.present ? esprpc::encode<Wire>(p, end, v.value) : 0;
+    }
+    template<typename Wire>
+    static int decode(const uint8_t **p, const uint8_t *end, rpc_optional<T> *out, esprpc_arena_t *arena)
+    {
+        bool present = false;
+        if (esprpc_bin_read_optional_tag(p, end, &present) != 0) return -1;
+        out->present = present;
+        return present ? esprpc::decode<Wire>(p, end, &out->value, arena) : 0;
+    }
+};
+
+/** LIST(T)：[4B count][elem...]；count 按 items 为 NULL 时视为 0 */
+template<typename T>
+struct codec<rpc_list<T>> {
+    template<typename Wire>
+    static constexpr bool bulk()
+    {
+        return !Wire::varint && !std::is_same_v<T, bool> && (std::is_arithmetic_v<T> || std::is_enum_v<T>);
+    }
+    template<typename Wire>
+    static size_t size(const rpc_list<T> &v)
+    {
+        size_t n = v.items ? v.len : 0;
+        constexpr size_t elem = detail::fixed_size<Wire, T>();
+        if constexpr (elem != 0) {
+            return 4 + n * elem;
+        } else {
+            size_t total = 4;
+            for (size_t i = 0; i < n; i++) total += esprpc::size<Wire>(v.items[i]);
+            return total;
+        }
+    }
+    template<typename Wire>
+    static int encode(uint8_t **p, const uint8_t *end, const rpc_list<T> &v)
+    {
+        size_t n = v.items ? v.len : 0;
+        if (esprpc_bin_write_u32(p, end, (uint32_t)n) != 0) return -1;
+        if constexpr (bulk<Wire>()) {
+            return codec<T>::write_array(p, end, v.items, n);
+        } else {
+            for (size_t i = 0; i < n; i++) {
+                if (esprpc::encode<Wire>(p, end, v.items[i]) != 0) return -1;
+            }
+            return 0;
+        }
+    }
+    /** count 超过 max_items 时返回 -1；数组从 arena 分配 */
+    template<typename Wire>
+    static int decode(const uint8_t **p, const uint8_t *end, rpc_list<T> *out, esprpc_arena_t *arena,
+                      uint32_t max_items = CONFIG_ESPRPC_LIST_MAX_ITEMS)
+    {
+        uint32_t count = 0;
+        if (esprpc_bin_read_u32(p, end, &count) != 0) return -1;
+        if (count > max_items) return -1;
+        T *arr = (T *)esprpc_arena_alloc(arena, count * sizeof(T));
+        if (!arr) return -1;
+        if constexpr (bulk<Wire>()) {
+            if (codec<T>::read_array(p, end, arr, count) != 0) return -1;
+        } else {
+            for (uint32_t i = 0; i < count; i++) {
+                if (esprpc::decode<Wire>(p, end, &arr[i], arena) != 0) return -1;
+            }
+        }
+        out->items = arr;
+        out->len = count;
+        return 0;
+    }
+};
+
+/** MAP(K, V)：[4B count][k0][v0][k1][v1]...；count 按 keys/values 任一为 NULL 时视为 0 */
+template<typename K, typename V>
+struct codec<rpc_map<K, V>> {
+    template<typename Wire>
+    static size_t size(const rpc_map<K, V> &v)
+    {
+        size_t n = (v.keys && v.values) ? v.len : 0;
+        constexpr size_t ks = detail::fixed_size<Wire, K>();
+        constexpr size_t vs = detail::fixed_size<Wire, V>();
+        if constexpr (ks != 0 && vs != 0) {
+            return 4 + n * (ks + vs);
+        } else {
+            size_t total = 4;
+            for (size_t i = 0; i < n; i++) {
+                total += esprpc::size<Wire>(v.keys[i]) + esprpc::size<Wire>(v.values[i]);
+            }
+            return total;
+        }
+    }
+    template<typename Wire>
+    static int encode(uint8_t **p, const uint8_t *end, const rpc_map<K, V> &v)
+    {
+        size_t n = (v.keys && v.values) ? v.len : 0;
+        if (esprpc_bin_write_u32(p, end, (uint32_t)n) != 0) return -1;
+        for (size_t i = 0; i < n; i++) {
+            if (esprpc::encode<Wire>(p, end, v.keys[i]) != 0) return -1;
+            if (esprpc::encode<Wire>(p, end, v.values[i]) != 0) return -1;
+        }
+        return 0;
+    }
+    /** count 超过 max_items 时返回 -1；keys/values 数组从 arena 分配，保持线上顺序，不去重 */
+    template<typename Wire>
+    static int decode(const uint8_t **p, const uint8_t *end, rpc_map<K, V> *out, esprpc_arena_t *arena,
+                      uint32_t max_items = CONFIG_ESPRPC_LIST_MAX_ITEMS)
+    {
+        uint32_t count = 0;
+        if (esprpc_bin_read_u32(p, end, &count) != 0) return -1;
+        if (count > max_items) return -1;
+        K *keys = (K *)esprpc_arena_alloc(arena, count * sizeof(K));
+        V *values = (V *)esprpc_arena_alloc(arena, count * sizeof(V));
+        if (!keys || !values) return -1;
+        for (uint32_t i = 0; i < count; i++) {
+            if (esprpc::decode<Wire>(p, end, &keys[i], arena) != 0) return -1;
+            if (esprpc::decode<Wire>(p, end, &values[i], arena) != 0) return -1;
+        }
+        out->keys = keys;
+        out->values = values;
+        out->len = count;
+        return 0;
+    }
+};
+
+/* ---------- struct：按 reflect<T>::fields 顺序逐字段 ---------- */
+
+namespace detail {
+
+/** 解码单个字段；LIST/MAP 字段带 ESPRPC_FIELD_MAX 上限 */
+template<typename Wire, typename T, typename F>
+int decode_field(const uint8_t **p, const uint8_t *end, T *out, esprpc_arena_t *arena, F)
+{
+    using M = typename member_of<std::remove_cv_t<decltype(F::member)>>::type;
+    if constexpr (is_counted<M>::value && F::max_items != 0) {
+        return codec<M>::template decode<Wire>(p, end, &(out->*F::member), arena, F::max_items);
+    } else {
+        return esprpc::decode<Wire>(p, end, &(out->*F::member), arena);
+    }
+}
+
+} // namespace detail
+
+template<typename T>
+struct codec<T, std::enable_if_t<detail::is_reflected<T>::value>> {
+    using fields = typename reflect<T>::fields;
+
+    template<typename Wire>
+    static size_t size(const T &v)
+    {
+        return std::apply([&](auto... f) { return (size_t(0) + ... + esprpc::size<Wire>(v.*decltype(f)::member)); },
+                          fields{});
+    }
+    template<typename Wire>
+    static int encode(uint8_t **p, const uint8_t *end, const T &v)
+    {
+        bool ok = std::apply([&](auto... f) { return (... && (esprpc::encode<Wire>(p, end, v.*decltype(f)::member) == 0)); },
+                             fields{});
+        return ok ? 0 : -1;
+    }
+    template<typename Wire>
+    static int decode(const uint8_t **p, const uint8_t *end, T *out, esprpc_arena_t *arena)
+    {
+        std::memset((void *)out, 0, sizeof(*out));
+        bool ok = std::apply([&](auto... f) { return (... && (detail::decode_field<Wire>(p, end, out, arena, f) == 0)); },
+                             fields{});
+        return ok ? 0 : -1;
+    }
+};
+
+/* ---------- 顶层字段 bitmap：第 i 位（字节 i/8 的位 i%8）对应第 i 个字段，增量流与字段掩码共用 ---------- */
+
+namespace detail {
+
+template<typename T>
+constexpr size_t field_count()
+{
+    return std::tuple_size_v<typename reflect<T>::fields>;
+}
+
+template<typename T>
+constexpr size_t field_bitmap_size()
+{
+    return (field_count<T>() + 7) / 8;
+}
+
+inline bool bit_set(const uint8_t *bitmap, size_t i)
+{
+    return (bitmap[i / 8] & (1u << (i % 8))) != 0;
+}
+
+/** 只解码 bitmap 中置位的字段，其余保持原值 */
+template<typename Wire, typename T, size_t... I>
+int decode_present(const uint8_t **p, const uint8_t *end, T *out, esprpc_arena_t *arena, const uint8_t *bitmap,
+                   std::index_sequence<I...>)
+{
+    using fields = typename reflect<T>::fields;
+    bool ok = (... && (!bit_set(bitmap, I) ||
+                       decode_field<Wire>(p, end, out, arena, std::tuple_element_t<I, fields>{}) == 0));
+    return ok ? 0 : -1;
+}
+
+} // namespace detail
+
+/* ---------- 增量流帧（格式见 esprpc_delta.h）：按顶层字段的编码字节比较 ---------- */
+
+namespace detail {
+
+/** 逐字段编码，ends[i] 记录第 i 个字段相对 base 的结束偏移 */
+template<typename Wire, typename T, size_t... I>
+int encode_fields(uint8_t **p, const uint8_t *end, const T &v, uint16_t *ends, const uint8_t *base,
+                  std::index_sequence<I...>)
+{
+    using fields = typename reflect<T>::fields;
+    bool ok = (... && (esprpc::encode<Wire>(p, end, v.*std::tuple_element_t<I, fields>::member) == 0 &&
+                       (ends[I] = (uint16_t)(*p - base), true)));
+    return ok ? 0 : -1;
+}
+
+} // namespace detail
+
+/** 增量帧的最大编码字节数（全部字段变化时） */
+template<typename Wire, typename T>
+inline size_t delta_size(const T &v)
+{
+    return 2 + detail::field_bitmap_size<T>() + esprpc::size<Wire>(v);
+}
+
+/**
+ * 编码一帧增量流：无基准或到达关键帧间隔时写关键帧，否则只写与上一帧编码不同的字段。
+ * 输出空间须不少于 delta_size(v)（先在输出中完整编码再原地压缩）。
+ */
+template<typename Wire, typename T>
+int encode_delta(esprpc_delta_t *d, uint8_t **p, const uint8_t *end, const T &v)
+{
+    constexpr size_t n = detail::field_count<T>();
+    constexpr size_t bm = detail::field_bitmap_size<T>();
+    static_assert(n > 0 && n <= ESPRPC_DELTA_MAX_FIELDS, "增量流 struct 的字段数须为 1..ESPRPC_DELTA_MAX_FIELDS");
+    uint8_t *out = *p;
+    if ((size_t)(end - out) < 2 + bm) return -1;
+    uint8_t *body = out + 2 + bm;
+    uint8_t *wp = body;
+    uint16_t ends[n];
+    if (detail::encode_fields<Wire>(&wp, end, v, ends, body, std::make_index_sequence<n>{}) != 0) return -1;
+    size_t full = (size_t)(wp - body);
+    if (full > 0xFFFF) return -1;
+
+    bool key = d->prev_len == 0 ||
+               (d->keyframe_interval != 0 && d->since_keyframe + 1u >= d->keyframe_interval);
+    uint8_t bitmap[bm] = {};
+    if (!key) {
+        for (size_t i = 0; i < n; i++) {
+            size_t ns = i ? ends[i - 1] : 0;
+            size_t os = i ? d->field_end[i - 1] : 0;
+            size_t len = ends[i] - ns;
+            if (len != (size_t)(d->field_end[i] - os) || std::memcmp(body + ns, d->prev + os, len) != 0) {
+                bitmap[i / 8] |= (uint8_t)(1u << (i % 8));
+            }
+        }
+    }
+    /* 本帧完整编码作为下一帧的比较基准（放不下则下一帧发关键帧） */
+    if (full <= d->prev_cap) {
+        std::memcpy(d->prev, body, full);
+        std::memcpy(d->field_end, ends, sizeof(ends));
+        d->prev_len = full;
+    } else {
+        d->prev_len = 0;
+    }
+    out[1] = d->seq++;
+    if (key) {
+        out[0] = ESPRPC_DELTA_KEYFRAME;
+        std::memmove(out + 2, body, full);
+        *p = out + 2 + full;
+        d->since_keyframe = 0;
+        return 0;
+    }
+    out[0] = 0;
+    std::memcpy(out + 2, bitmap, bm);
+    uint8_t *dst = body;
+    for (size_t i = 0; i < n; i++) {
+        if (!detail::bit_set(bitmap, i)) continue;
+        size_t s = i ? ends[i - 1] : 0;
+        std::memmove(dst, body + s, ends[i] - s);
+        dst += ends[i] - s;
+    }
+    *p = dst;
+    d->since_keyframe++;
+    return 0;
+}
+
+/**
+ * 解码一帧增量流到 *inout：关键帧整体覆盖；增量帧只更新出现的字段，其余保留上一帧的值
+ * （其字符串/数组所在内存须仍有效）。无基准或序号不连续时返回 -1，直到收到下一个关键帧。
+ */
+template<typename Wire, typename T>
+int decode_delta(esprpc_delta_rx_t *rx, const uint8_t **p, const uint8_t *end, T *inout, esprpc_arena_t *arena)
+{
+    constexpr size_t n = detail::field_count<T>();
+    constexpr size_t bm = detail::field_bitmap_size<T>();
+    if (end - *p < 2) return -1;
+    uint8_t flags = (*p)[0];
+    uint8_t seq = (*p)[1];
+    *p += 2;
+    int ret;
+    if (flags & ESPRPC_DELTA_KEYFRAME) {
+        ret = esprpc::decode<Wire>(p, end, inout, arena);
+    } else if (!rx->valid || seq != rx->seq || (size_t)(end - *p) < bm) {
+        ret = -1;
+    } else {
+        const uint8_t *bitmap = *p;
+        *p += bm;
+        ret = detail::decode_present<Wire>(p, end, inout, arena, bitmap, std::make_index_sequence<n>{});
+    }
+    rx->valid = ret == 0;
+    rx->seq = (uint8_t)(seq + 1);
+    return ret;
+}
+
+/* ---------- 字段掩码（"fieldmask"）：响应只编码 bitmap 中置位的顶层字段 ---------- */
+
+namespace detail {
+
+/** 掩码作用的 struct：T 本身，LIST(T)/PAGED(T) 时为元素 */
+template<typename T>
+struct masked_struct {
+    using type = T;
+};
+template<typename T>
+struct masked_struct<rpc_list<T>> {
+    using type = T;
+};
+template<typename T>
+struct masked_struct<rpc_cursor<T>> {
+    using type = T;
+};
+
+template<typename Wire, typename T, size_t... I>
+size_t size_present(const T &v, const uint8_t *mask, std::index_sequence<I...>)
+{
+    using fields = typename reflect<T>::fields;
+    return (size_t(0) + ... + (bit_set(mask, I) ? esprpc::size<Wire>(v.*std::tuple_element_t<I, fields>::member) : 0));
+}
+
+template<typename Wire, typename T, size_t... I>
+int encode_present(uint8_t **p, const uint8_t *end, const T &v, const uint8_t *mask, std::index_sequence<I...>)
+{
+    using fields = typename reflect<T>::fields;
+    bool ok = (... && (!bit_set(mask, I) ||
+                       esprpc::encode<Wire>(p, end, v.*std::tuple_element_t<I, fields>::member) == 0));
+    return ok ? 0 : -1;
+}
+
+} // namespace detail
+
+/** T（struct 或 LIST(struct)）的字段掩码字节数 */
+template<typename T>
+constexpr size_t fieldmask_size()
+{
+    return detail::field_bitmap_size<typename detail::masked_struct<T>::type>();
+}
+
+/** 读取请求开头的字段掩码；*mask 指向请求帧内，不拷贝 */
+template<typename T>
+int read_fieldmask(const uint8_t **p, const uint8_t *end, const uint8_t **mask)
+{
+    constexpr size_t bm = fieldmask_size<T>();
+    if ((size_t)(end - *p) < bm) return -1;
+    *mask = *p;
+    *p += bm;
+    return 0;
+}
+
+/** 掩码响应 [bitmap][值] 的编码字节数；LIST 时每个元素都按掩码编码 */
+template<typename Wire, typename T>
+size_t masked_size(const T &v, const uint8_t *mask)
+{
+    using S = typename detail::masked_struct<T>::type;
+    constexpr auto idx = std::make_index_sequence<detail::field_count<S>()>{};
+    size_t total = fieldmask_size<T>();
+    if constexpr (std::is_same_v<S, T>) {
+        total += detail::size_present<Wire>(v, mask, idx);
+    } else {
+        size_t n = v.items ? v.len : 0;
+        total += 4;
+        for (size_t i = 0; i < n; i++) total += detail::size_present<Wire>(v.items[i], mask, idx);
+    }
+    return total;
+}
+
+/** 编码掩码响应：先回写 bitmap，再按字段顺序只写置位的字段 */
+template<typename Wire, typename T>
+int encode_masked(uint8_t **p, const uint8_t *end, const T &v, const uint8_t *mask)
+{
+    using S = typename detail::masked_struct<T>::type;
+    constexpr auto idx = std::make_index_sequence<detail::field_count<S>()>{};
+    constexpr size_t bm = fieldmask_size<T>();
+    if ((size_t)(end - *p) < bm) return -1;
+    std::memcpy(*p, mask, bm);
+    *p += bm;
+    if constexpr (std::is_same_v<S, T>) {
+        return detail::encode_present<Wire>(p, end, v, mask, idx);
+    } else {
+        size_t n = v.items ? v.len : 0;
+        if (esprpc_bin_write_u32(p, end, (uint32_t)n) != 0) return -1;
+        for (size_t i = 0; i < n; i++) {
+            if (detail::encode_present<Wire>(p, end, v.items[i], mask, idx) != 0) return -1;
+        }
+        return 0;
+    }
+}
+
+/** 解码掩码响应；未请求的字段为零值 */
+template<typename Wire, typename T>
+int decode_masked(const uint8_t **p, const uint8_t *end, T *out, esprpc_arena_t *arena)
+{
+    using S = typename detail::masked_struct<T>::type;
+    constexpr auto idx = std::make_index_sequence<detail::field_count<S>()>{};
+    const uint8_t *mask = nullptr;
+    if (read_fieldmask<T>(p, end, &mask) != 0) return -1;
+    if constexpr (std::is_same_v<S, T>) {
+        std::memset((void *)out, 0, sizeof(*out));
+        return detail::decode_present<Wire>(p, end, out, arena, mask, idx);
+    } else {
+        uint32_t count = 0;
+        if (esprpc_bin_read_u32(p, end, &count) != 0) return -1;
+        if (count > CONFIG_ESPRPC_LIST_MAX_ITEMS) return -1;
+        S *arr = (S *)esprpc_arena_alloc(arena, count * sizeof(S));
+        if (!arr) return -1;
+        std::memset((void *)arr, 0, count * sizeof(S));
+        for (uint32_t i = 0; i < count; i++) {
+            if (detail::decode_present<Wire>(p, end, &arr[i], arena, mask, idx) != 0) return -1;
+        }
+        out->items = arr;
+        out->len = count;
+        return 0;
+    }
+}
+
+/* ---------- 分页列表（PAGED(T)）：逐个取游标元素编码，攒满一页即经 esprpc_send_partial 发给 arena 所属请求 ---------- */
+
+namespace detail {
+
+/** 页内单个元素：mask 非空时只编码置位的字段（"fieldmask"） */
+template<typename Wire, typename T>
+size_t page_item_size(const T &v, const uint8_t *mask)
+{
+    if constexpr (is_reflected<T>::value) {
+        if (mask) return size_present<Wire>(v, mask, std::make_index_sequence<field_count<T>()>{});
+    }
+    return esprpc::size<Wire>(v);
+}
+
+template<typename Wire, typename T>
+int encode_page_item(uint8_t **p, const uint8_t *end, const T &v, const uint8_t *mask)
+{
+    if constexpr (is_reflected<T>::value) {
+        if (mask) return encode_present<Wire>(p, end, v, mask, std::make_index_sequence<field_count<T>()>{});
+    }
+    return esprpc::encode<Wire>(p, end, v);
+}
+
+} // namespace detail
+
+/**
+ * 按页编码游标中的全部元素。每页 payload 为 [1B flags][bitmap，仅 mask 非空时][4B count][元素...]，
+ * 即 flags 加上与非分页 LIST 响应相同的编码；每页至多 page_items 个元素，且整帧不超过一个帧池块。
+ * 中间页（flags 含 ESPRPC_PAGE_MORE）直接发送，最后一页（可能为空）经 resp_buf 返回给 dispatch 调用方。
+ * 中途放弃（单个元素放不进一页、编码或发送中间页失败）时最后一页为不含元素、flags 为 ESPRPC_PAGE_ERROR 的页，
+ * 客户端据此结束调用而不是等到超时。
+ */
+template<typename Wire, typename T>
+int encode_paged(rpc_cursor<T> cur, size_t page_items, const uint8_t *mask, const esprpc_arena_t *req,
+                 uint8_t **resp_buf, size_t *resp_len)
+{
+    const size_t cap = CONFIG_ESPRPC_POOL_BLOCK_SIZE - 5; /* 减去帧头 */
+    size_t bm = 0;
+    if constexpr (detail::is_reflected<T>::value) {
+        if (mask) bm = detail::field_bitmap_size<T>();
+    }
+    const size_t head = 1 + bm + 4;
+    uint8_t *buf = (uint8_t *)malloc(cap);
+    if (!buf) return -1;
+    if (mask) std::memcpy(buf + 1, mask, bm);
+    uint8_t *wp = buf + head;
+    uint32_t count = 0;
+    bool abandoned = false;
+    T item;
+    bool have = cur.next && cur.next(cur.ctx, &item);
+    while (have) {
+        size_t n = detail::page_item_size<Wire>(item, mask);
+        if (head + n > cap) { /* 单个元素放不进一页 */
+            abandoned = true;
+            break;
+        }
+        if (count == page_items || (size_t)(wp - buf) + n > cap) {
+            uint8_t *cp = buf + 1 + bm;
+            buf[0] = ESPRPC_PAGE_MORE;
+            esprpc_bin_write_u32(&cp, buf + head, count);
+            if (esprpc_send_partial(req, buf, (size_t)(wp - buf)) != ESP_OK) {
+                abandoned = true;
+                break;
+            }
+            wp = buf + head;
+            count = 0;
+        }
+        if (detail::encode_page_item<Wire>(&wp, buf + cap, item, mask) != 0) {
+            abandoned = true;
+            break;
+        }
+        count++;
+        have = cur.next(cur.ctx, &item);
+    }
+    if (abandoned) { /* 已攒的元素不再发送，以空的错误页结束调用 */
+        wp = buf + head;
+        count = 0;
+    }
+    {
+        uint8_t *cp = buf + 1 + bm;
+        buf[0] = abandoned ? ESPRPC_PAGE_ERROR : 0;
+        esprpc_bin_write_u32(&cp, buf + head, count);
+    }
+    *resp_buf = buf;
+    *resp_len = (size_t)(wp - buf);
+    return 0;
+}
+
+} // namespace esprpc
+
+/** 描述 struct 的字段（按线上顺序），在全局作用域使用：ESPRPC_REFLECT(T, ESPRPC_FIELD(T, a), ...) */
+#define ESPRPC_REFLECT(T, ...)                    \
+    namespace esprpc {                            \
+    template<>                                    \
+    struct reflect<T> {                           \
+        using fields = std::tuple<__VA_ARGS__>;   \
+    };                                            \
+    }
+
+/** 普通字段 */
+#define ESPRPC_FIELD(T, name) ::esprpc::field<&T::name>
+
+/** LIST/MAP 字段，解码时 count 不得超过 max */
+#define ESPRPC_FIELD_MAX(T, name, max) ::esprpc::field<&T::name, (uint32_t)(max)>
+
+#endif /* ESPRPC_CODEC_HPP */
@@ -0,0 +1,69 @@
+/**
+ * @file esprpc_delta.h
+ * @brief 增量流帧（schema 中 RPC_METHOD_EX(..., STREAM(T), ..., "delta[:N]")）的编解码状态
+ *
+ * 帧 payload: [1B flags][1B seq][bitmap][字段...]
+ * - flags 的 ESPRPC_DELTA_KEYFRAME 位为 1 时是关键帧：无 bitmap，随后为 T 的完整编码
+ * - 否则为增量帧：bitmap 共 ceil(字段数/8) 字节，第 i 位（字节 i/8 的位 i%8）为 1 表示
+ *   第 i 个顶层字段有变化，随后仅按字段顺序写出变化字段的编码
+ * - seq 每帧加 1（mod 256）；接收端发现序号不连续时丢弃增量帧，直到下一个关键帧
+ *
+ * 发送端比较的是字段编码字节，不保存 T 本身，因此字符串等指针字段无需深拷贝。
+ */
+
+#ifndef ESPRPC_DELTA_H
+#define ESPRPC_DELTA_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** 单个增量流 struct 的顶层字段数上限（bitmap 最多 4 字节） */
+#define ESPRPC_DELTA_MAX_FIELDS 32
+
+/** flags：关键帧 */
+#define ESPRPC_DELTA_KEYFRAME 0x01
+
+/** 发送端状态：每个增量流一个，prev 由调用方提供 */
+typedef struct esprpc_delta {
+    uint8_t *prev;              /* 上一帧 T 的完整编码 */
+    size_t prev_cap;
+    size_t prev_len;            /* 0 表示尚无基准，下一帧为关键帧 */
+    uint16_t field_end[ESPRPC_DELTA_MAX_FIELDS]; /* 各字段在 prev 中的结束偏移 */
+    uint16_t keyframe_interval; /* 每 N 帧一个关键帧；0 表示仅首帧 */
+    uint16_t since_keyframe;
+    uint8_t seq;
+} esprpc_delta_t;
+
+/** 接收端状态 */
+typedef struct esprpc_delta_rx {
+    bool valid;   /* 已有关键帧基准且未丢帧 */
+    uint8_t seq;  /* 期望的下一帧序号 */
+} esprpc_delta_rx_t;
+
+/** 以调用方提供的缓冲区初始化发送端状态；cap 不足以容纳某帧完整编码时，下一帧退化为关键帧 */
+static inline void esprpc_delta_init(esprpc_delta_t *d, void *prev_buf, size_t cap, uint16_t keyframe_interval)
+{
+    d->prev = (uint8_t *)prev_buf;
+    d->prev_cap = prev_buf ? cap : 0;
+    d->prev_len = 0;
+    d->keyframe_interval = keyframe_interval;
+    d->since_keyframe = 0;
+    d->seq = 0;
+}
+
+/** 强制下一帧为关键帧（如有新订阅者时） */
+static inline void esprpc_delta_reset(esprpc_delta_t *d)
+{
+    d->prev_len = 0;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ESPRPC_DELTA_H */
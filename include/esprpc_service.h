@@ -9,7 +9,19 @@
 #ifndef ESPRPC_SERVICE_H
 #define ESPRPC_SERVICE_H
 
+#include "sdkconfig.h"
 #include "esprpc.h"
+#include "esprpc_arena.h"
+
+/* 生成的解码代码中 LIST 的默认元素上限（字段可用 LIST_MAX(T, N) 单独指定） */
+#ifndef CONFIG_ESPRPC_LIST_MAX_ITEMS
+#define CONFIG_ESPRPC_LIST_MAX_ITEMS 256
+#endif
+
+/* 响应/流帧池块大小：不支持 sendv 的传输在池块中拼接整帧，分页响应按此限制单页大小 */
+#ifndef CONFIG_ESPRPC_POOL_BLOCK_SIZE
+#define CONFIG_ESPRPC_POOL_BLOCK_SIZE 2048
+#endif
 
 #ifdef __cplusplus
 extern "C" {
@@ -23,10 +35,12 @@ extern "C" {
  * @param resp_buf 输出：响应数据（调用方负责释放）
  * @param resp_len 输出：响应长度
  * @param svc_ctx 服务实现上下文
+ * @param arena 本次请求的 arena，解码出的字符串/数组从中分配，dispatch 返回后由调用方回收
  * @return ESP_OK 成功
  */
 typedef int (*esprpc_dispatch_fn)(uint16_t method_id, const uint8_t *req_buf, size_t req_len,
-                                  uint8_t **resp_buf, size_t *resp_len, void *svc_ctx);
+                                  uint8_t **resp_buf, size_t *resp_len, void *svc_ctx,
+                                  esprpc_arena_t *arena);
 
 /**
  * @brief 注册服务（扩展版）
@@ -4,14 +4,19 @@
  *
  * 传输层负责底层收发，框架不关心具体实现（WebSocket/BLE/UART 等）。
  * 实现者需提供 send/start/stop 及 ctx，并在收到数据时调用 on_recv。
+ * 可选提供 sendv：框架发送帧头 + payload 时不再拼接，直接交给传输。
+ * 一个传输上有多个对端（WebSocket 会话、BLE 连接）时提供 reply_route/sendv_to，
+ * 响应与分页中间页只发回发起请求的对端，可在任意任务中发送。
  */
 
 #ifndef ESPRPC_TRANSPORT_H
 #define ESPRPC_TRANSPORT_H
 
+#include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
 #include "esp_err.h"
+#include "esprpc.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -27,14 +32,30 @@ typedef void (*esprpc_transport_on_recv_fn)(const uint8_t *data, size_t len, voi
 typedef struct esprpc_transport {
     /** 发送数据 */
     esp_err_t (*send)(void *ctx, const uint8_t *data, size_t len);
+    /** 可选：分段发送一帧（iov 各段顺序拼接即为帧），为 NULL 时框架拼接后调用 send */
+    esp_err_t (*sendv)(void *ctx, const esprpc_iovec_t *iov, size_t iovcnt);
     /** 启动传输，注册接收回调 */
     esp_err_t (*start)(void *ctx, esprpc_transport_on_recv_fn on_recv, void *user_ctx);
     /** 停止传输 */
     void (*stop)(void *ctx);
     /** 传输上下文 */
     void *ctx;
+    /** 可选：在收包回调中调用，取出本次请求的回复目标（WebSocket 会话 fd、BLE 连接句柄）；为 NULL 表示传输只有一个对端 */
+    esp_err_t (*reply_route)(void *ctx, uint32_t *route);
+    /** 可选：把一帧只发给 reply_route 取得的目标，可在任意任务中调用；目标已断开时返回 ESP_ERR_NOT_FOUND */
+    esp_err_t (*sendv_to)(void *ctx, uint32_t route, const esprpc_iovec_t *iov, size_t iovcnt);
 } esprpc_transport_t;
 
+/**
+ * @brief 处理 transport 收到的 RPC 请求：响应与分页中间页只发回该传输（及 reply_route 取得的对端），
+ *        不广播给其他传输。transport 为 NULL 时等同 esprpc_handle_request
+ * @param transport 收到请求的传输（已 esprpc_transport_add 的实例）
+ * @param data 完整帧数据
+ * @param len 帧长度
+ * @note 通常作为接收回调：transport->start(ctx, on_recv, transport)，on_recv 中以 user_ctx 调用本函数
+ */
+void esprpc_handle_request_from(esprpc_transport_t *transport, const uint8_t *data, size_t len);
+
 /**
  * @brief 添加传输层
  * @param transport 传输实例
@@ -48,6 +69,55 @@ esp_err_t esprpc_transport_add(esprpc_transport_t *transport);
  */
 void esprpc_transport_remove(esprpc_transport_t *transport);
 
+/* ---------- 发送队列（TX 任务） ---------- */
+
+/** 发送队列满时的处理策略 */
+typedef enum {
+    ESPRPC_TXQ_BLOCK = 0,     /* 生产者阻塞直到有空位 */
+    ESPRPC_TXQ_DROP_NEWEST,   /* 丢弃本帧 */
+    ESPRPC_TXQ_DROP_OLDEST,   /* 丢弃队列中最旧的一帧后入队 */
+} esprpc_txq_overflow_t;
+
+/** 发送队列配置 */
+typedef struct {
+    uint16_t depth;                  /* 队列深度（帧） */
+    uint8_t priority;                /* 发送任务优先级 */
+    uint32_t stack_size;             /* 发送任务栈大小（字节） */
+    int core_id;                     /* 发送任务绑定的核，<0 表示不绑核 */
+    esprpc_txq_overflow_t overflow;  /* 队列满时的策略 */
+} esprpc_txq_config_t;
+
+#define ESPRPC_TXQ_CONFIG_DEFAULT() { \
+    .depth = 16,                      \
+    .priority = 5,                    \
+    .stack_size = 3072,               \
+    .core_id = -1,                    \
+    .overflow = ESPRPC_TXQ_BLOCK,     \
+}
+
+/**
+ * @brief 为传输层套一个发送队列和独立的发送任务：返回的传输实例的 send/sendv 只把帧拷贝到
+ *        引用计数帧缓冲并入队，由发送任务调用 inner 的 sendv/send，生产者不再受链路速度阻塞
+ * @param inner 被包装的传输（如串口），start/stop 直接转给它
+ * @param cfg 队列配置，NULL 使用 ESPRPC_TXQ_CONFIG_DEFAULT()
+ * @return 包装后的传输实例（用于 esprpc_transport_add），失败返回 NULL
+ * @note inner 提供 reply_route/sendv_to 时（WebSocket、BLE），包装后的实例同样提供：回复目标在入队时确定、随帧入队，
+ *       发送任务经 inner 的 sendv_to 只发给该会话/连接；请求须经 esprpc_handle_request_from(包装后的实例, ...) 进入，
+ *       或在 inner 的收包回调中入队。流帧（invoke_id=0）仍按 inner 的订阅规则发送
+ */
+esprpc_transport_t *esprpc_txq_create(esprpc_transport_t *inner, const esprpc_txq_config_t *cfg);
+
+/**
+ * @brief 销毁发送队列：等发送任务发完已入队的帧并退出后释放资源，返回后可安全 esprpc_deinit
+ * @param txq esprpc_txq_create 的返回值，调用前须已 esprpc_transport_remove；不要在 inner 的发送路径中调用
+ */
+void esprpc_txq_destroy(esprpc_transport_t *txq);
+
+/**
+ * @brief 队列满被丢弃的帧数（DROP_NEWEST/DROP_OLDEST 策略）
+ */
+uint32_t esprpc_txq_dropped(const esprpc_transport_t *txq);
+
 /* ---------- WebSocket 传输 ---------- */
 
 /**
@@ -79,6 +149,24 @@ esp_err_t esprpc_transport_ble_init(void);
  */
 esprpc_transport_t *esprpc_transport_ble_get(void);
 
+/** BLE 收发统计（所有连接合计，断开时不清零；一帧发给 N 个连接计 N 次） */
+typedef struct {
+    uint32_t frames_sent;     /* 全部分段已交给协议栈的帧 */
+    uint32_t frames_queued;   /* 拥塞或队列非空时进入通知队列的帧 */
+    uint32_t frames_dropped;  /* 队列满、断开或协议栈报错而丢弃的帧 */
+    uint32_t congestion;      /* notify 因 mbuf 不足（BLE_HS_ENOMEM）暂停的次数 */
+    uint16_t queue_len;       /* 当前各连接队列中的帧数之和 */
+    uint16_t queue_peak;      /* 单个连接队列的最高水位 */
+    uint32_t frames_recv;     /* 交给 on_recv 的请求帧 */
+    uint32_t frames_recv_copied; /* 其中多段或跨 mbuf、经拼接缓冲拷贝的帧（其余直接引用 mbuf） */
+} esprpc_ble_stats_t;
+
+/**
+ * @brief 读取 BLE 收发统计
+ * @return ESP_OK；BLE 未启用时 ESP_ERR_NOT_SUPPORTED
+ */
+esp_err_t esprpc_transport_ble_get_stats(esprpc_ble_stats_t *out);
+
 /* ---------- 串口（UART）传输 ---------- */
 
 /**
@@ -102,11 +190,39 @@ void esprpc_serial_feed_packet(const uint8_t *data, size_t len);
 
 /**
  * @brief 外部管理串口时：把带前后缀的原始包交给框架（内部会按配置剥掉前后缀）
- * @param data 原始包 [prefix][RPC 帧][suffix]
+ * @param data 原始包 [prefix][RPC 帧][suffix]；COBS 模式下为一个编码后的包
  * @param len  总长度
  */
 void esprpc_serial_feed_raw_packet(const uint8_t *data, size_t len);
 
+/**
+ * @brief 外部管理串口时：把从串口读到的任意字节块交给框架，由框架按前后缀成帧
+ * @param data 任意长度的字节块，可含日志等非 RPC 数据，包可跨多次调用（按前后缀或 COBS 成帧）；len 为 0 时可为 NULL
+ * @param len  长度；读串口超时没有数据时以 0 调用，使静默超过 CONFIG_ESPRPC_SERIAL_RX_TIMEOUT_MS 的半包被放弃
+ *             （前后缀模式下从半包的下一字节重新找包）
+ * @note 只能由同一个任务调用；前后缀模式下完整落在本次数据中的包直接交给 on_recv，不拷贝
+ */
+void esprpc_serial_feed_bytes(const uint8_t *data, size_t len);
+
+/** esprpc_serial_feed_bytes 成帧与 ARQ 链路统计 */
+typedef struct {
+    uint32_t frames;          /* 成帧的包（含 on_recv 未注册时丢弃的） */
+    uint32_t frames_copied;   /* 其中经拼包缓冲拷贝的包（跨两次输入的半包；COBS 模式下为全部） */
+    uint32_t resyncs;         /* 前缀后长度超限或后缀不符、从下一字节重新找前缀的次数 */
+    uint32_t bytes_skipped;   /* 不属于任何包而跳过的字节（日志、噪声） */
+    uint32_t frames_corrupt;  /* COBS 模式下 CRC 或长度不符、超长而丢弃的包（含两个 0x00 之间的日志） */
+    uint32_t arq_retransmits;       /* ARQ：重发的帧（超时与快速重传） */
+    uint32_t arq_fast_retransmits;  /* ARQ：收到 REJ 后立即重发窗口的次数 */
+    uint32_t arq_discarded;         /* ARQ：乱序、重复或应答积压而未接收的 DATA 帧 */
+    uint32_t arq_dropped;           /* ARQ：链路断开时发送队列满、或应答队列扩容失败而丢弃的帧 */
+} esprpc_serial_stats_t;
+
+/**
+ * @brief 读取 esprpc_serial_feed_bytes 成帧统计
+ * @return ESP_OK；串口传输未启用时 ESP_ERR_NOT_SUPPORTED
+ */
+esp_err_t esprpc_serial_get_stats(esprpc_serial_stats_t *out);
+
 /** 前后缀最大字节数（用于 get_packet_marker 缓冲区） */
 #define ESPRPC_SERIAL_MARKER_MAX 16
 
@@ -130,6 +246,14 @@ void esprpc_serial_get_packet_marker(uint8_t *prefix_buf, size_t prefix_max, siz
  */
 esp_err_t esprpc_serial_set_tx_cb(void (*tx_fn)(const uint8_t *data, size_t len, void *ctx), void *ctx);
 
+/**
+ * @brief 可选：注册分段发送回调，注册后优先于 tx_cb，框架不再拼接 prefix + 帧 + suffix
+ * @param txv_fn 应用提供的发送函数，iov 各段顺序写出即为完整包，需整包原子写入
+ * @param ctx    txv_fn 的 user_ctx
+ * @return ESP_OK 成功
+ */
+esp_err_t esprpc_serial_set_txv_cb(void (*txv_fn)(const esprpc_iovec_t *iov, size_t iovcnt, void *ctx), void *ctx);
+
 #ifdef __cplusplus
 }
 #endif
@@ -25,9 +25,7 @@
 #include "driver/usb_serial_jtag.h"
 
 /* 使用 ESP32-C3 原生 USB Serial/JTAG（与 idf.py monitor 同口时，可在 menuconfig 将控制台改为 UART 避免占用） */
-static constexpr size_t kSerialFrameHeader = 5;
-static constexpr size_t kSerialFrameBufSize =
-    ESPRPC_SERIAL_MARKER_MAX + kSerialFrameHeader + CONFIG_ESPRPC_SERIAL_PAYLOAD_MAX + ESPRPC_SERIAL_MARKER_MAX;
+static constexpr size_t kSerialReadChunk = 256;
 
 static void serial_usb_jtag_tx_cb(const uint8_t *data, size_t len, void *ctx)
 {
@@ -38,158 +36,16 @@ static void serial_usb_jtag_tx_cb(const uint8_t *data, size_t len, void *ctx)
   }
 }
 
-static size_t find_prefix(const uint8_t *buf, size_t buf_len,
-                          const uint8_t *prefix, size_t prefix_len)
-{
-  if (prefix_len == 0 || buf_len < prefix_len)
-    return buf_len;
-  for (size_t i = 0; i <= buf_len - prefix_len; i++)
-  {
-    if (memcmp(buf + i, prefix, prefix_len) == 0)
-      return i;
-  }
-  return buf_len;
-}
-
+/* 读到多少交给框架多少，由 esprpc_serial_feed_bytes 按前后缀成帧并跳过日志等非 RPC 数据；
+ * 读超时以长度 0 调用，让框架放弃静默过久的半包 */
 static void serial_recv_task(void *arg)
 {
   (void)arg;
-  uint8_t prefix_buf[ESPRPC_SERIAL_MARKER_MAX], suffix_buf[ESPRPC_SERIAL_MARKER_MAX];
-  size_t prefix_len = 0, suffix_len = 0;
-  esprpc_serial_get_packet_marker(prefix_buf, sizeof(prefix_buf), &prefix_len,
-                                  suffix_buf, sizeof(suffix_buf), &suffix_len);
-
-  static uint8_t frame_buf[kSerialFrameBufSize];
-  uint8_t sync_buf[32];
-  size_t sync_len = 0;
-
+  static uint8_t buf[kSerialReadChunk];
   while (1)
   {
-    if (prefix_len > 0)
-    {
-      while (sync_len < prefix_len)
-      {
-        int n = usb_serial_jtag_read_bytes(sync_buf + sync_len, prefix_len - sync_len, pdMS_TO_TICKS(100));
-        if (n > 0)
-          sync_len += static_cast<size_t>(n);
-        if (n <= 0 && sync_len > 0)
-          break;
-      }
-      if (sync_len < prefix_len)
-        continue;
-      size_t idx = find_prefix(sync_buf, sync_len, prefix_buf, prefix_len);
-      if (idx >= sync_len)
-      {
-        memmove(sync_buf, sync_buf + 1, sync_len - 1);
-        sync_len--;
-        continue;
-      }
-      memcpy(frame_buf, prefix_buf, prefix_len);
-      size_t after_prefix = sync_len - idx - prefix_len;
-      if (after_prefix > 0)
-        memcpy(frame_buf + prefix_len, sync_buf + idx + prefix_len, after_prefix);
-      sync_len = 0;
-
-      size_t need = kSerialFrameHeader;
-      size_t got = after_prefix;
-      while (got < need)
-      {
-        int n = usb_serial_jtag_read_bytes(frame_buf + prefix_len + got, need - got, pdMS_TO_TICKS(100));
-        if (n > 0)
-          got += static_cast<size_t>(n);
-        if (n <= 0 && got > 0)
-          break;
-      }
-      if (got < need)
-        continue;
-
-      uint16_t payload_len = static_cast<uint16_t>(frame_buf[prefix_len + 3]) |
-                             (static_cast<uint16_t>(frame_buf[prefix_len + 4]) << 8);
-      if (payload_len > CONFIG_ESPRPC_SERIAL_PAYLOAD_MAX)
-      {
-        sync_len = 0;
-        continue;
-      }
-      need = kSerialFrameHeader + payload_len;
-      while (got < need)
-      {
-        int n = usb_serial_jtag_read_bytes(frame_buf + prefix_len + got, need - got, pdMS_TO_TICKS(500));
-        if (n > 0)
-          got += static_cast<size_t>(n);
-        if (n <= 0 && got > 0)
-          break;
-      }
-      if (got < need)
-        continue;
-
-      if (suffix_len > 0)
-      {
-        size_t left = suffix_len;
-        while (left > 0)
-        {
-          int n = usb_serial_jtag_read_bytes(frame_buf + prefix_len + got, left, pdMS_TO_TICKS(100));
-          if (n > 0)
-          {
-            got += static_cast<size_t>(n);
-            left -= static_cast<size_t>(n);
-          }
-          if (n <= 0)
-            break;
-        }
-        if (left > 0)
-          continue;
-      }
-
-      esprpc_serial_feed_raw_packet(frame_buf, prefix_len + got + suffix_len);
-      continue;
-    }
-
-    size_t got = 0;
-    while (got < kSerialFrameHeader)
-    {
-      int n = usb_serial_jtag_read_bytes(frame_buf + got, kSerialFrameHeader - got, pdMS_TO_TICKS(100));
-      if (n > 0)
-        got += static_cast<size_t>(n);
-      if (n <= 0 && got > 0)
-        break;
-    }
-    if (got < kSerialFrameHeader)
-      continue;
-
-    uint16_t payload_len = static_cast<uint16_t>(frame_buf[3]) | (static_cast<uint16_t>(frame_buf[4]) << 8);
-    if (payload_len > CONFIG_ESPRPC_SERIAL_PAYLOAD_MAX)
-      continue;
-    size_t need = kSerialFrameHeader + payload_len;
-    while (got < need)
-    {
-      int n = usb_serial_jtag_read_bytes(frame_buf + got, need - got, pdMS_TO_TICKS(500));
-      if (n > 0)
-        got += static_cast<size_t>(n);
-      if (n <= 0 && got > 0)
-        break;
-    }
-    if (got < need)
-      continue;
-
-    if (suffix_len > 0)
-    {
-      size_t left = suffix_len;
-      while (left > 0)
-      {
-        int n = usb_serial_jtag_read_bytes(frame_buf + got, left, pdMS_TO_TICKS(100));
-        if (n > 0)
-        {
-          got += static_cast<size_t>(n);
-          left -= static_cast<size_t>(n);
-        }
-        if (n <= 0)
-          break;
-      }
-      if (left > 0)
-        continue;
-    }
-
-    esprpc_serial_feed_raw_packet(frame_buf, got);
+    int n = usb_serial_jtag_read_bytes(buf, sizeof(buf), pdMS_TO_TICKS(20));
+    esprpc_serial_feed_bytes(buf, n > 0 ? static_cast<size_t>(n) : 0);
   }
 }
 
@@ -217,11 +73,11 @@ static const char *TAG = "main";
 static const char *TAG_WIFI = "main";
 
 /* 传输层接收回调：将数据交给 esprpc 处理（二进制帧） */
+/* user_ctx 为收到请求的传输实例，响应只发回该传输 */
 static void transport_recv_to_rpc(const uint8_t *data, size_t len,
                                   void *user_ctx)
 {
-  (void)user_ctx;
-  esprpc_handle_request(data, len);
+  esprpc_handle_request_from((esprpc_transport_t *)user_ctx, data, len);
 }
 
 static void wifi_init_sta(void)
@@ -291,7 +147,7 @@ extern "C" void app_main(void)
   if (ws)
   {
     esprpc_transport_add(ws);
-    ws->start(ws->ctx, transport_recv_to_rpc, NULL);
+    ws->start(ws->ctx, transport_recv_to_rpc, ws);
   }
   /* HTTP 服务器在 WiFi 获取 IP 后启动（见 on_wifi_ip_event） */
   ESP_ERROR_CHECK(esp_event_handler_register(IP_EVENT, IP_EVENT_STA_GOT_IP,
@@ -305,7 +161,7 @@ extern "C" void app_main(void)
   if (ble)
   {
     esprpc_transport_add(ble);
-    ble->start(ble->ctx, transport_recv_to_rpc, NULL);
+    ble->start(ble->ctx, transport_recv_to_rpc, ble);
   }
 #endif
 
@@ -321,7 +177,7 @@ extern "C" void app_main(void)
   if (serial)
   {
     esprpc_transport_add(serial);
-    serial->start(serial->ctx, transport_recv_to_rpc, NULL);
+    serial->start(serial->ctx, transport_recv_to_rpc, serial);
   }
 #endif
 
@@ -1,19 +1,51 @@
 /* Auto-generated - do not edit */
 #ifndef USER_SERVICE_RPC_GEN_HPP
 #define USER_SERVICE_RPC_GEN_HPP
+#include "esprpc_codec.hpp"
 #include "user_service.rpc.hpp"
 #include <cstdint>
 #include <cstddef>
 
+ESPRPC_REFLECT(User,
+    ESPRPC_FIELD(User, id),
+    ESPRPC_FIELD(User, name),
+    ESPRPC_FIELD(User, email),
+    ESPRPC_FIELD(User, status),
+    ESPRPC_FIELD(User, tags))
+
+ESPRPC_REFLECT(CreateUserRequest,
+    ESPRPC_FIELD(CreateUserRequest, name),
+    ESPRPC_FIELD(CreateUserRequest, email),
+    ESPRPC_FIELD(CreateUserRequest, password))
+
+ESPRPC_REFLECT(UserResponse,
+    ESPRPC_FIELD(UserResponse, id),
+    ESPRPC_FIELD(UserResponse, name),
+    ESPRPC_FIELD(UserResponse, email),
+    ESPRPC_FIELD(UserResponse, status))
+
+/* UserService.ListUsers 为分页列表："paged:32" */
+#define USER_SERVICE_LIST_USERS_PAGE_ITEMS 32
+
+/* UserService.WatchUsers 为增量流："delta:16" */
+#define USER_SERVICE_WATCH_USERS_KEYFRAME_INTERVAL 16
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
 int UserService_dispatch(uint16_t method_id, const uint8_t *req_buf, size_t req_len,
-                      uint8_t **resp_buf, size_t *resp_len, void *svc_ctx);
+                      uint8_t **resp_buf, size_t *resp_len, void *svc_ctx,
+                      esprpc_arena_t *arena);
 
 extern UserService user_service_impl_instance;
 
+size_t bin_size_User(const User *v);
+int bin_write_User(const User *v, uint8_t *buf, size_t buf_size);
+
+size_t bin_size_User_delta(const User *v);
+int bin_write_User_delta(esprpc_delta_t *d, const User *v, uint8_t *buf, size_t buf_size);
+
 #ifdef __cplusplus
 }
 #endif
@@ -34,13 +34,13 @@ RPC_STRUCT(UserResponse,
 )
 
 RPC_SERVICE(UserService)
-    RPC_METHOD(GetUser, UserResponse, int id)
+    RPC_METHOD_EX(GetUser, UserResponse, int id, "fieldmask")
     RPC_METHOD(CreateUser, UserResponse, CreateUserRequest request)
     RPC_METHOD(CreateUserV2, VOID, CreateUserRequest request)
     RPC_METHOD(UpdateUser, UserResponse, int id, CreateUserRequest request)
     RPC_METHOD(DeleteUser, bool, int id)
-    RPC_METHOD_EX(ListUsers, LIST(User), OPTIONAL(int) page, "timeout:5000")
-    RPC_METHOD(WatchUsers, STREAM(User), void)
+    RPC_METHOD_EX(ListUsers, PAGED(User), OPTIONAL(int) page, "timeout:5000,fieldmask,paged:32")
+    RPC_METHOD_EX(WatchUsers, STREAM(User), void, "delta:16")
     RPC_METHOD(Ping, VOID, void)
 RPC_SERVICE_END(UserService)
 
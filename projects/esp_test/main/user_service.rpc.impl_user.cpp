@@ -35,23 +35,9 @@ static void copy_str(char *dst, size_t dst_size, const char *src)
     }
 }
 
-/* 序列化单个 User 到 buf，返回写入字节数，失败返回 -1 */
-static int serialize_user(const User *u, uint8_t *buf, size_t buf_size)
-{
-    uint8_t *wp = buf;
-    const uint8_t *wend = buf + buf_size;
-    if (esprpc_bin_write_i32(&wp, wend, u->id) != 0) return -1;
-    if (esprpc_bin_write_str(&wp, wend, u->name ? u->name : "") != 0) return -1;
-    if (esprpc_bin_write_optional_tag(&wp, wend, u->email.present) != 0) return -1;
-    if (u->email.present && esprpc_bin_write_str(&wp, wend, u->email.value) != 0) return -1;
-    if (esprpc_bin_write_i32(&wp, wend, u->status) != 0) return -1;
-    /* LIST(string) tags: [4B count][for each: 2B len][bytes] */
-    if (esprpc_bin_write_u32(&wp, wend, (uint32_t)u->tags.len) != 0) return -1;
-    for (size_t i = 0; i < u->tags.len && u->tags.items; i++) {
-        if (esprpc_bin_write_str(&wp, wend, u->tags.items[i] ? u->tags.items[i] : "") != 0) return -1;
-    }
-    return (int)(wp - buf);
-}
+/* WatchUsers 为增量流：相邻两帧只发送变化的字段，每 16 帧一个关键帧 */
+static uint8_t s_watch_prev[256];
+static esprpc_delta_t s_watch_delta;
 
 rpc_stream<User> watch_users_impl(void)
 {
@@ -61,6 +47,10 @@ rpc_stream<User> watch_users_impl(void)
         return (rpc_stream<User>){ nullptr };
     }
     ESP_LOGI(TAG, "WatchUsers: user count %d", s_user_count);
+    if (!s_watch_delta.prev) {
+        esprpc_delta_init(&s_watch_delta, s_watch_prev, sizeof(s_watch_prev), USER_SERVICE_WATCH_USERS_KEYFRAME_INTERVAL);
+    }
+    esprpc_delta_reset(&s_watch_delta);  /* 新订阅者从关键帧开始 */
     uint8_t buf[256];
     for (size_t i = 0; i < s_user_count; i++) {
         User u = {
@@ -70,7 +60,7 @@ rpc_stream<User> watch_users_impl(void)
             s_users[i].status,
             { nullptr, 0 },
         };
-        int n = serialize_user(&u, buf, sizeof(buf));
+        int n = bin_write_User_delta(&s_watch_delta, &u, buf, sizeof(buf));
         if (n > 0) {
             esp_err_t err = esprpc_stream_emit(method_id, (const uint8_t *)buf, (size_t)n);
             if (err != ESP_OK) {
@@ -154,27 +144,33 @@ bool delete_user_impl(int id)
     return false;
 }
 
-/* 用于 ListUsers 返回的静态缓冲区（避免动态分配） */
-static User s_list_buffer[MAX_USERS];
+/* 分页游标：dispatch 逐个取用户编码，不需要整表缓冲 */
+static size_t s_list_pos;
 
-User_list list_users_impl(int_optional page)
+static bool list_users_next(void *ctx, User *out)
+{
+    size_t *pos = (size_t *)ctx;
+    if (*pos >= s_user_count) return false;
+    size_t i = (*pos)++;
+    *out = (User){
+        s_users[i].id,
+        s_users[i].name,
+        { true, s_users[i].email },
+        s_users[i].status,
+        { nullptr, 0 },
+    };
+    return true;
+}
+
+rpc_cursor<User> list_users_impl(int_optional page)
 {
     ESP_LOGI(TAG, "ListUsers(page=%s)", page.present ? "present" : "absent");
     if (page.present) {
         ESP_LOGI(TAG, "  page.value=%d", page.value);
     }
 
-    /* 返回当前用户数组的完整列表 */
-    for (size_t i = 0; i < s_user_count; i++) {
-        s_list_buffer[i] = (User){
-            s_users[i].id,
-            s_users[i].name,
-            { true, s_users[i].email },
-            s_users[i].status,
-            { nullptr, 0 },
-        };
-    }
-    return (User_list){ s_list_buffer, s_user_count };
+    s_list_pos = 0;
+    return (rpc_cursor<User>){ list_users_next, &s_list_pos };
 }
 
 VOID create_user_v2_impl(CreateUserRequest request)
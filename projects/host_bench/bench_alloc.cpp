@@ -0,0 +1,67 @@
+/**
+ * @file bench_alloc.cpp
+ * @brief 堆分配计数：链接时以 -Wl,--wrap 包装 malloc/calloc/realloc，并替换全局 operator new
+ */
+
+#include "bench_common.hpp"
+#include <cstdlib>
+#include <new>
+
+std::atomic<uint64_t> bench::g_alloc_count{0};
+
+extern "C" {
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t n, size_t size);
+void *__real_realloc(void *ptr, size_t size);
+
+void *__wrap_malloc(size_t size)
+{
+    bench::g_alloc_count.fetch_add(1, std::memory_order_relaxed);
+    return __real_malloc(size);
+}
+
+void *__wrap_calloc(size_t n, size_t size)
+{
+    bench::g_alloc_count.fetch_add(1, std::memory_order_relaxed);
+    return __real_calloc(n, size);
+}
+
+void *__wrap_realloc(void *ptr, size_t size)
+{
+    bench::g_alloc_count.fetch_add(1, std::memory_order_relaxed);
+    return __real_realloc(ptr, size);
+}
+}
+
+void *operator new(size_t size)
+{
+    bench::g_alloc_count.fetch_add(1, std::memory_order_relaxed);
+    void *p = __real_malloc(size ? size : 1);
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+
+void *operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void *p) noexcept
+{
+    free(p);
+}
+
+void operator delete[](void *p) noexcept
+{
+    free(p);
+}
+
+void operator delete(void *p, size_t) noexcept
+{
+    free(p);
+}
+
+void operator delete[](void *p, size_t) noexcept
+{
+    free(p);
+}
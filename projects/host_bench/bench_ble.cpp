@@ -0,0 +1,317 @@
+/**
+ * @file bench_ble.cpp
+ * @brief BLE 传输在 NimBLE host 替身上的流式通知吞吐：mbuf/链路缓冲有限时的丢帧与链路利用率
+ *
+ * 模型：每个 tick 为一个连接事件，链路至多发出 --per-tick 个通知，已提交未发出的通知
+ * 至多 --inflight 个（超出时 notify 返回 BLE_HS_ENOMEM）。生产者每 --burst-every 个 tick
+ * 突发一批帧，平均负载为链路容量的 --load 倍。--conns 个连接各自订阅该流、共用链路，
+ * 接收端按连接分别拼帧并校验内容与顺序。
+ *
+ * 最后测请求方向：同一请求以单段单 mbuf（直接引用）、单段跨 mbuf 与多段三种形态写入，
+ * 报告每帧耗时并核对 frames_recv / frames_recv_copied。
+ *
+ * 用法:
+ *   bench_ble [--ticks 20000] [--per-tick 4] [--inflight 6] [--mtu 185] [--frame-bytes 300]
+ *             [--burst-every 4] [--conns 1] [--load 0.5,0.9,1.5]
+ *             [--rx-frames 100000] [--rx-bytes 120]
+ *
+ * bench_ble_q0 为同一程序、CONFIG_ESPRPC_BLE_NOTIFY_QUEUE_LEN=0（拥塞即丢帧）。
+ * 帧损坏、乱序或 mbuf 泄漏时返回非零。
+ */
+
+#include "ble_mock.h"
+#include "esprpc.h"
+#include "esprpc_transport.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct Receiver {
+    std::vector<uint8_t> frame;
+    bool in_frame = false;
+    uint8_t next_seq = 0;
+    uint32_t last_id = 0;
+    uint64_t frames = 0;
+    uint64_t segments = 0;
+    uint64_t partial = 0;  /* 因段序号不连续丢弃的帧 */
+    uint64_t errors = 0;   /* 内容错误或乱序 */
+    size_t frame_bytes = 0;
+};
+
+constexpr int kMaxConns = 8;  /* 与 ble_mock 的连接句柄范围一致 */
+Receiver s_rx[kMaxConns];
+
+void check_frame(Receiver &r, const std::vector<uint8_t> &f)
+{
+    if (f.size() != r.frame_bytes || f[0] != 0x20 || (size_t)(f[3] | (f[4] << 8)) + 5 != f.size()) {
+        r.errors++;
+        return;
+    }
+    uint32_t id = (uint32_t)f[5] | ((uint32_t)f[6] << 8) | ((uint32_t)f[7] << 16) | ((uint32_t)f[8] << 24);
+    for (size_t i = 9; i < f.size(); i++) {
+        if (f[i] != (uint8_t)(id + i)) {
+            r.errors++;
+            return;
+        }
+    }
+    if (id <= r.last_id) r.errors++;  /* 可以有缺号（发送端丢弃），不能乱序或重复 */
+    r.last_id = id;
+    r.frames++;
+}
+
+void on_notify(uint16_t conn, const uint8_t *d, size_t n, void *ctx)
+{
+    (void)ctx;
+    Receiver &r = s_rx[conn];
+    r.segments++;
+    uint8_t seq = d[0] & 0x7F;
+    if (seq == 0) {
+        if (r.in_frame) r.partial++;
+        r.frame.clear();
+        r.in_frame = true;
+    } else if (!r.in_frame || seq != r.next_seq) {
+        if (r.in_frame) r.partial++;
+        r.in_frame = false;
+        return;
+    }
+    r.frame.insert(r.frame.end(), d + 1, d + n);
+    r.next_seq = (uint8_t)((seq + 1) & 0x7F);
+    if (!(d[0] & 0x80)) {
+        r.in_frame = false;
+        check_frame(r, r.frame);
+    }
+}
+
+struct Config {
+    int ticks = 20000;
+    int per_tick = 4;
+    int inflight = 6;
+    int mtu = 185;
+    size_t frame_bytes = 300;
+    int burst_every = 4;
+    int conns = 1;
+    int rx_frames = 100000;
+    size_t rx_bytes = 120;
+};
+
+uint64_t s_req_count;
+uint64_t s_req_sum;
+
+void on_request(const uint8_t *data, size_t len, void *ctx)
+{
+    (void)ctx;
+    s_req_count++;
+    s_req_sum += len + data[len - 1];
+}
+
+/** 运行一个负载点，返回 false 表示校验失败 */
+bool run(const Config &c, double load)
+{
+    ble_mock_reset(64, c.inflight);
+    ble_mock_set_notify_cb(on_notify, nullptr);
+    for (int h = 0; h < c.conns; h++) {
+        s_rx[h] = Receiver();
+        s_rx[h].frame_bytes = c.frame_bytes;
+        if (ble_mock_connect((uint16_t)h, (uint16_t)c.mtu) != 0) {
+            fprintf(stderr, "FAIL: connection %d rejected\n", h);
+            return false;
+        }
+        ble_mock_subscribe((uint16_t)h, 1);
+        const uint8_t sub[] = { 0x00, 0x20, 0, 0, 0, 0 };  /* 段头 + invoke_id=0 的请求：订阅 method 0x20 */
+        ble_mock_write((uint16_t)h, sub, sizeof(sub), 0);
+    }
+    esprpc_ble_stats_t before;
+    esprpc_transport_ble_get_stats(&before);
+
+    esprpc_transport_t *t = esprpc_transport_ble_get();
+    size_t seg_payload = (size_t)c.mtu - 3 - 1;
+    int segs_per_frame = (int)((c.frame_bytes + seg_payload - 1) / seg_payload);
+    double frames_per_tick = load * c.per_tick / segs_per_frame / c.conns;
+
+    std::vector<uint8_t> f(c.frame_bytes);
+    uint32_t id = 0;
+    uint64_t offered = 0, rejected = 0;
+    double credit = 0;
+    for (int tick = 0; tick < c.ticks; tick++) {
+        credit += frames_per_tick;
+        if (tick % c.burst_every == c.burst_every - 1) {
+            for (; credit >= 1; credit -= 1) {
+                id++;
+                f[0] = 0x20;
+                f[1] = f[2] = 0;
+                f[3] = (uint8_t)((c.frame_bytes - 5) & 0xFF);
+                f[4] = (uint8_t)((c.frame_bytes - 5) >> 8);
+                memcpy(&f[5], &id, 4);
+                for (size_t i = 9; i < f.size(); i++) f[i] = (uint8_t)(id + i);
+                esprpc_iovec_t iov[2] = { { f.data(), 5 }, { f.data() + 5, f.size() - 5 } };
+                offered++;
+                if (t->sendv(t->ctx, iov, 2) != ESP_OK) rejected++;
+            }
+        }
+        ble_mock_pump(c.per_tick);
+    }
+    esprpc_ble_stats_t st;
+    for (int i = 0; i < 100000; i++) {  /* 排空链路与通知队列 */
+        int n = ble_mock_pump(c.per_tick);
+        esprpc_transport_ble_get_stats(&st);
+        if (n == 0 && st.queue_len == 0) break;
+    }
+    for (int h = 0; h < c.conns; h++) ble_mock_disconnect((uint16_t)h);
+    ble_mock_stats_t ms = ble_mock_stats();
+
+    uint64_t frames = 0, segments = 0, partial = 0, errors = 0;
+    for (int h = 0; h < c.conns; h++) {
+        frames += s_rx[h].frames;
+        segments += s_rx[h].segments;
+        partial += s_rx[h].partial;
+        errors += s_rx[h].errors;
+    }
+    uint64_t expected = offered * (uint64_t)c.conns;  /* 每帧发给每个订阅连接 */
+    double util = 100.0 * (double)segments / ((double)c.ticks * c.per_tick);
+    double delivered_pct = expected ? 100.0 * (double)frames / (double)expected : 0;
+    printf("load=%-4.2f offered=%-7llu delivered=%-7llu (%5.1f%%) dropped=%-6u congestion=%-6u "
+           "queue_peak=%-3u partial=%-4llu link_util=%5.1f%% notify_enomem=%u\n",
+           load, (unsigned long long)expected, (unsigned long long)frames, delivered_pct,
+           st.frames_dropped - before.frames_dropped, st.congestion - before.congestion, st.queue_peak,
+           (unsigned long long)partial, util, ms.notify_enomem);
+
+    /* 每帧要么完整送达，要么计入 frames_dropped */
+    bool ok = errors == 0 && ms.mbufs_in_use == 0 &&
+              frames + (st.frames_dropped - before.frames_dropped) == expected;
+    if (!ok) {
+        fprintf(stderr, "FAIL: errors=%llu mbufs_in_use=%d rejected=%llu\n", (unsigned long long)errors,
+                ms.mbufs_in_use, (unsigned long long)rejected);
+    }
+    return ok;
+}
+
+/** 把一帧按 seg 字节分段写入，每段一次写操作 */
+void write_frame(uint16_t conn, const std::vector<uint8_t> &f, size_t seg, size_t chunk)
+{
+    uint8_t buf[528];  /* ATT MTU 上限 527 */
+    uint8_t seq = 0;
+    for (size_t off = 0; off < f.size(); off += seg, seq++) {
+        size_t n = f.size() - off < seg ? f.size() - off : seg;
+        buf[0] = (uint8_t)((seq & 0x7F) | (off + n < f.size() ? 0x80 : 0));
+        memcpy(buf + 1, f.data() + off, n);
+        ble_mock_write(conn, buf, n + 1, chunk);
+    }
+}
+
+/** 请求方向：三种写入形态的每帧耗时与拷贝计数 */
+bool run_rx(const Config &c)
+{
+    ble_mock_reset(64, c.inflight);
+    if (ble_mock_connect(0, (uint16_t)c.mtu) != 0) return false;
+    std::vector<uint8_t> f(c.rx_bytes);
+    f[0] = 0x20;
+    f[1] = 1;  /* invoke_id=1，普通请求 */
+    f[2] = 0;
+    f[3] = (uint8_t)((c.rx_bytes - 5) & 0xFF);
+    f[4] = (uint8_t)((c.rx_bytes - 5) >> 8);
+    for (size_t i = 5; i < f.size(); i++) f[i] = (uint8_t)i;
+    size_t seg_max = (size_t)c.mtu - 3 - 1;
+    size_t multi_seg = std::min(seg_max, std::max<size_t>(5, (c.rx_bytes + 2) / 3));
+
+    struct Shape {
+        const char *name;
+        size_t seg;
+        size_t chunk;  /* 每个 mbuf 的容量，0 为整段一个 mbuf */
+        bool copied;
+    } shapes[] = {
+        { "single-mbuf", c.rx_bytes, 0, false },
+        { "chained-mbuf", c.rx_bytes, (c.rx_bytes + 1) / 2, true },
+        { "multi-segment", multi_seg, 0, true },
+    };
+    bool ok = true;
+    for (const Shape &sh : shapes) {
+        if (sh.seg > seg_max) {
+            printf("rx %-13s skipped (frame %zuB exceeds one segment)\n", sh.name, c.rx_bytes);
+            continue;
+        }
+        esprpc_ble_stats_t before, after;
+        esprpc_transport_ble_get_stats(&before);
+        s_req_count = s_req_sum = 0;
+        auto t0 = std::chrono::steady_clock::now();
+        for (int i = 0; i < c.rx_frames; i++) write_frame(0, f, sh.seg, sh.chunk);
+        double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t0).count();
+        esprpc_transport_ble_get_stats(&after);
+        uint32_t recv = after.frames_recv - before.frames_recv;
+        uint32_t copied = after.frames_recv_copied - before.frames_recv_copied;
+        printf("rx %-13s frames=%-7u copied=%-7u %7.1f ns/frame\n", sh.name, recv, copied, ns / c.rx_frames);
+        uint64_t want_sum = (uint64_t)c.rx_frames * (c.rx_bytes + f.back());
+        if (recv != (uint32_t)c.rx_frames || s_req_count != (uint64_t)c.rx_frames || s_req_sum != want_sum ||
+            copied != (sh.copied ? recv : 0)) {
+            fprintf(stderr, "FAIL: rx %s recv=%u copied=%u delivered=%llu\n", sh.name, recv, copied,
+                    (unsigned long long)s_req_count);
+            ok = false;
+        }
+    }
+    ble_mock_disconnect(0);
+    if (ble_mock_stats().mbufs_in_use != 0) {
+        fprintf(stderr, "FAIL: rx mbufs_in_use=%d\n", ble_mock_stats().mbufs_in_use);
+        ok = false;
+    }
+    return ok;
+}
+
+}  // namespace
+
+int main(int argc, char **argv)
+{
+    Config c;
+    std::string loads = "0.5,0.9,1.5";
+    for (int i = 1; i < argc; i++) {
+        const char *a = argv[i];
+        const char *v = i + 1 < argc ? argv[i + 1] : nullptr;
+        if (!v) {
+            fprintf(stderr, "missing value for %s\n", a);
+            return 2;
+        }
+        if (strcmp(a, "--ticks") == 0) c.ticks = atoi(v);
+        else if (strcmp(a, "--per-tick") == 0) c.per_tick = atoi(v);
+        else if (strcmp(a, "--inflight") == 0) c.inflight = atoi(v);
+        else if (strcmp(a, "--mtu") == 0) c.mtu = atoi(v);
+        else if (strcmp(a, "--frame-bytes") == 0) c.frame_bytes = (size_t)atol(v);
+        else if (strcmp(a, "--burst-every") == 0) c.burst_every = atoi(v);
+        else if (strcmp(a, "--conns") == 0) c.conns = atoi(v);
+        else if (strcmp(a, "--load") == 0) loads = v;
+        else if (strcmp(a, "--rx-frames") == 0) c.rx_frames = atoi(v);
+        else if (strcmp(a, "--rx-bytes") == 0) c.rx_bytes = (size_t)atol(v);
+        else {
+            fprintf(stderr, "unknown option %s\n", a);
+            return 2;
+        }
+        i++;
+    }
+    if (c.frame_bytes < 9 || c.frame_bytes > 4096 || c.mtu < 23 || c.mtu > 527 || c.burst_every < 1 ||
+        c.conns < 1 || c.conns > kMaxConns || c.rx_bytes < 6 || c.rx_bytes > 4096 || c.rx_frames < 1) {
+        fprintf(stderr, "invalid options\n");
+        return 2;
+    }
+
+    esprpc_init();
+    ble_mock_reset(64, c.inflight);
+    esprpc_transport_ble_init();
+    esprpc_transport_t *t = esprpc_transport_ble_get();
+    t->start(t->ctx, on_request, nullptr);
+
+    printf("ticks=%d per_tick=%d inflight=%d mtu=%d frame=%zuB burst_every=%d conns=%d\n", c.ticks, c.per_tick,
+           c.inflight, c.mtu, c.frame_bytes, c.burst_every, c.conns);
+    bool ok = true;
+    for (size_t pos = 0; pos < loads.size();) {
+        size_t end = loads.find(',', pos);
+        if (end == std::string::npos) end = loads.size();
+        ok = run(c, atof(loads.substr(pos, end - pos).c_str())) && ok;
+        pos = end + 1;
+    }
+    ok = run_rx(c) && ok;
+    return ok ? 0 : 1;
+}
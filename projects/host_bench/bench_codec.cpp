@@ -0,0 +1,814 @@
+/**
+ * @file bench_codec.cpp
+ * @brief 编解码微基准：esprpc_bin_* 原语 + 生成代码（bin_read_* 与 dispatch 内的序列化）
+ *
+ * 生成的 .rpc.gen.cpp 在本文件内 #include，以便直接调用其中 static 的 bin_read_* 函数。
+ * bench_codec_varint 由同一源码构建（ESPRPC_BENCH_VARINT=1），生成代码使用 RPC_INT_ENCODING(varint)。
+ * 用法: bench_codec [--json out.json] [--filter substr] [--min-time-ms 200]
+ */
+
+#include "bench_common.hpp"
+#include "host_user_service.hpp"
+#include "esprpc.h"
+#include "esprpc_binary.h"
+#include "esprpc_transport.h"
+
+#include "user_service.rpc.gen.cpp"
+#include "bench_service.rpc.gen.cpp"
+
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <ctime>
+#include <vector>
+
+/* 手工构造的请求 payload 须与生成代码的整数编码一致 */
+#if ESPRPC_BENCH_VARINT
+#define BENCH_SUITE "codec_varint"
+#define bench_write_int esprpc_bin_write_varint_i32
+#define BENCH_WIRE esprpc::wire_varint
+#else
+#define BENCH_SUITE "codec"
+#define bench_write_int esprpc_bin_write_i32
+#define BENCH_WIRE esprpc::wire_fixed
+#endif
+
+/* ---------- BenchService 实现：原样回显 ---------- */
+
+Batch echo_impl(Batch batch)
+{
+    return batch;
+}
+
+int register_impl(CreateUserView request)
+{
+    return (int)(request.name.len + request.email.len);
+}
+
+int configure_impl(map_string_string settings)
+{
+    return (int)settings.len;
+}
+
+/* ---------- 请求 payload 构造 ---------- */
+
+static std::vector<uint8_t> encode_create_user_request(const char *name, const char *email, const char *password)
+{
+    std::vector<uint8_t> buf(512);
+    uint8_t *wp = buf.data();
+    const uint8_t *wend = buf.data() + buf.size();
+    esprpc_bin_write_str(&wp, wend, name);
+    esprpc_bin_write_str(&wp, wend, email);
+    esprpc_bin_write_optional_tag(&wp, wend, password != nullptr);
+    if (password) esprpc_bin_write_str(&wp, wend, password);
+    buf.resize((size_t)(wp - buf.data()));
+    return buf;
+}
+
+/** Batch: source + Meta{seq?, note?} + LIST(int) + LIST(Sample) + LIST(string) */
+static std::vector<uint8_t> encode_batch(size_t n_values, size_t n_samples, size_t n_tags)
+{
+    std::vector<uint8_t> buf(64 * 1024);
+    uint8_t *wp = buf.data();
+    const uint8_t *wend = buf.data() + buf.size();
+    esprpc_bin_write_str(&wp, wend, "sensor-node-17");
+    esprpc_bin_write_optional_tag(&wp, wend, true);
+    bench_write_int(&wp, wend, 42);
+    esprpc_bin_write_optional_tag(&wp, wend, true);
+    esprpc_bin_write_str(&wp, wend, "calibrated");
+    esprpc_bin_write_u32(&wp, wend, (uint32_t)n_values);
+    for (size_t i = 0; i < n_values; i++) bench_write_int(&wp, wend, (int)(i * 7));
+    esprpc_bin_write_u32(&wp, wend, (uint32_t)n_samples);
+    for (size_t i = 0; i < n_samples; i++) {
+        bench_write_int(&wp, wend, (int)i);
+        esprpc_bin_write_optional_tag(&wp, wend, (i & 1) == 0);
+        if ((i & 1) == 0) bench_write_int(&wp, wend, (int)(i * 100));
+        esprpc_bin_write_optional_tag(&wp, wend, (i % 3) == 0);
+        if ((i % 3) == 0) esprpc_bin_write_str(&wp, wend, "label");
+        bench_write_int(&wp, wend, (int)(i % 3));
+    }
+    esprpc_bin_write_u32(&wp, wend, (uint32_t)n_tags);
+    for (size_t i = 0; i < n_tags; i++) esprpc_bin_write_str(&wp, wend, "tag");
+    buf.resize((size_t)(wp - buf.data()));
+    return buf;
+}
+
+/* ---------- 设置项：MAP(string, string) 与 JSON 字符串对照 ---------- */
+
+static const char *const k_setting_keys[] = {
+    "wifi.ssid", "wifi.pass", "wifi.channel", "mqtt.host", "mqtt.port", "mqtt.user", "mqtt.topic", "led.mode",
+    "led.brightness", "sensor.period_ms", "sensor.unit", "ota.url", "ota.channel", "log.level", "tz", "name",
+};
+static const char *const k_setting_values[] = {
+    "home-2g", "s3cr3t\"pw", "6", "broker.local", "1883", "dev", "home/node17", "breathe",
+    "128", "500", "celsius", "https://ota.example/fw.bin", "stable", "info", "CST-8", "node-17",
+};
+static const size_t k_setting_count = sizeof(k_setting_keys) / sizeof(k_setting_keys[0]);
+
+static size_t json_put_quoted(char *out, size_t pos, size_t cap, const char *s)
+{
+    if (pos >= cap) return cap;
+    out[pos++] = '"';
+    for (; *s && pos < cap; s++) {
+        if (*s == '"' || *s == '\\') {
+            out[pos++] = '\\';
+            if (pos >= cap) return cap;
+        }
+        out[pos++] = *s;
+    }
+    if (pos < cap) out[pos++] = '"';
+    return pos;
+}
+
+/** 旧做法：设置项拼成扁平 JSON 对象 {"k":"v",...}，再作为 string 发送；溢出返回 0 */
+static size_t json_write_settings(char *out, size_t cap, const map_string_string &m)
+{
+    size_t pos = 0;
+    if (cap < 2) return 0;
+    out[pos++] = '{';
+    for (size_t i = 0; i < m.len; i++) {
+        if (i && pos < cap) out[pos++] = ',';
+        pos = json_put_quoted(out, pos, cap, m.keys[i]);
+        if (pos < cap) out[pos++] = ':';
+        pos = json_put_quoted(out, pos, cap, m.values[i]);
+    }
+    if (pos >= cap) return 0;
+    out[pos++] = '}';
+    return pos;
+}
+
+static const char *json_skip_ws(const char *p, const char *end)
+{
+    while (p < end && (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n')) p++;
+    return p;
+}
+
+/** 读取 "..."（仅处理 \" 与 \\ 转义），反转义后拷贝到 arena */
+static int json_read_str(const char **pp, const char *end, char **out, esprpc_arena_t *arena)
+{
+    const char *p = *pp;
+    if (p >= end || *p != '"') return -1;
+    const char *start = ++p;
+    size_t n = 0;
+    while (p < end && *p != '"') {
+        if (*p == '\\') p++;
+        p++;
+        n++;
+    }
+    if (p >= end) return -1;
+    char *s = (char *)esprpc_arena_alloc(arena, n + 1);
+    if (!s) return -1;
+    size_t i = 0;
+    for (const char *q = start; q < p; q++) {
+        if (*q == '\\') q++;
+        s[i++] = *q;
+    }
+    s[i] = 0;
+    *out = s;
+    *pp = p + 1;
+    return 0;
+}
+
+/** 解析 json_write_settings 的输出，键值拷贝到 arena，与 MAP 解码结果等价 */
+static int json_parse_settings(const char *s, size_t len, map_string_string *out, esprpc_arena_t *arena)
+{
+    const size_t cap = 64;
+    const char *end = s + len;
+    const char *p = json_skip_ws(s, end);
+    if (p >= end || *p++ != '{') return -1;
+    out->keys = (char **)esprpc_arena_alloc(arena, cap * sizeof(char *));
+    out->values = (char **)esprpc_arena_alloc(arena, cap * sizeof(char *));
+    out->len = 0;
+    if (!out->keys || !out->values) return -1;
+    p = json_skip_ws(p, end);
+    if (p < end && *p == '}') return 0;
+    for (;;) {
+        if (out->len == cap) return -1;
+        p = json_skip_ws(p, end);
+        if (json_read_str(&p, end, &out->keys[out->len], arena) != 0) return -1;
+        p = json_skip_ws(p, end);
+        if (p >= end || *p++ != ':') return -1;
+        p = json_skip_ws(p, end);
+        if (json_read_str(&p, end, &out->values[out->len], arena) != 0) return -1;
+        out->len++;
+        p = json_skip_ws(p, end);
+        if (p < end && *p == ',') {
+            p++;
+            continue;
+        }
+        return (p < end && *p == '}') ? 0 : -1;
+    }
+}
+
+static bool settings_equal(const map_string_string &m)
+{
+    if (m.len != k_setting_count) return false;
+    for (size_t i = 0; i < m.len; i++) {
+        if (strcmp(m.keys[i], k_setting_keys[i]) != 0 || strcmp(m.values[i], k_setting_values[i]) != 0) return false;
+    }
+    return true;
+}
+
+/** 解码 arena：与设备端一样每次请求前整体重置 */
+static uint8_t s_arena_buf[16 * 1024];
+static esprpc_arena_t s_arena;
+
+static esprpc_arena_t *fresh_arena()
+{
+    esprpc_arena_init(&s_arena, s_arena_buf, sizeof(s_arena_buf));
+    return &s_arena;
+}
+
+/** 调用 dispatch 并释放响应，返回响应字节数（失败 -1） */
+static long dispatch_once(esprpc_dispatch_fn fn, void *svc, uint16_t method_id, const std::vector<uint8_t> &req)
+{
+    uint8_t *resp = nullptr;
+    size_t resp_len = 0;
+    int ret = fn(method_id, req.data(), req.size(), &resp, &resp_len, svc, fresh_arena());
+    free(resp);
+    return ret == 0 ? (long)resp_len : -1;
+}
+
+/* ---------- 经 esprpc_handle_request_from 的完整请求：分页响应的中间页由 esprpc_send_partial 发出 ---------- */
+
+/** 统计发出的帧；capture 非空时同时保存各帧 payload */
+static struct {
+    size_t bytes;
+    std::vector<std::vector<uint8_t>> *capture;
+} s_sent;
+
+static esp_err_t count_sendv(void *, const esprpc_iovec_t *iov, size_t iovcnt)
+{
+    std::vector<uint8_t> frame;
+    for (size_t i = 0; i < iovcnt; i++) {
+        s_sent.bytes += iov[i].len;
+        if (s_sent.capture) frame.insert(frame.end(), (const uint8_t *)iov[i].base, (const uint8_t *)iov[i].base + iov[i].len);
+    }
+    if (s_sent.capture && frame.size() >= 5) s_sent.capture->emplace_back(frame.begin() + 5, frame.end());
+    return ESP_OK;
+}
+
+/** 模拟慢链路：每帧阻塞 20 µs */
+static esp_err_t slow_sendv(void *, const esprpc_iovec_t *, size_t)
+{
+    struct timespec ts = { 0, 20000 };
+    nanosleep(&ts, nullptr);
+    return ESP_OK;
+}
+
+static esprpc_transport_t s_count_transport = {
+    .send = nullptr,
+    .sendv = count_sendv,
+    .start = nullptr,
+    .stop = nullptr,
+    .ctx = nullptr,
+    .reply_route = nullptr,
+    .sendv_to = nullptr,
+};
+
+/** 拒收一切帧（相当于请求所在任务之外的 WebSocket、没有打开通知的 BLE），记下被调用的次数 */
+static size_t s_rejected;
+
+static esp_err_t reject_sendv(void *, const esprpc_iovec_t *, size_t)
+{
+    s_rejected++;
+    return ESP_ERR_INVALID_STATE;
+}
+
+static esprpc_transport_t s_reject_transport = {
+    .send = nullptr,
+    .sendv = reject_sendv,
+    .start = nullptr,
+    .stop = nullptr,
+    .ctx = nullptr,
+    .reply_route = nullptr,
+    .sendv_to = nullptr,
+};
+
+/** 多对端传输的替身：收包回调中的回复目标固定为 7；记下每帧发往的目标，sendv（不知道目标）记为 UINT32_MAX */
+static std::vector<uint32_t> s_routed_to;
+
+static esp_err_t routed_reply_route(void *, uint32_t *route)
+{
+    *route = 7;
+    return ESP_OK;
+}
+
+static esp_err_t routed_sendv_to(void *, uint32_t route, const esprpc_iovec_t *, size_t)
+{
+    s_routed_to.push_back(route);
+    return ESP_OK;
+}
+
+static esp_err_t routed_sendv(void *, const esprpc_iovec_t *, size_t)
+{
+    s_routed_to.push_back(UINT32_MAX);
+    return ESP_OK;
+}
+
+static std::vector<uint8_t> request_frame(uint8_t method_id, const std::vector<uint8_t> &payload)
+{
+    std::vector<uint8_t> f = { method_id, 1, 0, (uint8_t)(payload.size() & 0xff), (uint8_t)(payload.size() >> 8) };
+    f.insert(f.end(), payload.begin(), payload.end());
+    return f;
+}
+
+/** 处理一个请求帧，返回发出的总字节数（含各帧帧头） */
+static long request_once(const std::vector<uint8_t> &frame)
+{
+    s_sent.bytes = 0;
+    esprpc_handle_request_from(&s_count_transport, frame.data(), frame.size());
+    return s_sent.bytes ? (long)s_sent.bytes : -1;
+}
+
+int main(int argc, char **argv)
+{
+    bench::Options opts = bench::parse_options(argc, argv);
+    bench::Runner runner(BENCH_SUITE, opts);
+    esprpc_init();
+
+    /* ---------- 原语：小标量 ---------- */
+    uint8_t scratch[4096];
+    runner.run("scalars/encode", [&]() -> long {
+        uint8_t *wp = scratch;
+        const uint8_t *wend = scratch + sizeof(scratch);
+        if (esprpc_bin_write_i32(&wp, wend, 123456) != 0) return -1;
+        if (esprpc_bin_write_u32(&wp, wend, 42u) != 0) return -1;
+        if (esprpc_bin_write_bool(&wp, wend, true) != 0) return -1;
+        if (esprpc_bin_write_optional_tag(&wp, wend, true) != 0) return -1;
+        if (esprpc_bin_write_i32(&wp, wend, -7) != 0) return -1;
+        if (esprpc_bin_write_optional_tag(&wp, wend, false) != 0) return -1;
+        return (long)(wp - scratch);
+    });
+    runner.run("scalars/decode", [&]() -> long {
+        const uint8_t *p = scratch;
+        const uint8_t *end = scratch + 15;
+        int a = 0, c = 0;
+        uint32_t b = 0;
+        bool f = false, pr1 = false, pr2 = false;
+        if (esprpc_bin_read_i32(&p, end, &a) != 0) return -1;
+        if (esprpc_bin_read_u32(&p, end, &b) != 0) return -1;
+        if (esprpc_bin_read_bool(&p, end, &f) != 0) return -1;
+        if (esprpc_bin_read_optional_tag(&p, end, &pr1) != 0) return -1;
+        if (pr1 && esprpc_bin_read_i32(&p, end, &c) != 0) return -1;
+        if (esprpc_bin_read_optional_tag(&p, end, &pr2) != 0) return -1;
+        bench::do_not_optimize(a + c + (int)b + f);
+        return (long)(p - scratch);
+    });
+
+    /* ---------- 字符串密集 struct：CreateUserRequest ---------- */
+    const char *name = "Alice Wonderland";
+    const char *email = "alice.wonderland@example.com";
+    const char *password = "correct horse battery";
+    std::vector<uint8_t> create_req = encode_create_user_request(name, email, password);
+    runner.run("CreateUserRequest/encode", [&]() -> long {
+        uint8_t *wp = scratch;
+        const uint8_t *wend = scratch + sizeof(scratch);
+        if (esprpc_bin_write_str(&wp, wend, name) != 0) return -1;
+        if (esprpc_bin_write_str(&wp, wend, email) != 0) return -1;
+        if (esprpc_bin_write_optional_tag(&wp, wend, true) != 0) return -1;
+        if (esprpc_bin_write_str(&wp, wend, password) != 0) return -1;
+        return (long)(wp - scratch);
+    });
+    runner.run("CreateUserRequest/decode", [&]() -> long {
+        const uint8_t *p = create_req.data();
+        CreateUserRequest out;
+        if (bin_read_CreateUserRequest(&p, create_req.data() + create_req.size(), &out, fresh_arena()) != 0) return -1;
+        bench::do_not_optimize(out);
+        return (long)create_req.size();
+    });
+    /* 同一 payload 按 strview 解码（不拷贝）与按已知长度编码（不 strlen） */
+    runner.run("CreateUserRequest/decode/strview", [&]() -> long {
+        const uint8_t *p = create_req.data();
+        CreateUserView out;
+        if (bin_read_CreateUserView(&p, create_req.data() + create_req.size(), &out, fresh_arena()) != 0) return -1;
+        bench::do_not_optimize(out);
+        return (long)create_req.size();
+    });
+    {
+        const strview name_v = { name, strlen(name) };
+        const strview email_v = { email, strlen(email) };
+        const strview password_v = { password, strlen(password) };
+        runner.run("CreateUserRequest/encode/strview", [&]() -> long {
+            uint8_t *wp = scratch;
+            const uint8_t *wend = scratch + sizeof(scratch);
+            if (esprpc_bin_write_strn(&wp, wend, name_v.ptr, name_v.len) != 0) return -1;
+            if (esprpc_bin_write_strn(&wp, wend, email_v.ptr, email_v.len) != 0) return -1;
+            if (esprpc_bin_write_optional_tag(&wp, wend, true) != 0) return -1;
+            if (esprpc_bin_write_strn(&wp, wend, password_v.ptr, password_v.len) != 0) return -1;
+            return (long)(wp - scratch);
+        });
+    }
+
+    /* ---------- 生成的 dispatch（解码 + 调用 + 响应序列化） ---------- */
+    host_user_service_seed(8);
+    std::vector<uint8_t> get_req(6);
+    {
+        uint8_t *wp = get_req.data();
+        *wp++ = 0xFF; /* 字段掩码：全部字段 */
+        bench_write_int(&wp, get_req.data() + get_req.size(), 3);
+        get_req.resize((size_t)(wp - get_req.data()));
+    }
+    runner.run("UserService.GetUser/dispatch", [&]() -> long {
+        return dispatch_once(UserService_dispatch, &user_service_impl_instance, 0, get_req);
+    });
+
+    /* ListUsers 为 PAGED(User)：每 USER_SERVICE_LIST_USERS_PAGE_ITEMS 个用户一帧，bytes/op 为全部页帧的总字节 */
+    esprpc_register_service_ex("UserService", &user_service_impl_instance, UserService_dispatch);
+    esprpc_transport_add(&s_count_transport);
+    const std::vector<uint8_t> list_frame = request_frame(5, { 0xFF, 0 }); /* 全部字段，page 缺省 */
+    for (size_t n : { (size_t)8, (size_t)200, (size_t)500 }) {
+        host_user_service_seed(n);
+        runner.run("UserService.ListUsers/request/n=" + std::to_string(n), [&]() -> long {
+            return request_once(list_frame);
+        });
+    }
+
+    /* 字段掩码：只取 id + name（User 第 0、1 个字段），对照上面的全字段 n=200 */
+    {
+        const std::vector<uint8_t> masked_frame = request_frame(5, { 0x03, 0 });
+        host_user_service_seed(200);
+        /* 逐页解码（[flags][掩码 LIST]），拼回的列表须完整且只含 id、name */
+        std::vector<std::vector<uint8_t>> pages;
+        s_sent.capture = &pages;
+        request_once(masked_frame);
+        s_sent.capture = nullptr;
+        size_t total = 0;
+        bool ok = !pages.empty();
+        for (size_t i = 0; ok && i < pages.size(); i++) {
+            const std::vector<uint8_t> &pg = pages[i];
+            const uint8_t *p = pg.data() + 1;
+            User_list out = {};
+            bool more = i + 1 < pages.size();
+            ok = pg.size() > 1 && ((pg[0] & ESPRPC_PAGE_MORE) != 0) == more &&
+                 esprpc::decode_masked<BENCH_WIRE>(&p, pg.data() + pg.size(), &out, fresh_arena()) == 0 &&
+                 p == pg.data() + pg.size() && out.len <= USER_SERVICE_LIST_USERS_PAGE_ITEMS;
+            for (size_t k = 0; ok && k < out.len; k++, total++) {
+                char want[16];
+                snprintf(want, sizeof(want), "user_%zu", total);
+                ok = out.items[k].id == (int)total + 1 && strcmp(out.items[k].name, want) == 0 &&
+                     !out.items[k].email.present && out.items[k].status == 0;
+            }
+        }
+        if (!ok || total != 200) {
+            fprintf(stderr, "UserService.ListUsers/fieldmask: paged masked response does not decode\n");
+            return 1;
+        }
+        runner.run("UserService.ListUsers/request/n=200/fields=id,name", [&]() -> long {
+            return request_once(masked_frame);
+        });
+    }
+
+    /* 另注册一个拒收的传输：请求只从 s_count_transport 进来时全部页只发给它，另一个传输拒收不影响调用；
+     * 来源未知（esprpc_handle_request 广播）时第一页就失败，须以 ESPRPC_PAGE_ERROR 页结束而不是不再回应 */
+    {
+        esprpc_transport_add(&s_reject_transport);
+        host_user_service_seed(200);
+        std::vector<std::vector<uint8_t>> pages;
+        s_sent.capture = &pages;
+        s_rejected = 0;
+        esprpc_handle_request_from(&s_count_transport, list_frame.data(), list_frame.size());
+        size_t total = 0;
+        bool ok = pages.size() > 1 && s_rejected == 0;
+        for (size_t i = 0; ok && i < pages.size(); i++) {
+            const std::vector<uint8_t> &pg = pages[i];
+            const uint8_t *p = pg.data() + 1;
+            User_list out = {};
+            ok = pg.size() > 1 && pg[0] == (i + 1 < pages.size() ? ESPRPC_PAGE_MORE : 0) &&
+                 esprpc::decode_masked<BENCH_WIRE>(&p, pg.data() + pg.size(), &out, fresh_arena()) == 0;
+            total += out.len;
+        }
+        if (!ok || total != 200) {
+            fprintf(stderr, "UserService.ListUsers/two_transports: pages not routed to the origin only "
+                            "(%zu pages, %zu items, %zu rejected)\n", pages.size(), total, s_rejected);
+            return 1;
+        }
+
+        pages.clear();
+        esprpc_handle_request(list_frame.data(), list_frame.size());
+        s_sent.capture = nullptr;
+        esprpc_transport_remove(&s_reject_transport);
+        if (pages.size() != 2 || pages[0][0] != ESPRPC_PAGE_MORE || pages[1][0] != ESPRPC_PAGE_ERROR) {
+            fprintf(stderr, "UserService.ListUsers/broadcast_rejected: expected one page then an error page, got %zu\n",
+                    pages.size());
+            return 1;
+        }
+    }
+    esprpc_transport_remove(&s_count_transport);
+
+
+    /* ---------- LIST(int) 1K 元素：逐元素 vs esprpc_bin_*_array ---------- */
+    std::vector<int> ints(1024);
+    for (size_t i = 0; i < ints.size(); i++) ints[i] = (int)(i * 2654435761u);
+    std::vector<uint8_t> int_buf(ints.size() * 4);
+    std::vector<int> ints_out(ints.size());
+    const uint8_t *int_end = int_buf.data() + int_buf.size();
+    runner.run("i32_list/1024/encode/per_element", [&]() -> long {
+        uint8_t *wp = int_buf.data();
+        for (int v : ints) {
+            if (esprpc_bin_write_i32(&wp, int_end, v) != 0) return -1;
+        }
+        bench::do_not_optimize(int_buf.data());
+        return (long)(wp - int_buf.data());
+    });
+    runner.run("i32_list/1024/encode/bulk", [&]() -> long {
+        uint8_t *wp = int_buf.data();
+        if (esprpc_bin_write_i32_array(&wp, int_end, ints.data(), ints.size()) != 0) return -1;
+        bench::do_not_optimize(int_buf.data());
+        return (long)(wp - int_buf.data());
+    });
+    runner.run("i32_list/1024/decode/per_element", [&]() -> long {
+        const uint8_t *p = int_buf.data();
+        for (int &v : ints_out) {
+            if (esprpc_bin_read_i32(&p, int_end, &v) != 0) return -1;
+        }
+        bench::do_not_optimize(ints_out.data());
+        return (long)int_buf.size();
+    });
+    runner.run("i32_list/1024/decode/bulk", [&]() -> long {
+        const uint8_t *p = int_buf.data();
+        if (esprpc_bin_read_i32_array(&p, int_end, ints_out.data(), ints_out.size()) != 0) return -1;
+        bench::do_not_optimize(ints_out.data());
+        return (long)int_buf.size();
+    });
+
+    /* ---------- 流元素序列化：生成的 bin_write_User ---------- */
+    {
+        char user_name[] = "user_0003";
+        char *user_tags[] = { (char *)"admin", (char *)"beta" };
+        User u = { 3, user_name, { true, (char *)"user3@example.com" }, ACTIVE, { user_tags, 2 } };
+        runner.run("User/bin_write", [&]() -> long {
+            return bin_write_User(&u, scratch, sizeof(scratch));
+        });
+        runner.run("User/bin_size", [&]() -> long {
+            size_t n = bin_size_User(&u);
+            bench::do_not_optimize(n);
+            /* 与实际写入字节数不符视为失败 */
+            return (long)n == bin_write_User(&u, scratch, sizeof(scratch)) ? (long)n : -1;
+        });
+    }
+
+    /* ---------- 增量流：同一用户连续推送，每帧只有 status 变化 ---------- */
+    {
+        char *user_tags[] = { (char *)"admin", (char *)"beta", (char *)"ops", (char *)"oncall" };
+        User u = { 42, (char *)"Alice Zhang", { true, (char *)"alice@example.com" }, ACTIVE, { user_tags, 4 } };
+        static uint8_t prev[256];
+        esprpc_delta_t delta;
+        esprpc_delta_init(&delta, prev, sizeof(prev), USER_SERVICE_WATCH_USERS_KEYFRAME_INTERVAL);
+        uint32_t frame = 0;
+
+        /* 接收端按帧合并后须与完整编码一致（含关键帧间隔与首帧） */
+        static uint8_t rx_arena_buf[64 * 1024];
+        esprpc_arena_t rx_arena;
+        esprpc_arena_init(&rx_arena, rx_arena_buf, sizeof(rx_arena_buf));
+        esprpc_delta_rx_t rx = {};
+        User merged = {};
+        for (int i = 0; i < 64; i++) {
+            u.status = (frame++ & 1) ? INACTIVE : ACTIVE;
+            int n = bin_write_User_delta(&delta, &u, scratch, sizeof(scratch));
+            const uint8_t *p = scratch;
+            uint8_t want[256], got[256];
+            if (n <= 0 || esprpc::decode_delta<BENCH_WIRE>(&rx, &p, scratch + n, &merged, &rx_arena) != 0 ||
+                bin_write_User(&u, want, sizeof(want)) != bin_write_User(&merged, got, sizeof(got)) ||
+                memcmp(want, got, (size_t)bin_size_User(&u)) != 0) {
+                fprintf(stderr, "Stream/User/delta: frame %d does not reconstruct\n", i);
+                return 1;
+            }
+        }
+
+        /* 每次操作推送一个关键帧间隔（16 帧），bytes/op 为这 16 帧的线上总字节 */
+        runner.run("Stream/User/full/x16", [&]() -> long {
+            long total = 0;
+            for (int i = 0; i < USER_SERVICE_WATCH_USERS_KEYFRAME_INTERVAL; i++) {
+                u.status = (frame++ & 1) ? INACTIVE : ACTIVE;
+                int n = bin_write_User(&u, scratch, sizeof(scratch));
+                if (n < 0) return -1;
+                total += n;
+            }
+            return total;
+        });
+        runner.run("Stream/User/delta/x16", [&]() -> long {
+            long total = 0;
+            for (int i = 0; i < USER_SERVICE_WATCH_USERS_KEYFRAME_INTERVAL; i++) {
+                u.status = (frame++ & 1) ? INACTIVE : ACTIVE;
+                int n = bin_write_User_delta(&delta, &u, scratch, sizeof(scratch));
+                if (n < 0) return -1;
+                total += n;
+            }
+            return total;
+        });
+
+        /* 一帧流推送给 4 个会话的异步发送：每会话 malloc 拷贝 vs 帧池缓冲 + 引用计数 */
+        int stream_len = bin_write_User(&u, scratch, sizeof(scratch));
+        runner.run("Stream/User/fanout=4/malloc_copy", [&]() -> long {
+            for (int i = 0; i < 4; i++) {
+                void *buf = malloc((size_t)stream_len);
+                if (!buf) return -1;
+                memcpy(buf, scratch, (size_t)stream_len);
+                bench::do_not_optimize(buf);
+                free(buf);
+            }
+            return stream_len;
+        });
+        runner.run("Stream/User/fanout=4/refcount", [&]() -> long {
+            void *buf = esprpc_buf_alloc((size_t)stream_len);
+            if (!buf) return -1;
+            memcpy(buf, scratch, (size_t)stream_len);
+            for (int i = 0; i < 4; i++) esprpc_buf_ref(buf);
+            for (int i = 0; i < 4; i++) esprpc_buf_unref(buf);
+            esprpc_buf_unref(buf);
+            return stream_len;
+        });
+    }
+
+    /* ---------- 整数编码：小值（id/状态/计数）的 fixed 与 varint ---------- */
+    std::vector<int> small_ints(1024);
+    for (size_t i = 0; i < small_ints.size(); i++) small_ints[i] = (int)(i % 200) - 50;
+    std::vector<uint8_t> varint_buf(small_ints.size() * 5);
+    const uint8_t *varint_end = varint_buf.data() + varint_buf.size();
+    size_t varint_len = 0;
+    runner.run("i32_small/1024/encode/varint", [&]() -> long {
+        uint8_t *wp = varint_buf.data();
+        for (int v : small_ints) {
+            if (esprpc_bin_write_varint_i32(&wp, varint_end, v) != 0) return -1;
+        }
+        varint_len = (size_t)(wp - varint_buf.data());
+        return (long)varint_len;
+    });
+    runner.run("i32_small/1024/decode/varint", [&]() -> long {
+        const uint8_t *p = varint_buf.data();
+        const uint8_t *end = varint_buf.data() + varint_len;
+        for (int &v : ints_out) {
+            if (esprpc_bin_read_varint_i32(&p, end, &v) != 0) return -1;
+        }
+        bench::do_not_optimize(ints_out.data());
+        return (long)varint_len;
+    });
+
+    /* ---------- 嵌套 struct + 可选字段 + 列表：Batch ---------- */
+    std::vector<uint8_t> batch_req = encode_batch(8, 8, 4);
+    runner.run("Batch/decode", [&]() -> long {
+        const uint8_t *p = batch_req.data();
+        Batch out;
+        if (bin_read_Batch(&p, batch_req.data() + batch_req.size(), &out, fresh_arena()) != 0) return -1;
+        bench::do_not_optimize(out);
+        return (long)batch_req.size();
+    });
+    runner.run("BenchService.Echo/dispatch", [&]() -> long {
+        return dispatch_once(BenchService_dispatch, &bench_service_impl_instance, 0, batch_req);
+    });
+    /* 大列表：元素数按线上 count 分配，无截断 */
+    std::vector<uint8_t> batch_large_req = encode_batch(512, 64, 16);
+    runner.run("Batch/decode/values=512", [&]() -> long {
+        const uint8_t *p = batch_large_req.data();
+        Batch out;
+        if (bin_read_Batch(&p, batch_large_req.data() + batch_large_req.size(), &out, fresh_arena()) != 0) return -1;
+        if (out.values.len != 512 || out.samples.len != 64 || out.tags.len != 16) return -1;
+        bench::do_not_optimize(out);
+        return (long)batch_large_req.size();
+    });
+
+    /* ---------- MAP(string, string) 对照 JSON-in-string：同一组 16 个设置项 ---------- */
+    const map_string_string settings = { (char **)k_setting_keys, (char **)k_setting_values, k_setting_count };
+    std::vector<uint8_t> settings_req(esprpc::size<BENCH_WIRE>(settings));
+    {
+        uint8_t *wp = settings_req.data();
+        esprpc::encode<BENCH_WIRE>(&wp, settings_req.data() + settings_req.size(), settings);
+    }
+    runner.run("Settings/encode/map", [&]() -> long {
+        uint8_t *wp = scratch;
+        if (esprpc::encode<BENCH_WIRE>(&wp, scratch + sizeof(scratch), settings) != 0) return -1;
+        return (long)(wp - scratch);
+    });
+    runner.run("Settings/encode/json", [&]() -> long {
+        char json[1024];
+        size_t n = json_write_settings(json, sizeof(json), settings);
+        if (n == 0) return -1;
+        uint8_t *wp = scratch;
+        if (esprpc_bin_write_strn(&wp, scratch + sizeof(scratch), json, n) != 0) return -1;
+        return (long)(wp - scratch);
+    });
+    runner.run("Settings/decode/map", [&]() -> long {
+        const uint8_t *p = settings_req.data();
+        map_string_string out;
+        if (esprpc::decode<BENCH_WIRE>(&p, settings_req.data() + settings_req.size(), &out, fresh_arena()) != 0) return -1;
+        if (out.len != k_setting_count) return -1;
+        bench::do_not_optimize(out);
+        return (long)settings_req.size();
+    });
+    std::vector<uint8_t> settings_json_req(1024);
+    {
+        char json[1024];
+        size_t n = json_write_settings(json, sizeof(json), settings);
+        uint8_t *wp = settings_json_req.data();
+        esprpc_bin_write_strn(&wp, settings_json_req.data() + settings_json_req.size(), json, n);
+        settings_json_req.resize((size_t)(wp - settings_json_req.data()));
+    }
+    runner.run("Settings/decode/json", [&]() -> long {
+        const uint8_t *p = settings_json_req.data();
+        const char *json = nullptr;
+        size_t json_len = 0;
+        if (esprpc_bin_read_str_view(&p, settings_json_req.data() + settings_json_req.size(), &json, &json_len) != 0) return -1;
+        map_string_string out;
+        if (json_parse_settings(json, json_len, &out, fresh_arena()) != 0) return -1;
+        if (out.len != k_setting_count) return -1;
+        bench::do_not_optimize(out);
+        return (long)settings_json_req.size();
+    });
+    /* 两种解码结果须与原始设置项逐一相同 */
+    {
+        const uint8_t *p = settings_req.data();
+        map_string_string from_map, from_json;
+        bool ok = esprpc::decode<BENCH_WIRE>(&p, settings_req.data() + settings_req.size(), &from_map, fresh_arena()) == 0 &&
+                  settings_equal(from_map);
+        const char *json = nullptr;
+        size_t json_len = 0;
+        p = settings_json_req.data();
+        ok = ok && esprpc_bin_read_str_view(&p, settings_json_req.data() + settings_json_req.size(), &json, &json_len) == 0 &&
+             json_parse_settings(json, json_len, &from_json, fresh_arena()) == 0 && settings_equal(from_json);
+        if (!ok) {
+            fprintf(stderr, "Settings: decoded map/json mismatch\n");
+            return 1;
+        }
+    }
+    runner.run("BenchService.Configure/dispatch", [&]() -> long {
+        return dispatch_once(BenchService_dispatch, &bench_service_impl_instance, 2, settings_req);
+    });
+
+    /* 慢链路上推送流帧（放在最后：发送任务使进程变为多线程，会抬高其余用例的锁开销）：直接发送时生产者每帧都等链路；
+     * 套发送队列后生产者只付拷贝 + 入队。持续超过链路速率时 BLOCK 退化为链路速度，DROP_OLDEST 不阻塞但丢帧，
+     * 丢帧数与计时一并打印 */
+    {
+        static esprpc_transport_t slow = {
+            .send = nullptr,
+            .sendv = slow_sendv,
+            .start = nullptr,
+            .stop = nullptr,
+            .ctx = nullptr,
+            .reply_route = nullptr,
+            .sendv_to = nullptr,
+        };
+        uint8_t frame_payload[64] = {};
+        esprpc_transport_add(&slow);
+        runner.run("Stream/emit/slow_link/inline", [&]() -> long {
+            return esprpc_stream_emit(6, frame_payload, sizeof(frame_payload)) == ESP_OK ? (long)sizeof(frame_payload) : -1;
+        });
+        esprpc_transport_remove(&slow);
+
+        const struct {
+            const char *name;
+            esprpc_txq_overflow_t overflow;
+        } policies[] = {
+            { "Stream/emit/slow_link/txq_block", ESPRPC_TXQ_BLOCK },
+            { "Stream/emit/slow_link/txq_drop_oldest", ESPRPC_TXQ_DROP_OLDEST },
+        };
+        for (const auto &pol : policies) {
+            esprpc_txq_config_t cfg = ESPRPC_TXQ_CONFIG_DEFAULT();
+            cfg.depth = 64;
+            cfg.overflow = pol.overflow;
+            esprpc_transport_t *txq = esprpc_txq_create(&slow, &cfg);
+            esprpc_transport_add(txq);
+            uint64_t emitted = 0;
+            runner.run(pol.name, [&]() -> long {
+                emitted++;
+                esp_err_t e = esprpc_stream_emit(6, frame_payload, sizeof(frame_payload));
+                return e == ESP_OK || e == ESP_ERR_TIMEOUT ? (long)sizeof(frame_payload) : -1;
+            });
+            esprpc_transport_remove(txq);
+            uint32_t dropped = esprpc_txq_dropped(txq);
+            esprpc_txq_destroy(txq);
+            if (emitted) {
+                fprintf(stderr, "%s: emitted=%llu dropped=%u (%.1f%% delivered)\n", pol.name,
+                        (unsigned long long)emitted, dropped, 100.0 * (double)(emitted - dropped) / (double)emitted);
+            }
+        }
+
+        /* 包装多对端传输：分页响应的每一页都须带着入队时取得的回复目标，经 inner 的 sendv_to 发出 */
+        static esprpc_transport_t routed = {
+            .send = nullptr,
+            .sendv = routed_sendv,
+            .start = nullptr,
+            .stop = nullptr,
+            .ctx = nullptr,
+            .reply_route = routed_reply_route,
+            .sendv_to = routed_sendv_to,
+        };
+        esprpc_transport_t *txq = esprpc_txq_create(&routed, nullptr);
+        esprpc_transport_add(txq);
+        host_user_service_seed(200);
+        s_routed_to.clear();
+        esprpc_handle_request_from(txq, list_frame.data(), list_frame.size());
+        esprpc_transport_remove(txq);
+        esprpc_txq_destroy(txq);
+        bool ok = s_routed_to.size() > 1;
+        for (uint32_t r : s_routed_to) ok = ok && r == 7;
+        if (!ok) {
+            fprintf(stderr, "txq/routed: %zu frames, expected every page sent to route 7\n", s_routed_to.size());
+            return 1;
+        }
+    }
+
+    int rc = runner.finish();
+    esprpc_deinit();
+    return rc;
+}
@@ -0,0 +1,161 @@
+/**
+ * @file bench_common.hpp
+ * @brief 主机基准公共工具：计时循环、堆分配计数、结果表格与 JSON 输出
+ *
+ * 每个用例输出 ns/op、bytes/op（编码后字节数）、allocs/op（malloc/new 次数）。
+ * JSON 结果可用 compare.py 与基线对比。
+ */
+
+#ifndef BENCH_COMMON_HPP
+#define BENCH_COMMON_HPP
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace bench {
+
+/** 由 bench_alloc.cpp 中的 malloc/new 包装函数累加 */
+extern std::atomic<uint64_t> g_alloc_count;
+
+/** 阻止编译器把基准循环里的结果优化掉 */
+template<typename T>
+inline void do_not_optimize(const T &v)
+{
+    asm volatile("" : : "r,m"(v) : "memory");
+}
+
+struct Result {
+    std::string name;
+    double ns_per_op = 0;
+    double bytes_per_op = 0;
+    double allocs_per_op = 0;
+    uint64_t iterations = 0;
+    std::string error; /* 非空表示用例失败，未计时 */
+};
+
+struct Options {
+    const char *json_path = nullptr;  /* --json <file> */
+    const char *filter = nullptr;     /* --filter <substr> */
+    double min_time_ms = 200;         /* --min-time-ms <ms> */
+};
+
+/** 解析公共命令行参数，未识别的参数原样保留在 rest 中 */
+inline Options parse_options(int argc, char **argv, std::vector<const char *> *rest = nullptr)
+{
+    Options o;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--json") == 0 && i + 1 < argc) {
+            o.json_path = argv[++i];
+        } else if (strcmp(argv[i], "--filter") == 0 && i + 1 < argc) {
+            o.filter = argv[++i];
+        } else if (strcmp(argv[i], "--min-time-ms") == 0 && i + 1 < argc) {
+            o.min_time_ms = atof(argv[++i]);
+        } else if (rest) {
+            rest->push_back(argv[i]);
+        }
+    }
+    return o;
+}
+
+class Runner {
+public:
+    Runner(const char *suite, const Options &opts) : suite_(suite), opts_(opts) {}
+
+    /**
+     * 运行一个用例：fn() 执行一次操作并返回本次编码/解码的字节数（<0 表示失败）。
+     * 先执行一次校验与预热，然后倍增迭代次数直到总时长 >= min_time_ms。
+     */
+    template<typename Fn>
+    void run(const std::string &name, Fn &&fn)
+    {
+        if (opts_.filter && name.find(opts_.filter) == std::string::npos) return;
+        Result r;
+        r.name = name;
+        long bytes = fn();
+        if (bytes < 0) {
+            r.error = "operation failed";
+            report(r);
+            return;
+        }
+        uint64_t iters = 1;
+        double min_ns = opts_.min_time_ms * 1e6;
+        for (;;) {
+            uint64_t allocs_before = g_alloc_count.load(std::memory_order_relaxed);
+            auto t0 = std::chrono::steady_clock::now();
+            for (uint64_t i = 0; i < iters; i++) {
+                long b = fn();
+                do_not_optimize(b);
+            }
+            auto t1 = std::chrono::steady_clock::now();
+            uint64_t allocs = g_alloc_count.load(std::memory_order_relaxed) - allocs_before;
+            double ns = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count();
+            if (ns >= min_ns || iters >= (1ULL << 34)) {
+                r.iterations = iters;
+                r.ns_per_op = ns / (double)iters;
+                r.allocs_per_op = (double)allocs / (double)iters;
+                r.bytes_per_op = (double)bytes;
+                break;
+            }
+            iters *= 2;
+        }
+        report(r);
+    }
+
+    /** 直接记录外部测得的结果（如吞吐类用例） */
+    void add(const Result &r) { report(r); }
+
+    /** 输出 JSON（若指定 --json），返回进程退出码 */
+    int finish()
+    {
+        if (!opts_.json_path) return failed_ ? 1 : 0;
+        FILE *f = strcmp(opts_.json_path, "-") == 0 ? stdout : fopen(opts_.json_path, "w");
+        if (!f) {
+            perror(opts_.json_path);
+            return 1;
+        }
+        fprintf(f, "{\n  \"suite\": \"%s\",\n  \"results\": [\n", suite_);
+        for (size_t i = 0; i < results_.size(); i++) {
+            const Result &r = results_[i];
+            fprintf(f, "    {\"name\": \"%s\", \"ns_per_op\": %.3f, \"bytes_per_op\": %.1f, "
+                       "\"allocs_per_op\": %.3f, \"iterations\": %llu",
+                    r.name.c_str(), r.ns_per_op, r.bytes_per_op, r.allocs_per_op,
+                    (unsigned long long)r.iterations);
+            if (!r.error.empty()) fprintf(f, ", \"error\": \"%s\"", r.error.c_str());
+            fprintf(f, "}%s\n", i + 1 < results_.size() ? "," : "");
+        }
+        fprintf(f, "  ]\n}\n");
+        if (f != stdout) fclose(f);
+        return failed_ ? 1 : 0;
+    }
+
+private:
+    void report(const Result &r)
+    {
+        if (results_.empty()) {
+            fprintf(stderr, "%-48s %12s %10s %10s\n", "benchmark", "ns/op", "bytes/op", "allocs/op");
+        }
+        if (!r.error.empty()) {
+            fprintf(stderr, "%-48s %s\n", r.name.c_str(), r.error.c_str());
+            failed_ = true;
+        } else {
+            fprintf(stderr, "%-48s %12.1f %10.0f %10.2f\n", r.name.c_str(), r.ns_per_op,
+                    r.bytes_per_op, r.allocs_per_op);
+        }
+        results_.push_back(r);
+    }
+
+    const char *suite_;
+    Options opts_;
+    std::vector<Result> results_;
+    bool failed_ = false;
+};
+
+} // namespace bench
+
+#endif /* BENCH_COMMON_HPP */
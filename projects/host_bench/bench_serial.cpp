@@ -0,0 +1,336 @@
+/**
+ * @file bench_serial.cpp
+ * @brief 串口成帧吞吐：RPC 包与日志行交错、含假前缀和损坏包的字节流
+ *
+ * 字节流由日志行（随机插入前缀字节串作为假前缀）、合法包与后缀损坏的包交错组成，
+ * 按 1..--chunk 的随机块喂给 esprpc_serial_feed_bytes()，校验合法包全部按序送达、损坏包全部丢弃。
+ * 同一字节流再交给逐字节同步的旧式读循环（esp_test 示例中原有写法，读操作以内存流模拟）对照。
+ * 包经传输自身的发送路径（tx_cb）生成，因此同时覆盖发送端成帧。
+ *
+ * bench_serial_cobs 为同一程序、CONFIG_ESPRPC_SERIAL_COBS=1：损坏包为编码后改动一个字节（CRC 不符），
+ * 日志行落在两个包之间成为被丢弃的包；没有旧式读循环对照。
+ *
+ * 之后校验半包超时（CMake 传入 CONFIG_ESPRPC_SERIAL_RX_TIMEOUT_MS=50）：前后缀模式下一个长度字段被改大的包
+ * 后面紧跟一个合法包，静默前合法包被吞在半包里，超时后以长度 0 调用 feed_bytes 须送达它；COBS 模式下
+ * 缺少结尾 0x00 的包在超时后送达。
+ *
+ * 用法:
+ *   bench_serial [--packets 20000] [--log-ratio 3] [--corrupt-every 50] [--chunk 256] [--payload 64]
+ *
+ * 前缀 ">>"、后缀 "<<" 由 CMake 传入（COBS 模式下无前后缀）。帧丢失、乱序或损坏包被送达时返回非零。
+ */
+
+#include "esprpc.h"
+#include "esprpc_transport.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+constexpr size_t kHeader = 5;
+
+struct Config {
+    int packets = 20000;
+    int log_ratio = 3;       /* 每个包前平均日志行数 */
+    int corrupt_every = 50;  /* 每 N 个包有一个后缀损坏的包，0 为不插入 */
+    size_t chunk = 256;
+    size_t payload = 64;
+};
+
+struct Sink {
+    uint32_t next_id = 1;
+    uint64_t frames = 0;
+    uint64_t errors = 0;  /* 乱序、重复、内容错误或损坏包被送达 */
+    uint64_t lost = 0;    /* 合法包的缺号 */
+};
+Sink s_sink;
+
+void on_recv(const uint8_t *data, size_t len, void *ctx)
+{
+    (void)ctx;
+    uint32_t id;
+    if (len < kHeader + 4 || data[0] != 0x21) {
+        s_sink.errors++;
+        return;
+    }
+    memcpy(&id, data + kHeader, 4);
+    for (size_t i = kHeader + 4; i < len; i++) {
+        if (data[i] != (uint8_t)(id * 7 + i)) {
+            s_sink.errors++;
+            return;
+        }
+    }
+    if (id & 0x80000000u) s_sink.errors++;  /* 损坏包的 id 带最高位 */
+    else if (id < s_sink.next_id) s_sink.errors++;
+    else {
+        s_sink.lost += id - s_sink.next_id;
+        s_sink.next_id = id + 1;
+    }
+    s_sink.frames++;
+}
+
+std::vector<uint8_t> *s_tx_out;
+
+void capture_tx(const uint8_t *data, size_t len, void *ctx)
+{
+    (void)ctx;
+    s_tx_out->insert(s_tx_out->end(), data, data + len);
+}
+
+/** 经传输的 sendv 生成一个包追加到 out；corrupt 时改动一个字节使校验失败 */
+void append_packet(std::vector<uint8_t> &out, uint32_t id, size_t payload, bool corrupt)
+{
+    std::vector<uint8_t> f(kHeader + payload);
+    f[0] = 0x21;
+    f[1] = (uint8_t)(id & 0xFF);
+    f[2] = (uint8_t)((id >> 8) | 1);
+    f[3] = (uint8_t)(payload & 0xFF);
+    f[4] = (uint8_t)(payload >> 8);
+    memcpy(&f[kHeader], &id, 4);
+    for (size_t i = kHeader + 4; i < f.size(); i++) f[i] = (uint8_t)(id * 7 + i);
+    size_t start = out.size();
+    s_tx_out = &out;
+    esprpc_iovec_t iov[2] = { { f.data(), kHeader }, { f.data() + kHeader, payload } };
+    esprpc_transport_serial_get()->sendv(esprpc_transport_serial_get()->ctx, iov, 2);
+    if (!corrupt) return;
+#if CONFIG_ESPRPC_SERIAL_COBS
+    uint8_t &b = out[start + (out.size() - start) / 2];  /* 编码后的中间字节，不能变成 0x00 */
+    b = (uint8_t)(b ^ 0x55) ? (uint8_t)(b ^ 0x55) : 1;
+#else
+    (void)start;
+    out.back() ^= 0x55;  /* 后缀 */
+#endif
+}
+
+std::vector<uint8_t> make_stream(const Config &c, const std::vector<uint8_t> &pre, uint32_t *valid)
+{
+    static const char *kWords[] = { "wifi", "sta", "connected", "rssi=-61", "heap", "free=182344", "ble", "adv",
+                                    "timer", "tick", "I (12345)", "W (2210)", "event", "ip=192.168.1.7" };
+    std::mt19937 rng(42);
+    std::vector<uint8_t> out;
+    *valid = 0;
+    uint32_t id = 0;
+    for (int p = 0; p < c.packets; p++) {
+        int lines = (int)(rng() % (2 * c.log_ratio + 1));
+        for (int l = 0; l < lines; l++) {
+            std::string line;
+            int words = 3 + (int)(rng() % 8);
+            for (int w = 0; w < words; w++) {
+                if (!pre.empty() && rng() % 16 == 0) line.append(pre.begin(), pre.end());  /* 假前缀 */
+                line += kWords[rng() % (sizeof(kWords) / sizeof(kWords[0]))];
+                line += ' ';
+            }
+            line += "\r\n";
+            out.insert(out.end(), line.begin(), line.end());
+        }
+        bool corrupt = c.corrupt_every > 0 && p % c.corrupt_every == c.corrupt_every - 1;
+        if (corrupt) append_packet(out, 0x80000000u | (uint32_t)p, c.payload, true);
+        else {
+            append_packet(out, ++id, c.payload, false);
+            (*valid)++;
+        }
+    }
+    return out;
+}
+
+#if !CONFIG_ESPRPC_SERIAL_COBS
+
+/* ---------- 对照：逐字节同步的旧式读循环 ---------- */
+
+struct Stream {
+    const uint8_t *data;
+    size_t len;
+    size_t pos;
+    uint64_t reads;
+};
+
+int stream_read(Stream &s, uint8_t *dst, size_t n)
+{
+    s.reads++;
+    size_t k = s.len - s.pos < n ? s.len - s.pos : n;
+    memcpy(dst, s.data + s.pos, k);
+    s.pos += k;
+    return (int)k;
+}
+
+/** esp_test 原 serial_recv_task 的有前缀分支（超时即流结束） */
+void naive_frame(Stream &s, const std::vector<uint8_t> &pre, const std::vector<uint8_t> &suf, size_t payload_max)
+{
+    size_t pl = pre.size(), sl = suf.size();
+    std::vector<uint8_t> frame_buf(pl + kHeader + payload_max + sl);
+    uint8_t sync_buf[32];
+    size_t sync_len = 0;
+    while (s.pos < s.len) {
+        while (sync_len < pl) {
+            int n = stream_read(s, sync_buf + sync_len, pl - sync_len);
+            if (n <= 0) break;
+            sync_len += (size_t)n;
+        }
+        if (sync_len < pl) return;
+        size_t idx = sync_len;
+        for (size_t i = 0; i + pl <= sync_len; i++) {
+            if (memcmp(sync_buf + i, pre.data(), pl) == 0) {
+                idx = i;
+                break;
+            }
+        }
+        if (idx >= sync_len) {
+            memmove(sync_buf, sync_buf + 1, sync_len - 1);
+            sync_len--;
+            continue;
+        }
+        memcpy(frame_buf.data(), pre.data(), pl);
+        size_t got = sync_len - idx - pl;
+        if (got) memcpy(frame_buf.data() + pl, sync_buf + idx + pl, got);
+        sync_len = 0;
+        size_t need = kHeader;
+        while (got < need) {
+            int n = stream_read(s, frame_buf.data() + pl + got, need - got);
+            if (n <= 0) return;
+            got += (size_t)n;
+        }
+        size_t plen = (size_t)frame_buf[pl + 3] | ((size_t)frame_buf[pl + 4] << 8);
+        if (plen > payload_max) continue;
+        need = kHeader + plen + sl;
+        while (got < need) {
+            int n = stream_read(s, frame_buf.data() + pl + got, need - got);
+            if (n <= 0) return;
+            got += (size_t)n;
+        }
+        esprpc_serial_feed_raw_packet(frame_buf.data(), pl + got);
+    }
+}
+
+#endif /* !CONFIG_ESPRPC_SERIAL_COBS */
+
+/**
+ * 半包超时：id 为下一个合法包。前后缀模式下先喂长度字段被改大（仍不超限）的损坏包，紧跟合法包；
+ * COBS 模式下喂去掉结尾 0x00 的合法包。超时前合法包不应送达，超时后以长度 0 调用即送达且只送达一次。
+ */
+bool check_rx_timeout(uint32_t id, size_t payload)
+{
+    std::vector<uint8_t> bytes;
+#if CONFIG_ESPRPC_SERIAL_COBS
+    append_packet(bytes, id, payload, false);
+    bytes.pop_back();  /* 结尾 0x00 丢失 */
+#else
+    uint8_t pb[ESPRPC_SERIAL_MARKER_MAX];
+    size_t pl = 0;
+    esprpc_serial_get_packet_marker(pb, sizeof(pb), &pl, nullptr, 0, nullptr);
+    append_packet(bytes, 0x80000000u | id, payload, false);
+    bytes[pl + 3] = 0xFF;  /* 长度字段改为 0x07FF（不超过 PAYLOAD_MAX，不会立即重新同步） */
+    bytes[pl + 4] = 0x07;
+    append_packet(bytes, id, payload, false);
+#endif
+    s_sink = Sink();
+    s_sink.next_id = id;
+    esprpc_serial_feed_bytes(bytes.data(), bytes.size());
+    esprpc_serial_feed_bytes(nullptr, 0);
+    bool held = s_sink.frames == 0;
+    std::this_thread::sleep_for(std::chrono::milliseconds(CONFIG_ESPRPC_SERIAL_RX_TIMEOUT_MS + 20));
+    esprpc_serial_feed_bytes(nullptr, 0);
+    bool ok = held && s_sink.frames == 1 && s_sink.errors == 0 && s_sink.next_id == id + 1;
+    printf("rx-timeout  held-before=%s delivered-after=%llu errors=%llu\n", held ? "yes" : "no",
+           (unsigned long long)s_sink.frames, (unsigned long long)s_sink.errors);
+    return ok;
+}
+
+}  // namespace
+
+int main(int argc, char **argv)
+{
+    Config c;
+    for (int i = 1; i < argc; i++) {
+        const char *a = argv[i];
+        const char *v = i + 1 < argc ? argv[i + 1] : nullptr;
+        if (!v) {
+            fprintf(stderr, "missing value for %s\n", a);
+            return 2;
+        }
+        if (strcmp(a, "--packets") == 0) c.packets = atoi(v);
+        else if (strcmp(a, "--log-ratio") == 0) c.log_ratio = atoi(v);
+        else if (strcmp(a, "--corrupt-every") == 0) c.corrupt_every = atoi(v);
+        else if (strcmp(a, "--chunk") == 0) c.chunk = (size_t)atol(v);
+        else if (strcmp(a, "--payload") == 0) c.payload = (size_t)atol(v);
+        else {
+            fprintf(stderr, "unknown option %s\n", a);
+            return 2;
+        }
+        i++;
+    }
+    if (c.packets < 1 || c.log_ratio < 0 || c.corrupt_every < 0 || c.chunk < 1 || c.payload < 4 ||
+        c.payload > CONFIG_ESPRPC_SERIAL_PAYLOAD_MAX) {
+        fprintf(stderr, "invalid options\n");
+        return 2;
+    }
+
+    esprpc_init();
+    esprpc_transport_serial_init();
+    esprpc_transport_t *t = esprpc_transport_serial_get();
+    t->start(t->ctx, on_recv, nullptr);
+    esprpc_serial_set_tx_cb(capture_tx, nullptr);
+
+    uint8_t pb[ESPRPC_SERIAL_MARKER_MAX], sb[ESPRPC_SERIAL_MARKER_MAX];
+    size_t pl = 0, sl = 0;
+    esprpc_serial_get_packet_marker(pb, sizeof(pb), &pl, sb, sizeof(sb), &sl);
+    std::vector<uint8_t> pre(pb, pb + pl), suf(sb, sb + sl);
+
+    uint32_t valid = 0;
+    std::vector<uint8_t> stream = make_stream(c, pre, &valid);
+    printf("stream=%zuB packets=%d valid=%u payload=%zuB chunk<=%zu\n", stream.size(), c.packets, valid, c.payload,
+           c.chunk);
+
+    /* feed_bytes：随机块大小 */
+    std::mt19937 rng(7);
+    std::vector<size_t> chunks;
+    for (size_t off = 0; off < stream.size();) {
+        size_t n = 1 + rng() % c.chunk;
+        if (n > stream.size() - off) n = stream.size() - off;
+        chunks.push_back(n);
+        off += n;
+    }
+    s_sink = Sink();
+    auto t0 = std::chrono::steady_clock::now();
+    size_t off = 0;
+    for (size_t n : chunks) {
+        esprpc_serial_feed_bytes(stream.data() + off, n);
+        off += n;
+    }
+    double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t0).count();
+    esprpc_serial_stats_t st;
+    esprpc_serial_get_stats(&st);
+    Sink fb = s_sink;
+    printf("feed_bytes  delivered=%-7llu lost=%-5llu errors=%-3llu calls=%-8zu %6.2f ns/B %8.1f MB/s "
+           "copied=%u resyncs=%u corrupt=%u skipped=%uB\n",
+           (unsigned long long)fb.frames, (unsigned long long)fb.lost, (unsigned long long)fb.errors, chunks.size(),
+           ns / (double)stream.size(), (double)stream.size() / ns * 1e3, st.frames_copied, st.resyncs,
+           st.frames_corrupt, st.bytes_skipped);
+
+#if !CONFIG_ESPRPC_SERIAL_COBS
+    /* 对照 */
+    s_sink = Sink();
+    Stream s = { stream.data(), stream.size(), 0, 0 };
+    t0 = std::chrono::steady_clock::now();
+    naive_frame(s, pre, suf, CONFIG_ESPRPC_SERIAL_PAYLOAD_MAX);
+    ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t0).count();
+    printf("naive-loop  delivered=%-7llu lost=%-5llu errors=%-3llu reads=%-8llu %6.2f ns/B %8.1f MB/s\n",
+           (unsigned long long)s_sink.frames, (unsigned long long)s_sink.lost, (unsigned long long)s_sink.errors,
+           (unsigned long long)s.reads, ns / (double)stream.size(), (double)stream.size() / ns * 1e3);
+#endif
+
+    bool ok = fb.errors == 0 && fb.lost == 0 && fb.frames == valid;
+    if (!ok) fprintf(stderr, "FAIL: feed_bytes delivered %llu of %u valid packets\n", (unsigned long long)fb.frames,
+                     valid);
+    if (!check_rx_timeout(valid + 1, c.payload)) {
+        fprintf(stderr, "FAIL: partial packet not abandoned after the rx timeout\n");
+        ok = false;
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,313 @@
+/**
+ * @file bench_serial_arq.cpp
+ * @brief 串口 ARQ 可靠链路：一对 Linux pty 上的两个进程，发送端注入丢包与损坏
+ *
+ * 父进程扮演设备（pty 主端）：on_recv 中对每个请求回应 --replies 帧（收包任务内发送，多于应答队列初始长度时
+ * 相当于多页的分页响应），另一线程同时推送流帧（invoke_id 0）。
+ * 子进程扮演主机（pty 从端）：不等响应连续发出 --requests 个请求，校验响应与流帧各自按序、不缺不重地送达。
+ * 两端的 tx_cb 以 --loss 概率整包丢弃、以 --corrupt 概率改动一个字节后写入 pty。
+ * 两个进程各自运行一份 transport_serial.c（CONFIG_ESPRPC_SERIAL_ARQ=1），读线程把 pty 读到的字节交给
+ * esprpc_serial_feed_bytes()。
+ *
+ * 用法:
+ *   bench_serial_arq [--requests 2000] [--replies 1] [--streams 2000] [--payload 64] [--loss 0.05] [--corrupt 0.05]
+ *                    [--timeout 60]
+ *
+ * 超时前未全部送达、或出现乱序、重复、内容错误时返回非零。
+ */
+
+#include "esprpc.h"
+#include "esprpc_transport.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <errno.h>
+#include <pty.h>
+#include <sys/wait.h>
+#include <termios.h>
+#include <unistd.h>
+
+namespace {
+
+constexpr size_t kHeader = 5;
+constexpr uint8_t kMethodEcho = 0x21;
+constexpr uint8_t kMethodStream = 0x22;
+
+struct Config {
+    uint32_t requests = 2000;
+    uint32_t replies = 1;
+    uint32_t streams = 2000;
+    size_t payload = 64;
+    double loss = 0.05;
+    double corrupt = 0.05;
+    int timeout_s = 60;
+};
+Config s_cfg;
+
+int s_fd = -1;
+std::mutex s_rng_mu;
+std::mt19937 s_rng;
+std::atomic<uint64_t> s_lost_injected{0}, s_corrupt_injected{0};
+
+/** 发送回调：只由链路任务调用；按配置丢包或改动一个字节 */
+void lossy_tx(const uint8_t *data, size_t len, void *ctx)
+{
+    (void)ctx;
+    std::vector<uint8_t> pkt(data, data + len);
+    {
+        std::lock_guard<std::mutex> lk(s_rng_mu);
+        std::uniform_real_distribution<double> u(0, 1);
+        if (u(s_rng) < s_cfg.loss) {
+            s_lost_injected++;
+            return;
+        }
+        if (u(s_rng) < s_cfg.corrupt) {
+            pkt[1 + s_rng() % (len - 2)] ^= (uint8_t)(1 + s_rng() % 255);
+            s_corrupt_injected++;
+        }
+    }
+    for (size_t off = 0; off < pkt.size();) {
+        ssize_t n = write(s_fd, pkt.data() + off, pkt.size() - off);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return;
+        }
+        off += (size_t)n;
+    }
+}
+
+void reader_loop()
+{
+    uint8_t buf[256];
+    for (;;) {
+        ssize_t n = read(s_fd, buf, sizeof(buf));
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return;  /* 对端关闭（EIO） */
+        esprpc_serial_feed_bytes(buf, (size_t)n);
+    }
+}
+
+/** 帧：[method][invoke_id LE][len LE][4B id][填充]，填充由 id 决定 */
+std::vector<uint8_t> make_frame(uint8_t method, uint16_t invoke_id, uint32_t id)
+{
+    size_t n = s_cfg.payload;
+    std::vector<uint8_t> f(kHeader + n);
+    f[0] = method;
+    f[1] = (uint8_t)(invoke_id & 0xFF);
+    f[2] = (uint8_t)(invoke_id >> 8);
+    f[3] = (uint8_t)(n & 0xFF);
+    f[4] = (uint8_t)(n >> 8);
+    memcpy(f.data() + kHeader, &id, 4);
+    for (size_t i = kHeader + 4; i < f.size(); i++) f[i] = (uint8_t)(id * 13 + i);
+    return f;
+}
+
+/** 校验帧内容，返回其中的 id；不符返回 0 */
+uint32_t check_frame(const uint8_t *data, size_t len, uint8_t method)
+{
+    uint32_t id;
+    if (len != kHeader + s_cfg.payload || data[0] != method) return 0;
+    memcpy(&id, data + kHeader, 4);
+    for (size_t i = kHeader + 4; i < len; i++) {
+        if (data[i] != (uint8_t)(id * 13 + i)) return 0;
+    }
+    return id;
+}
+
+/** 发送一帧，返回重试次数。链路正常时 sendv 在队列满时自行等待；只有对端尚未出现（链路未建立）时队列满会丢帧并
+ *  返回 ESP_ERR_INVALID_STATE，此时让出 CPU 后重发 */
+uint32_t send_frame(esprpc_transport_t *t, const std::vector<uint8_t> &f)
+{
+    uint32_t retries = 0;
+    esprpc_iovec_t iov = { f.data(), f.size() };
+    while (t->sendv(t->ctx, &iov, 1) == ESP_ERR_INVALID_STATE) {
+        retries++;
+        std::this_thread::sleep_for(std::chrono::microseconds(200));
+    }
+    return retries;
+}
+
+/** 按序计数：id 须从 1 开始逐个递增 */
+struct Seq {
+    std::atomic<uint32_t> next{1};
+    std::atomic<uint32_t> errors{0};
+
+    void push(uint32_t id)
+    {
+        if (id != 0 && id == next.load()) next++;
+        else errors++;
+    }
+};
+
+void print_stats(const char *who, double secs)
+{
+    esprpc_serial_stats_t st;
+    esprpc_serial_get_stats(&st);
+    printf("%-6s %6.2fs injected loss=%-5llu corrupt=%-5llu | frames=%-6u corrupt=%-5u retransmits=%-6u "
+           "fast=%-5u discarded=%-5u dropped=%u\n",
+           who, secs, (unsigned long long)s_lost_injected.load(), (unsigned long long)s_corrupt_injected.load(),
+           st.frames, st.frames_corrupt, st.arq_retransmits, st.arq_fast_retransmits, st.arq_discarded,
+           st.arq_dropped);
+    fflush(stdout);
+}
+
+/* ---------- 主机（子进程） ---------- */
+
+Seq s_responses, s_stream_in;
+
+void host_on_recv(const uint8_t *data, size_t len, void *ctx)
+{
+    (void)ctx;
+    uint16_t invoke_id = (uint16_t)(data[1] | (data[2] << 8));
+    if (invoke_id == 0) {
+        s_stream_in.push(check_frame(data, len, kMethodStream));
+        return;
+    }
+    /* 第 r 个请求的第 k 帧回应 id 为 (r - 1) * replies + k + 1，invoke_id 回显请求 */
+    uint32_t id = check_frame(data, len, kMethodEcho);
+    uint32_t req = id ? (id - 1) / s_cfg.replies + 1 : 0;
+    if (id != 0 && (uint16_t)(req % 0xFFFF + 1) != invoke_id) id = 0;
+    s_responses.push(id);
+}
+
+int run_host()
+{
+    esprpc_transport_t *t = esprpc_transport_serial_get();
+    t->start(t->ctx, host_on_recv, nullptr);
+    std::thread(reader_loop).detach();
+
+    auto t0 = std::chrono::steady_clock::now();
+    uint32_t retries = 0;
+    for (uint32_t id = 1; id <= s_cfg.requests; id++) {
+        retries += send_frame(t, make_frame(kMethodEcho, (uint16_t)(id % 0xFFFF + 1), id));
+    }
+    auto deadline = t0 + std::chrono::seconds(s_cfg.timeout_s);
+    const uint32_t responses = s_cfg.requests * s_cfg.replies;
+    while ((s_responses.next <= responses || s_stream_in.next <= s_cfg.streams) &&
+           std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    print_stats("host", secs);
+    printf("host   responses=%u/%u stream=%u/%u errors=%u send-retries=%u %.0f frames/s\n",
+           s_responses.next.load() - 1, responses, s_stream_in.next.load() - 1, s_cfg.streams,
+           s_responses.errors.load() + s_stream_in.errors.load(), retries,
+           (double)(s_responses.next.load() - 1 + s_stream_in.next.load() - 1) / secs);
+    fflush(stdout);
+    /* 留时间让最后的 ACK 发出，设备端不再重传 */
+    std::this_thread::sleep_for(std::chrono::milliseconds(300));
+    bool ok = s_responses.next == responses + 1 && s_stream_in.next == s_cfg.streams + 1 &&
+              s_responses.errors == 0 && s_stream_in.errors == 0;
+    return ok ? 0 : 1;
+}
+
+/* ---------- 设备（父进程） ---------- */
+
+Seq s_requests;
+std::atomic<uint32_t> s_reply_fail{0};
+esprpc_transport_t *s_dev;
+
+void device_on_recv(const uint8_t *data, size_t len, void *ctx)
+{
+    (void)ctx;
+    uint32_t id = check_frame(data, len, kMethodEcho);
+    s_requests.push(id);
+    uint16_t invoke_id = (uint16_t)(data[1] | (data[2] << 8));
+    for (uint32_t k = 0; k < s_cfg.replies; k++) {
+        std::vector<uint8_t> f = make_frame(kMethodEcho, invoke_id, (id - 1) * s_cfg.replies + k + 1);
+        esprpc_iovec_t iov = { f.data(), f.size() };
+        if (s_dev->sendv(s_dev->ctx, &iov, 1) != ESP_OK) s_reply_fail++;
+    }
+}
+
+int run_device(pid_t host)
+{
+    s_dev = esprpc_transport_serial_get();
+    s_dev->start(s_dev->ctx, device_on_recv, nullptr);
+    std::thread(reader_loop).detach();
+
+    auto t0 = std::chrono::steady_clock::now();
+    std::thread([] {
+        for (uint32_t id = 1; id <= s_cfg.streams; id++) send_frame(s_dev, make_frame(kMethodStream, 0, id));
+    }).detach();
+
+    int status = 0;
+    waitpid(host, &status, 0);
+    double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    print_stats("device", secs);
+    printf("device requests=%u/%u errors=%u reply-failures=%u\n", s_requests.next.load() - 1, s_cfg.requests,
+           s_requests.errors.load(), s_reply_fail.load());
+    bool ok = WIFEXITED(status) && WEXITSTATUS(status) == 0 && s_requests.next == s_cfg.requests + 1 &&
+              s_requests.errors == 0 && s_reply_fail == 0;
+    if (!ok) fprintf(stderr, "FAIL: frames lost, duplicated or reordered over the ARQ link\n");
+    return ok ? 0 : 1;
+}
+
+}  // namespace
+
+int main(int argc, char **argv)
+{
+    Config &c = s_cfg;
+    for (int i = 1; i < argc; i++) {
+        std::string a = argv[i];
+        auto next = [&](void) -> const char * { return i + 1 < argc ? argv[++i] : "0"; };
+        if (a == "--requests") c.requests = (uint32_t)atoi(next());
+        else if (a == "--replies") c.replies = (uint32_t)atoi(next());
+        else if (a == "--streams") c.streams = (uint32_t)atoi(next());
+        else if (a == "--payload") c.payload = (size_t)atoi(next());
+        else if (a == "--loss") c.loss = atof(next());
+        else if (a == "--corrupt") c.corrupt = atof(next());
+        else if (a == "--timeout") c.timeout_s = atoi(next());
+        else {
+            fprintf(stderr,
+                    "usage: %s [--requests N] [--replies N] [--streams N] [--payload B] [--loss P] [--corrupt P] "
+                    "[--timeout S]\n",
+                    argv[0]);
+            return 2;
+        }
+    }
+    if (c.replies < 1 || c.payload < 4 || c.payload > CONFIG_ESPRPC_SERIAL_PAYLOAD_MAX || c.loss < 0 || c.loss >= 1 ||
+        c.corrupt < 0 || c.corrupt > 1 || c.timeout_s < 1) {
+        fprintf(stderr, "invalid options\n");
+        return 2;
+    }
+
+    int master = -1, slave = -1;
+    if (openpty(&master, &slave, nullptr, nullptr, nullptr) != 0) {
+        perror("openpty");
+        return 2;
+    }
+    struct termios tio;
+    tcgetattr(slave, &tio);
+    cfmakeraw(&tio);
+    tcsetattr(slave, TCSANOW, &tio);
+    printf("pty window=%d rto=%dms requests=%u replies=%u streams=%u payload=%zuB loss=%.2f corrupt=%.2f\n",
+           CONFIG_ESPRPC_SERIAL_ARQ_WINDOW, CONFIG_ESPRPC_SERIAL_ARQ_RTO_MS, c.requests, c.replies, c.streams, c.payload,
+           c.loss, c.corrupt);
+    fflush(stdout);
+
+    pid_t pid = fork();
+    if (pid < 0) {
+        perror("fork");
+        return 2;
+    }
+    bool host = pid == 0;
+    s_fd = host ? slave : master;
+    close(host ? master : slave);
+    s_rng.seed(host ? 11 : 7);
+
+    esprpc_init();
+    esprpc_transport_serial_init();
+    esprpc_serial_set_tx_cb(lossy_tx, nullptr);
+    if (host) _exit(run_host());
+    return run_device(pid);
+}
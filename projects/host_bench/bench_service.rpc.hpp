@@ -0,0 +1,48 @@
+/**
+ * @file bench_service.rpc.hpp
+ * @brief 基准测试专用 schema：嵌套 struct、可选字段、基本类型/字符串/struct 列表、字符串视图、MAP
+ */
+
+#ifndef BENCH_SERVICE_RPC_HPP
+#define BENCH_SERVICE_RPC_HPP
+
+#include "rpc_macros.hpp"
+
+RPC_ENUM(Level, LOW = 0, MID = 1, HIGH = 2)
+
+RPC_STRUCT(Meta,
+    OPTIONAL(int) seq;
+    OPTIONAL(string) note;
+)
+
+RPC_STRUCT(Sample,
+    int id;
+    OPTIONAL(int) value;
+    OPTIONAL(string) label;
+    Level level;
+)
+
+RPC_LIST_TYPEDEF(Sample)
+
+RPC_STRUCT(Batch,
+    REQUIRED(string) source;
+    Meta meta;
+    LIST_MAX(int, 1024) values;
+    LIST(Sample) samples;
+    LIST(string) tags;
+)
+
+/* 与 user_service 的 CreateUserRequest 线上编码相同，字段为 strview */
+RPC_STRUCT(CreateUserView,
+    REQUIRED(strview) name;
+    REQUIRED(strview) email;
+    OPTIONAL(strview) password;
+)
+
+RPC_SERVICE(BenchService)
+    RPC_METHOD(Echo, Batch, Batch batch)
+    RPC_METHOD(Register, int, CreateUserView request)
+    RPC_METHOD(Configure, int, MAP(string, string) settings)
+RPC_SERVICE_END(BenchService)
+
+#endif /* BENCH_SERVICE_RPC_HPP */
@@ -0,0 +1,494 @@
+/**
+ * @file ble_mock.c
+ * @brief NimBLE host API 替身实现（见 ble_mock.h）
+ */
+
+#include "ble_mock.h"
+#include "host/ble_hs.h"
+#include "nimble/nimble_port.h"
+#include "nimble/nimble_port_freertos.h"
+#include "services/gap/ble_svc_gap.h"
+#include "services/gatt/ble_svc_gatt.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define MOCK_MAX_CONNS 8
+#define MOCK_LINK_MAX  256
+
+struct ble_hs_cfg ble_hs_cfg;
+
+typedef struct {
+    uint16_t conn_handle;
+    struct os_mbuf *om;
+} link_item_t;
+
+static struct {
+    int mbuf_limit;
+    int link_capacity;
+    ble_mock_stats_t stats;
+    ble_mock_notify_fn notify_fn;
+    void *notify_ctx;
+    const struct ble_gatt_svc_def *svcs;
+    ble_gap_event_fn *gap_cb;
+    void *gap_arg;
+    uint16_t mtu[MOCK_MAX_CONNS];
+    link_item_t link[MOCK_LINK_MAX];
+    int link_head;
+    int link_count;
+    struct ble_npl_callout *callouts;
+    bool advertising;
+    uint16_t terminate_pending;  /* ble_gap_terminate 请求断开、尚未上报的连接 */
+} s_mock;
+
+static void gap_event(struct ble_gap_event *ev);
+
+/* ---------- mbuf ---------- */
+
+static struct os_mbuf *mbuf_get(void)
+{
+    if (s_mock.stats.mbufs_in_use >= s_mock.mbuf_limit) return NULL;
+    struct os_mbuf *m = (struct os_mbuf *)calloc(1, sizeof(struct os_mbuf));
+    if (!m) return NULL;
+    m->om_data = m->om_databuf;
+    s_mock.stats.mbufs_in_use++;
+    return m;
+}
+
+uint16_t os_mbuf_len(const struct os_mbuf *om)
+{
+    uint16_t n = 0;
+    for (; om; om = SLIST_NEXT(om, om_next)) n += om->om_len;
+    return n;
+}
+
+int os_mbuf_copydata(const struct os_mbuf *om, int off, int len, void *dst)
+{
+    uint8_t *d = (uint8_t *)dst;
+    for (; om && len > 0; om = SLIST_NEXT(om, om_next)) {
+        if (off >= om->om_len) {
+            off -= om->om_len;
+            continue;
+        }
+        int n = om->om_len - off;
+        if (n > len) n = len;
+        memcpy(d, om->om_data + off, (size_t)n);
+        d += n;
+        len -= n;
+        off = 0;
+    }
+    return len > 0 ? -1 : 0;
+}
+
+int os_mbuf_append(struct os_mbuf *om, const void *data, uint16_t len)
+{
+    const uint8_t *s = (const uint8_t *)data;
+    while (SLIST_NEXT(om, om_next)) om = SLIST_NEXT(om, om_next);
+    while (len > 0) {
+        size_t room = BLE_MOCK_MBUF_BLOCK - (size_t)(om->om_data - om->om_databuf) - om->om_len;
+        if (room == 0) {
+            struct os_mbuf *n = mbuf_get();
+            if (!n) return BLE_HS_ENOMEM;
+            SLIST_NEXT(om, om_next) = n;
+            om = n;
+            continue;
+        }
+        size_t k = len < room ? len : room;
+        memcpy(om->om_data + om->om_len, s, k);
+        om->om_len += (uint16_t)k;
+        s += k;
+        len -= (uint16_t)k;
+    }
+    return 0;
+}
+
+int os_mbuf_free_chain(struct os_mbuf *om)
+{
+    while (om) {
+        struct os_mbuf *n = SLIST_NEXT(om, om_next);
+        free(om);
+        s_mock.stats.mbufs_in_use--;
+        om = n;
+    }
+    return 0;
+}
+
+struct os_mbuf *ble_hs_mbuf_att_pkt(void)
+{
+    return mbuf_get();
+}
+
+struct os_mbuf *ble_hs_mbuf_from_flat(const void *buf, uint16_t len)
+{
+    struct os_mbuf *om = mbuf_get();
+    if (om && os_mbuf_append(om, buf, len) != 0) {
+        os_mbuf_free_chain(om);
+        return NULL;
+    }
+    return om;
+}
+
+/* ---------- GATT ---------- */
+
+static const struct ble_gatt_chr_def *find_chr(uint16_t flag)
+{
+    for (const struct ble_gatt_svc_def *s = s_mock.svcs; s && s->type; s++) {
+        for (const struct ble_gatt_chr_def *c = s->characteristics; c && c->uuid; c++) {
+            if (c->flags & flag) return c;
+        }
+    }
+    return NULL;
+}
+
+int ble_gatts_count_cfg(const struct ble_gatt_svc_def *defs)
+{
+    (void)defs;
+    return 0;
+}
+
+int ble_gatts_add_svcs(const struct ble_gatt_svc_def *defs)
+{
+    uint16_t handle = 0x10;
+    s_mock.svcs = defs;
+    for (const struct ble_gatt_svc_def *s = defs; s->type; s++) {
+        for (const struct ble_gatt_chr_def *c = s->characteristics; c && c->uuid; c++) {
+            if (c->val_handle) *c->val_handle = (handle += 2);
+        }
+    }
+    return 0;
+}
+
+static int notify_submit(uint16_t conn_handle, struct os_mbuf *om)
+{
+    if (conn_handle >= MOCK_MAX_CONNS || !s_mock.mtu[conn_handle]) {
+        os_mbuf_free_chain(om);
+        return BLE_HS_ENOTCONN;
+    }
+    if (s_mock.link_count >= s_mock.link_capacity || s_mock.link_count >= MOCK_LINK_MAX) {
+        os_mbuf_free_chain(om);
+        s_mock.stats.notify_enomem++;
+        return BLE_HS_ENOMEM;
+    }
+    link_item_t *it = &s_mock.link[(s_mock.link_head + s_mock.link_count) % MOCK_LINK_MAX];
+    it->conn_handle = conn_handle;
+    it->om = om;
+    s_mock.link_count++;
+    s_mock.stats.notify_ok++;
+    return 0;
+}
+
+int ble_gatts_notify_custom(uint16_t conn_handle, uint16_t att_handle, struct os_mbuf *om)
+{
+    int rc = notify_submit(conn_handle, om);
+    /* NimBLE 对每次通知尝试同步上报 NOTIFY_TX，不等待空口发出 */
+    struct ble_gap_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.type = BLE_GAP_EVENT_NOTIFY_TX;
+    ev.notify_tx.status = rc;
+    ev.notify_tx.conn_handle = conn_handle;
+    ev.notify_tx.attr_handle = att_handle;
+    gap_event(&ev);
+    return rc;
+}
+
+int ble_gattc_exchange_mtu(uint16_t conn_handle, ble_gatt_mtu_fn *cb, void *cb_arg)
+{
+    (void)conn_handle;
+    (void)cb;
+    (void)cb_arg;
+    return 0;
+}
+
+uint16_t ble_att_mtu(uint16_t conn_handle)
+{
+    return conn_handle < MOCK_MAX_CONNS ? s_mock.mtu[conn_handle] : 0;
+}
+
+int ble_att_set_preferred_mtu(uint16_t mtu)
+{
+    return (mtu < BLE_ATT_MTU_DFLT || mtu > BLE_ATT_MTU_MAX) ? BLE_HS_EINVAL : 0;
+}
+
+/* ---------- NPL callout ---------- */
+
+void ble_npl_callout_init(struct ble_npl_callout *co, struct ble_npl_eventq *evq,
+                          ble_npl_event_fn *ev_cb, void *ev_arg)
+{
+    (void)evq;
+    struct ble_npl_callout *c = s_mock.callouts;
+    while (c && c != co) c = c->next;
+    if (!c) {
+        co->next = s_mock.callouts;
+        s_mock.callouts = co;
+    }
+    co->ev.fn = ev_cb;
+    co->ev.arg = ev_arg;
+    co->armed = false;
+}
+
+int ble_npl_callout_reset(struct ble_npl_callout *co, ble_npl_time_t ticks)
+{
+    (void)ticks;  /* 替身不计时间：下一次 ble_mock_pump 时到期 */
+    co->armed = true;
+    return 0;
+}
+
+void ble_npl_callout_stop(struct ble_npl_callout *co)
+{
+    co->armed = false;
+}
+
+bool ble_npl_callout_is_active(struct ble_npl_callout *co)
+{
+    return co->armed;
+}
+
+ble_npl_time_t ble_npl_time_ms_to_ticks32(uint32_t ms)
+{
+    return ms;
+}
+
+struct ble_npl_eventq *nimble_port_get_dflt_eventq(void)
+{
+    static struct ble_npl_eventq q;
+    return &q;
+}
+
+/* ---------- GAP / host ---------- */
+
+int ble_gap_adv_set_fields(const struct ble_hs_adv_fields *fields)
+{
+    (void)fields;
+    return 0;
+}
+
+int ble_gap_adv_start(uint8_t own_addr_type, const void *direct_addr, int32_t duration_ms,
+                      const struct ble_gap_adv_params *params, ble_gap_event_fn *cb, void *cb_arg)
+{
+    (void)own_addr_type;
+    (void)direct_addr;
+    (void)duration_ms;
+    (void)params;
+    if (s_mock.advertising) return BLE_HS_EALREADY;
+    s_mock.gap_cb = cb;
+    s_mock.gap_arg = cb_arg;
+    s_mock.advertising = true;
+    return 0;
+}
+
+int ble_gap_adv_stop(void)
+{
+    if (!s_mock.advertising) return BLE_HS_EALREADY;
+    s_mock.advertising = false;
+    return 0;
+}
+
+int ble_gap_adv_active(void)
+{
+    return s_mock.advertising;
+}
+
+int ble_gap_terminate(uint16_t conn_handle, uint8_t hci_reason)
+{
+    (void)hci_reason;
+    if (conn_handle >= MOCK_MAX_CONNS || !s_mock.mtu[conn_handle]) return BLE_HS_ENOTCONN;
+    s_mock.terminate_pending = conn_handle;
+    return 0;
+}
+
+int ble_hs_id_infer_auto(int privacy, uint8_t *out_addr_type)
+{
+    (void)privacy;
+    *out_addr_type = BLE_OWN_ADDR_PUBLIC;
+    return 0;
+}
+
+esp_err_t nimble_port_init(void)
+{
+    return ESP_OK;
+}
+
+void nimble_port_run(void)
+{
+}
+
+void nimble_port_freertos_init(void (*host_task_fn)(void *))
+{
+    (void)host_task_fn;
+    if (ble_hs_cfg.sync_cb) ble_hs_cfg.sync_cb();  /* 立即“同步”，开始广播 */
+}
+
+void nimble_port_freertos_deinit(void)
+{
+}
+
+void ble_svc_gap_init(void)
+{
+}
+
+static const char *s_device_name = "nimble";
+
+int ble_svc_gap_device_name_set(const char *name)
+{
+    s_device_name = name;
+    return 0;
+}
+
+const char *ble_svc_gap_device_name(void)
+{
+    return s_device_name;
+}
+
+void ble_svc_gatt_init(void)
+{
+}
+
+/* ---------- 控制接口 ---------- */
+
+static void gap_event(struct ble_gap_event *ev)
+{
+    if (s_mock.gap_cb) s_mock.gap_cb(ev, s_mock.gap_arg);
+}
+
+void ble_mock_reset(int mbuf_limit, int link_capacity)
+{
+    s_mock.terminate_pending = BLE_HS_CONN_HANDLE_NONE;
+    while (s_mock.link_count) {
+        os_mbuf_free_chain(s_mock.link[s_mock.link_head].om);
+        s_mock.link_head = (s_mock.link_head + 1) % MOCK_LINK_MAX;
+        s_mock.link_count--;
+    }
+    s_mock.mbuf_limit = mbuf_limit;
+    s_mock.link_capacity = link_capacity;
+    memset(&s_mock.stats, 0, sizeof(s_mock.stats));
+    memset(s_mock.mtu, 0, sizeof(s_mock.mtu));
+}
+
+void ble_mock_set_notify_cb(ble_mock_notify_fn fn, void *ctx)
+{
+    s_mock.notify_fn = fn;
+    s_mock.notify_ctx = ctx;
+}
+
+int ble_mock_connect(uint16_t conn_handle, uint16_t mtu)
+{
+    struct ble_gap_event ev;
+    if (!s_mock.advertising || conn_handle >= MOCK_MAX_CONNS || s_mock.mtu[conn_handle]) return -1;
+    s_mock.advertising = false;  /* 与控制器一致：建立连接即停止广播 */
+    memset(&ev, 0, sizeof(ev));
+    s_mock.mtu[conn_handle] = BLE_ATT_MTU_DFLT;
+    ev.type = BLE_GAP_EVENT_CONNECT;
+    ev.connect.conn_handle = conn_handle;
+    gap_event(&ev);
+    if (s_mock.terminate_pending == conn_handle) {
+        s_mock.terminate_pending = BLE_HS_CONN_HANDLE_NONE;
+        ble_mock_disconnect(conn_handle);
+        return -1;
+    }
+    s_mock.mtu[conn_handle] = mtu;
+    memset(&ev, 0, sizeof(ev));
+    ev.type = BLE_GAP_EVENT_MTU;
+    ev.mtu.conn_handle = conn_handle;
+    ev.mtu.value = mtu;
+    gap_event(&ev);
+    return 0;
+}
+
+void ble_mock_disconnect(uint16_t conn_handle)
+{
+    struct ble_gap_event ev;
+    memset(&ev, 0, sizeof(ev));
+    s_mock.mtu[conn_handle] = 0;
+    ev.type = BLE_GAP_EVENT_DISCONNECT;
+    ev.disconnect.reason = BLE_ERR_REM_USER_CONN_TERM;
+    ev.disconnect.conn.conn_handle = conn_handle;
+    gap_event(&ev);
+}
+
+int ble_mock_advertising(void)
+{
+    return s_mock.advertising;
+}
+
+void ble_mock_subscribe(uint16_t conn_handle, int notify)
+{
+    const struct ble_gatt_chr_def *rx = find_chr(BLE_GATT_CHR_F_NOTIFY);
+    struct ble_gap_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.type = BLE_GAP_EVENT_SUBSCRIBE;
+    ev.subscribe.conn_handle = conn_handle;
+    ev.subscribe.attr_handle = rx && rx->val_handle ? *rx->val_handle : 0;
+    ev.subscribe.cur_notify = notify ? 1 : 0;
+    gap_event(&ev);
+}
+
+int ble_mock_write(uint16_t conn_handle, const void *data, size_t len, size_t chunk)
+{
+    const struct ble_gatt_chr_def *tx = find_chr(BLE_GATT_CHR_F_WRITE);
+    if (!tx) return -1;
+    /* 写入走单独的“接收”mbuf，不受通知 mbuf 上限影响 */
+    struct os_mbuf *head = NULL, *tail = NULL;
+    const uint8_t *p = (const uint8_t *)data;
+    size_t step = chunk ? chunk : BLE_MOCK_MBUF_BLOCK;
+    for (size_t off = 0; off < len || !head; off += step) {
+        struct os_mbuf *m = (struct os_mbuf *)calloc(1, sizeof(struct os_mbuf));
+        m->om_data = m->om_databuf;
+        size_t n = len - off < step ? len - off : step;
+        memcpy(m->om_data, p + off, n);
+        m->om_len = (uint16_t)n;
+        if (tail) SLIST_NEXT(tail, om_next) = m; else head = m;
+        tail = m;
+        s_mock.stats.mbufs_in_use++;
+    }
+    struct ble_gatt_access_ctxt ctxt = { BLE_GATT_ACCESS_OP_WRITE_CHR, head };
+    int rc = tx->access_cb(conn_handle, *tx->val_handle, &ctxt, tx->arg);
+    os_mbuf_free_chain(head);
+    return rc;
+}
+
+int ble_mock_read_rx(uint16_t conn_handle, uint8_t *out, size_t cap)
+{
+    const struct ble_gatt_chr_def *rx = find_chr(BLE_GATT_CHR_F_NOTIFY);
+    if (!rx) return -1;
+    struct os_mbuf *om = (struct os_mbuf *)calloc(1, sizeof(struct os_mbuf));
+    om->om_data = om->om_databuf;
+    s_mock.stats.mbufs_in_use++;
+    struct ble_gatt_access_ctxt ctxt = { BLE_GATT_ACCESS_OP_READ_CHR, om };
+    int n = -1;
+    if (rx->access_cb(conn_handle, *rx->val_handle, &ctxt, rx->arg) == 0 && os_mbuf_len(om) <= cap) {
+        n = os_mbuf_len(om);
+        os_mbuf_copydata(om, 0, n, out);
+    }
+    os_mbuf_free_chain(om);
+    return n;
+}
+
+int ble_mock_pump(int n)
+{
+    int sent = 0;
+    while (sent < n && s_mock.link_count) {
+        link_item_t it = s_mock.link[s_mock.link_head];
+        s_mock.link_head = (s_mock.link_head + 1) % MOCK_LINK_MAX;
+        s_mock.link_count--;
+        uint8_t buf[BLE_ATT_MTU_MAX];
+        uint16_t len = os_mbuf_len(it.om);
+        os_mbuf_copydata(it.om, 0, len, buf);
+        os_mbuf_free_chain(it.om);
+        s_mock.stats.delivered++;
+        sent++;
+        if (s_mock.notify_fn) s_mock.notify_fn(it.conn_handle, buf, len, s_mock.notify_ctx);
+    }
+    /* 一个连接事件过去：执行此前已启动的 callout（回调中重新启动的留到下一次） */
+    for (struct ble_npl_callout *co = s_mock.callouts; co; co = co->next) {
+        if (co->armed) {
+            co->armed = false;
+            s_mock.stats.callouts_fired++;
+            co->ev.fn(&co->ev);
+        }
+    }
+    return sent;
+}
+
+ble_mock_stats_t ble_mock_stats(void)
+{
+    return s_mock.stats;
+}
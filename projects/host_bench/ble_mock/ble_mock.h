@@ -0,0 +1,63 @@
+/**
+ * @file ble_mock.h
+ * @brief NimBLE host 替身的控制接口：注入连接/写入事件、模拟链路发送与 mbuf 耗尽
+ *
+ * 所有事件在调用线程中同步回调（相当于 NimBLE host 任务），不要从多个线程同时驱动。
+ * 与 NimBLE 一致，NOTIFY_TX 在每次 ble_gatts_notify_custom 内同步触发（status 为其返回值），
+ * 不表示空口已发出；mbuf 在 ble_mock_pump 发出后才释放。
+ */
+
+#ifndef BLE_MOCK_H
+#define BLE_MOCK_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** 通知到达对端时回调（data 为属性值，即 [段头][帧的一段]） */
+typedef void (*ble_mock_notify_fn)(uint16_t conn_handle, const uint8_t *data, size_t len, void *ctx);
+
+typedef struct {
+    uint32_t notify_ok;      /* notify 成功提交 */
+    uint32_t notify_enomem;  /* notify 因 mbuf/链路缓冲不足返回 BLE_HS_ENOMEM */
+    uint32_t delivered;      /* 已由 ble_mock_pump 发出 */
+    uint32_t callouts_fired; /* ble_mock_pump 中执行的 NPL callout 次数 */
+    int mbufs_in_use;        /* 当前占用的 mbuf 块数 */
+} ble_mock_stats_t;
+
+/** 清空状态；mbuf 上限与链路缓冲（已提交未发出的通知数）上限 */
+void ble_mock_reset(int mbuf_limit, int link_capacity);
+void ble_mock_set_notify_cb(ble_mock_notify_fn fn, void *ctx);
+
+/**
+ * 触发 CONNECT（并以 mtu 完成 MTU 交换）/ DISCONNECT 事件。
+ * 未在广播时 ble_mock_connect 返回 -1；传输层在 CONNECT 回调中 ble_gap_terminate 时随即断开并返回 -1
+ */
+int ble_mock_connect(uint16_t conn_handle, uint16_t mtu);
+void ble_mock_disconnect(uint16_t conn_handle);
+/** 当前是否在广播 */
+int ble_mock_advertising(void);
+/** 触发对 RX 特征的 SUBSCRIBE 事件 */
+void ble_mock_subscribe(uint16_t conn_handle, int notify);
+
+/** 对 TX 特征写一次属性值；chunk>0 时按 chunk 字节拆成 mbuf 链。返回 access_cb 的返回值 */
+int ble_mock_write(uint16_t conn_handle, const void *data, size_t len, size_t chunk);
+/** 读 RX 特征，返回读到的字节数，失败 -1 */
+int ble_mock_read_rx(uint16_t conn_handle, uint8_t *out, size_t cap);
+
+/**
+ * 模拟一个连接事件：链路发出至多 n 个已提交的通知（回调 notify_fn 并释放 mbuf），
+ * 然后执行已启动的 NPL callout（替身不计时间，启动后总在下一次 pump 到期）。返回发出数
+ */
+int ble_mock_pump(int n);
+
+ble_mock_stats_t ble_mock_stats(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* BLE_MOCK_H */
@@ -0,0 +1,3 @@
+/* 主机构建替身：见 host/ble_hs.h */
+#pragma once
+#include "host/ble_hs.h"
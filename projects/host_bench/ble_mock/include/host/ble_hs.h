@@ -0,0 +1,222 @@
+/**
+ * @file ble_hs.h
+ * @brief 主机构建用 NimBLE host API 替身：只覆盖 transport_ble.c 用到的子集，行为由 ble_mock.c 模拟
+ *
+ * mbuf 为真实的链式结构（每块 BLE_MOCK_MBUF_BLOCK 字节），可模拟 msys 耗尽与链路拥塞。
+ */
+
+#ifndef HOST_BLE_HS_H
+#define HOST_BLE_HS_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* ---------- 错误码 ---------- */
+
+#define BLE_HS_EAGAIN   1
+#define BLE_HS_EALREADY 2
+#define BLE_HS_EINVAL   3
+#define BLE_HS_ENOMEM   6
+#define BLE_HS_ENOTCONN 7
+#define BLE_HS_EBUSY    15
+
+#define BLE_ATT_ERR_UNLIKELY                0x0e
+#define BLE_ATT_ERR_INVALID_ATTR_VALUE_LEN  0x0d
+#define BLE_ATT_ERR_INSUFFICIENT_RES        0x11
+
+#define BLE_ERR_REM_USER_CONN_TERM 0x13
+
+#define BLE_HS_CONN_HANDLE_NONE 0xffff
+#define BLE_HS_FOREVER          INT32_MAX
+#define BLE_ATT_MTU_DFLT        23
+#define BLE_ATT_MTU_MAX         527
+
+/* ---------- mbuf ---------- */
+
+#define BLE_MOCK_MBUF_BLOCK 256
+
+struct os_mbuf {
+    uint8_t *om_data;
+    uint16_t om_len;
+    struct { struct os_mbuf *sle_next; } om_next;
+    uint8_t om_databuf[BLE_MOCK_MBUF_BLOCK];
+};
+
+#define SLIST_NEXT(elm, field) ((elm)->field.sle_next)
+
+uint16_t os_mbuf_len(const struct os_mbuf *om);
+int os_mbuf_copydata(const struct os_mbuf *om, int off, int len, void *dst);
+int os_mbuf_append(struct os_mbuf *om, const void *data, uint16_t len);
+int os_mbuf_free_chain(struct os_mbuf *om);
+struct os_mbuf *ble_hs_mbuf_att_pkt(void);
+struct os_mbuf *ble_hs_mbuf_from_flat(const void *buf, uint16_t len);
+
+/* ---------- UUID / GATT 定义 ---------- */
+
+typedef struct { uint8_t type; } ble_uuid_t;
+typedef struct { ble_uuid_t u; uint8_t value[16]; } ble_uuid128_t;
+#define BLE_UUID_TYPE_128 128
+#define BLE_UUID128_INIT(uuid128...) { .u = { .type = BLE_UUID_TYPE_128 }, .value = { uuid128 } }
+
+#define BLE_GATT_ACCESS_OP_READ_CHR  0
+#define BLE_GATT_ACCESS_OP_WRITE_CHR 1
+
+struct ble_gatt_access_ctxt {
+    uint8_t op;
+    struct os_mbuf *om;
+};
+
+typedef int ble_gatt_access_fn(uint16_t conn_handle, uint16_t attr_handle,
+                               struct ble_gatt_access_ctxt *ctxt, void *arg);
+
+#define BLE_GATT_CHR_F_READ          0x0002
+#define BLE_GATT_CHR_F_WRITE_NO_RSP  0x0004
+#define BLE_GATT_CHR_F_WRITE         0x0008
+#define BLE_GATT_CHR_F_NOTIFY        0x0010
+
+struct ble_gatt_chr_def {
+    const ble_uuid_t *uuid;
+    ble_gatt_access_fn *access_cb;
+    void *arg;
+    uint16_t flags;
+    uint16_t *val_handle;
+};
+
+#define BLE_GATT_SVC_TYPE_PRIMARY 1
+
+struct ble_gatt_svc_def {
+    uint8_t type;
+    const ble_uuid_t *uuid;
+    const struct ble_gatt_chr_def *characteristics;
+};
+
+int ble_gatts_count_cfg(const struct ble_gatt_svc_def *defs);
+int ble_gatts_add_svcs(const struct ble_gatt_svc_def *defs);
+/** 发送通知；无论成功与否都消耗 om，并同步触发一次 NOTIFY_TX（status 为返回值），与 NimBLE 一致 */
+int ble_gatts_notify_custom(uint16_t conn_handle, uint16_t att_handle, struct os_mbuf *om);
+
+typedef int ble_gatt_mtu_fn(uint16_t conn_handle, const void *error, uint16_t mtu, void *arg);
+int ble_gattc_exchange_mtu(uint16_t conn_handle, ble_gatt_mtu_fn *cb, void *cb_arg);
+uint16_t ble_att_mtu(uint16_t conn_handle);
+int ble_att_set_preferred_mtu(uint16_t mtu);
+
+/* ---------- GAP ---------- */
+
+#define BLE_GAP_EVENT_CONNECT       0
+#define BLE_GAP_EVENT_DISCONNECT    1
+#define BLE_GAP_EVENT_ADV_COMPLETE  9
+#define BLE_GAP_EVENT_SUBSCRIBE     14
+#define BLE_GAP_EVENT_MTU           15
+#define BLE_GAP_EVENT_NOTIFY_TX     13
+
+struct ble_gap_conn_desc {
+    uint16_t conn_handle;
+};
+
+struct ble_gap_event {
+    uint8_t type;
+    union {
+        struct { int status; uint16_t conn_handle; } connect;
+        struct { int reason; struct ble_gap_conn_desc conn; } disconnect;
+        struct { uint16_t conn_handle; uint16_t channel_id; uint16_t value; } mtu;
+        struct { int status; uint16_t conn_handle; uint16_t attr_handle; uint8_t indication : 1; } notify_tx;
+        struct {
+            uint16_t conn_handle;
+            uint16_t attr_handle;
+            uint8_t reason;
+            uint8_t prev_notify : 1;
+            uint8_t cur_notify : 1;
+            uint8_t prev_indicate : 1;
+            uint8_t cur_indicate : 1;
+        } subscribe;
+        struct { int reason; } adv_complete;
+    };
+};
+
+typedef int ble_gap_event_fn(struct ble_gap_event *event, void *arg);
+
+#define BLE_GAP_CONN_MODE_UND 2
+#define BLE_GAP_DISC_MODE_GEN 2
+#define BLE_OWN_ADDR_PUBLIC   0
+
+struct ble_gap_adv_params {
+    uint8_t conn_mode;
+    uint8_t disc_mode;
+    uint16_t itvl_min;
+    uint16_t itvl_max;
+};
+
+#define BLE_HS_ADV_F_DISC_GEN    0x02
+#define BLE_HS_ADV_F_BREDR_UNSUP 0x04
+
+struct ble_hs_adv_fields {
+    uint8_t flags;
+    const uint8_t *name;
+    uint8_t name_len;
+    unsigned name_is_complete : 1;
+    const ble_uuid128_t *uuids128;
+    uint8_t num_uuids128;
+    unsigned uuids128_is_complete : 1;
+};
+
+int ble_gap_adv_set_fields(const struct ble_hs_adv_fields *fields);
+int ble_gap_adv_start(uint8_t own_addr_type, const void *direct_addr, int32_t duration_ms,
+                      const struct ble_gap_adv_params *params, ble_gap_event_fn *cb, void *cb_arg);
+int ble_gap_adv_stop(void);
+int ble_gap_adv_active(void);
+/** 断开连接；与 NimBLE 一样异步完成，DISCONNECT 事件在当前事件回调返回后触发 */
+int ble_gap_terminate(uint16_t conn_handle, uint8_t hci_reason);
+int ble_hs_id_infer_auto(int privacy, uint8_t *out_addr_type);
+
+/* ---------- NPL 定时器（callout），回调在 host 任务（ble_mock_pump）中执行 ---------- */
+
+struct ble_npl_event;
+typedef void ble_npl_event_fn(struct ble_npl_event *ev);
+
+struct ble_npl_event {
+    ble_npl_event_fn *fn;
+    void *arg;
+};
+
+struct ble_npl_eventq {
+    int unused;
+};
+
+struct ble_npl_callout {
+    struct ble_npl_event ev;
+    bool armed;
+    struct ble_npl_callout *next;  /* 已初始化 callout 链表 */
+};
+
+typedef uint32_t ble_npl_time_t;
+
+void ble_npl_callout_init(struct ble_npl_callout *co, struct ble_npl_eventq *evq,
+                          ble_npl_event_fn *ev_cb, void *ev_arg);
+int ble_npl_callout_reset(struct ble_npl_callout *co, ble_npl_time_t ticks);
+void ble_npl_callout_stop(struct ble_npl_callout *co);
+bool ble_npl_callout_is_active(struct ble_npl_callout *co);
+ble_npl_time_t ble_npl_time_ms_to_ticks32(uint32_t ms);
+
+static inline void *ble_npl_event_get_arg(struct ble_npl_event *ev)
+{
+    return ev->arg;
+}
+
+/* ---------- host 配置 ---------- */
+
+struct ble_hs_cfg {
+    void (*reset_cb)(int reason);
+    void (*sync_cb)(void);
+};
+extern struct ble_hs_cfg ble_hs_cfg;
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* HOST_BLE_HS_H */
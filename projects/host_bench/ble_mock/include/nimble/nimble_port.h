@@ -0,0 +1,12 @@
+/* 主机构建替身：见 host/ble_hs.h */
+#pragma once
+#include "esp_err.h"
+#ifdef __cplusplus
+extern "C" {
+#endif
+esp_err_t nimble_port_init(void);
+void nimble_port_run(void);
+struct ble_npl_eventq *nimble_port_get_dflt_eventq(void);
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,10 @@
+/* 主机构建替身：host 任务不启动，由 ble_mock.c 在调用线程中驱动事件 */
+#pragma once
+#ifdef __cplusplus
+extern "C" {
+#endif
+void nimble_port_freertos_init(void (*host_task_fn)(void *));
+void nimble_port_freertos_deinit(void);
+#ifdef __cplusplus
+}
+#endif
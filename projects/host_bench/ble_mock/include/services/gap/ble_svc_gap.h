@@ -0,0 +1,11 @@
+/* 主机构建替身：见 host/ble_hs.h */
+#pragma once
+#ifdef __cplusplus
+extern "C" {
+#endif
+void ble_svc_gap_init(void);
+int ble_svc_gap_device_name_set(const char *name);
+const char *ble_svc_gap_device_name(void);
+#ifdef __cplusplus
+}
+#endif
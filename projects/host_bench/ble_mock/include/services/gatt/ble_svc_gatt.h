@@ -0,0 +1,9 @@
+/* 主机构建替身：见 host/ble_hs.h */
+#pragma once
+#ifdef __cplusplus
+extern "C" {
+#endif
+void ble_svc_gatt_init(void);
+#ifdef __cplusplus
+}
+#endif
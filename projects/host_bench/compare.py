@@ -0,0 +1,59 @@
+#!/usr/bin/env python3
+"""
+对比两次基准 JSON 结果（bench_* --json 输出）
+用法: python compare.py <baseline.json> <current.json> [--threshold 10]
+ns/op 或 allocs/op 劣化超过阈值（百分比）时以非零退出码结束，便于 CI 使用。
+"""
+
+import argparse
+import json
+import sys
+
+
+def load(path: str) -> dict[str, dict]:
+    with open(path, 'r', encoding='utf-8') as f:
+        data = json.load(f)
+    return {r['name']: r for r in data.get('results', [])}
+
+
+def pct(old: float, new: float) -> float:
+    if old == 0:
+        return 0.0 if new == 0 else float('inf')
+    return (new - old) / old * 100.0
+
+
+def main() -> int:
+    parser = argparse.ArgumentParser(description='Compare esp-rpc host benchmark results')
+    parser.add_argument('baseline')
+    parser.add_argument('current')
+    parser.add_argument('--threshold', type=float, default=10.0,
+                        help='Regression threshold in percent (default: 10)')
+    args = parser.parse_args()
+
+    base = load(args.baseline)
+    cur = load(args.current)
+    regressed = False
+    print(f'{"benchmark":<48} {"ns/op":>22} {"bytes/op":>16} {"allocs/op":>16}')
+    for name in sorted(set(base) | set(cur)):
+        b, c = base.get(name), cur.get(name)
+        if b is None or c is None:
+            print(f'{name:<48} {"(only in " + ("current" if b is None else "baseline") + ")":>22}')
+            continue
+        if b.get('error') or c.get('error'):
+            print(f'{name:<48} {"error: " + (c.get("error") or "ok (baseline failed)"):>22}')
+            regressed = regressed or bool(c.get('error'))
+            continue
+        d_ns = pct(b['ns_per_op'], c['ns_per_op'])
+        d_bytes = pct(b['bytes_per_op'], c['bytes_per_op'])
+        d_alloc = c['allocs_per_op'] - b['allocs_per_op']
+        mark = ''
+        if d_ns > args.threshold or d_alloc > 0:
+            mark = '  <-- regression'
+            regressed = True
+        print(f'{name:<48} {c["ns_per_op"]:>10.1f} ({d_ns:+6.1f}%) {c["bytes_per_op"]:>7.0f} ({d_bytes:+5.1f}%)'
+              f' {c["allocs_per_op"]:>7.2f} ({d_alloc:+.2f}){mark}')
+    return 1 if regressed else 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
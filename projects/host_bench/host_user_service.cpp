@@ -0,0 +1,171 @@
+/**
+ * @file host_user_service.cpp
+ * @brief UserService 的主机端实现：内存存储，容量放大到可测数百个用户
+ */
+
+#include "host_user_service.hpp"
+#include "user_service.rpc.gen.hpp"
+#include "esprpc.h"
+#include "esprpc_binary.h"
+#include <cstdio>
+#include <cstring>
+
+#define MAX_USERS  1024
+#define MAX_NAME   32
+#define MAX_EMAIL  64
+
+static struct {
+    int id;
+    char name[MAX_NAME];
+    char email[MAX_EMAIL];
+    UserStatus status;
+} s_users[MAX_USERS];
+static size_t s_user_count = 0;
+static int s_next_id = 1;
+
+static void copy_str(char *dst, size_t dst_size, const char *src)
+{
+    if (!src) {
+        dst[0] = '\0';
+        return;
+    }
+    snprintf(dst, dst_size, "%s", src);
+}
+
+void host_user_service_seed(size_t n)
+{
+    if (n > MAX_USERS) n = MAX_USERS;
+    s_user_count = 0;
+    s_next_id = 1;
+    for (size_t i = 0; i < n; i++) {
+        s_users[i].id = s_next_id++;
+        snprintf(s_users[i].name, MAX_NAME, "user_%zu", i);
+        snprintf(s_users[i].email, MAX_EMAIL, "user_%zu@example.com", i);
+        s_users[i].status = ACTIVE;
+    }
+    s_user_count = n;
+}
+
+size_t host_user_service_count(void)
+{
+    return s_user_count;
+}
+
+static User user_at(size_t i)
+{
+    return (User){
+        s_users[i].id,
+        s_users[i].name,
+        { true, s_users[i].email },
+        s_users[i].status,
+        { nullptr, 0 },
+    };
+}
+
+static UserResponse response_at(size_t i)
+{
+    return (UserResponse){
+        s_users[i].id,
+        s_users[i].name,
+        s_users[i].email,
+        s_users[i].status,
+    };
+}
+
+UserResponse get_user_impl(int id)
+{
+    for (size_t i = 0; i < s_user_count; i++) {
+        if (s_users[i].id == id) return response_at(i);
+    }
+    return (UserResponse){};
+}
+
+UserResponse create_user_impl(CreateUserRequest request)
+{
+    if (s_user_count >= MAX_USERS) {
+        /* 满了就覆盖最后一个，保证长时间压测下行为稳定 */
+        s_user_count = MAX_USERS - 1;
+    }
+    size_t i = s_user_count++;
+    s_users[i].id = s_next_id++;
+    copy_str(s_users[i].name, MAX_NAME, request.name);
+    copy_str(s_users[i].email, MAX_EMAIL, request.email);
+    s_users[i].status = ACTIVE;
+    return response_at(i);
+}
+
+VOID create_user_v2_impl(CreateUserRequest request)
+{
+    create_user_impl(request);
+}
+
+UserResponse update_user_impl(int id, CreateUserRequest request)
+{
+    for (size_t i = 0; i < s_user_count; i++) {
+        if (s_users[i].id == id) {
+            copy_str(s_users[i].name, MAX_NAME, request.name);
+            copy_str(s_users[i].email, MAX_EMAIL, request.email);
+            return response_at(i);
+        }
+    }
+    return (UserResponse){};
+}
+
+bool delete_user_impl(int id)
+{
+    for (size_t i = 0; i < s_user_count; i++) {
+        if (s_users[i].id == id) {
+            memmove(&s_users[i], &s_users[i + 1], (s_user_count - 1 - i) * sizeof(s_users[0]));
+            s_user_count--;
+            return true;
+        }
+    }
+    return false;
+}
+
+/* 与 esp_test 一致：分页游标逐个产出用户 */
+static size_t s_list_pos;
+
+static bool list_users_next(void *ctx, User *out)
+{
+    size_t *pos = (size_t *)ctx;
+    if (*pos >= s_user_count) return false;
+    *out = user_at((*pos)++);
+    return true;
+}
+
+rpc_cursor<User> list_users_impl(int_optional page)
+{
+    (void)page;
+    s_list_pos = 0;
+    return (rpc_cursor<User>){ list_users_next, &s_list_pos };
+}
+
+/* 与 esp_test 一致：逐个用户经生成的 bin_write_User_delta 编码为增量帧后 stream_emit */
+static uint8_t s_watch_prev[256];
+static esprpc_delta_t s_watch_delta;
+
+rpc_stream<User> watch_users_impl(void)
+{
+    uint16_t method_id = esprpc_get_stream_method_id();
+    if (method_id == ESPRPC_STREAM_METHOD_ID_NONE) {
+        return (rpc_stream<User>){ nullptr };
+    }
+    if (!s_watch_delta.prev) {
+        esprpc_delta_init(&s_watch_delta, s_watch_prev, sizeof(s_watch_prev), USER_SERVICE_WATCH_USERS_KEYFRAME_INTERVAL);
+    }
+    esprpc_delta_reset(&s_watch_delta);
+    uint8_t buf[256];
+    for (size_t i = 0; i < s_user_count; i++) {
+        User u = user_at(i);
+        int n = bin_write_User_delta(&s_watch_delta, &u, buf, sizeof(buf));
+        if (n > 0) {
+            esprpc_stream_emit(method_id, buf, (size_t)n);
+        }
+    }
+    return (rpc_stream<User>){ nullptr };
+}
+
+VOID ping_impl(void)
+{
+}
@@ -0,0 +1,17 @@
+/**
+ * @file host_user_service.hpp
+ * @brief UserService 的主机端实现（与 esp_test 的 impl_user.cpp 行为一致，去掉日志）
+ */
+
+#ifndef HOST_USER_SERVICE_HPP
+#define HOST_USER_SERVICE_HPP
+
+#include <cstddef>
+
+/** 预置 n 个用户（覆盖已有数据），供 ListUsers/GetUser 使用 */
+void host_user_service_seed(size_t n);
+
+/** 当前存储的用户数 */
+size_t host_user_service_count(void);
+
+#endif /* HOST_USER_SERVICE_HPP */
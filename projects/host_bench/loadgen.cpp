@@ -0,0 +1,502 @@
+/**
+ * @file loadgen.cpp
+ * @brief 端到端负载生成器：经进程内 loopback 传输驱动 esprpc_handle_request_from
+ *
+ * 模型与设备端一致：单个“接收任务”线程串行调用 esprpc_handle_request_from，
+ * 客户端按加权方法组合构造请求帧并投递到其输入队列。
+ *
+ * 两种负载模式：
+ * - 固定并发（--concurrency N）：N 个闭环客户端，各自发送 -> 等待完成 -> 再发送
+ * - 固定到达率（--rate R）：开环调度，第 i 个请求的计划发送时刻为 t0 + i/R
+ *
+ * 延迟统计带 coordinated omission 校正：
+ * - 固定到达率：延迟从“计划发送时刻”起算，调度落后不会掩盖排队时间
+ * - 固定并发：按 HdrHistogram recordValueWithExpectedInterval 的方式补齐缺失样本，
+ *   期望间隔取 --expected-interval-us，未指定时取实测平均服务时间
+ *
+ * 用法:
+ *   loadgen [--concurrency 4 | --rate 20000] [--duration-s 5] [--users 8]
+ *           [--mix GetUser=40,CreateUser=10,CreateUserV2=10,UpdateUser=5,DeleteUser=5,ListUsers=20,WatchUsers=5,Ping=5]
+ *           [--expected-interval-us N] [--json out.json]
+ */
+
+#include "bench_common.hpp"
+#include "host_user_service.hpp"
+#include "esprpc.h"
+#include "esprpc_binary.h"
+#include "esprpc_service.h"
+#include "esprpc_transport.h"
+#include "user_service.rpc.gen.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+/* ---------- 方法表（方法索引与 user_service.rpc.hpp 声明顺序一致） ---------- */
+
+enum class CallKind { Call, Void, Stream };
+
+struct MethodSpec {
+    const char *name;
+    uint8_t method_id;
+    CallKind kind;
+    void (*build)(std::vector<uint8_t> &payload, std::mt19937 &rng);
+};
+
+static void put_i32(std::vector<uint8_t> &b, int v)
+{
+    uint8_t tmp[4];
+    uint8_t *wp = tmp;
+    esprpc_bin_write_i32(&wp, tmp + 4, v);
+    b.insert(b.end(), tmp, tmp + 4);
+}
+
+static void put_str(std::vector<uint8_t> &b, const char *s)
+{
+    size_t len = strlen(s);
+    b.push_back((uint8_t)(len & 0xff));
+    b.push_back((uint8_t)((len >> 8) & 0xff));
+    b.insert(b.end(), s, s + len);
+}
+
+static void build_create_request(std::vector<uint8_t> &b, std::mt19937 &rng)
+{
+    char name[32];
+    snprintf(name, sizeof(name), "load_%u", (unsigned)(rng() % 100000));
+    put_str(b, name);
+    put_str(b, "load@example.com");
+    b.push_back(0); /* password 缺省 */
+}
+
+static int random_user_id(std::mt19937 &rng)
+{
+    size_t n = host_user_service_count();
+    return n ? (int)(rng() % n) + 1 : 1;
+}
+
+static const MethodSpec kMethods[] = {
+    /* GetUser/ListUsers 为 "fieldmask" 方法：请求以字段掩码开头，0xFF 取全部字段 */
+    { "GetUser", 0, CallKind::Call, [](std::vector<uint8_t> &b, std::mt19937 &rng) {
+          b.push_back(0xFF);
+          put_i32(b, random_user_id(rng));
+      } },
+    { "CreateUser", 1, CallKind::Call, build_create_request },
+    { "CreateUserV2", 2, CallKind::Void, build_create_request },
+    { "UpdateUser", 3, CallKind::Call, [](std::vector<uint8_t> &b, std::mt19937 &rng) {
+          put_i32(b, random_user_id(rng));
+          build_create_request(b, rng);
+      } },
+    { "DeleteUser", 4, CallKind::Call, [](std::vector<uint8_t> &b, std::mt19937 &rng) { put_i32(b, random_user_id(rng)); } },
+    { "ListUsers", 5, CallKind::Call, [](std::vector<uint8_t> &b, std::mt19937 &) {
+          b.push_back(0xFF);
+          b.push_back(0); /* page 缺省 */
+      } },
+    { "WatchUsers", 6, CallKind::Stream, [](std::vector<uint8_t> &, std::mt19937 &) {} },
+    { "Ping", 7, CallKind::Void, [](std::vector<uint8_t> &, std::mt19937 &) {} },
+};
+static constexpr size_t kMethodCount = sizeof(kMethods) / sizeof(kMethods[0]);
+
+/* ---------- 进行中的请求 ---------- */
+
+struct Op {
+    const MethodSpec *method = nullptr;
+    uint16_t invoke_id = 0;
+    std::vector<uint8_t> frame;
+    Clock::time_point intended;
+    bool got_response = false;
+    bool done = false;
+    std::mutex mu;
+    std::condition_variable cv;
+};
+
+/* ---------- 进程内传输：服务端 send 直接回到负载生成器 ---------- */
+
+struct LoopbackCtx {
+    Op *current = nullptr;        /* 仅服务线程访问 */
+    uint64_t stream_frames = 0;
+    uint64_t response_frames = 0;
+    uint64_t response_bytes = 0;
+};
+
+static LoopbackCtx s_loop;
+
+static esp_err_t loop_send(void *ctx, const uint8_t *data, size_t len)
+{
+    LoopbackCtx *lc = (LoopbackCtx *)ctx;
+    if (len < 5) return ESP_ERR_INVALID_SIZE;
+    uint16_t invoke_id = (uint16_t)data[1] | ((uint16_t)data[2] << 8);
+    lc->response_bytes += len;
+    if (invoke_id == 0) {
+        lc->stream_frames++;
+    } else {
+        lc->response_frames++;
+        if (lc->current && lc->current->invoke_id == invoke_id) lc->current->got_response = true;
+    }
+    return ESP_OK;
+}
+
+/* 核心按 [帧头][payload] 分段发送，与真实传输一样走 sendv，不经过拼接 */
+static esp_err_t loop_sendv(void *ctx, const esprpc_iovec_t *iov, size_t iovcnt)
+{
+    uint8_t hdr[5];
+    size_t have = 0;
+    size_t total = 0;
+    for (size_t i = 0; i < iovcnt; i++) {
+        const uint8_t *b = (const uint8_t *)iov[i].base;
+        for (size_t k = 0; k < iov[i].len && have < sizeof(hdr); k++) hdr[have++] = b[k];
+        total += iov[i].len;
+    }
+    if (have < sizeof(hdr)) return ESP_ERR_INVALID_SIZE;
+    esp_err_t err = loop_send(ctx, hdr, sizeof(hdr));
+    ((LoopbackCtx *)ctx)->response_bytes += total - sizeof(hdr);
+    return err;
+}
+
+static esp_err_t loop_start(void *ctx, esprpc_transport_on_recv_fn on_recv, void *user_ctx)
+{
+    (void)ctx;
+    (void)on_recv;
+    (void)user_ctx;
+    return ESP_OK;
+}
+
+static void loop_stop(void *ctx)
+{
+    (void)ctx;
+}
+
+static esprpc_transport_t s_loop_transport = {
+    .send = loop_send,
+    .sendv = loop_sendv,
+    .start = loop_start,
+    .stop = loop_stop,
+    .ctx = &s_loop,
+    .reply_route = nullptr,
+    .sendv_to = nullptr,
+};
+
+/* ---------- 服务线程（相当于设备上的接收任务） ---------- */
+
+struct MethodStats {
+    std::vector<uint64_t> latency_ns;
+    uint64_t errors = 0;
+};
+
+class Server {
+public:
+    void submit(std::shared_ptr<Op> op)
+    {
+        {
+            std::lock_guard<std::mutex> lk(mu_);
+            queue_.push_back(std::move(op));
+        }
+        cv_.notify_one();
+    }
+
+    void stop()
+    {
+        {
+            std::lock_guard<std::mutex> lk(mu_);
+            stopping_ = true;
+        }
+        cv_.notify_one();
+    }
+
+    size_t depth()
+    {
+        std::lock_guard<std::mutex> lk(mu_);
+        return queue_.size();
+    }
+
+    /** 服务线程主循环；统计只在本线程写，无需加锁 */
+    void run()
+    {
+        for (;;) {
+            std::shared_ptr<Op> op;
+            {
+                std::unique_lock<std::mutex> lk(mu_);
+                cv_.wait(lk, [&] { return stopping_ || !queue_.empty(); });
+                if (queue_.empty()) return;
+                op = std::move(queue_.front());
+                queue_.pop_front();
+            }
+            s_loop.current = op.get();
+            esprpc_handle_request_from(&s_loop_transport, op->frame.data(), op->frame.size());
+            s_loop.current = nullptr;
+            Clock::time_point now = Clock::now();
+
+            MethodStats &st = stats[op->method - kMethods];
+            if (op->method->kind == CallKind::Call && !op->got_response) {
+                st.errors++;
+            } else {
+                st.latency_ns.push_back((uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(now - op->intended).count());
+            }
+            {
+                std::lock_guard<std::mutex> lk(op->mu);
+                op->done = true;
+            }
+            op->cv.notify_one();
+        }
+    }
+
+    MethodStats stats[kMethodCount];
+
+private:
+    std::mutex mu_;
+    std::condition_variable cv_;
+    std::deque<std::shared_ptr<Op>> queue_;
+    bool stopping_ = false;
+};
+
+/* ---------- 加权方法组合 ---------- */
+
+struct Mix {
+    std::vector<const MethodSpec *> methods;
+    std::discrete_distribution<size_t> dist;
+
+    const MethodSpec *pick(std::mt19937 &rng) { return methods[dist(rng)]; }
+};
+
+static bool parse_mix(const char *spec, Mix *out)
+{
+    std::vector<double> weights;
+    std::string s(spec);
+    size_t pos = 0;
+    while (pos < s.size()) {
+        size_t comma = s.find(',', pos);
+        std::string item = s.substr(pos, comma == std::string::npos ? std::string::npos : comma - pos);
+        pos = comma == std::string::npos ? s.size() : comma + 1;
+        size_t eq = item.find('=');
+        std::string name = item.substr(0, eq);
+        double w = eq == std::string::npos ? 1.0 : atof(item.c_str() + eq + 1);
+        const MethodSpec *m = nullptr;
+        for (const MethodSpec &cand : kMethods) {
+            if (name == cand.name) m = &cand;
+        }
+        if (!m) {
+            fprintf(stderr, "unknown method in --mix: %s\n", name.c_str());
+            return false;
+        }
+        if (w > 0) {
+            out->methods.push_back(m);
+            weights.push_back(w);
+        }
+    }
+    if (out->methods.empty()) return false;
+    out->dist = std::discrete_distribution<size_t>(weights.begin(), weights.end());
+    return true;
+}
+
+/* ---------- 延迟统计 ---------- */
+
+/** HdrHistogram 式校正：value 超过期望间隔时，补记 value - k*interval 的样本 */
+static std::vector<uint64_t> corrected_samples(const std::vector<uint64_t> &raw, uint64_t interval_ns)
+{
+    std::vector<uint64_t> out(raw);
+    if (interval_ns == 0) return out;
+    for (uint64_t v : raw) {
+        for (uint64_t missing = v > interval_ns ? v - interval_ns : 0; missing >= interval_ns; missing -= interval_ns) {
+            out.push_back(missing);
+        }
+    }
+    return out;
+}
+
+static uint64_t percentile(std::vector<uint64_t> &sorted, double p)
+{
+    if (sorted.empty()) return 0;
+    size_t idx = (size_t)(p / 100.0 * (double)(sorted.size() - 1) + 0.5);
+    return sorted[std::min(idx, sorted.size() - 1)];
+}
+
+static void report_latency(bench::Runner &runner, const std::string &prefix, std::vector<uint64_t> samples)
+{
+    std::sort(samples.begin(), samples.end());
+    static const struct { const char *name; double p; } kPct[] = {
+        { "p50", 50 }, { "p90", 90 }, { "p99", 99 }, { "p999", 99.9 }, { "max", 100 },
+    };
+    for (const auto &k : kPct) {
+        bench::Result r;
+        r.name = prefix + "/" + k.name;
+        r.ns_per_op = (double)percentile(samples, k.p);
+        r.iterations = samples.size();
+        runner.add(r);
+    }
+}
+
+static void print_usage(const char *prog)
+{
+    fprintf(stderr,
+            "usage: %s [--concurrency N | --rate R] [--duration-s S] [--users N]\n"
+            "          [--mix GetUser=40,CreateUser=10,...] [--expected-interval-us N] [--json out.json]\n",
+            prog);
+}
+
+int main(int argc, char **argv)
+{
+    std::vector<const char *> rest;
+    bench::Options opts = bench::parse_options(argc, argv, &rest);
+    int concurrency = 0;
+    double rate = 0;
+    double duration_s = 5;
+    size_t users = 8;
+    double expected_interval_us = 0;
+    const char *mix_spec = "GetUser=40,CreateUser=10,CreateUserV2=10,UpdateUser=5,DeleteUser=5,ListUsers=20,WatchUsers=5,Ping=5";
+    for (size_t i = 0; i < rest.size(); i++) {
+        const char *a = rest[i];
+        const char *v = i + 1 < rest.size() ? rest[i + 1] : nullptr;
+        if (strcmp(a, "--help") == 0 || strcmp(a, "-h") == 0) {
+            print_usage(argv[0]);
+            return 0;
+        }
+        if (!v) {
+            fprintf(stderr, "missing value for %s\n", a);
+            print_usage(argv[0]);
+            return 2;
+        }
+        if (strcmp(a, "--concurrency") == 0) concurrency = atoi(v);
+        else if (strcmp(a, "--rate") == 0) rate = atof(v);
+        else if (strcmp(a, "--duration-s") == 0) duration_s = atof(v);
+        else if (strcmp(a, "--users") == 0) users = (size_t)atol(v);
+        else if (strcmp(a, "--mix") == 0) mix_spec = v;
+        else if (strcmp(a, "--expected-interval-us") == 0) expected_interval_us = atof(v);
+        else {
+            fprintf(stderr, "unknown option %s\n", a);
+            print_usage(argv[0]);
+            return 2;
+        }
+        i++;
+    }
+    if (concurrency <= 0 && rate <= 0) concurrency = 1;
+
+    Mix mix;
+    if (!parse_mix(mix_spec, &mix)) return 2;
+
+    esprpc_init();
+    esprpc_transport_add(&s_loop_transport);
+    esprpc_register_service_ex("UserService", &user_service_impl_instance, UserService_dispatch);
+    host_user_service_seed(users);
+
+    Server server;
+    std::thread server_thread([&] { server.run(); });
+    std::atomic<uint16_t> next_invoke{1};
+    auto make_op = [&](const MethodSpec *m, std::mt19937 &rng) {
+        auto op = std::make_shared<Op>();
+        op->method = m;
+        op->invoke_id = 0;
+        if (m->kind == CallKind::Call) {
+            uint16_t id = next_invoke.fetch_add(1);
+            if (id == 0) id = next_invoke.fetch_add(1);
+            op->invoke_id = id;
+        }
+        std::vector<uint8_t> payload;
+        m->build(payload, rng);
+        op->frame.resize(5 + payload.size());
+        op->frame[0] = m->method_id;
+        op->frame[1] = (uint8_t)(op->invoke_id & 0xff);
+        op->frame[2] = (uint8_t)(op->invoke_id >> 8);
+        op->frame[3] = (uint8_t)(payload.size() & 0xff);
+        op->frame[4] = (uint8_t)(payload.size() >> 8);
+        std::copy(payload.begin(), payload.end(), op->frame.begin() + 5);
+        return op;
+    };
+
+    Clock::time_point t0 = Clock::now();
+    Clock::time_point deadline = t0 + std::chrono::microseconds((int64_t)(duration_s * 1e6));
+    uint64_t issued = 0;
+    if (rate > 0) {
+        /* 开环：按计划时刻投递，不等待完成 */
+        std::mt19937 rng(12345);
+        double period_ns = 1e9 / rate;
+        for (;; issued++) {
+            Clock::time_point intended = t0 + std::chrono::nanoseconds((int64_t)(period_ns * (double)issued));
+            if (intended >= deadline) break;
+            std::this_thread::sleep_until(intended);
+            auto op = make_op(mix.pick(rng), rng);
+            op->intended = intended;
+            server.submit(std::move(op));
+        }
+    } else {
+        /* 闭环：每个客户端保持 1 个在途请求 */
+        std::vector<std::thread> clients;
+        std::atomic<uint64_t> count{0};
+        for (int c = 0; c < concurrency; c++) {
+            clients.emplace_back([&, c] {
+                std::mt19937 rng(1000 + c);
+                while (Clock::now() < deadline) {
+                    auto op = make_op(mix.pick(rng), rng);
+                    op->intended = Clock::now();
+                    Op *raw = op.get();
+                    server.submit(op);
+                    std::unique_lock<std::mutex> lk(raw->mu);
+                    raw->cv.wait(lk, [&] { return raw->done; });
+                    count.fetch_add(1, std::memory_order_relaxed);
+                }
+            });
+        }
+        for (auto &t : clients) t.join();
+        issued = count.load();
+    }
+    server.stop();
+    server_thread.join();
+    double elapsed_s = std::chrono::duration<double>(Clock::now() - t0).count();
+
+    /* ---------- 汇总 ---------- */
+    bench::Runner runner("loadgen", opts);
+    std::vector<uint64_t> all;
+    uint64_t errors = 0;
+    for (size_t i = 0; i < kMethodCount; i++) {
+        const MethodStats &st = server.stats[i];
+        all.insert(all.end(), st.latency_ns.begin(), st.latency_ns.end());
+        errors += st.errors;
+        if (!st.latency_ns.empty() || st.errors) {
+            fprintf(stderr, "%-14s ok=%-10zu errors=%llu\n", kMethods[i].name, st.latency_ns.size(),
+                    (unsigned long long)st.errors);
+        }
+    }
+    double throughput = (double)all.size() / elapsed_s;
+    fprintf(stderr, "mode=%s issued=%llu completed=%zu errors=%llu elapsed=%.2fs throughput=%.0f ops/s "
+                    "responses=%llu stream_frames=%llu\n",
+            rate > 0 ? "fixed-rate" : "fixed-concurrency", (unsigned long long)issued, all.size(),
+            (unsigned long long)errors, elapsed_s, throughput, (unsigned long long)s_loop.response_frames,
+            (unsigned long long)s_loop.stream_frames);
+
+    bench::Result tp;
+    tp.name = "loadgen/throughput";
+    tp.ns_per_op = throughput > 0 ? 1e9 / throughput : 0;
+    tp.bytes_per_op = all.empty() ? 0 : (double)s_loop.response_bytes / (double)all.size();
+    tp.iterations = all.size();
+    runner.add(tp);
+
+    if (rate > 0) {
+        /* 开环延迟已从计划时刻起算，本身即为校正值 */
+        report_latency(runner, "loadgen/latency", all);
+    } else {
+        uint64_t interval_ns = (uint64_t)(expected_interval_us * 1000.0);
+        if (interval_ns == 0 && !all.empty()) {
+            uint64_t sum = 0;
+            for (uint64_t v : all) sum += v;
+            interval_ns = sum / all.size();
+        }
+        report_latency(runner, "loadgen/latency_raw", all);
+        report_latency(runner, "loadgen/latency", corrected_samples(all, interval_ns));
+    }
+    for (size_t i = 0; i < kMethodCount; i++) {
+        if (!server.stats[i].latency_ns.empty()) {
+            report_latency(runner, std::string("loadgen/") + kMethods[i].name, server.stats[i].latency_ns);
+        }
+    }
+
+    int rc = runner.finish();
+    esprpc_deinit();
+    return errors ? 1 : rc;
+}
@@ -0,0 +1,26 @@
+/**
+ * @file esp_log.h
+ * @brief 主机构建用 esp_log.h 替身：默认只输出 W/E，避免日志干扰基准结果
+ *
+ * 编译时可用 -DHOST_LOG_LEVEL=3 打开 I 级日志。
+ */
+
+#ifndef HOST_ESP_LOG_H
+#define HOST_ESP_LOG_H
+
+#include <stdio.h>
+
+#ifndef HOST_LOG_LEVEL
+#define HOST_LOG_LEVEL 2 /* 1=E 2=W 3=I 4=D 5=V */
+#endif
+
+#define HOST_LOG(lvl, ch, tag, fmt, ...) \
+    do { if ((lvl) <= HOST_LOG_LEVEL) fprintf(stderr, ch " (%s) " fmt "\n", tag, ##__VA_ARGS__); } while (0)
+
+#define ESP_LOGE(tag, fmt, ...) HOST_LOG(1, "E", tag, fmt, ##__VA_ARGS__)
+#define ESP_LOGW(tag, fmt, ...) HOST_LOG(2, "W", tag, fmt, ##__VA_ARGS__)
+#define ESP_LOGI(tag, fmt, ...) HOST_LOG(3, "I", tag, fmt, ##__VA_ARGS__)
+#define ESP_LOGD(tag, fmt, ...) HOST_LOG(4, "D", tag, fmt, ##__VA_ARGS__)
+#define ESP_LOGV(tag, fmt, ...) HOST_LOG(5, "V", tag, fmt, ##__VA_ARGS__)
+
+#endif /* HOST_ESP_LOG_H */
@@ -0,0 +1,21 @@
+/**
+ * @file esp_random.h
+ * @brief 主机构建用随机数替身：以时间与进程号作种子的伪随机数
+ */
+
+#ifndef HOST_ESP_RANDOM_H
+#define HOST_ESP_RANDOM_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+static inline uint32_t esp_random(void)
+{
+    static __thread unsigned int seed;
+    if (seed == 0) seed = (unsigned int)time(NULL) ^ ((unsigned int)getpid() << 16) ^ (unsigned int)clock();
+    return ((uint32_t)rand_r(&seed) << 16) ^ (uint32_t)rand_r(&seed);
+}
+
+#endif /* HOST_ESP_RANDOM_H */
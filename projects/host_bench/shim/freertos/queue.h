@@ -0,0 +1,113 @@
+/**
+ * @file queue.h
+ * @brief 主机构建用队列替身：定长环形缓冲 + pthread 条件变量，支持不等待、限时与永久等待
+ */
+
+#ifndef HOST_FREERTOS_QUEUE_H
+#define HOST_FREERTOS_QUEUE_H
+
+#include "freertos/FreeRTOS.h"
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+typedef struct host_queue {
+    pthread_mutex_t mutex;
+    pthread_cond_t not_empty;
+    pthread_cond_t not_full;
+    UBaseType_t len;
+    UBaseType_t item_size;
+    UBaseType_t head;
+    UBaseType_t count;
+    unsigned char items[];
+} *QueueHandle_t;
+
+/** 等待条件变量：ticks 为 portMAX_DELAY 时永久等待，否则等到 deadline（CLOCK_REALTIME）为止；超时返回 0 */
+static inline int host_queue_wait(pthread_cond_t *cond, pthread_mutex_t *m, TickType_t ticks, const struct timespec *deadline)
+{
+    if (ticks == portMAX_DELAY) return pthread_cond_wait(cond, m) == 0;
+    return pthread_cond_timedwait(cond, m, deadline) == 0;
+}
+
+static inline void host_queue_deadline(TickType_t ticks, struct timespec *ts)
+{
+    clock_gettime(CLOCK_REALTIME, ts);
+    ts->tv_sec += (time_t)(ticks / 1000);
+    ts->tv_nsec += (long)(ticks % 1000) * 1000000L;
+    if (ts->tv_nsec >= 1000000000L) {
+        ts->tv_sec++;
+        ts->tv_nsec -= 1000000000L;
+    }
+}
+
+static inline QueueHandle_t xQueueCreate(UBaseType_t len, UBaseType_t item_size)
+{
+    QueueHandle_t q = (QueueHandle_t)malloc(sizeof(struct host_queue) + (size_t)len * item_size);
+    if (!q) return NULL;
+    pthread_mutex_init(&q->mutex, NULL);
+    pthread_cond_init(&q->not_empty, NULL);
+    pthread_cond_init(&q->not_full, NULL);
+    q->len = len;
+    q->item_size = item_size;
+    q->head = 0;
+    q->count = 0;
+    return q;
+}
+
+static inline BaseType_t xQueueSend(QueueHandle_t q, const void *item, TickType_t ticks)
+{
+    struct timespec deadline;
+    if (ticks != 0 && ticks != portMAX_DELAY) host_queue_deadline(ticks, &deadline);
+    pthread_mutex_lock(&q->mutex);
+    while (q->count == q->len) {
+        if (ticks == 0 || !host_queue_wait(&q->not_full, &q->mutex, ticks, &deadline)) {
+            if (q->count < q->len) break;  /* 超时与唤醒同时发生 */
+            pthread_mutex_unlock(&q->mutex);
+            return pdFAIL;
+        }
+    }
+    memcpy(q->items + (size_t)((q->head + q->count) % q->len) * q->item_size, item, q->item_size);
+    q->count++;
+    pthread_cond_signal(&q->not_empty);
+    pthread_mutex_unlock(&q->mutex);
+    return pdPASS;
+}
+
+static inline BaseType_t xQueueReceive(QueueHandle_t q, void *item, TickType_t ticks)
+{
+    struct timespec deadline;
+    if (ticks != 0 && ticks != portMAX_DELAY) host_queue_deadline(ticks, &deadline);
+    pthread_mutex_lock(&q->mutex);
+    while (q->count == 0) {
+        if (ticks == 0 || !host_queue_wait(&q->not_empty, &q->mutex, ticks, &deadline)) {
+            if (q->count > 0) break;  /* 超时与唤醒同时发生 */
+            pthread_mutex_unlock(&q->mutex);
+            return pdFAIL;
+        }
+    }
+    memcpy(item, q->items + (size_t)q->head * q->item_size, q->item_size);
+    q->head = (q->head + 1) % q->len;
+    q->count--;
+    pthread_cond_signal(&q->not_full);
+    pthread_mutex_unlock(&q->mutex);
+    return pdPASS;
+}
+
+static inline UBaseType_t uxQueueMessagesWaiting(QueueHandle_t q)
+{
+    pthread_mutex_lock(&q->mutex);
+    UBaseType_t n = q->count;
+    pthread_mutex_unlock(&q->mutex);
+    return n;
+}
+
+static inline void vQueueDelete(QueueHandle_t q)
+{
+    pthread_mutex_destroy(&q->mutex);
+    pthread_cond_destroy(&q->not_empty);
+    pthread_cond_destroy(&q->not_full);
+    free(q);
+}
+
+#endif /* HOST_FREERTOS_QUEUE_H */
@@ -0,0 +1,82 @@
+/**
+ * @file task.h
+ * @brief 主机构建用任务替身：任务映射为分离的 pthread，忽略优先级、栈大小与绑核
+ */
+
+#ifndef HOST_FREERTOS_TASK_H
+#define HOST_FREERTOS_TASK_H
+
+#include "freertos/FreeRTOS.h"
+#include <pthread.h>
+#include <stdlib.h>
+#include <time.h>
+
+typedef pthread_t *TaskHandle_t;
+typedef void (*TaskFunction_t)(void *);
+
+#define tskNO_AFFINITY 0x7FFFFFFF
+
+typedef struct {
+    TaskFunction_t fn;
+    void *arg;
+} host_task_start_t;
+
+static inline void *host_task_entry(void *p)
+{
+    host_task_start_t s = *(host_task_start_t *)p;
+    free(p);
+    s.fn(s.arg);
+    return NULL;
+}
+
+static inline BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char *name, uint32_t stack_size,
+                                                 void *arg, UBaseType_t priority, TaskHandle_t *out,
+                                                 BaseType_t core_id)
+{
+    (void)name;
+    (void)stack_size;
+    (void)priority;
+    (void)core_id;
+    host_task_start_t *s = (host_task_start_t *)malloc(sizeof(*s));
+    if (!s) return pdFAIL;
+    s->fn = fn;
+    s->arg = arg;
+    pthread_t t;
+    if (pthread_create(&t, NULL, host_task_entry, s) != 0) {
+        free(s);
+        return pdFAIL;
+    }
+    pthread_detach(t);
+    if (out) *out = NULL;
+    return pdPASS;
+}
+
+/** 只支持删除自身（任务函数末尾调用） */
+static inline void vTaskDelete(TaskHandle_t t)
+{
+    (void)t;
+    pthread_exit(NULL);
+}
+
+/** 单调时钟毫秒数（tick 即 1 ms） */
+static inline TickType_t xTaskGetTickCount(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (TickType_t)((uint64_t)ts.tv_sec * 1000u + (uint64_t)ts.tv_nsec / 1000000u);
+}
+
+/** 以线程局部变量的地址区分线程，只用于比较，不能当作 pthread 句柄使用 */
+static inline TaskHandle_t xTaskGetCurrentTaskHandle(void)
+{
+    static __thread pthread_t self;
+    return &self;
+}
+
+static inline void vTaskDelay(TickType_t ticks)
+{
+    struct timespec ts = { (time_t)(ticks / 1000), (long)(ticks % 1000) * 1000000L };
+    nanosleep(&ts, NULL);
+}
+
+#endif /* HOST_FREERTOS_TASK_H */
@@ -0,0 +1,16 @@
+/**
+ * @file sdkconfig.h
+ * @brief 主机构建用 sdkconfig 替身（对应 Kconfig 默认值）
+ *
+ * 仅供 projects/host_bench 在 Linux 上编译 esp-rpc 源码使用，不参与 ESP-IDF 构建。
+ */
+
+#ifndef HOST_SDKCONFIG_H
+#define HOST_SDKCONFIG_H
+
+#define CONFIG_ESPRPC_POOL_BLOCK_SIZE 2048
+#define CONFIG_ESPRPC_ARENA_SIZE 2048
+#define CONFIG_ESPRPC_LIST_MAX_ITEMS 256
+#define CONFIG_ESPRPC_RPC_CALL_TIMEOUT_MS 2000
+
+#endif /* HOST_SDKCONFIG_H */
@@ -2,6 +2,28 @@
 
 import type { User, CreateUserRequest, UserResponse } from './rpc_types';
 
+/** "fieldmask" 方法的请求掩码：names 为 struct 字段的声明顺序，fields 缺省时请求全部字段 */
+function fieldMask(fields: readonly string[] | undefined, names: readonly string[]): Uint8Array {
+  const mask = new Uint8Array((names.length + 7) >> 3);
+  names.forEach((name, i) => {
+    if (!fields || fields.includes(name)) mask[i >> 3] |= 1 << (i & 7);
+  });
+  return mask;
+}
+
+/** 分页列表（PAGED(T)）的一页：more 为 true 时同一 invokeId 还有后续页，传输层拼成 { items, len } 后 resolve；
+ *  aborted 为 true 时设备中途放弃了调用（本页为空且是最后一页），传输层以错误 reject */
+export class RpcPage<T = unknown> {
+  readonly items: T[];
+  readonly more: boolean;
+  readonly aborted: boolean;
+  constructor(items: T[], more: boolean, aborted = false) {
+    this.items = items;
+    this.more = more;
+    this.aborted = aborted;
+  }
+}
+
 export function encodeRequest(methodId: number, args: IArguments | unknown[]): Uint8Array {
   const argsOrArray = args.length !== undefined ? Array.from(args as IArguments) : (args as unknown[]);
 
@@ -17,6 +39,8 @@ export function encodeRequest(methodId: number, args: IArguments | unknown[]): U
           buf = newBuf; dv = new DataView(buf);
         }
       };
+      const _fm = fieldMask(args[1], ['id', 'name', 'email', 'status']);
+      ensure(_fm.length); new Uint8Array(buf).set(_fm, off); off += _fm.length;
       ensure(4); dv.setInt32(off, args[0] | 0, true); off += 4;
       return new Uint8Array(buf, 0, off);
     }
@@ -129,6 +153,8 @@ export function encodeRequest(methodId: number, args: IArguments | unknown[]): U
           buf = newBuf; dv = new DataView(buf);
         }
       };
+      const _fm = fieldMask(args[1], ['id', 'name', 'email', 'status', 'tags']);
+      ensure(_fm.length); new Uint8Array(buf).set(_fm, off); off += _fm.length;
       ensure(1);
       if (args[0] !== undefined && args[0] !== null) {
         dv.setUint8(off, 1); off += 1; ensure(4); dv.setInt32(off, args[0] | 0, true); off += 4;
@@ -140,18 +166,30 @@ export function encodeRequest(methodId: number, args: IArguments | unknown[]): U
   throw new Error(`Unknown methodId: ${methodId}`);
 }
 
+/** 增量流（"delta"）每个 methodId 的上一帧完整对象与期望的下一帧序号 */
+const _deltaBase = new Map<number, { seq: number; value: any }>();
+
 export function decodeResponse<T = unknown>(methodId: number, payload: Uint8Array): T {
 
     if (methodId === 0) {
       const dv = new DataView(payload.buffer, payload.byteOffset, payload.byteLength);
       let off = 0;
+      const _fm = payload.subarray(off, off + 1); off += 1;
       const result: any = {};
-      result.id = dv.getInt32(off, true); off += 4;
-      const _lname = dv.getUint16(off, true); off += 2;
-      result.name = new TextDecoder().decode(new Uint8Array(payload.buffer, payload.byteOffset + off, _lname)); off += _lname;
-      const _lemail = dv.getUint16(off, true); off += 2;
-      result.email = new TextDecoder().decode(new Uint8Array(payload.buffer, payload.byteOffset + off, _lemail)); off += _lemail;
-      result.status = dv.getInt32(off, true); off += 4;
+      if (_fm[0] & 1) {
+        result.id = dv.getInt32(off, true); off += 4;
+      }
+      if (_fm[0] & 2) {
+        const _len = dv.getUint16(off, true); off += 2;
+        result.name = new TextDecoder().decode(new Uint8Array(dv.buffer, dv.byteOffset + off, _len)); off += _len;
+      }
+      if (_fm[0] & 4) {
+        const _len = dv.getUint16(off, true); off += 2;
+        result.email = new TextDecoder().decode(new Uint8Array(dv.buffer, dv.byteOffset + off, _len)); off += _len;
+      }
+      if (_fm[0] & 8) {
+        result.status = dv.getInt32(off, true); off += 4;
+      }
       return result;
     }
     if (methodId === 1) {
@@ -186,53 +224,130 @@ export function decodeResponse<T = unknown>(methodId: number, payload: Uint8Arra
     if (methodId === 4) {
       const dv = new DataView(payload.buffer, payload.byteOffset, payload.byteLength);
       let off = 0;
-      return dv.getUint8(off) !== 0;
+      let ret: any;
+      ret = dv.getUint8(off) !== 0; off += 1;
+      return ret;
     }
     if (methodId === 5) {
       const dv = new DataView(payload.buffer, payload.byteOffset, payload.byteLength);
       let off = 0;
+      const _pageFlags = dv.getUint8(off); off += 1;
+      const _fm = payload.subarray(off, off + 1); off += 1;
       const count = dv.getUint32(off, true); off += 4;
       const items: any[] = [];
       for (let i = 0; i < count; i++) {
-        const item: any = {};
-        item.id = dv.getInt32(off, true); off += 4;
-        const _lname = dv.getUint16(off, true); off += 2;
-        item.name = new TextDecoder().decode(new Uint8Array(payload.buffer, payload.byteOffset + off, _lname)); off += _lname;
-        const _pemail = dv.getUint8(off); off += 1;
-        if (_pemail) { const _lemail = dv.getUint16(off, true); off += 2;
-          item.email = new TextDecoder().decode(new Uint8Array(payload.buffer, payload.byteOffset + off, _lemail)); off += _lemail; }
-        item.status = dv.getInt32(off, true); off += 4;
+        const result: any = {};
+        if (_fm[0] & 1) {
+          result.id = dv.getInt32(off, true); off += 4;
+        }
+        if (_fm[0] & 2) {
+          const _len = dv.getUint16(off, true); off += 2;
+          result.name = new TextDecoder().decode(new Uint8Array(dv.buffer, dv.byteOffset + off, _len)); off += _len;
+        }
+        if (_fm[0] & 4) {
+          const _present = dv.getUint8(off); off += 1;
+          if (_present) {
+            const _len = dv.getUint16(off, true); off += 2;
+            result.email = new TextDecoder().decode(new Uint8Array(dv.buffer, dv.byteOffset + off, _len)); off += _len;
+          } else {
+            result.email = undefined;
+          }
+        }
+        if (_fm[0] & 8) {
+          result.status = dv.getInt32(off, true); off += 4;
+        }
+        if (_fm[0] & 16) {
+          {
           const _count = dv.getUint32(off, true); off += 4;
-          item.tags = [];
+          result.tags = [];
           for (let i = 0; i < _count; i++) {
             let _item: any;
             const _len = dv.getUint16(off, true); off += 2;
             _item = new TextDecoder().decode(new Uint8Array(dv.buffer, dv.byteOffset + off, _len)); off += _len;
-            item.tags.push(_item);
+            result.tags.push(_item);
           }
-        items.push(item);
+          }
+        }
+        items.push(result);
       }
-      return { items, len: items.length };
+      return new RpcPage(items, (_pageFlags & 1) !== 0, (_pageFlags & 2) !== 0) as T;
     }
     if (methodId === 6) {
       const dv = new DataView(payload.buffer, payload.byteOffset, payload.byteLength);
       let off = 0;
+      const _flags = dv.getUint8(off); off += 1;
+      const _seq = dv.getUint8(off); off += 1;
+      const _base = _deltaBase.get(6);
       const result: any = {};
-      result.id = dv.getInt32(off, true); off += 4;
-      const _lname = dv.getUint16(off, true); off += 2;
-      result.name = new TextDecoder().decode(new Uint8Array(payload.buffer, payload.byteOffset + off, _lname)); off += _lname;
-      const _pemail = dv.getUint8(off); off += 1;
-      if (_pemail) { const _lemail = dv.getUint16(off, true); off += 2;
-        result.email = new TextDecoder().decode(new Uint8Array(payload.buffer, payload.byteOffset + off, _lemail)); off += _lemail; }
-      result.status = dv.getInt32(off, true); off += 4;
-        const _count = dv.getUint32(off, true); off += 4;
-        result.tags = [];
-        for (let i = 0; i < _count; i++) {
-          let _item: any;
+      if (_flags & 1) {
+        {
+          result.id = dv.getInt32(off, true); off += 4;
+        }
+        {
           const _len = dv.getUint16(off, true); off += 2;
-          _item = new TextDecoder().decode(new Uint8Array(dv.buffer, dv.byteOffset + off, _len)); off += _len;
-          result.tags.push(_item);
+          result.name = new TextDecoder().decode(new Uint8Array(dv.buffer, dv.byteOffset + off, _len)); off += _len;
         }
+        {
+          const _present = dv.getUint8(off); off += 1;
+          if (_present) {
+            const _len = dv.getUint16(off, true); off += 2;
+            result.email = new TextDecoder().decode(new Uint8Array(dv.buffer, dv.byteOffset + off, _len)); off += _len;
+          } else {
+            result.email = undefined;
+          }
+        }
+        {
+          result.status = dv.getInt32(off, true); off += 4;
+        }
+        {
+          {
+          const _count = dv.getUint32(off, true); off += 4;
+          result.tags = [];
+          for (let i = 0; i < _count; i++) {
+            let _item: any;
+            const _len = dv.getUint16(off, true); off += 2;
+            _item = new TextDecoder().decode(new Uint8Array(dv.buffer, dv.byteOffset + off, _len)); off += _len;
+            result.tags.push(_item);
+          }
+          }
+        }
+      } else {
+        if (!_base || _base.seq !== _seq) { _deltaBase.delete(6); return undefined as T; }
+        const _bm = payload.subarray(off, off + 1); off += 1;
+        Object.assign(result, _base.value);
+        if (_bm[0] & 1) {
+          result.id = dv.getInt32(off, true); off += 4;
+        }
+        if (_bm[0] & 2) {
+          const _len = dv.getUint16(off, true); off += 2;
+          result.name = new TextDecoder().decode(new Uint8Array(dv.buffer, dv.byteOffset + off, _len)); off += _len;
+        }
+        if (_bm[0] & 4) {
+          const _present = dv.getUint8(off); off += 1;
+          if (_present) {
+            const _len = dv.getUint16(off, true); off += 2;
+            result.email = new TextDecoder().decode(new Uint8Array(dv.buffer, dv.byteOffset + off, _len)); off += _len;
+          } else {
+            result.email = undefined;
+          }
+        }
+        if (_bm[0] & 8) {
+          result.status = dv.getInt32(off, true); off += 4;
+        }
+        if (_bm[0] & 16) {
+          {
+          const _count = dv.getUint32(off, true); off += 4;
+          result.tags = [];
+          for (let i = 0; i < _count; i++) {
+            let _item: any;
+            const _len = dv.getUint16(off, true); off += 2;
+            _item = new TextDecoder().decode(new Uint8Array(dv.buffer, dv.byteOffset + off, _len)); off += _len;
+            result.tags.push(_item);
+          }
+          }
+        }
+      }
+      _deltaBase.set(6, { seq: (_seq + 1) & 0xff, value: result });
       return result;
     }
     if (methodId === 7) {
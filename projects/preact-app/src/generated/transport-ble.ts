@@ -2,31 +2,72 @@
  * BLE 传输实现（Web Bluetooth API，二进制协议）
  *
  * 服务 UUID: 0000E530-1212-EFDE-1523-785FEABCD123
- * TX 特征 (写): 0000E531-...  RX 特征 (通知): 0000E532-...
+ * TX 特征 (写): 0000E531-...  RX 特征 (通知): 0000E532-...，读取得到设备端的 ATT MTU
+ *
+ * 分段（与 transport_ble.c 一致）：每次写/通知为 [1B 段头][帧的一段]，段头 bit7=后面还有段，
+ * bit0-6=段序号（首段为 0），每段不超过 ATT MTU - 3 字节。
  */
 
 import type { EsprpcTransport } from './transport';
-import { encodeRequest, decodeResponse } from './rpc_binary_codec';
+import { encodeRequest, decodeResponse, RpcPage } from './rpc_binary_codec';
 
 const ESPRPC_SERVICE_UUID = '0000e530-1212-efde-1523-785feabcd123';
 const ESPRPC_CHR_TX_UUID = '0000e531-1212-efde-1523-785feabcd123';
 const ESPRPC_CHR_RX_UUID = '0000e532-1212-efde-1523-785feabcd123';
+const SEG_MORE = 0x80;
+const SEG_SEQ_MASK = 0x7f;
 
 export function createBleTransport(): EsprpcTransport {
   let device: BluetoothDevice | null = null;
   let txChar: BluetoothRemoteGATTCharacteristic | null = null;
   let rxChar: BluetoothRemoteGATTCharacteristic | null = null;
   let invokeIdCounter = 1;
-  const pending = new Map<number, { resolve: (v: unknown) => void; reject: (e: Error) => void; timeoutId: ReturnType<typeof setTimeout> }>();
+  const pending = new Map<number, { resolve: (v: unknown) => void; reject: (e: Error) => void; rearm: () => void; pages: unknown[]; onPage?: (items: unknown[]) => void }>();
   const streamSubs = new Map<number, (data: unknown) => void>();
+  let segSize = 20;  /* 每段属性值字节数（含段头）= ATT MTU - 3，连接后从 RX 特征读取 */
+  let writeChain: Promise<void> = Promise.resolve();  /* Web Bluetooth 不允许并发写，逐段串行 */
+  let rxParts: Uint8Array[] | null = null;
+  let rxSeq = 0;
 
   function sendFrame(frame: Uint8Array): void {
     if (!txChar) return;
-    txChar.writeValueWithoutResponse(frame);
+    const chunk = segSize - 1;
+    for (let off = 0, seq = 0; off < frame.length; off += chunk, seq++) {
+      const end = Math.min(off + chunk, frame.length);
+      const seg = new Uint8Array(1 + end - off);
+      seg[0] = (seq & SEG_SEQ_MASK) | (end < frame.length ? SEG_MORE : 0);
+      seg.set(frame.subarray(off, end), 1);
+      writeChain = writeChain.then(() => txChar?.writeValueWithoutResponse(seg)).catch(() => {});
+    }
+  }
+
+  /** 拼接一个通知段，拼满整帧后返回，否则返回 null；序号不连续时丢弃当前帧 */
+  function onSegment(seg: Uint8Array): Uint8Array | null {
+    if (seg.length < 1) return null;
+    const seq = seg[0] & SEG_SEQ_MASK;
+    if (seq === 0) {
+      rxParts = [];
+    } else if (!rxParts || seq !== rxSeq) {
+      rxParts = null;
+      return null;
+    }
+    rxParts.push(seg.slice(1));
+    rxSeq = (seq + 1) & SEG_SEQ_MASK;
+    if (seg[0] & SEG_MORE) return null;
+    const parts = rxParts;
+    rxParts = null;
+    if (parts.length === 1) return parts[0];
+    const frame = new Uint8Array(parts.reduce((n, p) => n + p.length, 0));
+    let off = 0;
+    for (const p of parts) {
+      frame.set(p, off);
+      off += p.length;
+    }
+    return frame;
   }
 
   return {
-    async call<T = unknown>(methodId: number, args: IArguments, options?: { timeout?: number }): Promise<T> {
+    async call<T = unknown>(methodId: number, args: IArguments, options?: { timeout?: number; onPage?: (items: unknown[]) => void }): Promise<T> {
       return new Promise((resolve, reject) => {
         if (!txChar) {
           reject(new Error('Not connected'));
@@ -35,17 +76,20 @@ export function createBleTransport(): EsprpcTransport {
         const invokeId = invokeIdCounter++;
         if (invokeIdCounter > 0xfffe) invokeIdCounter = 1;
         const timeoutMs = options?.timeout ?? 2000;
-        const timeoutId = setTimeout(() => {
+        const expire = () => {
           const h = pending.get(invokeId);
           if (h) {
             pending.delete(invokeId);
             reject(new Error(`RPC 超时 (${timeoutMs}ms)`));
           }
-        }, timeoutMs);
+        };
+        let timeoutId = setTimeout(expire, timeoutMs);
         pending.set(invokeId, {
           resolve: (v) => { clearTimeout(timeoutId); (resolve as (v: unknown) => void)(v); },
           reject: (e) => { clearTimeout(timeoutId); reject(e); },
-          timeoutId,
+          rearm: () => { clearTimeout(timeoutId); timeoutId = setTimeout(expire, timeoutMs); },
+          pages: [],
+          onPage: options?.onPage,
         });
         const payload = encodeRequest(methodId, args);
         const frame = new Uint8Array(5 + payload.length);
@@ -88,13 +132,20 @@ export function createBleTransport(): EsprpcTransport {
       const service = await server.getPrimaryService(ESPRPC_SERVICE_UUID);
       txChar = await service.getCharacteristic(ESPRPC_CHR_TX_UUID);
       rxChar = await service.getCharacteristic(ESPRPC_CHR_RX_UUID);
+      try {
+        const mtu = (await rxChar.readValue()).getUint16(0, true);
+        segSize = Math.min(512, Math.max(23, mtu) - 3);
+      } catch (_) {
+        segSize = 20;
+      }
       await rxChar.startNotifications();
       rxChar.addEventListener('characteristicvaluechanged', (ev: Event) => {
         const target = ev.target as BluetoothRemoteGATTCharacteristic;
         const value = target?.value;
-        if (!value || value.byteLength < 5) return;
+        if (!value) return;
         try {
-          const data = new Uint8Array(value.buffer, value.byteOffset, value.byteLength);
+          const data = onSegment(new Uint8Array(value.buffer, value.byteOffset, value.byteLength));
+          if (!data || data.length < 5) return;
           const methodId = data[0];
           const invokeId = data[1] | (data[2] << 8);
           const payloadLen = data[3] | (data[4] << 8);
@@ -103,13 +154,25 @@ export function createBleTransport(): EsprpcTransport {
           const result = decodeResponse(methodId, payload);
           if (invokeId !== 0) {
             const h = pending.get(invokeId);
-            if (h) {
+            if (h && result instanceof RpcPage && result.aborted) {
+              pending.delete(invokeId);
+              h.reject(new Error('RPC 分页响应被设备中止'));
+            } else if (h && result instanceof RpcPage) {
+              h.onPage?.(result.items);
+              h.pages.push(...result.items);
+              if (result.more) {
+                h.rearm();  /* 每收到一页重新计时 */
+              } else {
+                pending.delete(invokeId);
+                h.resolve({ items: h.pages, len: h.pages.length });
+              }
+            } else if (h) {
               pending.delete(invokeId);
               h.resolve(result);
             }
           } else {
             const cb = streamSubs.get(methodId);
-            if (cb) cb(result);
+            if (cb && result !== undefined) cb(result);
           }
         } catch (_) {}
       });
@@ -121,7 +184,9 @@ export function createBleTransport(): EsprpcTransport {
       device = null;
       txChar = null;
       rxChar = null;
-      pending.forEach((h) => { clearTimeout(h.timeoutId); h.reject(new Error('Disconnected')); });
+      rxParts = null;
+      writeChain = Promise.resolve();
+      pending.forEach((h) => { h.reject(new Error('Disconnected')); });
       pending.clear();
     },
   };
@@ -3,7 +3,7 @@
  */
 
 import type { EsprpcTransport } from './transport';
-import { encodeRequest, decodeResponse } from './rpc_binary_codec';
+import { encodeRequest, decodeResponse, RpcPage } from './rpc_binary_codec';
 
 function closeCodeMessage(code: number): string {
   const map: Record<number, string> = {
@@ -19,11 +19,11 @@ function closeCodeMessage(code: number): string {
 export function createWebSocketTransport(url: string): EsprpcTransport {
   let ws: WebSocket | null = null;
   let invokeIdCounter = 1;
-  const pending = new Map<number, { resolve: (v: unknown) => void; reject: (e: Error) => void; timeoutId: ReturnType<typeof setTimeout> }>();
+  const pending = new Map<number, { resolve: (v: unknown) => void; reject: (e: Error) => void; rearm: () => void; pages: unknown[]; onPage?: (items: unknown[]) => void }>();
   const streamSubs = new Map<number, (data: unknown) => void>();
 
   return {
-    async call<T = unknown>(methodId: number, args: IArguments, options?: { timeout?: number }): Promise<T> {
+    async call<T = unknown>(methodId: number, args: IArguments, options?: { timeout?: number; onPage?: (items: unknown[]) => void }): Promise<T> {
       return new Promise((resolve, reject) => {
         if (!ws || ws.readyState !== WebSocket.OPEN) {
           reject(new Error('Not connected'));
@@ -32,17 +32,20 @@ export function createWebSocketTransport(url: string): EsprpcTransport {
         const invokeId = invokeIdCounter++;
         if (invokeIdCounter > 0xfffe) invokeIdCounter = 1;
         const timeoutMs = options?.timeout ?? 2000;
-        const timeoutId = setTimeout(() => {
+        const expire = () => {
           const h = pending.get(invokeId);
           if (h) {
             pending.delete(invokeId);
             reject(new Error(`RPC 超时 (${timeoutMs}ms)`));
           }
-        }, timeoutMs);
+        };
+        let timeoutId = setTimeout(expire, timeoutMs);
         pending.set(invokeId, {
           resolve: (v) => { clearTimeout(timeoutId); (resolve as (v: unknown) => void)(v); },
           reject: (e) => { clearTimeout(timeoutId); reject(e); },
-          timeoutId,
+          rearm: () => { clearTimeout(timeoutId); timeoutId = setTimeout(expire, timeoutMs); },
+          pages: [],
+          onPage: options?.onPage,
         });
         const payload = encodeRequest(methodId, args);
         const frame = new Uint8Array(5 + payload.length);
@@ -112,20 +115,32 @@ export function createWebSocketTransport(url: string): EsprpcTransport {
           const result = decodeResponse(methodId, payload);
           if (invokeId !== 0) {
             const h = pending.get(invokeId);
-            if (h) {
+            if (h && result instanceof RpcPage && result.aborted) {
+              pending.delete(invokeId);
+              h.reject(new Error('RPC 分页响应被设备中止'));
+            } else if (h && result instanceof RpcPage) {
+              h.onPage?.(result.items);
+              h.pages.push(...result.items);
+              if (result.more) {
+                h.rearm();  /* 每收到一页重新计时 */
+              } else {
+                pending.delete(invokeId);
+                h.resolve({ items: h.pages, len: h.pages.length });
+              }
+            } else if (h) {
               pending.delete(invokeId);
               h.resolve(result);
             }
           } else {
             const cb = streamSubs.get(methodId);
-            if (cb) cb(result);
+            if (cb && result !== undefined) cb(result);
           }
         } catch (_) {}
       };
     },
     disconnect(): void {
       if (ws) { ws.close(); ws = null; }
-      pending.forEach((h) => { clearTimeout(h.timeoutId); h.reject(new Error('Disconnected')); });
+      pending.forEach((h) => { h.reject(new Error('Disconnected')); });
       pending.clear();
     },
     };
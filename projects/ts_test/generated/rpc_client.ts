@@ -3,14 +3,38 @@
 import type { CreateUserRequest, User, UserResponse } from './rpc_types';
 import type { EsprpcTransport } from './transport';
 
+/** 把分页调用的 onPage 回调转为按页产出的异步迭代器；调用失败时在迭代中抛出 */
+function pagesOf<T>(start: (onPage: (items: unknown[]) => void) => Promise<unknown>): AsyncIterable<T[]> {
+  return {
+    async *[Symbol.asyncIterator]() {
+      const queue: T[][] = [];
+      let wake: (() => void) | null = null;
+      let done = false;
+      let error: unknown = null;
+      start((items) => { queue.push(items as T[]); wake?.(); }).then(
+        () => { done = true; wake?.(); },
+        (e) => { error = e; done = true; wake?.(); },
+      );
+      for (;;) {
+        const page = queue.shift();
+        if (page) { yield page; continue; }
+        if (done) break;
+        await new Promise<void>((r) => { wake = r; });
+        wake = null;
+      }
+      if (error) throw error;
+    },
+  };
+}
+
 export class UserServiceClient {
   readonly #transport: EsprpcTransport;
   constructor(transport: EsprpcTransport) {
     this.#transport = transport;
   }
 
-  async GetUser(_id: number): Promise<UserResponse> {
-    return this.#transport.call<UserResponse>(0, arguments);
+  async GetUser<K extends keyof UserResponse = keyof UserResponse>(_id: number, _fields?: K[]): Promise<Pick<UserResponse, K>> {
+    return this.#transport.call<Pick<UserResponse, K>>(0, arguments);
   }
 
   async CreateUser(_request: CreateUserRequest): Promise<UserResponse> {
@@ -29,8 +53,13 @@ export class UserServiceClient {
     return this.#transport.call<boolean>(4, arguments);
   }
 
-  async ListUsers(_page: number | undefined): Promise<User[]> {
-    return this.#transport.call<User[]>(5, arguments, { timeout: 5000 });
+  async ListUsers<K extends keyof User = keyof User>(_page: number | undefined, _fields?: K[]): Promise<Pick<User, K>[]> {
+    return this.#transport.call<Pick<User, K>[]>(5, arguments, { timeout: 5000 });
+  }
+
+  ListUsersPages<K extends keyof User = keyof User>(_page: number | undefined, _fields?: K[]): AsyncIterable<Pick<User, K>[]> {
+    const args = arguments;
+    return pagesOf<Pick<User, K>>((onPage) => this.#transport.call(5, args, { timeout: 5000, onPage }));
   }
 
   WatchUsers(): { subscribe(cb: (v: User) => void): () => void } {
@@ -3,11 +3,14 @@
  *
  * 与 ESP32 transport_serial.c 使用相同帧格式: [1B method_id][2B invoke_id LE][2B payload_len LE][payload]
  * 若指定 prefix/suffix，收发时自动插入与剥离，与 ESP 端 Kconfig 前后缀一致即可复用串口。
+ * framing: 'cobs' 对应 ESP 端 CONFIG_ESPRPC_SERIAL_COBS：每包为 0x00 + COBS(帧 + CRC-16 LE) + 0x00，
+ * 损坏的包在下一个 0x00 处丢弃，不影响后续包。
+ * framing: 'arq' 对应 CONFIG_ESPRPC_SERIAL_ARQ：在 COBS 之上加序号、累计确认与滑动窗口重传，丢包与损坏的包自动重发。
  * 需在 HTTPS 或 localhost 下使用；用户需在浏览器弹窗中选择串口设备。
  */
 
 import type { EsprpcTransport } from './transport';
-import { encodeRequest, decodeResponse } from './rpc_binary_codec';
+import { encodeRequest, decodeResponse, RpcPage } from './rpc_binary_codec';
 
 function toMarkerBytes(v: string | number[] | Uint8Array | undefined): Uint8Array {
   if (v === undefined || v === null) return new Uint8Array(0);
@@ -16,32 +19,310 @@ function toMarkerBytes(v: string | number[] | Uint8Array | undefined): Uint8Arra
   return new Uint8Array(v as number[]);
 }
 
-export function createSerialTransport(options?: { baudRate?: number; prefix?: string | number[] | Uint8Array; suffix?: string | number[] | Uint8Array }): EsprpcTransport {
+export type SerialFraming = 'marker' | 'cobs' | 'arq';
+
+/** CRC-16/CCITT-FALSE（多项式 0x1021，初值 0xFFFF），与 C 端 COBS 模式一致 */
+function crc16(data: Uint8Array): number {
+  let crc = 0xffff;
+  for (let i = 0; i < data.length; i++) {
+    crc ^= data[i]! << 8;
+    for (let b = 0; b < 8; b++) crc = crc & 0x8000 ? ((crc << 1) ^ 0x1021) & 0xffff : (crc << 1) & 0xffff;
+  }
+  return crc;
+}
+
+/** 编码为 0x00 + COBS(帧 + CRC-16 LE) + 0x00 */
+function cobsEncodePacket(frame: Uint8Array): Uint8Array {
+  const crc = crc16(frame);
+  const src = new Uint8Array(frame.length + 2);
+  src.set(frame);
+  src[frame.length] = crc & 0xff;
+  src[frame.length + 1] = crc >> 8;
+  const out = new Uint8Array(src.length + Math.floor(src.length / 254) + 3);
+  let len = 2, codePos = 1, code = 1;
+  for (let i = 0; i < src.length; i++) {
+    const b = src[i]!;
+    if (b !== 0) {
+      out[len++] = b;
+      if (++code !== 0xff) continue;
+    }
+    out[codePos] = code;
+    codePos = len++;
+    code = 1;
+  }
+  out[codePos] = code;
+  out[len++] = 0;
+  return out.subarray(0, len);
+}
+
+/** 解码两个 0x00 之间的 COBS 包并校验 CRC，返回去掉 CRC 的内容，失败返回 null */
+function cobsDecodePacket(enc: number[]): Uint8Array | null {
+  const out = new Uint8Array(enc.length);
+  let n = 0, i = 0;
+  while (i < enc.length) {
+    const code = enc[i++]!;
+    if (i + code - 1 > enc.length) return null;
+    for (let k = 1; k < code; k++) out[n++] = enc[i++]!;
+    if (code !== 0xff && i < enc.length) out[n++] = 0;
+  }
+  if (n < 3) return null;
+  const packet = out.subarray(0, n - 2);
+  if (crc16(packet) !== (out[n - 2]! | (out[n - 1]! << 8))) return null;
+  return packet;
+}
+
+/** 帧头中的负载长度与帧长一致 */
+function rpcFrameOk(frame: Uint8Array): boolean {
+  return frame.length >= 5 && 5 + (frame[3]! | (frame[4]! << 8)) === frame.length;
+}
+
+/** COBS 模式收包：buf 为两次调用间未结束的包，按 0x00 切包，CRC 校验通过的内容交给 onPacket */
+function feedCobs(buf: number[], chunk: Uint8Array, onPacket: (packet: Uint8Array) => void): void {
+  for (let i = 0; i < chunk.length; i++) {
+    const b = chunk[i]!;
+    if (b !== 0) {
+      buf.push(b);
+      continue;
+    }
+    if (buf.length === 0) continue;
+    const packet = cobsDecodePacket(buf);
+    buf.length = 0;
+    if (packet) onPacket(packet);
+  }
+}
+
+export interface SerialArqOptions {
+  /** 在途帧数上限，默认 4 */
+  window?: number;
+  /** 重传超时（ms），连续超时时加倍，最多 8 倍，默认 200 */
+  rtoMs?: number;
+}
+
+const ARQ_DATA = 0x01;
+const ARQ_REJ = 0x02;
+
+interface ArqLink {
+  send(frame: Uint8Array): void;
+  onPacket(packet: Uint8Array): void;
+  close(): void;
+}
+
+/**
+ * 可靠链路（framing: 'arq'）：COBS 包内为 [ctl][epoch][seq][ack] + 帧，Go-Back-N 滑动窗口，与 C 端一致。
+ * ack 为期望对端的下一个 seq；出现缺口时回一次 REJ，收到 REJ 立即重发窗口，否则超时重发。
+ * epoch 为本端会话号：对端会话号变化（重启）时两个方向都从 seq 0 重新编号。
+ */
+function createArqLink(write: (packet: Uint8Array) => void, deliver: (frame: Uint8Array) => void, opts?: SerialArqOptions): ArqLink {
+  const window = opts?.window ?? 4;
+  const rtoMs = opts?.rtoMs ?? 200;
+  let epoch = Math.floor(Math.random() * 256);
+  let peerEpoch = -1;
+  let rxExpect = 0;
+  let rejSent = false;
+  let ackPending = false;
+  let ackScheduled = false;
+  let base = 0;
+  const inflight: Uint8Array[] = [];
+  const queue: Uint8Array[] = [];
+  let rto = rtoMs;
+  let stalls = 0;
+  let timer: ReturnType<typeof setTimeout> | null = null;
+
+  function emit(ctl: number, seq: number, frame?: Uint8Array): void {
+    const p = new Uint8Array(4 + (frame ? frame.length : 0));
+    p[0] = ctl;
+    p[1] = epoch;
+    p[2] = seq & 0xff;
+    p[3] = rxExpect;
+    if (frame) p.set(frame, 4);
+    ackPending = false;
+    write(cobsEncodePacket(p));
+  }
+
+  function arm(): void {
+    if (timer) clearTimeout(timer);
+    timer = inflight.length ? setTimeout(onTimeout, rto) : null;
+  }
+
+  function resend(): void {
+    inflight.forEach((f, i) => emit(ARQ_DATA, base + i, f));
+    arm();
+  }
+
+  function onTimeout(): void {
+    timer = null;
+    if (++stalls >= 8) {
+      /* 长时间没有进展：换会话号，两个方向都从 seq 0 开始 */
+      epoch = (epoch + 1 + Math.floor(Math.random() * 255)) & 0xff;
+      base = 0;
+      rxExpect = 0;
+      rejSent = false;
+      stalls = 0;
+      rto = rtoMs;
+    } else {
+      rto = Math.min(rto * 2, rtoMs * 8);
+    }
+    resend();
+  }
+
+  function fill(): void {
+    const idle = inflight.length === 0;
+    while (inflight.length < window && queue.length) {
+      const f = queue.shift()!;
+      emit(ARQ_DATA, base + inflight.length, f);
+      inflight.push(f);
+    }
+    if (idle && inflight.length) arm();
+  }
+
+  function flushAck(): void {
+    ackScheduled = false;
+    if (ackPending) emit(0, 0);
+  }
+
+  return {
+    send(frame: Uint8Array): void {
+      queue.push(frame);
+      fill();
+    },
+    onPacket(p: Uint8Array): void {
+      if (p.length < 4) return;
+      const ctl = p[0]!;
+      const data = (ctl & ARQ_DATA) !== 0;
+      if (data ? !rpcFrameOk(p.subarray(4)) : p.length !== 4) return;
+      if (p[1] !== peerEpoch) {
+        const known = peerEpoch >= 0;
+        peerEpoch = p[1]!;
+        rxExpect = 0;
+        rejSent = false;
+        if (known) {
+          base = 0;
+          rto = rtoMs;
+          stalls = 0;
+          if (inflight.length) resend();
+        }
+      }
+      const ack = p[3]!;
+      const acked = (ack - base) & 0xff;
+      if (acked > 0 && acked <= inflight.length) {
+        inflight.splice(0, acked);
+        base = ack;
+        rto = rtoMs;
+        stalls = 0;
+        arm();
+      }
+      if (ctl & ARQ_REJ && ack === base && inflight.length) resend();
+      if (data) {
+        const ahead = (p[2]! - rxExpect) & 0xff;
+        if (ahead === 0) {
+          rxExpect = (rxExpect + 1) & 0xff;
+          rejSent = false;
+          deliver(p.subarray(4));
+        } else if (ahead < 128 && !rejSent) {
+          rejSent = true;
+          emit(ARQ_REJ, 0);
+        }
+        ackPending = true;
+        if (!ackScheduled) {
+          ackScheduled = true;
+          queueMicrotask(flushAck);
+        }
+      }
+      fill();
+    },
+    close(): void {
+      if (timer) clearTimeout(timer);
+      timer = null;
+      ackPending = false;
+      inflight.length = 0;
+      queue.length = 0;
+    },
+  };
+}
+
+export function createSerialTransport(options?: { baudRate?: number; prefix?: string | number[] | Uint8Array; suffix?: string | number[] | Uint8Array; framing?: SerialFraming; arq?: SerialArqOptions }): EsprpcTransport {
   const baudRate = options?.baudRate ?? 115200;
+  const cobs = options?.framing === 'cobs' || options?.framing === 'arq';
   const prefixBytes = toMarkerBytes(options?.prefix);
   const suffixBytes = toMarkerBytes(options?.suffix);
   const prefixLen = prefixBytes.length;
   const suffixLen = suffixBytes.length;
   let port: SerialPort | null = null;
   let reader: ReadableStreamDefaultReader<Uint8Array> | null = null;
+  let link: ArqLink | null = null;
+  let writeChain: Promise<void> = Promise.resolve();
   let invokeIdCounter = 1;
-  const pending = new Map<number, { resolve: (v: unknown) => void; reject: (e: Error) => void; timeoutId: ReturnType<typeof setTimeout> }>();
+  const pending = new Map<number, { resolve: (v: unknown) => void; reject: (e: Error) => void; rearm: () => void; pages: unknown[]; onPage?: (items: unknown[]) => void }>();
   const streamSubs = new Map<number, (data: unknown) => void>();
 
+  /** 写操作串行排队：同一时刻只能有一个 writer（ARQ 重传会连续写多包） */
+  function writePacket(packet: Uint8Array): Promise<void> {
+    writeChain = writeChain.then(async () => {
+      if (!port?.writable) return;
+      const writer = port.writable.getWriter();
+      try {
+        await writer.write(packet);
+      } finally {
+        writer.releaseLock();
+      }
+    }).catch(() => {});
+    return writeChain;
+  }
+
   async function sendFrame(frame: Uint8Array): Promise<void> {
     if (!port?.writable) return;
+    if (link) {
+      link.send(frame);
+      return;
+    }
+    await writePacket(cobs ? cobsEncodePacket(frame) : withMarkers(frame));
+  }
+
+  function onCobsPacket(packet: Uint8Array): void {
+    if (link) link.onPacket(packet);
+    else if (rpcFrameOk(packet)) handleFrame(packet);
+  }
+
+  function withMarkers(frame: Uint8Array): Uint8Array {
     const total = prefixLen + frame.length + suffixLen;
     const packet = new Uint8Array(total);
     let off = 0;
     if (prefixLen) { packet.set(prefixBytes, off); off += prefixLen; }
     packet.set(frame, off); off += frame.length;
     if (suffixLen) packet.set(suffixBytes, off);
-    const writer = port.writable.getWriter();
+    return packet;
+  }
+
+  function handleFrame(frame: Uint8Array): void {
+    const methodId = frame[0]!;
+    const invokeId = frame[1]! | (frame[2]! << 8);
+    const payloadLen = frame[3]! | (frame[4]! << 8);
+    const payload = frame.subarray(5, 5 + payloadLen);
     try {
-      await writer.write(packet);
-    } finally {
-      writer.releaseLock();
-    }
+      const result = decodeResponse(methodId, payload);
+      if (invokeId !== 0) {
+        const h = pending.get(invokeId);
+        if (h && result instanceof RpcPage && result.aborted) {
+          pending.delete(invokeId);
+          h.reject(new Error('RPC 分页响应被设备中止'));
+        } else if (h && result instanceof RpcPage) {
+          h.onPage?.(result.items);
+          h.pages.push(...result.items);
+          if (result.more) {
+            h.rearm();  /* 每收到一页重新计时 */
+          } else {
+            pending.delete(invokeId);
+            h.resolve({ items: h.pages, len: h.pages.length });
+          }
+        } else if (h) {
+          pending.delete(invokeId);
+          h.resolve(result);
+        }
+      } else {
+        const cb = streamSubs.get(methodId);
+        if (cb && result !== undefined) cb(result);
+      }
+    } catch (_) {}
   }
 
   function findPrefix(buf: number[], prefix: Uint8Array): number {
@@ -63,6 +344,10 @@ export function createSerialTransport(options?: { baudRate?: number; prefix?: st
       while (true) {
         const { value, done } = await reader!.read();
         if (done) break;
+        if (cobs) {
+          feedCobs(buf, value!, onCobsPacket);
+          continue;
+        }
         for (let i = 0; i < value!.length; i++) buf.push(value![i]);
         if (prefixLen > 0) {
           const idx = findPrefix(buf, prefixBytes);
@@ -82,30 +367,14 @@ export function createSerialTransport(options?: { baudRate?: number; prefix?: st
           need = 5;
           if (frame.length < 5) continue;
           if (suffixLen > 0 && buf.length >= suffixLen) buf.splice(0, suffixLen);
-          const methodId = frame[0]!;
-          const invokeId = frame[1]! | (frame[2]! << 8);
-          const payloadLen = frame[3]! | (frame[4]! << 8);
-          const payload = frame.subarray(5, 5 + payloadLen);
-          try {
-            const result = decodeResponse(methodId, payload);
-            if (invokeId !== 0) {
-              const h = pending.get(invokeId);
-              if (h) {
-                pending.delete(invokeId);
-                h.resolve(result);
-              }
-            } else {
-              const cb = streamSubs.get(methodId);
-              if (cb) cb(result);
-            }
-          } catch (_) {}
+          handleFrame(frame);
         }
       }
     })();
   }
 
   return {
-    async call<T = unknown>(methodId: number, args: IArguments, options?: { timeout?: number }): Promise<T> {
+    async call<T = unknown>(methodId: number, args: IArguments, options?: { timeout?: number; onPage?: (items: unknown[]) => void }): Promise<T> {
       return new Promise((resolve, reject) => {
         if (!port) {
           reject(new Error('Not connected'));
@@ -114,17 +383,20 @@ export function createSerialTransport(options?: { baudRate?: number; prefix?: st
         const invokeId = invokeIdCounter++;
         if (invokeIdCounter > 0xfffe) invokeIdCounter = 1;
         const timeoutMs = options?.timeout ?? 2000;
-        const timeoutId = setTimeout(() => {
+        const expire = () => {
           const h = pending.get(invokeId);
           if (h) {
             pending.delete(invokeId);
             reject(new Error(`RPC 超时 (${timeoutMs}ms)`));
           }
-        }, timeoutMs);
+        };
+        let timeoutId = setTimeout(expire, timeoutMs);
         pending.set(invokeId, {
           resolve: (v) => { clearTimeout(timeoutId); (resolve as (v: unknown) => void)(v); },
           reject: (e) => { clearTimeout(timeoutId); reject(e); },
-          timeoutId,
+          rearm: () => { clearTimeout(timeoutId); timeoutId = setTimeout(expire, timeoutMs); },
+          pages: [],
+          onPage: options?.onPage,
         });
         const payload = encodeRequest(methodId, args);
         const frame = new Uint8Array(5 + payload.length);
@@ -162,10 +434,13 @@ export function createSerialTransport(options?: { baudRate?: number; prefix?: st
       const nav = navigator as unknown as { serial: { requestPort: () => Promise<SerialPort> } };
       port = await nav.serial.requestPort();
       await port.open({ baudRate });
+      if (options?.framing === 'arq') link = createArqLink((p) => { void writePacket(p); }, handleFrame, options.arq);
       reader = port.readable!.getReader();
       runReadLoop();
     },
     disconnect(): void {
+      link?.close();
+      link = null;
       if (reader) {
         reader.cancel();
         reader = null;
@@ -174,7 +449,7 @@ export function createSerialTransport(options?: { baudRate?: number; prefix?: st
         try { port.close(); } catch (_) {}
         port = null;
       }
-      pending.forEach((h) => { clearTimeout(h.timeoutId); h.reject(new Error('Disconnected')); });
+      pending.forEach((h) => { h.reject(new Error('Disconnected')); });
       pending.clear();
     },
   };
@@ -195,16 +470,50 @@ export interface NodeSerialPortLike {
  */
 export function createSerialTransportFromPort(
   port: NodeSerialPortLike,
-  options?: { prefix?: string | number[] | Uint8Array; suffix?: string | number[] | Uint8Array }
+  options?: { prefix?: string | number[] | Uint8Array; suffix?: string | number[] | Uint8Array; framing?: SerialFraming; arq?: SerialArqOptions }
 ): EsprpcTransport {
+  const cobs = options?.framing === 'cobs' || options?.framing === 'arq';
   const prefixBytes = toMarkerBytes(options?.prefix);
   const suffixBytes = toMarkerBytes(options?.suffix);
   const prefixLen = prefixBytes.length;
   const suffixLen = suffixBytes.length;
+  let link: ArqLink | null = null;
   let invokeIdCounter = 1;
-  const pending = new Map<number, { resolve: (v: unknown) => void; reject: (e: Error) => void; timeoutId: ReturnType<typeof setTimeout> }>();
+  const pending = new Map<number, { resolve: (v: unknown) => void; reject: (e: Error) => void; rearm: () => void; pages: unknown[]; onPage?: (items: unknown[]) => void }>();
   const streamSubs = new Map<number, (data: unknown) => void>();
 
+  function handleFrame(frame: Uint8Array): void {
+    const methodId = frame[0]!;
+    const invokeId = frame[1]! | (frame[2]! << 8);
+    const payloadLen = frame[3]! | (frame[4]! << 8);
+    const payload = frame.subarray(5, 5 + payloadLen);
+    try {
+      const result = decodeResponse(methodId, payload);
+      if (invokeId !== 0) {
+        const h = pending.get(invokeId);
+        if (h && result instanceof RpcPage && result.aborted) {
+          pending.delete(invokeId);
+          h.reject(new Error('RPC 分页响应被设备中止'));
+        } else if (h && result instanceof RpcPage) {
+          h.onPage?.(result.items);
+          h.pages.push(...result.items);
+          if (result.more) {
+            h.rearm();  /* 每收到一页重新计时 */
+          } else {
+            pending.delete(invokeId);
+            h.resolve({ items: h.pages, len: h.pages.length });
+          }
+        } else if (h) {
+          pending.delete(invokeId);
+          h.resolve(result);
+        }
+      } else {
+        const cb = streamSubs.get(methodId);
+        if (cb && result !== undefined) cb(result);
+      }
+    } catch (_) {}
+  }
+
   function findPrefix(buf: number[], prefix: Uint8Array): number {
     const plen = prefix.length;
     if (buf.length < plen) return buf.length;
@@ -220,6 +529,13 @@ export function createSerialTransportFromPort(
   let need = 5;
 
   function onData(chunk: Uint8Array): void {
+    if (cobs) {
+      feedCobs(buf, chunk, (packet) => {
+        if (link) link.onPacket(packet);
+        else if (rpcFrameOk(packet)) handleFrame(packet);
+      });
+      return;
+    }
     for (let i = 0; i < chunk.length; i++) buf.push(chunk[i]!);
     if (prefixLen > 0) {
       const idx = findPrefix(buf, prefixBytes);
@@ -239,28 +555,20 @@ export function createSerialTransportFromPort(
       need = 5;
       if (frame.length < 5) continue;
       if (suffixLen > 0 && buf.length >= suffixLen) buf.splice(0, suffixLen);
-      const methodId = frame[0]!;
-      const invokeId = frame[1]! | (frame[2]! << 8);
-      const payloadLen = frame[3]! | (frame[4]! << 8);
-      const payload = frame.subarray(5, 5 + payloadLen);
-      try {
-        const result = decodeResponse(methodId, payload);
-        if (invokeId !== 0) {
-          const h = pending.get(invokeId);
-          if (h) {
-            pending.delete(invokeId);
-            h.resolve(result);
-          }
-        } else {
-          const cb = streamSubs.get(methodId);
-          if (cb) cb(result);
-        }
-      } catch (_) {}
+      handleFrame(frame);
     }
   }
 
   function sendFrame(frame: Uint8Array): void {
     if (!port.isOpen) return;
+    if (link) {
+      link.send(frame);
+      return;
+    }
+    if (cobs) {
+      port.write(cobsEncodePacket(frame));
+      return;
+    }
     const total = prefixLen + frame.length + suffixLen;
     const packet = new Uint8Array(total);
     let off = 0;
@@ -276,7 +584,7 @@ export function createSerialTransportFromPort(
   }
 
   return {
-    async call<T = unknown>(methodId: number, args: IArguments, options?: { timeout?: number }): Promise<T> {
+    async call<T = unknown>(methodId: number, args: IArguments, options?: { timeout?: number; onPage?: (items: unknown[]) => void }): Promise<T> {
       return new Promise((resolve, reject) => {
         if (!port.isOpen) {
           reject(new Error('Port is not open'));
@@ -285,17 +593,20 @@ export function createSerialTransportFromPort(
         const invokeId = invokeIdCounter++;
         if (invokeIdCounter > 0xfffe) invokeIdCounter = 1;
         const timeoutMs = options?.timeout ?? 2000;
-        const timeoutId = setTimeout(() => {
+        const expire = () => {
           const h = pending.get(invokeId);
           if (h) {
             pending.delete(invokeId);
             reject(new Error(`RPC 超时 (${timeoutMs}ms)`));
           }
-        }, timeoutMs);
+        };
+        let timeoutId = setTimeout(expire, timeoutMs);
         pending.set(invokeId, {
           resolve: (v) => { clearTimeout(timeoutId); (resolve as (v: unknown) => void)(v); },
           reject: (e) => { clearTimeout(timeoutId); reject(e); },
-          timeoutId,
+          rearm: () => { clearTimeout(timeoutId); timeoutId = setTimeout(expire, timeoutMs); },
+          pages: [],
+          onPage: options?.onPage,
         });
         const payload = encodeRequest(methodId, args);
         const frame = new Uint8Array(5 + payload.length);
@@ -330,11 +641,14 @@ export function createSerialTransportFromPort(
       if (!port.isOpen) {
         throw new Error('Port is not open. Open the serialport before calling connect().');
       }
+      if (options?.framing === 'arq') link = createArqLink((p) => { port.write(p); }, handleFrame, options.arq);
       port.on('data', onData);
     },
     disconnect(): void {
       removeDataListener();
-      pending.forEach((h) => { clearTimeout(h.timeoutId); h.reject(new Error('Disconnected')); });
+      link?.close();
+      link = null;
+      pending.forEach((h) => { h.reject(new Error('Disconnected')); });
       pending.clear();
       buf.length = 0;
       need = 5;
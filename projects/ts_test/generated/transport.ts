@@ -3,7 +3,8 @@
  */
 
 export interface EsprpcTransport {
-  call<T = unknown>(methodId: number, args: IArguments, options?: { timeout?: number }): Promise<T>;
+  /** onPage：分页列表（PAGED）每收到一页回调一次，全部页到齐后 Promise 以完整列表 resolve */
+  call<T = unknown>(methodId: number, args: IArguments, options?: { timeout?: number; onPage?: (items: unknown[]) => void }): Promise<T>;
   /** 发送 stream 请求（不等待响应，数据通过 subscribe 回调接收） */
   sendStreamRequest(methodId: number, args?: IArguments | unknown[]): void;
   subscribe<T = unknown>(methodId: number, cb: (data: T) => void): void;
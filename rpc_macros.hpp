@@ -17,6 +17,22 @@
 /* ---------- 基础类型 ---------- */
 typedef char *string;
 
+/**
+ * 字符串视图（线上编码与 string 相同）：解码时直接指向接收帧，不拷贝、不截断，
+ * 不以 NUL 结尾，仅在 handler 执行期间有效；编码时按 len 写入，不做 strlen
+ */
+struct rpc_strview {
+    const char *ptr;
+    size_t len;
+};
+typedef rpc_strview strview;
+
+/* 定宽数值类型（线上编码见 esprpc_binary.h）；int32 与 int 等价 */
+typedef int int32;
+typedef uint32_t uint32;
+typedef int64_t int64;
+typedef uint64_t uint64;
+
 /* ---------- C++ 模板 ---------- */
 template<typename T>
 struct rpc_optional {
@@ -42,18 +58,46 @@ struct rpc_stream {
     void *ctx;  /* 流上下文，供 esprpc_stream_emit 等使用 */
 };
 
+/**
+ * 分页列表游标（PAGED(T) 方法的返回值）：dispatch 反复调用 next 取下一个元素，攒满一页即编码发送，
+ * 元素无需整体驻留内存；next 写出的字符串/数组只需在下一次调用 next 前有效
+ */
+template<typename T>
+struct rpc_cursor {
+    bool (*next)(void *ctx, T *out);  /* 写出下一个元素返回 true，没有更多时返回 false */
+    void *ctx;
+};
+
 #define OPTIONAL(type) rpc_optional<type>
 #define REQUIRED(type) type
 #define VOID void
 #define LIST(type) rpc_list<type>
+/** 带解码上限的 LIST：线上 count 超过 max 时请求解码失败（未指定时用 CONFIG_ESPRPC_LIST_MAX_ITEMS） */
+#define LIST_MAX(type, max) rpc_list<type>
 #define MAP(key, value) rpc_map<key, value>
 
 /* 类型别名（兼容生成器/impl） */
 typedef rpc_optional<char *> string_optional;
 typedef rpc_list<char *> string_list;
 typedef rpc_map<char *, char *> map_string_string;
+typedef rpc_optional<strview> strview_optional;
+typedef rpc_list<strview> strview_list;
 typedef rpc_optional<int> int_optional;
 typedef rpc_list<int> int_list;
+typedef rpc_optional<bool> bool_optional;
+typedef rpc_list<bool> bool_list;
+typedef rpc_optional<int32> int32_optional;
+typedef rpc_list<int32> int32_list;
+typedef rpc_optional<uint32> uint32_optional;
+typedef rpc_list<uint32> uint32_list;
+typedef rpc_optional<int64> int64_optional;
+typedef rpc_list<int64> int64_list;
+typedef rpc_optional<uint64> uint64_optional;
+typedef rpc_list<uint64> uint64_list;
+typedef rpc_optional<float> float_optional;
+typedef rpc_list<float> float_list;
+typedef rpc_optional<double> double_optional;
+typedef rpc_list<double> double_list;
 
 /* ---------- 服务定义 ---------- */
 #define RPC_SERVICE(name) typedef struct name {
@@ -75,7 +119,14 @@ typedef rpc_list<int> int_list;
 
 #define STREAM(type) rpc_stream<type>
 
+/** 分页返回的列表：线上按页（"paged:N"，缺省 16 个元素一页）发送，客户端拼回完整 LIST */
+#define PAGED(type) rpc_cursor<type>
+
 /** 结构体 LIST 类型定义：RPC_LIST_TYPEDEF(User) -> User_list */
 #define RPC_LIST_TYPEDEF(T) typedef rpc_list<T> T##_list;
 
+/* ---------- 编码选项（仅供生成器读取） ---------- */
+/** 整数线上编码：RPC_INT_ENCODING(fixed) 为 4B LE（默认），RPC_INT_ENCODING(varint) 为 zigzag varint */
+#define RPC_INT_ENCODING(mode)
+
 #endif /* RPC_MACROS_HPP */
@@ -15,12 +15,13 @@
 #include "sdkconfig.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/semphr.h"
+#include <stdbool.h>
 #include <string.h>
 #include <stdlib.h>
 #include "esp_log.h"
 
-#ifndef CONFIG_ESPRPC_POOL_BLOCK_SIZE
-#define CONFIG_ESPRPC_POOL_BLOCK_SIZE 2048
+#ifndef CONFIG_ESPRPC_ARENA_SIZE
+#define CONFIG_ESPRPC_ARENA_SIZE 2048
 #endif
 
 static const char *TAG = "esprpc";
@@ -28,29 +29,39 @@ static const char *TAG = "esprpc";
 #define MAX_TRANSPORTS 4   /* 最大传输层数量 */
 #define MAX_SERVICES 8     /* 最大服务数量 */
 
-/** 块头：释放后复用为 free 链表 next */
-typedef struct {
+/** 块头：空闲时为 free 链表 next；esprpc_buf_alloc 分配出的块记录引用计数与来源 */
+typedef union {
     void *next;
+    struct {
+        uint16_t refs;
+        uint16_t pooled;  /* 1=取自帧池，0=超过块大小时直接 malloc */
+    } buf;
 } pool_block_t;
 #define POOL_HEADER_SIZE ((size_t)sizeof(pool_block_t))
 
 /** 内存池：固定大小块分配，释放的块放入 free 链表复用 */
-static pool_block_t *s_pool_free; /* 空闲块链表 */
-static SemaphoreHandle_t s_pool_mutex;
+typedef struct {
+    pool_block_t *free;       /* 空闲块链表 */
+    SemaphoreHandle_t mutex;
+    size_t block_size;        /* 每块可用字节数（不含块头） */
+} block_pool_t;
 
-static void *pool_malloc(void)
+static block_pool_t s_frame_pool = { NULL, NULL, CONFIG_ESPRPC_POOL_BLOCK_SIZE }; /* 响应/流帧 */
+static block_pool_t s_arena_pool = { NULL, NULL, CONFIG_ESPRPC_ARENA_SIZE };      /* 请求解码 arena */
+
+static void *pool_malloc_from(block_pool_t *pool)
 {
-    if (xSemaphoreTake(s_pool_mutex, portMAX_DELAY) != pdTRUE) {
+    if (xSemaphoreTake(pool->mutex, portMAX_DELAY) != pdTRUE) {
         return NULL;
     }
 
-    size_t total = POOL_HEADER_SIZE + (size_t)CONFIG_ESPRPC_POOL_BLOCK_SIZE;
+    size_t total = POOL_HEADER_SIZE + pool->block_size;
     void *out = NULL;
 
     /* 从 free 链表取一个块 */
-    if (s_pool_free) {
-        pool_block_t *b = s_pool_free;
-        s_pool_free = (pool_block_t *)b->next;
+    if (pool->free) {
+        pool_block_t *b = pool->free;
+        pool->free = (pool_block_t *)b->next;
         out = (char *)b + POOL_HEADER_SIZE;
         goto done;
     }
@@ -62,18 +73,92 @@ static void *pool_malloc(void)
     }
 
 done:
-    xSemaphoreGive(s_pool_mutex);
+    xSemaphoreGive(pool->mutex);
     return out;
 }
 
-static void pool_free(void *ptr)
+static void pool_free_to(block_pool_t *pool, void *ptr)
 {
     if (!ptr) return;
-    if (xSemaphoreTake(s_pool_mutex, portMAX_DELAY) != pdTRUE) return;
+    if (xSemaphoreTake(pool->mutex, portMAX_DELAY) != pdTRUE) return;
     pool_block_t *b = (pool_block_t *)((char *)ptr - POOL_HEADER_SIZE);
-    b->next = s_pool_free;
-    s_pool_free = b;
-    xSemaphoreGive(s_pool_mutex);
+    b->next = pool->free;
+    pool->free = b;
+    xSemaphoreGive(pool->mutex);
+}
+
+static esp_err_t pool_init(block_pool_t *pool)
+{
+    pool->free = NULL;
+    pool->mutex = xSemaphoreCreateMutex();
+    return pool->mutex ? ESP_OK : ESP_ERR_NO_MEM;
+}
+
+static void pool_deinit(block_pool_t *pool)
+{
+    if (pool->mutex) {
+        vSemaphoreDelete(pool->mutex);
+        pool->mutex = NULL;
+    }
+    /* 释放 free 链表中的所有块 */
+    while (pool->free) {
+        pool_block_t *b = pool->free;
+        pool->free = (pool_block_t *)b->next;
+        free(b);
+    }
+}
+
+static void *pool_malloc(void)
+{
+    return pool_malloc_from(&s_frame_pool);
+}
+
+static void pool_free(void *ptr)
+{
+    pool_free_to(&s_frame_pool, ptr);
+}
+
+/* ---------- 引用计数帧缓冲 ---------- */
+
+void *esprpc_buf_alloc(size_t len)
+{
+    pool_block_t *b;
+    if (len <= s_frame_pool.block_size) {
+        void *p = pool_malloc();
+        if (!p) return NULL;
+        b = (pool_block_t *)((char *)p - POOL_HEADER_SIZE);
+        b->buf.pooled = 1;
+    } else {
+        b = (pool_block_t *)malloc(POOL_HEADER_SIZE + len);
+        if (!b) return NULL;
+        b->buf.pooled = 0;
+    }
+    b->buf.refs = 1;
+    return (char *)b + POOL_HEADER_SIZE;
+}
+
+void esprpc_buf_ref(void *buf)
+{
+    if (!buf) return;
+    pool_block_t *b = (pool_block_t *)((char *)buf - POOL_HEADER_SIZE);
+    xSemaphoreTake(s_frame_pool.mutex, portMAX_DELAY);
+    b->buf.refs++;
+    xSemaphoreGive(s_frame_pool.mutex);
+}
+
+void esprpc_buf_unref(void *buf)
+{
+    if (!buf) return;
+    pool_block_t *b = (pool_block_t *)((char *)buf - POOL_HEADER_SIZE);
+    xSemaphoreTake(s_frame_pool.mutex, portMAX_DELAY);
+    bool last = --b->buf.refs == 0;
+    xSemaphoreGive(s_frame_pool.mutex);
+    if (!last) return;
+    if (b->buf.pooled) {
+        pool_free(buf);
+    } else {
+        free(b);
+    }
 }
 
 /** 已注册服务条目 */
@@ -111,10 +196,10 @@ esp_err_t esprpc_init(void)
     s_service_count = 0;
     s_transport_count = 0;
     s_on_recv = NULL;
-    s_pool_free = NULL;
-    s_pool_mutex = xSemaphoreCreateMutex();
-    if (s_pool_mutex == NULL) {
+    if (pool_init(&s_frame_pool) != ESP_OK || pool_init(&s_arena_pool) != ESP_OK) {
         ESP_LOGE(TAG, "Failed to create pool mutex");
+        pool_deinit(&s_frame_pool);
+        pool_deinit(&s_arena_pool);
         return ESP_ERR_NO_MEM;
     }
     ESP_LOGI(TAG, "RPC initialized");
@@ -123,17 +208,8 @@ esp_err_t esprpc_init(void)
 
 void esprpc_deinit(void)
 {
-    if (s_pool_mutex) {
-        vSemaphoreDelete(s_pool_mutex);
-        s_pool_mutex = NULL;
-    }
-    /* 释放 free 链表中的所有块 */
-    while (s_pool_free) {
-        pool_block_t *b = s_pool_free;
-        s_pool_free = (pool_block_t *)b->next;
-        free(b);
-    }
-    s_pool_free = NULL;
+    pool_deinit(&s_frame_pool);
+    pool_deinit(&s_arena_pool);
     s_service_count = 0;
     s_transport_count = 0;
     s_on_recv = NULL;
@@ -197,14 +273,95 @@ esp_err_t esprpc_send(const uint8_t *data, size_t len)
 {
     esp_err_t err = ESP_OK;
     for (int i = 0; i < s_transport_count; i++) {
-        if (s_transports[i] && s_transports[i]->send) {
-            esp_err_t e = s_transports[i]->send(s_transports[i]->ctx, data, len);
-            if (e != ESP_OK) err = e;
+        esprpc_transport_t *t = s_transports[i];
+        if (!t) continue;
+        esp_err_t e = ESP_OK;
+        if (t->send) {
+            e = t->send(t->ctx, data, len);
+        } else if (t->sendv) {
+            esprpc_iovec_t iov = { data, len };
+            e = t->sendv(t->ctx, &iov, 1);
         }
+        if (e != ESP_OK) err = e;
     }
     return err;
 }
 
+/** 用一个传输发送一帧：支持 sendv 时直接交出各段，否则拼接到池块（*flat，多个传输共用一次拼接）后 send */
+static esp_err_t transport_sendv(esprpc_transport_t *t, const esprpc_iovec_t *iov, size_t iovcnt,
+                                 size_t total, uint8_t **flat)
+{
+    if (t->sendv) {
+        return t->sendv(t->ctx, iov, iovcnt);
+    }
+    if (!t->send) {
+        return ESP_OK;
+    }
+    if (!*flat) {
+        if (total > CONFIG_ESPRPC_POOL_BLOCK_SIZE) {
+            ESP_LOGE(TAG, "Frame too large for pool block (%zu > %d), drop", total,
+                     (int)CONFIG_ESPRPC_POOL_BLOCK_SIZE);
+            return ESP_ERR_INVALID_SIZE;
+        }
+        *flat = (uint8_t *)pool_malloc();
+        if (!*flat) {
+            ESP_LOGE(TAG, "Failed to alloc frame buffer");
+            return ESP_ERR_NO_MEM;
+        }
+        size_t off = 0;
+        for (size_t k = 0; k < iovcnt; k++) {
+            if (iov[k].len) memcpy(*flat + off, iov[k].base, iov[k].len);
+            off += iov[k].len;
+        }
+    }
+    return t->send(t->ctx, *flat, total);
+}
+
+esp_err_t esprpc_sendv(const esprpc_iovec_t *iov, size_t iovcnt)
+{
+    size_t total = 0;
+    for (size_t k = 0; k < iovcnt; k++) total += iov[k].len;
+
+    esp_err_t err = ESP_OK;
+    uint8_t *flat = NULL;  /* 不支持 sendv 的传输共用一次拼接结果 */
+    for (int i = 0; i < s_transport_count; i++) {
+        esprpc_transport_t *t = s_transports[i];
+        if (!t) continue;
+        esp_err_t e = transport_sendv(t, iov, iovcnt, total, &flat);
+        if (e != ESP_OK) err = e;
+    }
+    if (flat) pool_free(flat);
+    return err;
+}
+
+/** 把 arena 所属请求的响应帧发回来源：有 reply_route 的对端时用 sendv_to，其次整个来源传输，来源未知时广播 */
+static esp_err_t send_reply(const esprpc_arena_t *req, const esprpc_iovec_t *iov, size_t iovcnt)
+{
+    esprpc_transport_t *t = req->req_transport;
+    if (!t) {
+        return esprpc_sendv(iov, iovcnt);
+    }
+    if (req->req_routed && t->sendv_to) {
+        return t->sendv_to(t->ctx, req->req_route, iov, iovcnt);
+    }
+    size_t total = 0;
+    for (size_t k = 0; k < iovcnt; k++) total += iov[k].len;
+    uint8_t *flat = NULL;
+    esp_err_t err = transport_sendv(t, iov, iovcnt, total, &flat);
+    if (flat) pool_free(flat);
+    return err;
+}
+
+/** 写 5 字节帧头 [method_id][invoke_id LE][payload_len LE] */
+static void frame_header(uint8_t hdr[5], uint8_t method_id, uint16_t invoke_id, size_t payload_len)
+{
+    hdr[0] = method_id;
+    hdr[1] = (uint8_t)(invoke_id & 0xFF);
+    hdr[2] = (uint8_t)((invoke_id >> 8) & 0xFF);
+    hdr[3] = (uint8_t)(payload_len & 0xFF);
+    hdr[4] = (uint8_t)((payload_len >> 8) & 0xFF);
+}
+
 void esprpc_set_stream_method_id(uint16_t method_id)
 {
     s_stream_method_id = method_id;
@@ -217,22 +374,27 @@ uint16_t esprpc_get_stream_method_id(void)
 
 esp_err_t esprpc_stream_emit(uint16_t method_id, const uint8_t *data, size_t len)
 {
-    if (5 + len > CONFIG_ESPRPC_POOL_BLOCK_SIZE) {
-        ESP_LOGE(TAG, "Stream data too large (%zu > %d), drop", 5 + len,
-                 (int)CONFIG_ESPRPC_POOL_BLOCK_SIZE);
-        return ESP_ERR_NO_MEM;
+    if (len > 0xFFFF) {
+        ESP_LOGE(TAG, "Stream data too large (%zu > 65535), drop", len);
+        return ESP_ERR_INVALID_SIZE;
     }
-    uint8_t *frame = (uint8_t *)pool_malloc();
-    if (!frame) return ESP_ERR_NO_MEM;
-    frame[0] = (uint8_t)(method_id & 0xFF);
-    frame[1] = 0;  /* invoke_id = 0 表示流式推送 */
-    frame[2] = 0;
-    frame[3] = (uint8_t)(len & 0xFF);
-    frame[4] = (uint8_t)((len >> 8) & 0xFF);
-    memcpy(frame + 5, data, len);
-    esp_err_t err = esprpc_send(frame, 5 + len);
-    pool_free(frame);
-    return err;
+    uint8_t hdr[5];
+    frame_header(hdr, (uint8_t)(method_id & 0xFF), 0, len);  /* invoke_id = 0 表示流式推送 */
+    esprpc_iovec_t iov[2] = { { hdr, sizeof(hdr) }, { data, len } };
+    return esprpc_sendv(iov, 2);
+}
+
+esp_err_t esprpc_send_partial(const esprpc_arena_t *req, const uint8_t *data, size_t len)
+{
+    if (!req || !req->has_req) return ESP_ERR_INVALID_STATE;
+    if (len > 0xFFFF) {
+        ESP_LOGE(TAG, "Partial response too large (%zu > 65535), drop", len);
+        return ESP_ERR_INVALID_SIZE;
+    }
+    uint8_t hdr[5];
+    frame_header(hdr, req->req_method_id, req->req_invoke_id, len);
+    esprpc_iovec_t iov[2] = { { hdr, sizeof(hdr) }, { data, len } };
+    return send_reply(req, iov, 2);
 }
 
 /* ---------- 请求处理 ---------- */
@@ -242,8 +404,9 @@ esp_err_t esprpc_stream_emit(uint16_t method_id, const uint8_t *data, size_t len
  * 帧格式: [1B method_id][2B invoke_id LE][2B payload_len LE][N bytes payload]
  * method_id: 高 3 位=服务索引, 低 5 位=方法索引
  * invoke_id: 调用 ID，响应帧回显以匹配并发请求
+ * transport: 收到请求的传输，响应只发回它；NULL 时广播给全部传输
  */
-void esprpc_handle_request(const uint8_t *data, size_t len)
+void esprpc_handle_request_from(esprpc_transport_t *transport, const uint8_t *data, size_t len)
 {
     if (len < 5) return;
 
@@ -261,32 +424,47 @@ void esprpc_handle_request(const uint8_t *data, size_t len)
         uint8_t *resp_buf = NULL;
         size_t resp_len = 0;
         uint16_t full_id = (uint16_t)(svc_idx << 5) | mth_idx;
+        /* 每个请求独占一个 arena 块，解码可重入；响应发出后整块归还 */
+        void *arena_buf = pool_malloc_from(&s_arena_pool);
+        if (!arena_buf) {
+            ESP_LOGE(TAG, "Failed to alloc request arena");
+            return;
+        }
+        esprpc_arena_t arena;
+        esprpc_arena_init(&arena, arena_buf, s_arena_pool.block_size);
+        arena.has_req = true;
+        arena.req_method_id = method_id;
+        arena.req_invoke_id = invoke_id;
+        arena.req_transport = transport;
+        /* 须在收包回调中取：多对端传输据此把响应（含其他任务发出的中间页）发回发起请求的对端 */
+        if (transport && transport->reply_route &&
+            transport->reply_route(transport->ctx, &arena.req_route) == ESP_OK) {
+            arena.req_routed = true;
+        }
         int ret = s_services[svc_idx].dispatch(full_id, payload, payload_len,
                                               &resp_buf, &resp_len,
-                                              s_services[svc_idx].impl);
-        /* 构造响应帧并广播到所有传输（回显 invoke_id）；使用固定大小池缓冲区 */
+                                              s_services[svc_idx].impl, &arena);
+        if (ret != 0) {
+            ESP_LOGW(TAG, "Dispatch failed for method 0x%02x (arena used %zu/%zu)", method_id,
+                     arena.used, arena.cap);
+        }
+        /* 帧头与响应分段交给传输（回显 invoke_id），不做拼接拷贝 */
         if (ret == 0 && resp_buf && resp_len > 0) {
-            size_t frame_len = 5 + resp_len;
-            if (frame_len > CONFIG_ESPRPC_POOL_BLOCK_SIZE) {
-                ESP_LOGE(TAG, "Response frame too large (%zu > %d), drop", frame_len,
-                         (int)CONFIG_ESPRPC_POOL_BLOCK_SIZE);
-                free(resp_buf);
+            if (resp_len > 0xFFFF) {
+                ESP_LOGE(TAG, "Response too large (%zu > 65535), drop", resp_len);
             } else {
-                uint8_t *frame = (uint8_t *)pool_malloc();
-                if (frame) {
-                    frame[0] = method_id;
-                    frame[1] = invoke_id & 0xFF;
-                    frame[2] = (invoke_id >> 8) & 0xFF;
-                    frame[3] = resp_len & 0xFF;
-                    frame[4] = (resp_len >> 8) & 0xFF;
-                    memcpy(frame + 5, resp_buf, resp_len);
-                    esprpc_send(frame, frame_len);
-                    pool_free(frame);
-                } else {
-                    ESP_LOGE(TAG, "Failed to alloc response frame buffer");
-                }
-                free(resp_buf);
+                uint8_t hdr[5];
+                frame_header(hdr, method_id, invoke_id, resp_len);
+                esprpc_iovec_t iov[2] = { { hdr, sizeof(hdr) }, { resp_buf, resp_len } };
+                send_reply(&arena, iov, 2);
             }
         }
+        free(resp_buf); /* 失败时 dispatch 也可能已分配（序列化中途出错） */
+        pool_free_to(&s_arena_pool, arena_buf);
     }
 }
+
+void esprpc_handle_request(const uint8_t *data, size_t len)
+{
+    esprpc_handle_request_from(NULL, data, len);
+}
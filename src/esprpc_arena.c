@@ -0,0 +1,34 @@
+/**
+ * @file esprpc_arena.c
+ * @brief 单次请求 bump 分配器实现
+ */
+
+#include "esprpc_arena.h"
+#include <string.h>
+
+void esprpc_arena_init(esprpc_arena_t *a, void *buf, size_t cap)
+{
+    a->base = (uint8_t *)buf;
+    a->cap = buf ? cap : 0;
+    a->used = 0;
+    a->has_req = false;
+    a->req_method_id = 0;
+    a->req_invoke_id = 0;
+    a->req_transport = NULL;
+    a->req_routed = false;
+    a->req_route = 0;
+}
+
+int esprpc_arena_read_str(esprpc_arena_t *a, const uint8_t **p, const uint8_t *end, char **out)
+{
+    if (*p + 2 > end) return -1;
+    uint16_t len = (uint16_t)(*p)[0] | ((uint16_t)(*p)[1] << 8);
+    if ((size_t)(end - (*p + 2)) < len) return -1;
+    char *s = (char *)esprpc_arena_alloc(a, (size_t)len + 1);
+    if (!s) return -1;
+    memcpy(s, *p + 2, len);
+    s[len] = 0;
+    *out = s;
+    *p += 2 + len;
+    return 0;
+}
@@ -6,6 +6,72 @@
 #include "esprpc_binary.h"
 #include <string.h>
 
+/* 线上格式为小端；本机同为小端时数组可整体 memcpy（ESP32 / x86 均满足），否则逐元素翻转字节序 */
+#if defined(__BYTE_ORDER__) && defined(__ORDER_LITTLE_ENDIAN__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#define ESPRPC_BIN_NATIVE_LE 1
+#else
+#define ESPRPC_BIN_NATIVE_LE 0
+#endif
+
+_Static_assert(sizeof(int) == 4, "esprpc 二进制协议要求 32 位 int");
+_Static_assert(sizeof(float) == 4 && sizeof(double) == 8, "esprpc 二进制协议要求 IEEE754 float/double");
+
+/** 读取 size 字节小端无符号整数 */
+static inline uint64_t bin_load_le(const uint8_t *src, size_t size)
+{
+    uint64_t v = 0;
+    for (size_t i = 0; i < size; i++) {
+        v |= (uint64_t)src[i] << (8 * i);
+    }
+    return v;
+}
+
+/** 写入 size 字节小端无符号整数 */
+static inline void bin_store_le(uint8_t *dst, uint64_t v, size_t size)
+{
+    for (size_t i = 0; i < size; i++) {
+        dst[i] = (uint8_t)(v >> (8 * i));
+    }
+}
+
+/** 拷贝 n 个 size 字节元素，线上小端 <-> 本机字节序 */
+static void bin_copy_le_array(uint8_t *dst, const uint8_t *src, size_t n, size_t size)
+{
+#if ESPRPC_BIN_NATIVE_LE
+    memcpy(dst, src, n * size);
+#else
+    for (size_t i = 0; i < n; i++) {
+        for (size_t b = 0; b < size; b++) {
+            dst[i * size + b] = src[i * size + (size - 1 - b)];
+        }
+    }
+#endif
+}
+
+/** n 个 size 字节元素能否放入 [p, end)，避免 n * size 溢出 */
+static inline bool bin_fits(const uint8_t *p, const uint8_t *end, size_t n, size_t size)
+{
+    return p <= end && n <= (size_t)(end - p) / size;
+}
+
+static int bin_read_le_array(const uint8_t **p, const uint8_t *end, void *out, size_t n, size_t size)
+{
+    if (!bin_fits(*p, end, n, size)) return -1;
+    if (n == 0) return 0;
+    bin_copy_le_array((uint8_t *)out, *p, n, size);
+    *p += n * size;
+    return 0;
+}
+
+static int bin_write_le_array(uint8_t **p, const uint8_t *end, const void *v, size_t n, size_t size)
+{
+    if (!bin_fits(*p, end, n, size)) return -1;
+    if (n == 0) return 0;
+    bin_copy_le_array(*p, (const uint8_t *)v, n, size);
+    *p += n * size;
+    return 0;
+}
+
 int esprpc_bin_read_i32(const uint8_t **p, const uint8_t *end, int *out)
 {
     if (*p + 4 > end) return -1;
@@ -22,6 +88,131 @@ int esprpc_bin_read_u32(const uint8_t **p, const uint8_t *end, uint32_t *out)
     return 0;
 }
 
+int esprpc_bin_read_i64(const uint8_t **p, const uint8_t *end, int64_t *out)
+{
+    if (*p + 8 > end) return -1;
+    *out = (int64_t)bin_load_le(*p, 8);
+    *p += 8;
+    return 0;
+}
+
+int esprpc_bin_read_u64(const uint8_t **p, const uint8_t *end, uint64_t *out)
+{
+    if (*p + 8 > end) return -1;
+    *out = bin_load_le(*p, 8);
+    *p += 8;
+    return 0;
+}
+
+int esprpc_bin_read_f32(const uint8_t **p, const uint8_t *end, float *out)
+{
+    if (*p + 4 > end) return -1;
+    uint32_t bits = (uint32_t)bin_load_le(*p, 4);
+    memcpy(out, &bits, 4);
+    *p += 4;
+    return 0;
+}
+
+int esprpc_bin_read_f64(const uint8_t **p, const uint8_t *end, double *out)
+{
+    if (*p + 8 > end) return -1;
+    uint64_t bits = bin_load_le(*p, 8);
+    memcpy(out, &bits, 8);
+    *p += 8;
+    return 0;
+}
+
+int esprpc_bin_read_varint_u32(const uint8_t **p, const uint8_t *end, uint32_t *out)
+{
+    uint32_t v = 0;
+    const uint8_t *q = *p;
+    for (int shift = 0; shift < 35; shift += 7) {
+        if (q >= end) return -1;
+        uint8_t b = *q++;
+        if (shift == 28 && (b & 0xf0)) return -1; /* 超出 32 位 */
+        v |= (uint32_t)(b & 0x7f) << shift;
+        if (!(b & 0x80)) {
+            *out = v;
+            *p = q;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+int esprpc_bin_read_varint_i32(const uint8_t **p, const uint8_t *end, int *out)
+{
+    uint32_t u = 0;
+    if (esprpc_bin_read_varint_u32(p, end, &u) != 0) return -1;
+    *out = (int)((u >> 1) ^ (0u - (u & 1)));
+    return 0;
+}
+
+int esprpc_bin_read_varint_u64(const uint8_t **p, const uint8_t *end, uint64_t *out)
+{
+    uint64_t v = 0;
+    const uint8_t *q = *p;
+    for (int shift = 0; shift < 70; shift += 7) {
+        if (q >= end) return -1;
+        uint8_t b = *q++;
+        if (shift == 63 && (b & 0xfe)) return -1; /* 超出 64 位 */
+        v |= (uint64_t)(b & 0x7f) << shift;
+        if (!(b & 0x80)) {
+            *out = v;
+            *p = q;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+int esprpc_bin_read_varint_i64(const uint8_t **p, const uint8_t *end, int64_t *out)
+{
+    uint64_t u = 0;
+    if (esprpc_bin_read_varint_u64(p, end, &u) != 0) return -1;
+    *out = (int64_t)((u >> 1) ^ (0ull - (u & 1)));
+    return 0;
+}
+
+int esprpc_bin_read_i32_array(const uint8_t **p, const uint8_t *end, int *out, size_t n)
+{
+    return bin_read_le_array(p, end, out, n, 4);
+}
+
+int esprpc_bin_read_u32_array(const uint8_t **p, const uint8_t *end, uint32_t *out, size_t n)
+{
+    return bin_read_le_array(p, end, out, n, 4);
+}
+
+int esprpc_bin_read_i64_array(const uint8_t **p, const uint8_t *end, int64_t *out, size_t n)
+{
+    return bin_read_le_array(p, end, out, n, 8);
+}
+
+int esprpc_bin_read_u64_array(const uint8_t **p, const uint8_t *end, uint64_t *out, size_t n)
+{
+    return bin_read_le_array(p, end, out, n, 8);
+}
+
+int esprpc_bin_read_f32_array(const uint8_t **p, const uint8_t *end, float *out, size_t n)
+{
+    return bin_read_le_array(p, end, out, n, 4);
+}
+
+int esprpc_bin_read_f64_array(const uint8_t **p, const uint8_t *end, double *out, size_t n)
+{
+    return bin_read_le_array(p, end, out, n, 8);
+}
+
+int esprpc_bin_skip(const uint8_t **p, const uint8_t *end, size_t n, size_t elem_size)
+{
+    if (*p > end) return -1;
+    if (n == 0 || elem_size == 0) return 0;
+    if (n > (size_t)(end - *p) / elem_size) return -1;
+    *p += n * elem_size;
+    return 0;
+}
+
 int esprpc_bin_read_bool(const uint8_t **p, const uint8_t *end, bool *out)
 {
     if (*p + 1 > end) return -1;
@@ -42,6 +233,17 @@ int esprpc_bin_read_str(const uint8_t **p, const uint8_t *end, char *buf, size_t
     return 0;
 }
 
+int esprpc_bin_read_str_view(const uint8_t **p, const uint8_t *end, const char **out, size_t *out_len)
+{
+    if (*p + 2 > end) return -1;
+    uint16_t len = (uint16_t)(*p)[0] | ((uint16_t)(*p)[1] << 8);
+    if ((size_t)(end - (*p + 2)) < len) return -1;
+    *out = (const char *)(*p + 2);
+    *out_len = len;
+    *p += 2 + len;
+    return 0;
+}
+
 int esprpc_bin_read_optional_tag(const uint8_t **p, const uint8_t *end, bool *present)
 {
     if (*p + 1 > end) return -1;
@@ -72,6 +274,42 @@ int esprpc_bin_write_u32(uint8_t **p, const uint8_t *end, uint32_t v)
     return 0;
 }
 
+int esprpc_bin_write_i64(uint8_t **p, const uint8_t *end, int64_t v)
+{
+    if (*p + 8 > end) return -1;
+    bin_store_le(*p, (uint64_t)v, 8);
+    *p += 8;
+    return 0;
+}
+
+int esprpc_bin_write_u64(uint8_t **p, const uint8_t *end, uint64_t v)
+{
+    if (*p + 8 > end) return -1;
+    bin_store_le(*p, v, 8);
+    *p += 8;
+    return 0;
+}
+
+int esprpc_bin_write_f32(uint8_t **p, const uint8_t *end, float v)
+{
+    if (*p + 4 > end) return -1;
+    uint32_t bits;
+    memcpy(&bits, &v, 4);
+    bin_store_le(*p, bits, 4);
+    *p += 4;
+    return 0;
+}
+
+int esprpc_bin_write_f64(uint8_t **p, const uint8_t *end, double v)
+{
+    if (*p + 8 > end) return -1;
+    uint64_t bits;
+    memcpy(&bits, &v, 8);
+    bin_store_le(*p, bits, 8);
+    *p += 8;
+    return 0;
+}
+
 int esprpc_bin_write_bool(uint8_t **p, const uint8_t *end, bool v)
 {
     if (*p + 1 > end) return -1;
@@ -83,11 +321,15 @@ int esprpc_bin_write_bool(uint8_t **p, const uint8_t *end, bool v)
 int esprpc_bin_write_str(uint8_t **p, const uint8_t *end, const char *s)
 {
     if (!s) s = "";
-    size_t len = strlen(s);
-    if (len > 65535 || *p + 2 + len > end) return -1;
+    return esprpc_bin_write_strn(p, end, s, strlen(s));
+}
+
+int esprpc_bin_write_strn(uint8_t **p, const uint8_t *end, const char *s, size_t len)
+{
+    if (len > 65535 || (size_t)(end - *p) < 2 + len) return -1;
     (*p)[0] = (uint8_t)(len & 0xff);
     (*p)[1] = (uint8_t)((len >> 8) & 0xff);
-    memcpy(*p + 2, s, len);
+    if (len > 0) memcpy(*p + 2, s, len);
     *p += 2 + len;
     return 0;
 }
@@ -99,3 +341,61 @@ int esprpc_bin_write_optional_tag(uint8_t **p, const uint8_t *end, bool present)
     *p += 1;
     return 0;
 }
+
+int esprpc_bin_write_i32_array(uint8_t **p, const uint8_t *end, const int *v, size_t n)
+{
+    return bin_write_le_array(p, end, v, n, 4);
+}
+
+int esprpc_bin_write_u32_array(uint8_t **p, const uint8_t *end, const uint32_t *v, size_t n)
+{
+    return bin_write_le_array(p, end, v, n, 4);
+}
+
+int esprpc_bin_write_i64_array(uint8_t **p, const uint8_t *end, const int64_t *v, size_t n)
+{
+    return bin_write_le_array(p, end, v, n, 8);
+}
+
+int esprpc_bin_write_u64_array(uint8_t **p, const uint8_t *end, const uint64_t *v, size_t n)
+{
+    return bin_write_le_array(p, end, v, n, 8);
+}
+
+int esprpc_bin_write_f32_array(uint8_t **p, const uint8_t *end, const float *v, size_t n)
+{
+    return bin_write_le_array(p, end, v, n, 4);
+}
+
+int esprpc_bin_write_f64_array(uint8_t **p, const uint8_t *end, const double *v, size_t n)
+{
+    return bin_write_le_array(p, end, v, n, 8);
+}
+
+int esprpc_bin_write_varint_u32(uint8_t **p, const uint8_t *end, uint32_t v)
+{
+    return esprpc_bin_write_varint_u64(p, end, v);
+}
+
+int esprpc_bin_write_varint_i32(uint8_t **p, const uint8_t *end, int v)
+{
+    return esprpc_bin_write_varint_u32(p, end, esprpc_bin_zigzag32(v));
+}
+
+int esprpc_bin_write_varint_u64(uint8_t **p, const uint8_t *end, uint64_t v)
+{
+    if (*p + esprpc_bin_varint_u64_size(v) > end) return -1;
+    uint8_t *q = *p;
+    while (v >= 0x80) {
+        *q++ = (uint8_t)(v | 0x80);
+        v >>= 7;
+    }
+    *q++ = (uint8_t)v;
+    *p = q;
+    return 0;
+}
+
+int esprpc_bin_write_varint_i64(uint8_t **p, const uint8_t *end, int64_t v)
+{
+    return esprpc_bin_write_varint_u64(p, end, esprpc_bin_zigzag64(v));
+}
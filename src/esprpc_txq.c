@@ -0,0 +1,212 @@
+/**
+ * @file esprpc_txq.c
+ * @brief 传输层发送队列：帧拷贝到引用计数帧缓冲后入队，由独立任务调用被包装传输发送
+ */
+
+#include "esprpc_transport.h"
+#include "esprpc.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include <string.h>
+#include <stdlib.h>
+
+static const char *TAG = "esprpc_txq";
+
+/** 队列项；buf 为 NULL 时通知发送任务退出。routed 时经 inner 的 sendv_to 只发给入队时取得的 route */
+typedef struct {
+    uint8_t *buf;
+    size_t len;
+    bool routed;
+    uint32_t route;
+} txq_item_t;
+
+/** 发送队列上下文，transport 为对外的包装实例（须为首成员，ctx 指回本结构） */
+typedef struct {
+    esprpc_transport_t transport;
+    esprpc_transport_t *inner;
+    QueueHandle_t queue;
+    QueueHandle_t done;  /* 发送任务退出时投递一项，esprpc_txq_destroy 等待后释放资源 */
+    esprpc_txq_overflow_t overflow;
+    volatile uint32_t dropped;
+} txq_t;
+
+static void txq_task(void *arg)
+{
+    txq_t *q = (txq_t *)arg;
+    txq_item_t item;
+    for (;;) {
+        if (xQueueReceive(q->queue, &item, portMAX_DELAY) != pdTRUE) continue;
+        if (!item.buf) break;
+        esprpc_transport_t *t = q->inner;
+        if (item.routed) {
+            esprpc_iovec_t iov = { item.buf, item.len };
+            t->sendv_to(t->ctx, item.route, &iov, 1);
+        } else if (t->sendv) {
+            esprpc_iovec_t iov = { item.buf, item.len };
+            t->sendv(t->ctx, &iov, 1);
+        } else if (t->send) {
+            t->send(t->ctx, item.buf, item.len);
+        }
+        esprpc_buf_unref(item.buf);
+    }
+    uint8_t token = 0;
+    xQueueSend(q->done, &token, portMAX_DELAY);
+    vTaskDelete(NULL);
+}
+
+/** 按溢出策略入队；成功后队列持有 item.buf 的引用 */
+static esp_err_t txq_push(txq_t *q, txq_item_t *item)
+{
+    switch (q->overflow) {
+    case ESPRPC_TXQ_DROP_NEWEST:
+        if (xQueueSend(q->queue, item, 0) == pdTRUE) return ESP_OK;
+        break;
+    case ESPRPC_TXQ_DROP_OLDEST:
+        for (int tries = 0; tries < 4; tries++) {
+            if (xQueueSend(q->queue, item, 0) == pdTRUE) return ESP_OK;
+            txq_item_t old;
+            if (xQueueReceive(q->queue, &old, 0) == pdTRUE) {
+                if (!old.buf) {  /* 不丢弃退出通知 */
+                    xQueueSend(q->queue, &old, portMAX_DELAY);
+                    break;
+                }
+                esprpc_buf_unref(old.buf);
+                q->dropped++;
+            }
+        }
+        break;
+    case ESPRPC_TXQ_BLOCK:
+    default:
+        if (xQueueSend(q->queue, item, portMAX_DELAY) == pdTRUE) return ESP_OK;
+        break;
+    }
+    esprpc_buf_unref(item->buf);
+    q->dropped++;
+    return ESP_ERR_TIMEOUT;
+}
+
+/** 拷贝一帧到帧池缓冲并入队 */
+static esp_err_t txq_enqueue(txq_t *q, const esprpc_iovec_t *iov, size_t iovcnt, bool routed, uint32_t route)
+{
+    size_t total = 0;
+    for (size_t i = 0; i < iovcnt; i++) total += iov[i].len;
+    txq_item_t item = { esprpc_buf_alloc(total ? total : 1), total, routed, route };
+    if (!item.buf) return ESP_ERR_NO_MEM;
+    size_t off = 0;
+    for (size_t i = 0; i < iovcnt; i++) {
+        if (iov[i].len) memcpy(item.buf + off, iov[i].base, iov[i].len);
+        off += iov[i].len;
+    }
+    return txq_push(q, &item);
+}
+
+/** 帧是否为响应（invoke_id≠0），帧头可能跨段 */
+static bool frame_is_response(const esprpc_iovec_t *iov, size_t iovcnt)
+{
+    uint8_t hdr[3];
+    size_t got = 0;
+    for (size_t i = 0; i < iovcnt && got < 3; i++) {
+        const uint8_t *b = (const uint8_t *)iov[i].base;
+        for (size_t j = 0; j < iov[i].len && got < 3; j++) hdr[got++] = b[j];
+    }
+    return got == 3 && (hdr[1] | hdr[2]) != 0;
+}
+
+/** 响应在 inner 的收包回调中入队时顺带取回复目标（发送任务中已无从得知）；流帧照常发给 inner 的全部订阅者 */
+static esp_err_t txq_sendv(void *ctx, const esprpc_iovec_t *iov, size_t iovcnt)
+{
+    txq_t *q = (txq_t *)ctx;
+    esprpc_transport_t *t = q->inner;
+    uint32_t route = 0;
+    bool routed = t->reply_route && t->sendv_to && frame_is_response(iov, iovcnt) &&
+                  t->reply_route(t->ctx, &route) == ESP_OK;
+    return txq_enqueue(q, iov, iovcnt, routed, route);
+}
+
+static esp_err_t txq_sendv_to(void *ctx, uint32_t route, const esprpc_iovec_t *iov, size_t iovcnt)
+{
+    return txq_enqueue((txq_t *)ctx, iov, iovcnt, true, route);
+}
+
+static esp_err_t txq_reply_route(void *ctx, uint32_t *route)
+{
+    esprpc_transport_t *t = ((txq_t *)ctx)->inner;
+    return t->reply_route(t->ctx, route);
+}
+
+static esp_err_t txq_send(void *ctx, const uint8_t *data, size_t len)
+{
+    esprpc_iovec_t iov = { data, len };
+    return txq_sendv(ctx, &iov, 1);
+}
+
+static esp_err_t txq_start(void *ctx, esprpc_transport_on_recv_fn on_recv, void *user_ctx)
+{
+    txq_t *q = (txq_t *)ctx;
+    return q->inner->start ? q->inner->start(q->inner->ctx, on_recv, user_ctx) : ESP_OK;
+}
+
+static void txq_stop(void *ctx)
+{
+    txq_t *q = (txq_t *)ctx;
+    if (q->inner->stop) q->inner->stop(q->inner->ctx);
+}
+
+esprpc_transport_t *esprpc_txq_create(esprpc_transport_t *inner, const esprpc_txq_config_t *cfg)
+{
+    static const esprpc_txq_config_t def = ESPRPC_TXQ_CONFIG_DEFAULT();
+    if (!inner) return NULL;
+    if (!cfg) cfg = &def;
+
+    txq_t *q = (txq_t *)calloc(1, sizeof(txq_t));
+    if (!q) return NULL;
+    q->inner = inner;
+    q->overflow = cfg->overflow;
+    q->queue = xQueueCreate(cfg->depth ? cfg->depth : 1, sizeof(txq_item_t));
+    q->done = xQueueCreate(1, sizeof(uint8_t));
+    if (!q->queue || !q->done) {
+        if (q->queue) vQueueDelete(q->queue);
+        if (q->done) vQueueDelete(q->done);
+        free(q);
+        return NULL;
+    }
+    q->transport.send = txq_send;
+    q->transport.sendv = txq_sendv;
+    q->transport.start = txq_start;
+    q->transport.stop = txq_stop;
+    q->transport.ctx = q;
+    if (inner->reply_route && inner->sendv_to) {
+        q->transport.reply_route = txq_reply_route;
+        q->transport.sendv_to = txq_sendv_to;
+    }
+
+    BaseType_t core = cfg->core_id < 0 ? tskNO_AFFINITY : cfg->core_id;
+    if (xTaskCreatePinnedToCore(txq_task, "esprpc_tx", cfg->stack_size, q, cfg->priority, NULL, core) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create TX task");
+        vQueueDelete(q->queue);
+        vQueueDelete(q->done);
+        free(q);
+        return NULL;
+    }
+    return &q->transport;
+}
+
+void esprpc_txq_destroy(esprpc_transport_t *txq)
+{
+    if (!txq) return;
+    txq_t *q = (txq_t *)txq->ctx;
+    txq_item_t quit = { NULL, 0, false, 0 };
+    xQueueSend(q->queue, &quit, portMAX_DELAY);
+    uint8_t token;
+    xQueueReceive(q->done, &token, portMAX_DELAY);  /* 等任务发完队列中的帧并退出，此后不再引用帧缓冲 */
+    vQueueDelete(q->queue);
+    vQueueDelete(q->done);
+    free(q);
+}
+
+uint32_t esprpc_txq_dropped(const esprpc_transport_t *txq)
+{
+    return txq ? ((const txq_t *)txq->ctx)->dropped : 0;
+}
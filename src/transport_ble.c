@@ -7,12 +7,28 @@
  *
  * 服务 UUID: 0xE5R0 (ESPRPC 自定义)
  * - 特征 TX (写): 客户端 -> ESP32 请求
- * - 特征 RX (通知): ESP32 -> 客户端 响应
+ * - 特征 RX (通知): ESP32 -> 客户端 响应；读取返回当前连接的 ATT MTU（2 字节 LE），客户端据此分段
+ *
+ * 分段：每次写/通知为 [1B 段头][帧的一段]，段头 bit7=后面还有段，bit0-6=段序号（mod 128，首段为 0）。
+ * 每段不超过 ATT MTU - 3 字节；接收端按序号拼回整帧，序号不连续时丢弃该帧。
+ *
+ * 多连接：最多 CONFIG_BT_NIMBLE_MAX_CONNECTIONS 个，有空槽时连接后继续广播。每个连接有独立的
+ * 拼帧缓冲、订阅状态与通知队列。响应只回给发起请求的连接（reply_route 记下连接句柄，其他任务发出的
+ * 分页中间页经 sendv_to 发往该连接）；流帧（invoke_id=0）只发给打开了
+ * RX 通知、且以 invoke_id=0 请求过该方法的连接。
+ *
+ * 通知队列：notify 因 mbuf 不足返回 BLE_HS_ENOMEM 时，该帧（含已发出的段位置）与后续帧按序进入
+ * 本连接的队列并暂停发送。NimBLE 的 NOTIFY_TX 在每次提交时同步上报、不表示 mbuf 已释放，
+ * 因此暂停后由 NPL 定时器（host 任务中执行）重试；期间收到其它成功的 NOTIFY_TX 时提前重试。
  */
 
 #include "esprpc_transport.h"
 #include "esprpc.h"
 #include "esp_log.h"
+#include "sdkconfig.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
 #include <string.h>
 #include <stdlib.h>
 
@@ -39,7 +55,29 @@ static const char *TAG = "esprpc_ble";
 #define ESPRPC_CHR_RX_UUID 0x23, 0xd1, 0xbc, 0xea, 0x5f, 0x78, 0x23, 0x15, \
                            0xde, 0xef, 0x12, 0x12, 0x32, 0xe5, 0x00, 0x00
 
-#define BLE_RPC_FRAME_MAX (512) /* 单帧最大长度，受 MTU 限制 */
+#ifndef CONFIG_ESPRPC_BLE_FRAME_MAX
+#define CONFIG_ESPRPC_BLE_FRAME_MAX 4096
+#endif
+#ifndef CONFIG_ESPRPC_BLE_PREFERRED_MTU
+#define CONFIG_ESPRPC_BLE_PREFERRED_MTU 517
+#endif
+#ifndef CONFIG_ESPRPC_BLE_NOTIFY_QUEUE_LEN
+#define CONFIG_ESPRPC_BLE_NOTIFY_QUEUE_LEN 8
+#endif
+#ifndef CONFIG_ESPRPC_BLE_NOTIFY_RETRY_MS
+#define CONFIG_ESPRPC_BLE_NOTIFY_RETRY_MS 10
+#endif
+#ifndef CONFIG_BT_NIMBLE_MAX_CONNECTIONS
+#define CONFIG_BT_NIMBLE_MAX_CONNECTIONS 1
+#endif
+
+#define BLE_RPC_FRAME_MAX CONFIG_ESPRPC_BLE_FRAME_MAX /* 分段拼回后的单帧最大长度 */
+#define BLE_ATT_VALUE_MAX 512                         /* 单次写/通知的属性值上限 */
+#define BLE_SEG_MORE      0x80                        /* 段头：后面还有段 */
+#define BLE_SEG_SEQ_MASK  0x7F
+#define BLE_TXQ_LEN       CONFIG_ESPRPC_BLE_NOTIFY_QUEUE_LEN  /* 0 表示不排队，拥塞即丢帧 */
+#define BLE_TXQ_SLOTS     (BLE_TXQ_LEN > 0 ? BLE_TXQ_LEN : 1)
+#define BLE_MAX_CONNS     CONFIG_BT_NIMBLE_MAX_CONNECTIONS
 
 static const ble_uuid128_t esprpc_svc_uuid = BLE_UUID128_INIT(
     ESPRPC_SVC_UUID);
@@ -51,13 +89,44 @@ static const ble_uuid128_t esprpc_chr_rx_uuid = BLE_UUID128_INIT(
 static uint16_t chr_tx_val_handle;
 static uint16_t chr_rx_val_handle;
 
-/** BLE 传输上下文 */
+/** 通知队列项：帧拷贝（esprpc_buf）及已发出的位置 */
+typedef struct
+{
+    uint8_t *buf;
+    size_t len;
+    size_t off;   /* 已 notify 的字节数 */
+    uint8_t seq;  /* 下一段序号 */
+} ble_txq_item_t;
+
+/** 单个连接的状态；conn_handle 为 BLE_HS_CONN_HANDLE_NONE 表示空槽 */
 typedef struct
 {
     uint16_t conn_handle;
-    bool connected;
+    bool notify_enabled;         /* 对端已打开 RX 特征的通知（CCCD） */
+    uint32_t subs[8];            /* 以 invoke_id=0 请求过的 method_id 位图，流帧只发给订阅者 */
+    /* 拼帧状态，仅在 host 任务中访问 */
+    uint8_t *rx_buf;             /* 分段拼接中的帧（esprpc_buf_alloc），NULL 表示无 */
+    size_t rx_len;
+    size_t rx_total;             /* 由首段帧头得出的整帧长度 */
+    uint8_t rx_seq;              /* 期望的下一段序号 */
+    /* 发送状态，持有 tx_lock 访问 */
+    ble_txq_item_t txq[BLE_TXQ_SLOTS];
+    uint8_t txq_head;
+    uint8_t txq_count;
+    volatile bool tx_paused;     /* mbuf 不足，等待重试 */
+    struct ble_npl_callout tx_retry;
+} ble_conn_t;
+
+/** BLE 传输上下文 */
+typedef struct
+{
     esprpc_transport_on_recv_fn on_recv;
     void *on_recv_ctx;
+    SemaphoreHandle_t tx_lock;   /* 保护连接槽、订阅、发送状态与下面两项 current_* */
+    ble_conn_t conns[BLE_MAX_CONNS];
+    ble_conn_t *current_conn;    /* on_recv 期间发起请求的连接，响应发往此连接 */
+    TaskHandle_t current_task;   /* 执行 on_recv 的 host 任务，只有该任务的响应按 current_conn 路由 */
+    esprpc_ble_stats_t stats;
 } ble_ctx_t;
 
 static ble_ctx_t s_ble_ctx = {0};
@@ -90,44 +159,237 @@ static const struct ble_gatt_svc_def esprpc_gatt_svc[] = {
     {0},
 };
 
-static int rpc_chr_access(uint16_t conn_handle, uint16_t attr_handle,
-                          struct ble_gatt_access_ctxt *ctxt, void *arg)
+/** 按句柄查找连接；传入 BLE_HS_CONN_HANDLE_NONE 时返回空槽 */
+static ble_conn_t *conn_find(ble_ctx_t *bc, uint16_t conn_handle)
 {
-    ble_ctx_t *ctx = &s_ble_ctx;
-    (void)arg;
+    for (int i = 0; i < BLE_MAX_CONNS; i++)
+    {
+        if (bc->conns[i].conn_handle == conn_handle)
+        {
+            return &bc->conns[i];
+        }
+    }
+    return NULL;
+}
 
-    if (ctxt->op == BLE_GATT_ACCESS_OP_WRITE_CHR && attr_handle == chr_tx_val_handle)
+static bool conn_subscribed(const ble_conn_t *c, uint8_t method_id)
+{
+    return (c->subs[method_id >> 5] >> (method_id & 31)) & 1u;
+}
+
+/** 丢弃拼接中的帧 */
+static void ble_rx_reset(ble_conn_t *c)
+{
+    esprpc_buf_unref(c->rx_buf);
+    c->rx_buf = NULL;
+    c->rx_len = 0;
+    c->rx_total = 0;
+}
+
+/** mbuf 链上的顺序读游标：逐个 mbuf 前进，不像 os_mbuf_copydata 每次从链头按偏移查找 */
+typedef struct
+{
+    const struct os_mbuf *om;
+    size_t off;                  /* 在 om 内的偏移 */
+} ble_mbuf_cursor_t;
+
+/** 跳过已读完的 mbuf，返回当前 mbuf 内剩余字节数（链尾为 0） */
+static size_t ble_cursor_avail(ble_mbuf_cursor_t *cur)
+{
+    while (cur->om && cur->off >= cur->om->om_len)
     {
-        uint32_t len = os_mbuf_len(ctxt->om);
-        if (len < 5 || len > BLE_RPC_FRAME_MAX)
+        cur->om = SLIST_NEXT(cur->om, om_next);
+        cur->off = 0;
+    }
+    return cur->om ? cur->om->om_len - cur->off : 0;
+}
+
+/** 拷出 n 字节并前进，链中数据不足返回 false */
+static bool ble_cursor_read(ble_mbuf_cursor_t *cur, void *dst, size_t n)
+{
+    uint8_t *d = (uint8_t *)dst;
+    while (n > 0)
+    {
+        size_t k = ble_cursor_avail(cur);
+        if (k == 0)
+            return false;
+        if (k > n)
+            k = n;
+        memcpy(d, cur->om->om_data + cur->off, k);
+        cur->off += k;
+        d += k;
+        n -= k;
+    }
+    return true;
+}
+
+/** 后续 n 字节都在同一个 mbuf 内时返回其地址（不拷贝）并前进，否则返回 NULL 且不前进 */
+static const uint8_t *ble_cursor_contig(ble_mbuf_cursor_t *cur, size_t n)
+{
+    if (ble_cursor_avail(cur) < n)
+        return NULL;
+    const uint8_t *p = cur->om->om_data + cur->off;
+    cur->off += n;
+    return p;
+}
+
+/** 整帧交给 on_recv；frame 可能直接指向 mbuf，仅在本次调用期间有效 */
+static void ble_rx_dispatch(ble_ctx_t *bc, ble_conn_t *c, const uint8_t *frame, size_t len, bool copied)
+{
+    uint8_t method_id = frame[0];
+    ESP_LOGI(TAG, "RPC frame recv conn=%d len=%lu methodId=%d", c->conn_handle, (unsigned long)len, method_id);
+    xSemaphoreTake(bc->tx_lock, portMAX_DELAY);
+    /* invoke_id=0 的请求为流订阅（或即发即忘），此后该 method_id 的流帧发往本连接 */
+    if (frame[1] == 0 && frame[2] == 0)
+    {
+        c->subs[method_id >> 5] |= 1u << (method_id & 31);
+    }
+    bc->stats.frames_recv++;
+    if (copied)
+        bc->stats.frames_recv_copied++;
+    bc->current_conn = c;
+    bc->current_task = xTaskGetCurrentTaskHandle();
+    xSemaphoreGive(bc->tx_lock);
+    bc->on_recv(frame, len, bc->on_recv_ctx);
+    xSemaphoreTake(bc->tx_lock, portMAX_DELAY);
+    bc->current_conn = NULL;
+    bc->current_task = NULL;
+    xSemaphoreGive(bc->tx_lock);
+}
+
+/**
+ * 处理一次写入的段：[1B 段头][数据]，拼满整帧后交给 on_recv。
+ * 单段帧且位于同一个 mbuf 内时直接把 mbuf 数据交给 on_recv（写回调返回前 mbuf 不会释放）；
+ * 多段帧或跨 mbuf 的帧用游标一次拷进拼接缓冲。
+ */
+static int ble_rx_segment(ble_ctx_t *bc, ble_conn_t *c, const struct os_mbuf *om)
+{
+    uint32_t len = os_mbuf_len(om);
+    ble_mbuf_cursor_t cur = { om, 0 };
+    uint8_t hdr;
+    if (len < 2 || len > BLE_ATT_VALUE_MAX || !ble_cursor_read(&cur, &hdr, 1))
+    {
+        return BLE_ATT_ERR_INVALID_ATTR_VALUE_LEN;
+    }
+    uint8_t seq = hdr & BLE_SEG_SEQ_MASK;
+    size_t n = len - 1;
+
+    if (seq == 0)
+    {
+        /* 首段：由帧头得出整帧长度 */
+        uint8_t fh[5];
+        ble_mbuf_cursor_t peek = cur;
+        ble_rx_reset(c);
+        if (n < sizeof(fh) || !ble_cursor_read(&peek, fh, sizeof(fh)))
         {
             return BLE_ATT_ERR_INVALID_ATTR_VALUE_LEN;
         }
-        uint8_t *buf = (uint8_t *)malloc(len);
-        if (!buf)
+        size_t total = sizeof(fh) + ((size_t)fh[3] | ((size_t)fh[4] << 8));
+        if (total > BLE_RPC_FRAME_MAX || n > total)
         {
-            return BLE_ATT_ERR_INSUFFICIENT_RES;
+            ESP_LOGW(TAG, "BLE frame len %u invalid (max %d)", (unsigned)total, BLE_RPC_FRAME_MAX);
+            return BLE_ATT_ERR_INVALID_ATTR_VALUE_LEN;
         }
-        int rc = os_mbuf_copydata(ctxt->om, 0, len, buf);
-        if (rc != 0)
+        if (!(hdr & BLE_SEG_MORE))
         {
-            free(buf);
-            return BLE_ATT_ERR_UNLIKELY;
+            if (n != total)
+            {
+                ESP_LOGW(TAG, "BLE frame short (%u/%u), dropping", (unsigned)n, (unsigned)total);
+                return 0;
+            }
+            const uint8_t *frame = ble_cursor_contig(&cur, n);
+            if (frame)
+            {
+                if (bc->on_recv)
+                    ble_rx_dispatch(bc, c, frame, n, false);
+                return 0;
+            }
         }
-        if (ctx->on_recv)
+        c->rx_buf = esprpc_buf_alloc(total);
+        if (!c->rx_buf)
         {
-            ESP_LOGI(TAG, "RPC frame recv len=%lu methodId=%d", (unsigned long)len, buf[0]);
-            ctx->on_recv(buf, len, ctx->on_recv_ctx);
+            return BLE_ATT_ERR_INSUFFICIENT_RES;
         }
-        free(buf);
+        c->rx_total = total;
+    }
+    else if (!c->rx_buf || seq != c->rx_seq || c->rx_len + n > c->rx_total)
+    {
+        ESP_LOGW(TAG, "BLE segment %u out of order, dropping frame", seq);
+        ble_rx_reset(c);
+        return 0;
+    }
+
+    if (!ble_cursor_read(&cur, c->rx_buf + c->rx_len, n))
+    {
+        ble_rx_reset(c);
+        return BLE_ATT_ERR_UNLIKELY;
+    }
+    c->rx_len += n;
+    c->rx_seq = (uint8_t)((seq + 1) & BLE_SEG_SEQ_MASK);
+
+    if (hdr & BLE_SEG_MORE)
+    {
         return 0;
     }
+    if (c->rx_len != c->rx_total)
+    {
+        ESP_LOGW(TAG, "BLE frame short (%u/%u), dropping", (unsigned)c->rx_len, (unsigned)c->rx_total);
+    }
+    else if (bc->on_recv)
+    {
+        ble_rx_dispatch(bc, c, c->rx_buf, c->rx_len, true);
+    }
+    ble_rx_reset(c);
+    return 0;
+}
+
+static int rpc_chr_access(uint16_t conn_handle, uint16_t attr_handle,
+                          struct ble_gatt_access_ctxt *ctxt, void *arg)
+{
+    ble_ctx_t *bc = &s_ble_ctx;
+    (void)arg;
+
+    if (ctxt->op == BLE_GATT_ACCESS_OP_WRITE_CHR && attr_handle == chr_tx_val_handle)
+    {
+        ble_conn_t *c = conn_handle != BLE_HS_CONN_HANDLE_NONE ? conn_find(bc, conn_handle) : NULL;
+        return c ? ble_rx_segment(bc, c, ctxt->om) : BLE_ATT_ERR_UNLIKELY;
+    }
+    if (ctxt->op == BLE_GATT_ACCESS_OP_READ_CHR && attr_handle == chr_rx_val_handle)
+    {
+        /* 读 RX 特征得到本连接的 ATT MTU，客户端据此决定写入分段大小 */
+        uint16_t mtu = ble_att_mtu(conn_handle);
+        uint8_t v[2] = { (uint8_t)(mtu & 0xFF), (uint8_t)(mtu >> 8) };
+        return os_mbuf_append(ctxt->om, v, sizeof(v)) == 0 ? 0 : BLE_ATT_ERR_INSUFFICIENT_RES;
+    }
     return BLE_ATT_ERR_UNLIKELY;
 }
 
 static void ble_hs_sync_cb(void);
 static void ble_hs_reset_cb(int reason);
 static int ble_gap_event(struct ble_gap_event *event, void *arg);
+static void ble_txq_flush(ble_ctx_t *bc, ble_conn_t *c);
+
+/** 有空闲连接槽且未在广播时开始广播（在 host 任务中调用） */
+static void ble_advertise(void)
+{
+    if (!conn_find(&s_ble_ctx, BLE_HS_CONN_HANDLE_NONE) || ble_gap_adv_active())
+    {
+        return;
+    }
+    struct ble_gap_adv_params adv_params = {
+        .conn_mode = BLE_GAP_CONN_MODE_UND,
+        .disc_mode = BLE_GAP_DISC_MODE_GEN,
+        .itvl_min = 0x20,
+        .itvl_max = 0x40,
+    };
+    int rc = ble_gap_adv_start(BLE_OWN_ADDR_PUBLIC, NULL, BLE_HS_FOREVER,
+                               &adv_params,
+                               ble_gap_event, NULL);
+    if (rc != 0)
+    {
+        ESP_LOGE(TAG, "ble_gap_adv_start failed: %d", rc);
+    }
+}
 
 static void ble_hs_sync_cb(void)
 {
@@ -153,21 +415,8 @@ static void ble_hs_sync_cb(void)
     {
         ESP_LOGW(TAG, "ble_gap_adv_set_fields failed: %d", rc);
     }
-    struct ble_gap_adv_params adv_params = {
-        .conn_mode = BLE_GAP_CONN_MODE_UND,
-        .disc_mode = BLE_GAP_DISC_MODE_GEN,
-        .itvl_min = 0x20,
-        .itvl_max = 0x40,
-    };
-    rc = ble_gap_adv_start(BLE_OWN_ADDR_PUBLIC, NULL, BLE_HS_FOREVER,
-                           &adv_params,
-                           ble_gap_event, NULL);
-    if (rc != 0)
-    {
-        ESP_LOGE(TAG, "ble_gap_adv_start failed: %d", rc);
-        return;
-    }
-    ESP_LOGI(TAG, "BLE advertising started, RPC service UUID 0xE530");
+    ble_advertise();
+    ESP_LOGI(TAG, "BLE advertising started, RPC service UUID 0xE530, max %d connections", BLE_MAX_CONNS);
 }
 
 static void ble_hs_reset_cb(int reason)
@@ -177,7 +426,8 @@ static void ble_hs_reset_cb(int reason)
 
 static int ble_gap_event(struct ble_gap_event *event, void *arg)
 {
-    ble_ctx_t *ctx = &s_ble_ctx;
+    ble_ctx_t *bc = &s_ble_ctx;
+    ble_conn_t *c;
     (void)arg;
 
     switch (event->type)
@@ -185,50 +435,88 @@ static int ble_gap_event(struct ble_gap_event *event, void *arg)
     case BLE_GAP_EVENT_CONNECT:
         if (event->connect.status == 0)
         {
-            ctx->conn_handle = event->connect.conn_handle;
-            ctx->connected = true;
-            ESP_LOGI(TAG, "BLE connected, conn_handle=%d", ctx->conn_handle);
+            uint16_t handle = event->connect.conn_handle;
+            xSemaphoreTake(bc->tx_lock, portMAX_DELAY);
+            c = conn_find(bc, BLE_HS_CONN_HANDLE_NONE);
+            if (c)
+            {
+                c->conn_handle = handle;
+                c->notify_enabled = false;
+                memset(c->subs, 0, sizeof(c->subs));
+            }
+            xSemaphoreGive(bc->tx_lock);
+            if (!c)
+            {
+                ESP_LOGW(TAG, "BLE connection limit reached, rejecting conn_handle=%d", handle);
+                ble_gap_terminate(handle, BLE_ERR_REM_USER_CONN_TERM);
+                break;
+            }
+            ESP_LOGI(TAG, "BLE connected, conn_handle=%d", handle);
+            /* 主动发起 MTU 交换（偏好值见 ble_att_set_preferred_mtu），结果见 BLE_GAP_EVENT_MTU */
+            int rc = ble_gattc_exchange_mtu(handle, NULL, NULL);
+            if (rc != 0)
+            {
+                ESP_LOGW(TAG, "ble_gattc_exchange_mtu failed: %d", rc);
+            }
         }
         else
         {
             ESP_LOGI(TAG, "BLE connect failed, status=%d", event->connect.status);
-            /* 连接失败时重新开始广播 */
-            struct ble_gap_adv_params adv_params = {
-                .conn_mode = BLE_GAP_CONN_MODE_UND,
-                .disc_mode = BLE_GAP_DISC_MODE_GEN,
-                .itvl_min = 0x20,
-                .itvl_max = 0x40,
-            };
-            ble_gap_adv_start(BLE_OWN_ADDR_PUBLIC, NULL, BLE_HS_FOREVER,
-                              &adv_params, ble_gap_event, NULL);
         }
+        /* 建立连接时广播已停止：还有空槽则继续广播，便于其他客户端连接 */
+        ble_advertise();
         break;
     case BLE_GAP_EVENT_DISCONNECT:
-        ctx->conn_handle = BLE_HS_CONN_HANDLE_NONE;
-        ctx->connected = false;
-        ESP_LOGI(TAG, "BLE disconnected");
+        xSemaphoreTake(bc->tx_lock, portMAX_DELAY);
+        c = conn_find(bc, event->disconnect.conn.conn_handle);
+        if (c)
+        {
+            ble_txq_flush(bc, c);
+            c->conn_handle = BLE_HS_CONN_HANDLE_NONE;
+            c->notify_enabled = false;
+        }
+        xSemaphoreGive(bc->tx_lock);
+        if (c)
+        {
+            ble_rx_reset(c);
+        }
+        ESP_LOGI(TAG, "BLE disconnected, conn_handle=%d reason=%d",
+                 event->disconnect.conn.conn_handle, event->disconnect.reason);
         /* 断开后重新开始广播，便于再次连接 */
+        ble_advertise();
+        break;
+    case BLE_GAP_EVENT_SUBSCRIBE:
+        if (event->subscribe.attr_handle == chr_rx_val_handle)
+        {
+            xSemaphoreTake(bc->tx_lock, portMAX_DELAY);
+            c = conn_find(bc, event->subscribe.conn_handle);
+            if (c)
+            {
+                c->notify_enabled = event->subscribe.cur_notify;
+            }
+            xSemaphoreGive(bc->tx_lock);
+            ESP_LOGI(TAG, "BLE notify %s, conn_handle=%d", event->subscribe.cur_notify ? "on" : "off",
+                     event->subscribe.conn_handle);
+        }
+        break;
+    case BLE_GAP_EVENT_MTU:
+        ESP_LOGI(TAG, "BLE MTU updated, conn_handle=%d mtu=%d", event->mtu.conn_handle, event->mtu.value);
+        break;
+    case BLE_GAP_EVENT_NOTIFY_TX:
+        /* 同步于 notify 调用上报，此处不取 tx_lock；暂停中见到成功的提交说明 mbuf 已有余量，提前重试 */
+        if (event->notify_tx.status == 0)
         {
-            struct ble_gap_adv_params adv_params = {
-                .conn_mode = BLE_GAP_CONN_MODE_UND,
-                .disc_mode = BLE_GAP_DISC_MODE_GEN,
-                .itvl_min = 0x20,
-                .itvl_max = 0x40,
-            };
-            ble_gap_adv_start(BLE_OWN_ADDR_PUBLIC, NULL, BLE_HS_FOREVER,
-                              &adv_params, ble_gap_event, NULL);
+            for (int i = 0; i < BLE_MAX_CONNS; i++)
+            {
+                if (bc->conns[i].tx_paused)
+                {
+                    ble_npl_callout_reset(&bc->conns[i].tx_retry, 0);
+                }
+            }
         }
         break;
     case BLE_GAP_EVENT_ADV_COMPLETE:
-        struct ble_gap_adv_params adv_params = {
-            .conn_mode = BLE_GAP_CONN_MODE_UND,
-            .disc_mode = BLE_GAP_DISC_MODE_GEN,
-            .itvl_min = 0x20,
-            .itvl_max = 0x40,
-        };
-        ble_gap_adv_start(BLE_OWN_ADDR_PUBLIC, NULL, BLE_HS_FOREVER,
-                          &adv_params,
-                          ble_gap_event, NULL);
+        ble_advertise();
         break;
     default:
         break;
@@ -236,30 +524,335 @@ static int ble_gap_event(struct ble_gap_event *event, void *arg)
     return 0;
 }
 
-static esp_err_t ble_send(void *ctx, const uint8_t *data, size_t len)
+/** 单段可携带的帧字节数（ATT MTU - 3 - 段头） */
+static size_t ble_seg_payload_max(uint16_t conn_handle)
 {
-    ble_ctx_t *bc = (ble_ctx_t *)ctx;
-    if (!bc || !bc->connected || bc->conn_handle == BLE_HS_CONN_HANDLE_NONE)
+    uint16_t mtu = ble_att_mtu(conn_handle);
+    size_t seg_max = (mtu > 3 ? mtu - 3 : BLE_ATT_MTU_DFLT - 3);
+    if (seg_max > BLE_ATT_VALUE_MAX) seg_max = BLE_ATT_VALUE_MAX;
+    return seg_max - 1;
+}
+
+/**
+ * 从帧的第 *off 字节起逐段 notify，iov 各段直接追加到 mbuf，不先拼接到平坦缓冲。
+ * 每成功一段推进 off 与 seq；返回 0（发完）或 NimBLE 错误码，BLE_HS_ENOMEM 表示 mbuf 不足
+ */
+static int ble_notify_from(ble_conn_t *c, const esprpc_iovec_t *iov, size_t iovcnt,
+                           size_t total, size_t *off, uint8_t *seq)
+{
+    size_t seg_max = ble_seg_payload_max(c->conn_handle);
+    size_t vi = 0, voff = *off;
+    while (vi < iovcnt && voff >= iov[vi].len)
     {
-        return ESP_ERR_INVALID_STATE;
+        voff -= iov[vi].len;
+        vi++;
+    }
+    while (*off < total)
+    {
+        size_t n = total - *off < seg_max ? total - *off : seg_max;
+        uint8_t hdr = (uint8_t)(*seq | (*off + n < total ? BLE_SEG_MORE : 0));
+        struct os_mbuf *om = ble_hs_mbuf_att_pkt();
+        if (!om || os_mbuf_append(om, &hdr, 1) != 0)
+        {
+            if (om) os_mbuf_free_chain(om);
+            return BLE_HS_ENOMEM;
+        }
+        for (size_t left = n; left > 0;)
+        {
+            size_t take = iov[vi].len - voff;
+            if (take > left) take = left;
+            if (take > 0 && os_mbuf_append(om, (const uint8_t *)iov[vi].base + voff, (uint16_t)take) != 0)
+            {
+                os_mbuf_free_chain(om);
+                return BLE_HS_ENOMEM;
+            }
+            left -= take;
+            voff += take;
+            if (voff == iov[vi].len)
+            {
+                vi++;
+                voff = 0;
+            }
+        }
+        int rc = ble_gatts_notify_custom(c->conn_handle, chr_rx_val_handle, om);
+        if (rc != 0)
+        {
+            return rc;
+        }
+        *off += n;
+        *seq = (uint8_t)((*seq + 1) & BLE_SEG_SEQ_MASK);
     }
-    if (len > BLE_RPC_FRAME_MAX)
+    return 0;
+}
+
+/** mbuf 不足：暂停该连接的发送，稍后由 tx_retry 继续。需持有 tx_lock */
+static void ble_txq_pause(ble_ctx_t *bc, ble_conn_t *c)
+{
+    c->tx_paused = true;
+    bc->stats.congestion++;
+    ble_npl_callout_reset(&c->tx_retry, ble_npl_time_ms_to_ticks32(CONFIG_ESPRPC_BLE_NOTIFY_RETRY_MS));
+}
+
+/** 拷贝帧入队（off/seq 为已发出部分）；队列满时丢弃新帧。需持有 tx_lock */
+static esp_err_t ble_txq_push(ble_ctx_t *bc, ble_conn_t *c, const esprpc_iovec_t *iov, size_t iovcnt,
+                              size_t total, size_t off, uint8_t seq)
+{
+#if BLE_TXQ_LEN == 0
+    (void)c;
+    (void)iov;
+    (void)iovcnt;
+    (void)total;
+    (void)off;
+    (void)seq;
+    bc->stats.frames_dropped++;  /* 未启用队列 */
+    return ESP_ERR_NO_MEM;
+#else
+    if (c->txq_count >= BLE_TXQ_LEN)
     {
-        ESP_LOGW(TAG, "Frame too large (%zu), truncating", len);
-        len = BLE_RPC_FRAME_MAX;
+        bc->stats.frames_dropped++;
+        return ESP_ERR_NO_MEM;
     }
-    struct os_mbuf *om = ble_hs_mbuf_from_flat(data, len);
-    if (!om)
+    uint8_t *buf = (uint8_t *)esprpc_buf_alloc(total);
+    if (!buf)
     {
+        bc->stats.frames_dropped++;
         return ESP_ERR_NO_MEM;
     }
-    int rc = ble_gatts_notify_custom(bc->conn_handle, chr_rx_val_handle, om);
-    if (rc != 0)
+    size_t pos = 0;
+    for (size_t i = 0; i < iovcnt; i++)
     {
-        ESP_LOGE(TAG, "ble_gatts_notify_custom failed: %d", rc);
-        return ESP_FAIL;
+        memcpy(buf + pos, iov[i].base, iov[i].len);
+        pos += iov[i].len;
     }
+    ble_txq_item_t *it = &c->txq[(c->txq_head + c->txq_count) % BLE_TXQ_SLOTS];
+    it->buf = buf;
+    it->len = total;
+    it->off = off;
+    it->seq = seq;
+    c->txq_count++;
+    bc->stats.frames_queued++;
+    if (c->txq_count > bc->stats.queue_peak) bc->stats.queue_peak = c->txq_count;
     return ESP_OK;
+#endif
+}
+
+/** 按序发送该连接队列中的帧，直到队列空或再次拥塞。需持有 tx_lock */
+static void ble_txq_pump(ble_ctx_t *bc, ble_conn_t *c)
+{
+    while (c->txq_count > 0 && !c->tx_paused)
+    {
+        ble_txq_item_t *it = &c->txq[c->txq_head];
+        esprpc_iovec_t iov = { it->buf, it->len };
+        int rc = ble_notify_from(c, &iov, 1, it->len, &it->off, &it->seq);
+        if (rc == BLE_HS_ENOMEM)
+        {
+            ble_txq_pause(bc, c);
+            return;
+        }
+        if (rc != 0)
+        {
+            ESP_LOGE(TAG, "ble_gatts_notify_custom failed: %d", rc);
+            bc->stats.frames_dropped++;
+        }
+        else
+        {
+            bc->stats.frames_sent++;
+        }
+        esprpc_buf_unref(it->buf);
+        c->txq_head = (uint8_t)((c->txq_head + 1) % BLE_TXQ_SLOTS);
+        c->txq_count--;
+    }
+}
+
+/** 丢弃该连接队列中的帧（断开/停止时）。需持有 tx_lock */
+static void ble_txq_flush(ble_ctx_t *bc, ble_conn_t *c)
+{
+    while (c->txq_count > 0)
+    {
+        esprpc_buf_unref(c->txq[c->txq_head].buf);
+        c->txq_head = (uint8_t)((c->txq_head + 1) % BLE_TXQ_SLOTS);
+        c->txq_count--;
+        bc->stats.frames_dropped++;
+    }
+    c->txq_head = 0;
+    c->tx_paused = false;
+    ble_npl_callout_stop(&c->tx_retry);
+}
+
+/** tx_retry 到期（host 任务）：恢复该连接的发送 */
+static void ble_tx_retry_cb(struct ble_npl_event *ev)
+{
+    ble_ctx_t *bc = &s_ble_ctx;
+    ble_conn_t *c = (ble_conn_t *)ble_npl_event_get_arg(ev);
+    xSemaphoreTake(bc->tx_lock, portMAX_DELAY);
+    c->tx_paused = false;
+    if (c->conn_handle != BLE_HS_CONN_HANDLE_NONE)
+    {
+        ble_txq_pump(bc, c);
+    }
+    xSemaphoreGive(bc->tx_lock);
+}
+
+/** 向一个连接发送一帧：队列为空时直接 notify；拥塞时剩余部分与后续帧进入该连接的通知队列。需持有 tx_lock */
+static esp_err_t ble_conn_send(ble_ctx_t *bc, ble_conn_t *c, const esprpc_iovec_t *iov, size_t iovcnt, size_t total)
+{
+    if (total > ((size_t)BLE_SEG_SEQ_MASK + 1) * ble_seg_payload_max(c->conn_handle))  /* 段序号不回绕，首段才为 0 */
+    {
+        ESP_LOGE(TAG, "Frame too large for BLE (%u bytes, mtu %u)", (unsigned)total, ble_att_mtu(c->conn_handle));
+        bc->stats.frames_dropped++;
+        return ESP_ERR_INVALID_SIZE;
+    }
+    if (c->txq_count > 0 || c->tx_paused)
+    {
+        return ble_txq_push(bc, c, iov, iovcnt, total, 0, 0);
+    }
+    size_t off = 0;
+    uint8_t seq = 0;
+    int rc = ble_notify_from(c, iov, iovcnt, total, &off, &seq);
+    if (rc == 0)
+    {
+        bc->stats.frames_sent++;
+        return ESP_OK;
+    }
+    if (rc == BLE_HS_ENOMEM)
+    {
+#if BLE_TXQ_LEN > 0
+        ble_txq_pause(bc, c);
+        return ble_txq_push(bc, c, iov, iovcnt, total, off, seq);
+#else
+        ESP_LOGD(TAG, "BLE notify congested, frame dropped");  /* 未启用队列，计入 stats */
+        bc->stats.congestion++;
+        bc->stats.frames_dropped++;
+        return ESP_ERR_NO_MEM;
+#endif
+    }
+    ESP_LOGE(TAG, "ble_gatts_notify_custom failed: %d", rc);
+    bc->stats.frames_dropped++;
+    return ESP_FAIL;
+}
+
+/** 取帧头前 3 字节（method_id、invoke_id），帧头可能跨段 */
+static bool frame_peek_header(const esprpc_iovec_t *iov, size_t iovcnt, uint8_t hdr[3])
+{
+    size_t got = 0;
+    for (size_t i = 0; i < iovcnt && got < 3; i++)
+    {
+        const uint8_t *b = (const uint8_t *)iov[i].base;
+        for (size_t j = 0; j < iov[i].len && got < 3; j++) hdr[got++] = b[j];
+    }
+    return got == 3;
+}
+
+/**
+ * 分段发送一帧（iov 各段顺序拼接即为帧）
+ * - 响应（invoke_id≠0）：在 host 任务的 on_recv 内发送时发给发起请求的连接；其他任务发送时无从得知请求来源，
+ *   仅当只有一个连接才发给它
+ * - 流帧（invoke_id=0）：发给打开了通知且订阅了该 method_id 的每个连接，各连接独立排队，慢连接不影响其他连接
+ */
+static esp_err_t ble_sendv(void *ctx, const esprpc_iovec_t *iov, size_t iovcnt)
+{
+    ble_ctx_t *bc = (ble_ctx_t *)ctx;
+    uint8_t hdr[3];
+    if (!bc || !bc->tx_lock || !frame_peek_header(iov, iovcnt, hdr))
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+    uint16_t invoke_id = (uint16_t)hdr[1] | ((uint16_t)hdr[2] << 8);
+    size_t total = 0;
+    for (size_t i = 0; i < iovcnt; i++) total += iov[i].len;
+
+    esp_err_t err = ESP_OK;
+    xSemaphoreTake(bc->tx_lock, portMAX_DELAY);
+    if (invoke_id != 0)
+    {
+        ble_conn_t *target = bc->current_task == xTaskGetCurrentTaskHandle() ? bc->current_conn : NULL;
+        if (!target)
+        {
+            int n = 0;
+            for (int i = 0; i < BLE_MAX_CONNS; i++)
+            {
+                if (bc->conns[i].conn_handle != BLE_HS_CONN_HANDLE_NONE)
+                {
+                    target = &bc->conns[i];
+                    n++;
+                }
+            }
+            if (n != 1) target = NULL;  /* 多个连接时无法判断请求来源 */
+        }
+        if (!target || target->conn_handle == BLE_HS_CONN_HANDLE_NONE || !target->notify_enabled)
+        {
+            err = ESP_ERR_INVALID_STATE;
+        }
+        else
+        {
+            err = ble_conn_send(bc, target, iov, iovcnt, total);
+        }
+    }
+    else
+    {
+        for (int i = 0; i < BLE_MAX_CONNS; i++)
+        {
+            ble_conn_t *c = &bc->conns[i];
+            if (c->conn_handle == BLE_HS_CONN_HANDLE_NONE || !c->notify_enabled || !conn_subscribed(c, hdr[0]))
+            {
+                continue;
+            }
+            esp_err_t e = ble_conn_send(bc, c, iov, iovcnt, total);
+            if (e != ESP_OK) err = e;
+        }
+    }
+    xSemaphoreGive(bc->tx_lock);
+    return err;
+}
+
+/** 在 host 任务的收包回调中取回复目标：发起请求的连接句柄 */
+static esp_err_t ble_reply_route(void *ctx, uint32_t *route)
+{
+    ble_ctx_t *bc = (ble_ctx_t *)ctx;
+    esp_err_t err = ESP_ERR_INVALID_STATE;
+    xSemaphoreTake(bc->tx_lock, portMAX_DELAY);
+    if (bc->current_conn && bc->current_task == xTaskGetCurrentTaskHandle())
+    {
+        *route = bc->current_conn->conn_handle;
+        err = ESP_OK;
+    }
+    xSemaphoreGive(bc->tx_lock);
+    return err;
+}
+
+/** 只发给连接句柄为 route 的连接，可在任意任务中调用；连接已断开返回 ESP_ERR_NOT_FOUND */
+static esp_err_t ble_sendv_to(void *ctx, uint32_t route, const esprpc_iovec_t *iov, size_t iovcnt)
+{
+    ble_ctx_t *bc = (ble_ctx_t *)ctx;
+    if (!bc || !bc->tx_lock || route == BLE_HS_CONN_HANDLE_NONE)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+    size_t total = 0;
+    for (size_t i = 0; i < iovcnt; i++) total += iov[i].len;
+    esp_err_t err;
+    xSemaphoreTake(bc->tx_lock, portMAX_DELAY);
+    ble_conn_t *c = conn_find(bc, (uint16_t)route);
+    if (!c)
+    {
+        err = ESP_ERR_NOT_FOUND;
+    }
+    else if (!c->notify_enabled)
+    {
+        err = ESP_ERR_INVALID_STATE;
+    }
+    else
+    {
+        err = ble_conn_send(bc, c, iov, iovcnt, total);
+    }
+    xSemaphoreGive(bc->tx_lock);
+    return err;
+}
+
+static esp_err_t ble_send(void *ctx, const uint8_t *data, size_t len)
+{
+    esprpc_iovec_t iov = { data, len };
+    return ble_sendv(ctx, &iov, 1);
 }
 
 static esp_err_t ble_start(void *ctx, esprpc_transport_on_recv_fn on_recv, void *user_ctx)
@@ -277,17 +870,30 @@ static void ble_stop(void *ctx)
     ble_ctx_t *bc = (ble_ctx_t *)ctx;
     if (bc)
     {
-        bc->conn_handle = BLE_HS_CONN_HANDLE_NONE;
-        bc->connected = false;
+        xSemaphoreTake(bc->tx_lock, portMAX_DELAY);
+        for (int i = 0; i < BLE_MAX_CONNS; i++)
+        {
+            ble_txq_flush(bc, &bc->conns[i]);
+            bc->conns[i].conn_handle = BLE_HS_CONN_HANDLE_NONE;
+            bc->conns[i].notify_enabled = false;
+        }
+        xSemaphoreGive(bc->tx_lock);
         bc->on_recv = NULL;
+        for (int i = 0; i < BLE_MAX_CONNS; i++)
+        {
+            ble_rx_reset(&bc->conns[i]);
+        }
     }
 }
 
 static esprpc_transport_t s_ble_transport = {
     .send = ble_send,
+    .sendv = ble_sendv,
     .start = ble_start,
     .stop = ble_stop,
     .ctx = &s_ble_ctx,
+    .reply_route = ble_reply_route,
+    .sendv_to = ble_sendv_to,
 };
 
 static void ble_host_task(void *param)
@@ -301,7 +907,15 @@ esp_err_t esprpc_transport_ble_init(void)
 {
     int rc;
     memset(&s_ble_ctx, 0, sizeof(s_ble_ctx));
-    s_ble_ctx.conn_handle = BLE_HS_CONN_HANDLE_NONE;
+    for (int i = 0; i < BLE_MAX_CONNS; i++)
+    {
+        s_ble_ctx.conns[i].conn_handle = BLE_HS_CONN_HANDLE_NONE;
+    }
+    s_ble_ctx.tx_lock = xSemaphoreCreateMutex();
+    if (!s_ble_ctx.tx_lock)
+    {
+        return ESP_ERR_NO_MEM;
+    }
 
     esp_err_t ret = nimble_port_init();
     if (ret != ESP_OK)
@@ -309,11 +923,22 @@ esp_err_t esprpc_transport_ble_init(void)
         ESP_LOGE(TAG, "nimble_port_init failed: %s", esp_err_to_name(ret));
         return ret;
     }
+    for (int i = 0; i < BLE_MAX_CONNS; i++)
+    {
+        ble_npl_callout_init(&s_ble_ctx.conns[i].tx_retry, nimble_port_get_dflt_eventq(),
+                             ble_tx_retry_cb, &s_ble_ctx.conns[i]);
+    }
 
     /* 必须在 nimble_port_freertos_init 之前设置回调和初始化服务 */
     ble_hs_cfg.reset_cb = ble_hs_reset_cb;
     ble_hs_cfg.sync_cb = ble_hs_sync_cb;
 
+    rc = ble_att_set_preferred_mtu(CONFIG_ESPRPC_BLE_PREFERRED_MTU);
+    if (rc != 0)
+    {
+        ESP_LOGW(TAG, "ble_att_set_preferred_mtu failed: %d", rc);
+    }
+
     /* 初始化 GAP/GATT 标准服务（NimBLE 必需） */
     ble_svc_gap_init();
     ble_svc_gatt_init();
@@ -347,6 +972,23 @@ esprpc_transport_t *esprpc_transport_ble_get(void)
     return &s_ble_transport;
 }
 
+esp_err_t esprpc_transport_ble_get_stats(esprpc_ble_stats_t *out)
+{
+    if (!out)
+        return ESP_ERR_INVALID_ARG;
+    if (!s_ble_ctx.tx_lock)
+        return ESP_ERR_INVALID_STATE;
+    xSemaphoreTake(s_ble_ctx.tx_lock, portMAX_DELAY);
+    *out = s_ble_ctx.stats;
+    out->queue_len = 0;
+    for (int i = 0; i < BLE_MAX_CONNS; i++)
+    {
+        out->queue_len += s_ble_ctx.conns[i].txq_count;
+    }
+    xSemaphoreGive(s_ble_ctx.tx_lock);
+    return ESP_OK;
+}
+
 #else /* !CONFIG_ESPRPC_ENABLE_BLE || !CONFIG_BT_NIMBLE_ENABLED */
 
 esp_err_t esprpc_transport_ble_init(void)
@@ -360,4 +1002,10 @@ esprpc_transport_t *esprpc_transport_ble_get(void)
     return NULL;
 }
 
+esp_err_t esprpc_transport_ble_get_stats(esprpc_ble_stats_t *out)
+{
+    (void)out;
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
 #endif /* CONFIG_ESPRPC_ENABLE_BLE && CONFIG_BT_NIMBLE_ENABLED */
@@ -5,9 +5,13 @@
  * 依赖 CONFIG_HTTPD_WS_SUPPORT。流程：
  * 1. esprpc_transport_ws_init()
  * 2. esprpc_transport_add(esprpc_transport_ws_get())
- * 3. transport->start(ctx, esprpc_handle_request, NULL)
+ * 3. transport->start(ctx, on_recv, transport)，on_recv 中调用 esprpc_handle_request_from
  * 4. WiFi 获 IP 后调用 esprpc_transport_ws_start_server(NULL) 或传入已有 httpd
  * 端点: ws://<ip>:80/ws；传入非空 httpd 时与调用方共用同一服务器
+ *
+ * 多客户端：最多 CONFIG_ESPRPC_WS_MAX_SESSIONS 个会话，握手时分配、httpd 关闭会话时回收。
+ * 响应只回给发起请求的会话（reply_route 记下会话 fd，其他任务发出的分页中间页经 sendv_to 进该会话的队列）；流帧（invoke_id=0）只发给以 invoke_id=0 请求过该方法的会话，
+ * 每个会话有独立的异步发送队列，逐帧交给 httpd。
  */
 
 #include "esprpc_transport.h"
@@ -22,12 +26,46 @@ static const char *TAG = "esprpc_ws";
 
 #if CONFIG_HTTPD_WS_SUPPORT
 
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+
+#ifndef CONFIG_ESPRPC_WS_MAX_SESSIONS
+#define CONFIG_ESPRPC_WS_MAX_SESSIONS 4
+#endif
+#ifndef CONFIG_ESPRPC_WS_SESSION_QUEUE_LEN
+#define CONFIG_ESPRPC_WS_SESSION_QUEUE_LEN 8
+#endif
+
+#define WS_MAX_SESSIONS  CONFIG_ESPRPC_WS_MAX_SESSIONS
+#define WS_QUEUE_LEN     CONFIG_ESPRPC_WS_SESSION_QUEUE_LEN
+
+/** 异步发送队列项：buf 为 esprpc_buf_alloc 的引用计数缓冲，同一流帧发给多个会话时共用，每项持有一个引用 */
+typedef struct {
+    uint8_t *buf;
+    size_t len;
+} ws_frame_t;
+
+/** 一个 WebSocket 客户端会话 */
+typedef struct {
+    int fd;                       /* -1 表示空闲槽位 */
+    uint32_t subs[8];             /* 以 invoke_id=0 请求过的 method_id 位图，流帧只发给订阅者 */
+    ws_frame_t q[WS_QUEUE_LEN];   /* 待发送的异步帧，队首在 busy 时已交给 httpd */
+    uint8_t q_head;
+    uint8_t q_count;
+    bool busy;                    /* 队首帧发送中，完成回调后再发下一帧 */
+    uint32_t dropped;             /* 队列满丢弃的帧数 */
+} ws_session_t;
+
 /** WebSocket 传输上下文 */
 typedef struct {
     httpd_handle_t server;
     bool server_owned;  /* true=内部创建需负责 stop，false=外部传入不 stop */
-    int sockfd;  /* 当前连接的客户端 fd，-1 表示无连接 */
-    httpd_req_t *current_req;  /* handler 内当前请求，用于同步发送（避免 httpd_queue_work 死锁） */
+    ws_session_t sessions[WS_MAX_SESSIONS];
+    SemaphoreHandle_t sess_lock;  /* 保护 sessions 与下面三项 current_* */
+    httpd_req_t *current_req;     /* handler 内当前请求，用于同步发送（避免 httpd_queue_work 死锁） */
+    ws_session_t *current_sess;   /* current_req 所属会话 */
+    TaskHandle_t current_task;    /* 执行 handler 的任务，只有该任务可用 current_req 发送 */
     esprpc_transport_on_recv_fn on_recv;
     void *on_recv_ctx;
     char *uri_path;  /* WebSocket URI 路径，需手动释放内存 */
@@ -35,6 +73,8 @@ typedef struct {
 
 static ws_ctx_t s_ws_ctx = {0};
 
+static esp_err_t ws_handler(httpd_req_t *req);
+
 static httpd_uri_t ws_uri = {
     .uri       = "/rpc",  /* 默认路径，会在 esprpc_transport_ws_start_server 中更新 */
     .method    = HTTP_GET,
@@ -43,48 +83,258 @@ static httpd_uri_t ws_uri = {
     .is_websocket = true,
 };
 
+/* ---------- 会话表（调用方持有 sess_lock） ---------- */
+
+static bool session_subscribed(const ws_session_t *s, uint8_t method_id)
+{
+    return (s->subs[method_id >> 5] >> (method_id & 31)) & 1u;
+}
+
+static void ws_send_complete_cb(esp_err_t err, int socket, void *arg);
+
+/** 会话空闲时把队首帧交给 httpd；提交失败的帧直接丢弃 */
+static void session_pump(ws_ctx_t *wc, ws_session_t *s)
+{
+    while (!s->busy && s->q_count) {
+        ws_frame_t *f = &s->q[s->q_head];
+        httpd_ws_frame_t frame = {
+            .final = true,
+            .fragmented = false,
+            .type = HTTPD_WS_TYPE_BINARY,
+            .payload = f->buf,
+            .len = f->len,
+        };
+        if (httpd_ws_send_data_async(wc->server, s->fd, &frame, ws_send_complete_cb, f->buf) == ESP_OK) {
+            s->busy = true;
+        } else {
+            esprpc_buf_unref(f->buf);
+            s->q_head = (uint8_t)((s->q_head + 1) % WS_QUEUE_LEN);
+            s->q_count--;
+        }
+    }
+}
+
+/** 入队一帧；队列满时只丢弃该会话的这一帧 */
+static esp_err_t session_enqueue(ws_ctx_t *wc, ws_session_t *s, uint8_t *buf, size_t len)
+{
+    if (s->q_count == WS_QUEUE_LEN) {
+        if (s->dropped++ == 0) {
+            ESP_LOGW(TAG, "Session fd=%d send queue full, dropping frames", s->fd);
+        }
+        return ESP_ERR_NO_MEM;
+    }
+    ws_frame_t *f = &s->q[(s->q_head + s->q_count) % WS_QUEUE_LEN];
+    f->buf = buf;
+    f->len = len;
+    s->q_count++;
+    esprpc_buf_ref(buf);
+    session_pump(wc, s);
+    return ESP_OK;
+}
+
+/** httpd 任务中回调：释放队首帧的引用并继续发送该会话的下一帧；会话已关闭时只释放引用 */
 static void ws_send_complete_cb(esp_err_t err, int socket, void *arg)
 {
     (void)err;
-    (void)socket;
-    free(arg);
+    ws_ctx_t *wc = &s_ws_ctx;
+    xSemaphoreTake(wc->sess_lock, portMAX_DELAY);
+    for (int i = 0; i < WS_MAX_SESSIONS; i++) {
+        ws_session_t *s = &wc->sessions[i];
+        if (s->fd == socket && s->busy && s->q[s->q_head].buf == arg) {
+            s->q_head = (uint8_t)((s->q_head + 1) % WS_QUEUE_LEN);
+            s->q_count--;
+            s->busy = false;
+            session_pump(wc, s);
+            break;
+        }
+    }
+    xSemaphoreGive(wc->sess_lock);
+    esprpc_buf_unref(arg);
 }
 
-/** 通过 WebSocket 发送二进制帧
- * 在 handler 内调用时用 current_req 直接同步发送；否则用 async（handler 外调用时 current_req 为 NULL） */
-static esp_err_t ws_send(void *ctx, const uint8_t *data, size_t len)
+/** httpd 关闭会话时回调（作为 sess_ctx 的 free_ctx）：释放排队帧，发送中的队首由完成回调释放 */
+static void ws_session_closed(void *ctx)
+{
+    ws_ctx_t *wc = &s_ws_ctx;
+    ws_session_t *s = (ws_session_t *)ctx;
+    xSemaphoreTake(wc->sess_lock, portMAX_DELAY);
+    ESP_LOGI(TAG, "WebSocket client fd=%d closed (dropped %u frames)", s->fd, (unsigned)s->dropped);
+    for (uint8_t k = s->busy ? 1 : 0; k < s->q_count; k++) {
+        esprpc_buf_unref(s->q[(s->q_head + k) % WS_QUEUE_LEN].buf);
+    }
+    memset(s, 0, sizeof(*s));
+    s->fd = -1;
+    xSemaphoreGive(wc->sess_lock);
+}
+
+/* ---------- 发送 ---------- */
+
+/** 用 handler 内的 req 同步发送，多段时作为同一消息的分片逐段发送，不拼接 */
+static esp_err_t ws_send_sync(httpd_req_t *req, const esprpc_iovec_t *iov, size_t iovcnt)
+{
+    size_t n = 0;  /* 非空段数 */
+    for (size_t i = 0; i < iovcnt; i++) {
+        if (iov[i].len) n++;
+    }
+    size_t k = 0;
+    for (size_t i = 0; i < iovcnt; i++) {
+        if (!iov[i].len) continue;
+        httpd_ws_frame_t frame = {
+            .final = (k + 1 == n),
+            .fragmented = (n > 1),
+            .type = (k == 0) ? HTTPD_WS_TYPE_BINARY : HTTPD_WS_TYPE_CONTINUE,
+            .payload = (uint8_t *)iov[i].base,
+            .len = iov[i].len,
+        };
+        esp_err_t ret = httpd_ws_send_frame(req, &frame);
+        if (ret != ESP_OK) return ret;
+        k++;
+    }
+    return ESP_OK;
+}
+
+/** 调用任务正是执行 handler 的任务时返回 current_req（及所属会话），否则返回 NULL。调用方持有 sess_lock */
+static httpd_req_t *ws_owned_req(ws_ctx_t *wc, ws_session_t **sess)
+{
+    if (!wc->current_req || wc->current_task != xTaskGetCurrentTaskHandle()) {
+        *sess = NULL;
+        return NULL;
+    }
+    *sess = wc->current_sess;
+    return wc->current_req;
+}
+
+/** 取帧头前 3 字节（method_id、invoke_id），帧头可能跨段 */
+static bool frame_peek_header(const esprpc_iovec_t *iov, size_t iovcnt, uint8_t hdr[3])
+{
+    size_t got = 0;
+    for (size_t i = 0; i < iovcnt && got < 3; i++) {
+        const uint8_t *b = (const uint8_t *)iov[i].base;
+        for (size_t j = 0; j < iov[i].len && got < 3; j++) hdr[got++] = b[j];
+    }
+    return got == 3;
+}
+
+/** 通过 WebSocket 发送一帧（iov 各段顺序拼接即为帧）
+ * - 响应（invoke_id≠0）：只发给发起请求的会话，须在 handler 任务内调用，用 current_req 同步发送；
+ *   其他任务无从得知响应属于哪个会话，返回 ESP_ERR_INVALID_STATE
+ * - 流帧（invoke_id=0）：发给订阅了该 method_id 的每个会话；在 handler 任务内调用时当前请求所属会话同步发送，
+ *   其余会话（其他任务调用时为全部会话）共用一份拼接到帧池缓冲的拷贝，各持一个引用进各自的发送队列，
+ *   慢客户端不阻塞其他客户端 */
+static esp_err_t ws_sendv(void *ctx, const esprpc_iovec_t *iov, size_t iovcnt)
 {
     ws_ctx_t *wc = (ws_ctx_t *)ctx;
-    if (!wc || wc->sockfd < 0 || !wc->server) {
+    uint8_t hdr[3];
+    if (!wc || !wc->server || !frame_peek_header(iov, iovcnt, hdr)) {
         return ESP_ERR_INVALID_STATE;
     }
+    uint16_t invoke_id = (uint16_t)hdr[1] | ((uint16_t)hdr[2] << 8);
 
-    httpd_ws_frame_t frame = {
-        .final = true,
-        .fragmented = false,
-        .type = HTTPD_WS_TYPE_BINARY,
-        .payload = (uint8_t *)data,
-        .len = len,
-    };
+    ws_session_t *cur_sess;
+    xSemaphoreTake(wc->sess_lock, portMAX_DELAY);
+    httpd_req_t *cur_req = ws_owned_req(wc, &cur_sess);  /* 解锁后仍有效：req 在本任务的 handler 返回前不会释放 */
 
-    /* handler 内：直接同步发送，避免 httpd_queue_work 导致同任务死锁 */
-    if (wc->current_req) {
-        return httpd_ws_send_frame(wc->current_req, &frame);
+    if (invoke_id != 0) {
+        xSemaphoreGive(wc->sess_lock);
+        /* 响应只在 handler 内产生：避免 httpd_queue_work 导致同任务死锁，直接同步发送 */
+        return cur_req ? ws_send_sync(cur_req, iov, iovcnt) : ESP_ERR_INVALID_STATE;
     }
 
-    /* handler 外（如流式推送）：异步发送 */
-    uint8_t *buf = malloc(len);
-    if (!buf) {
-        return ESP_ERR_NO_MEM;
+    esp_err_t err = ESP_OK;
+    bool to_current = false;
+    uint8_t *buf = NULL;
+    size_t total = 0;
+    for (int i = 0; i < WS_MAX_SESSIONS; i++) {
+        ws_session_t *s = &wc->sessions[i];
+        if (s->fd < 0 || !session_subscribed(s, hdr[0])) continue;
+        if (cur_req && s == cur_sess) {
+            to_current = true;
+            continue;
+        }
+        if (!buf) {
+            for (size_t k = 0; k < iovcnt; k++) total += iov[k].len;
+            buf = esprpc_buf_alloc(total);  /* 本函数持有一个引用，循环结束后释放 */
+            if (!buf) {
+                err = ESP_ERR_NO_MEM;
+                break;
+            }
+            size_t off = 0;
+            for (size_t k = 0; k < iovcnt; k++) {
+                if (iov[k].len) memcpy(buf + off, iov[k].base, iov[k].len);
+                off += iov[k].len;
+            }
+        }
+        esp_err_t e = session_enqueue(wc, s, buf, total);
+        if (e != ESP_OK) err = e;
     }
-    memcpy(buf, data, len);
-    frame.payload = buf;
-    esp_err_t ret = httpd_ws_send_data_async(wc->server, wc->sockfd, &frame,
-                                            ws_send_complete_cb, buf);
-    if (ret != ESP_OK) {
-        free(buf);
+    xSemaphoreGive(wc->sess_lock);
+    esprpc_buf_unref(buf);
+
+    if (to_current) {
+        esp_err_t e = ws_send_sync(cur_req, iov, iovcnt);
+        if (e != ESP_OK) err = e;
+    }
+    return err;
+}
+
+/** 在 handler 任务的收包回调中取回复目标：发起请求的会话 fd */
+static esp_err_t ws_reply_route(void *ctx, uint32_t *route)
+{
+    ws_ctx_t *wc = (ws_ctx_t *)ctx;
+    ws_session_t *sess;
+    xSemaphoreTake(wc->sess_lock, portMAX_DELAY);
+    httpd_req_t *req = ws_owned_req(wc, &sess);
+    if (req && sess) *route = (uint32_t)sess->fd;
+    xSemaphoreGive(wc->sess_lock);
+    return (req && sess) ? ESP_OK : ESP_ERR_INVALID_STATE;
+}
+
+/** 只发给会话 fd=route：在该会话的 handler 任务内同步发送，其他任务（如分页响应的生产者）拷贝进帧池缓冲后
+ *  走该会话的异步发送队列；会话已关闭返回 ESP_ERR_NOT_FOUND */
+static esp_err_t ws_sendv_to(void *ctx, uint32_t route, const esprpc_iovec_t *iov, size_t iovcnt)
+{
+    ws_ctx_t *wc = (ws_ctx_t *)ctx;
+    if (!wc || !wc->server) return ESP_ERR_INVALID_STATE;
+    ws_session_t *cur_sess;
+    xSemaphoreTake(wc->sess_lock, portMAX_DELAY);
+    httpd_req_t *cur_req = ws_owned_req(wc, &cur_sess);
+    if (cur_req && cur_sess && (uint32_t)cur_sess->fd == route) {
+        xSemaphoreGive(wc->sess_lock);
+        return ws_send_sync(cur_req, iov, iovcnt);
+    }
+    ws_session_t *s = NULL;
+    for (int i = 0; i < WS_MAX_SESSIONS; i++) {
+        if (wc->sessions[i].fd >= 0 && (uint32_t)wc->sessions[i].fd == route) {
+            s = &wc->sessions[i];
+            break;
+        }
+    }
+    if (!s) {
+        xSemaphoreGive(wc->sess_lock);
+        return ESP_ERR_NOT_FOUND;
+    }
+    size_t total = 0;
+    for (size_t k = 0; k < iovcnt; k++) total += iov[k].len;
+    uint8_t *buf = esprpc_buf_alloc(total);
+    esp_err_t err = ESP_ERR_NO_MEM;
+    if (buf) {
+        size_t off = 0;
+        for (size_t k = 0; k < iovcnt; k++) {
+            if (iov[k].len) memcpy(buf + off, iov[k].base, iov[k].len);
+            off += iov[k].len;
+        }
+        err = session_enqueue(wc, s, buf, total);
     }
-    return ret;
+    xSemaphoreGive(wc->sess_lock);
+    esprpc_buf_unref(buf);
+    return err;
+}
+
+/** 通过 WebSocket 发送二进制帧 */
+static esp_err_t ws_send(void *ctx, const uint8_t *data, size_t len)
+{
+    esprpc_iovec_t iov = { data, len };
+    return ws_sendv(ctx, &iov, 1);
 }
 
 /** 保存接收回调，收到二进制帧时调用 */
@@ -101,19 +351,40 @@ static void ws_stop(void *ctx)
 {
     ws_ctx_t *wc = (ws_ctx_t *)ctx;
     if (wc) {
-        wc->sockfd = -1;
         wc->on_recv = NULL;
     }
 }
 
+/** 握手时分配会话槽位，并挂到 httpd 会话上下文，会话关闭时由 httpd 回调 ws_session_closed */
+static esp_err_t ws_session_open(ws_ctx_t *wc, httpd_req_t *req)
+{
+    int fd = httpd_req_to_sockfd(req);
+    ws_session_t *s = NULL;
+    xSemaphoreTake(wc->sess_lock, portMAX_DELAY);
+    for (int i = 0; i < WS_MAX_SESSIONS; i++) {
+        if (wc->sessions[i].fd < 0) {
+            s = &wc->sessions[i];
+            s->fd = fd;
+            break;
+        }
+    }
+    xSemaphoreGive(wc->sess_lock);
+    if (!s) {
+        ESP_LOGW(TAG, "WebSocket sessions full (%d), rejecting fd=%d", WS_MAX_SESSIONS, fd);
+        return ESP_FAIL;
+    }
+    req->sess_ctx = s;
+    req->free_ctx = ws_session_closed;
+    ESP_LOGI(TAG, "WebSocket handshake, client fd=%d connected", fd);
+    return ESP_OK;
+}
+
 /** /ws URI 处理：GET=握手，后续=二进制帧收发 */
 static esp_err_t ws_handler(httpd_req_t *req)
 {
     ws_ctx_t *wc = &s_ws_ctx;
     if (req->method == HTTP_GET) {
-        ESP_LOGI(TAG, "WebSocket handshake, client connected");
-        wc->sockfd = httpd_req_to_sockfd(req);
-        return ESP_OK;
+        return ws_session_open(wc, req);
     }
 
     /* 收到 WebSocket 二进制帧，转发给 on_recv（即 esprpc_handle_request） */
@@ -129,46 +400,63 @@ static esp_err_t ws_handler(httpd_req_t *req)
         return ESP_OK;
     }
 
-    uint8_t *buf = malloc(frame.len);
+    /* 直接收进帧池缓冲（不超过池块大小时），避免每帧 malloc */
+    uint8_t *buf = esprpc_buf_alloc(frame.len);
     if (!buf) {
         return ESP_ERR_NO_MEM;
     }
     frame.payload = buf;
     ret = httpd_ws_recv_frame(req, &frame, frame.len);
     if (ret != ESP_OK) {
-        free(buf);
+        esprpc_buf_unref(buf);
         return ret;
     }
 
-    if (wc->on_recv && frame.type == HTTPD_WS_TYPE_BINARY) {
+    ws_session_t *s = (ws_session_t *)req->sess_ctx;
+    if (wc->on_recv && s && frame.type == HTTPD_WS_TYPE_BINARY) {
         uint8_t method_id = (frame.len >= 1) ? buf[0] : 0;
         ESP_LOGI(TAG, "RPC frame recv len=%d methodId=%d", (int)frame.len, method_id);
+        /* invoke_id=0 的请求为流订阅（或即发即忘），此后该 method_id 的流帧发往本会话 */
+        xSemaphoreTake(wc->sess_lock, portMAX_DELAY);
+        if (frame.len >= 5 && buf[1] == 0 && buf[2] == 0) {
+            s->subs[method_id >> 5] |= 1u << (method_id & 31);
+        }
         wc->current_req = req;
+        wc->current_sess = s;
+        wc->current_task = xTaskGetCurrentTaskHandle();
+        xSemaphoreGive(wc->sess_lock);
         wc->on_recv(buf, frame.len, wc->on_recv_ctx);
+        xSemaphoreTake(wc->sess_lock, portMAX_DELAY);
         wc->current_req = NULL;
+        wc->current_sess = NULL;
+        wc->current_task = NULL;
+        xSemaphoreGive(wc->sess_lock);
     }
-    free(buf);
+    esprpc_buf_unref(buf);
     return ESP_OK;
 }
 
-static httpd_uri_t ws_uri = {
-    .method    = HTTP_GET,
-    .handler   = ws_handler,
-    .user_ctx  = NULL,
-    .is_websocket = true,
-};
-
 static esprpc_transport_t s_ws_transport = {
     .send  = ws_send,
+    .sendv = ws_sendv,
     .start = ws_start,
     .stop  = ws_stop,
     .ctx   = &s_ws_ctx,
+    .reply_route = ws_reply_route,
+    .sendv_to = ws_sendv_to,
 };
 
 esp_err_t esprpc_transport_ws_init(void)
 {
     memset(&s_ws_ctx, 0, sizeof(s_ws_ctx));
-    s_ws_ctx.sockfd = -1;
+    for (int i = 0; i < WS_MAX_SESSIONS; i++) {
+        s_ws_ctx.sessions[i].fd = -1;
+    }
+    s_ws_ctx.sess_lock = xSemaphoreCreateMutex();
+    if (!s_ws_ctx.sess_lock) {
+        ESP_LOGE(TAG, "Failed to create session lock");
+        return ESP_ERR_NO_MEM;
+    }
     /* 分配默认 URI 路径 */
     s_ws_ctx.uri_path = strdup("/rpc");
     if (!s_ws_ctx.uri_path) {
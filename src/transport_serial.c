@@ -5,12 +5,35 @@
  * 帧格式与 WebSocket/BLE 一致: [1B method_id][2B invoke_id LE][2B payload_len LE][payload]
  * 可选：每个 packet 可配置前缀/后缀（字面量或 \\xNN），便于与其他协议复用串口。
  * 串口由外部代码管理：应用需注册发送回调 esprpc_serial_set_tx_cb()，
- * 识别前后缀后通过 esprpc_serial_feed_packet() / esprpc_serial_feed_raw_packet() 把 RPC 包交给本模块。
+ * 识别前后缀后通过 esprpc_serial_feed_packet() / esprpc_serial_feed_raw_packet() 把 RPC 包交给本模块，
+ * 或把读到的任意字节块交给 esprpc_serial_feed_bytes()，由本模块成帧。
+ *
+ * 成帧（feed_bytes）：memchr 定位前缀首字节再比较其余字节；前缀后的长度超限或后缀不符时从该前缀的
+ * 下一字节重新查找，不丢弃其后的数据。完整落在本次输入中的包直接交给 on_recv（不拷贝），
+ * 只有跨两次输入的半包才拷进拼包缓冲，并且每次只补足当前包所需的字节。
+ *
+ * COBS 模式（CONFIG_ESPRPC_SERIAL_COBS，取代前后缀）：每包为 0x00 + COBS(帧 + CRC-16 LE) + 0x00。
+ * COBS 编码后包内不含 0x00，任何损坏最多影响到下一个 0x00 为止；CRC-16/CCITT-FALSE 或帧头长度
+ * 不符的包在交给 on_recv 前丢弃。包前的 0x00 把同一串口上的日志等数据隔成独立的（被丢弃的）包。
+ *
+ * 可靠链路（CONFIG_ESPRPC_SERIAL_ARQ，基于 COBS 模式）：COBS 包内在帧前加 [ctl][epoch][seq][ack] 链路头，
+ * 由链路任务按 Go-Back-N 滑动窗口发送：最多 WINDOW 帧在途，对端按序接收并累计确认（ack 为期望的下一个 seq，
+ * 可捎带在 DATA 帧上）。出现缺口时对端丢弃其后的帧，并对每个缺口回一个带 REJ 标志的 ACK，发送端收到后
+ * 立即重发窗口内全部帧（快速重传）；REJ 也丢失时靠超时重传，超时时间连续超时时加倍。
+ * epoch 为每端启动时随机选取的会话号：对端会话号变化（重启）时两个方向都从 seq 0 重新编号。
+ * sendv 只把帧拷进队列，背压留在链路内：on_recv 中（收包任务内）发出的帧进按需扩容的应答队列、从不丢弃，
+ * 应答积压时暂不接收新的 DATA 帧；其他任务在发送队列满时等待，只有链路断开（未收到过对端或已停滞）时才丢帧。
  */
 
 #include "esprpc_transport.h"
 #include "esprpc.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
 #include "esp_log.h"
+#include "esp_random.h"
+#include <stdbool.h>
 #include <string.h>
 #include <stdlib.h>
 #include <ctype.h>
@@ -23,8 +46,69 @@ static const char *TAG = "esprpc_serial";
 #define SERIAL_RPC_PAYLOAD_MAX  (CONFIG_ESPRPC_SERIAL_PAYLOAD_MAX)
 #define SERIAL_PREFIX_SUFFIX_MAX 16
 
+#define SERIAL_IOV_MAX 8  /* 分段发送回调单次最多段数（含前后缀） */
+#define SERIAL_CRC_LEN 2
+
+#ifndef CONFIG_ESPRPC_SERIAL_RX_TIMEOUT_MS
+#define CONFIG_ESPRPC_SERIAL_RX_TIMEOUT_MS 500
+#endif
+#define SERIAL_RX_TIMEOUT_MS CONFIG_ESPRPC_SERIAL_RX_TIMEOUT_MS  /* 半包在无新字节时保留的上限，0 为不限 */
+
+#if CONFIG_ESPRPC_SERIAL_ARQ
+#define SERIAL_ARQ_HDR          4     /* [ctl][epoch][seq][ack] */
+#define SERIAL_ARQ_DATA         0x01  /* ctl：带 seq 与 RPC 帧；否则为纯 ACK */
+#define SERIAL_ARQ_REJ          0x02  /* ctl：纯 ACK，ack 之后出现了缺口，请求立即重发 */
+#define SERIAL_ARQ_WINDOW       CONFIG_ESPRPC_SERIAL_ARQ_WINDOW
+#define SERIAL_ARQ_QUEUE_LEN    CONFIG_ESPRPC_SERIAL_ARQ_QUEUE_LEN
+#define SERIAL_ARQ_RTO_MS       CONFIG_ESPRPC_SERIAL_ARQ_RTO_MS
+#define SERIAL_ARQ_RTO_MAX_MS   (SERIAL_ARQ_RTO_MS * 8)
+#define SERIAL_ARQ_STALLS       8     /* 连续超时达到该次数后换会话号重新同步 */
+#define SERIAL_LINK_HDR         SERIAL_ARQ_HDR
+#else
+#define SERIAL_LINK_HDR         0
+#endif
+
 /** 发送回调：由应用提供，用于把 RPC 帧（含可选前后缀）发到串口 */
 typedef void (*serial_tx_fn_t)(const uint8_t *data, size_t len, void *ctx);
+/** 分段发送回调：各段顺序即 prefix + 帧 + suffix */
+typedef void (*serial_txv_fn_t)(const esprpc_iovec_t *iov, size_t iovcnt, void *ctx);
+
+#if CONFIG_ESPRPC_SERIAL_ARQ
+/** 待发送或在途的 RPC 帧（引用计数帧缓冲） */
+typedef struct {
+    uint8_t *buf;
+    size_t len;
+} serial_arq_frame_t;
+
+/** ARQ 链路状态 */
+typedef struct {
+    QueueHandle_t txq;            /* 其他任务 sendv 的帧 */
+    QueueHandle_t wake;           /* 长度 1：有新帧、收到 ACK 或需要回 ACK 时唤醒链路任务 */
+    SemaphoreHandle_t lock;       /* 保护收包任务与链路任务共享的以下字段 */
+    TaskHandle_t rx_task;         /* 调用 feed_bytes 的任务 */
+    serial_arq_frame_t *reply;    /* 收包任务（on_recv 内）sendv 的帧（环形），满时加倍扩容；链路任务优先发送 */
+    uint16_t reply_cap;
+    uint16_t reply_head;
+    uint16_t reply_count;
+    bool link_up;                 /* 收到过对端且未停滞：其他任务在发送队列满时等待而不是丢帧 */
+    bool peer_known;
+    uint8_t peer_epoch;
+    uint8_t rx_expect;            /* 期望对端的下一个 seq */
+    bool ack_pending;
+    bool rej_pending;             /* 待发 REJ */
+    bool rej_sent;                /* 当前缺口已发过 REJ，收到按序帧后清除 */
+    bool peer_reset;              /* 对端换了会话，链路任务须从 seq 0 重新编号 */
+    bool peer_rej;                /* 收到对端的 REJ */
+    uint8_t peer_ack;             /* 对端最近的累计 ACK */
+    /* 以下仅链路任务访问 */
+    uint8_t epoch;
+    uint8_t base;                 /* 窗口首帧的 seq */
+    uint8_t head;                 /* 窗口首帧在 win 中的下标 */
+    uint8_t count;                /* 在途帧数 */
+    TickType_t sent_at;           /* 窗口首帧最近一次发出的时刻 */
+    serial_arq_frame_t win[SERIAL_ARQ_WINDOW];
+} serial_arq_t;
+#endif
 
 /** 串口传输上下文（仅外部管理，不创建 UART/任务） */
 typedef struct {
@@ -34,12 +118,31 @@ typedef struct {
     size_t suffix_len;
     serial_tx_fn_t tx_cb;
     void *tx_cb_ctx;
+    serial_txv_fn_t txv_cb;
+    void *txv_cb_ctx;
     esprpc_transport_on_recv_fn on_recv;
     void *on_recv_ctx;
+    /* feed_bytes 成帧状态，仅在调用 feed_bytes 的任务中访问 */
+    uint8_t *rx_buf;             /* 拼包缓冲，首次 feed_bytes 时分配，容量为一个最大包 */
+    size_t rx_cap;
+    size_t rx_len;
+    size_t rx_need;              /* 缓冲中的候选包还缺的字节数 */
+    TickType_t rx_last;          /* 最近一次收到字节的时刻，用于半包超时 */
+#if CONFIG_ESPRPC_SERIAL_COBS
+    size_t rx_raw;               /* 当前包已收到的编码字节数 */
+    uint8_t cobs_code;           /* 当前块的码字节，0 表示包刚开始 */
+    uint8_t cobs_left;           /* 当前块剩余的数据字节 */
+    bool rx_drop;                /* 超长，丢弃到下一个 0x00 */
+#endif
+#if CONFIG_ESPRPC_SERIAL_ARQ
+    serial_arq_t arq;
+#endif
+    esprpc_serial_stats_t stats;
 } serial_ctx_t;
 
 static serial_ctx_t s_serial_ctx = {0};
 
+#if !CONFIG_ESPRPC_SERIAL_COBS
 /**
  * 解析前后缀字符串为字节序列。支持：
  * - 字面量：每个字符即一字节，如 ">>" "RPC"
@@ -65,12 +168,341 @@ static size_t parse_packet_marker(const char *str, uint8_t *out, size_t max_len)
     }
     return n;
 }
+#endif
+
+#if CONFIG_ESPRPC_SERIAL_COBS
+
+/** CRC-16/CCITT-FALSE（多项式 0x1021，初值 0xFFFF），半字节查表 */
+static uint16_t serial_crc16(uint16_t crc, const uint8_t *p, size_t n)
+{
+    static const uint16_t tbl[16] = {
+        0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
+        0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF,
+    };
+    for (; n > 0; n--, p++) {
+        crc = (uint16_t)((crc << 4) ^ tbl[(crc >> 12) ^ (*p >> 4)]);
+        crc = (uint16_t)((crc << 4) ^ tbl[(crc >> 12) ^ (*p & 0x0F)]);
+    }
+    return crc;
+}
+
+/** 流式 COBS 编码：输入可分多次给出 */
+typedef struct {
+    uint8_t *out;
+    size_t len;        /* 已写出的字节 */
+    size_t code_pos;   /* 当前块码字节的位置 */
+    uint8_t code;
+} cobs_enc_t;
+
+/** 写出包前的 0x00 并开始第一个块 */
+static void cobs_enc_begin(cobs_enc_t *e, uint8_t *out)
+{
+    e->out = out;
+    e->out[0] = 0;
+    e->code_pos = 1;
+    e->len = 2;
+    e->code = 1;
+}
+
+static void cobs_enc_put(cobs_enc_t *e, const uint8_t *p, size_t n)
+{
+    for (; n > 0; n--, p++) {
+        if (*p != 0) {
+            e->out[e->len++] = *p;
+            if (++e->code != 0xFF) continue;
+        }
+        /* 遇到 0x00 或块满 254 字节：回填码字节，开始新块 */
+        e->out[e->code_pos] = e->code;
+        e->code_pos = e->len++;
+        e->code = 1;
+    }
+}
 
-/** 发送：把 prefix + data + suffix 通过 tx_cb 交给应用发送 */
-static esp_err_t serial_send_impl(serial_ctx_t *sc, const uint8_t *data, size_t len)
+/** 回填最后一个码字节并写出包尾 0x00，返回总长度 */
+static size_t cobs_enc_end(cobs_enc_t *e)
 {
+    e->out[e->code_pos] = e->code;
+    e->out[e->len++] = 0;
+    return e->len;
+}
+
+/** COBS 模式发送：编码到一个缓冲后整包交给 txv_cb 或 tx_cb */
+static esp_err_t serial_sendv_cobs(serial_ctx_t *sc, const esprpc_iovec_t *iov, size_t iovcnt)
+{
+    if (!sc->txv_cb && !sc->tx_cb) return ESP_ERR_INVALID_STATE;
+    size_t n = SERIAL_CRC_LEN;
+    uint16_t crc = 0xFFFF;
+    for (size_t i = 0; i < iovcnt; i++) {
+        n += iov[i].len;
+        crc = serial_crc16(crc, (const uint8_t *)iov[i].base, iov[i].len);
+    }
+    uint8_t *buf = (uint8_t *)malloc(n + n / 254 + 3);
+    if (!buf) return ESP_ERR_NO_MEM;
+    uint8_t trailer[SERIAL_CRC_LEN] = { (uint8_t)(crc & 0xFF), (uint8_t)(crc >> 8) };
+    cobs_enc_t e;
+    cobs_enc_begin(&e, buf);
+    for (size_t i = 0; i < iovcnt; i++) {
+        cobs_enc_put(&e, (const uint8_t *)iov[i].base, iov[i].len);
+    }
+    cobs_enc_put(&e, trailer, sizeof(trailer));
+    size_t total = cobs_enc_end(&e);
+    if (sc->txv_cb) {
+        esprpc_iovec_t v = { buf, total };
+        sc->txv_cb(&v, 1, sc->txv_cb_ctx);
+    } else {
+        sc->tx_cb(buf, total, sc->tx_cb_ctx);
+    }
+    free(buf);
+    return ESP_OK;
+}
+
+#if CONFIG_ESPRPC_SERIAL_ARQ
+
+/** 发出一个链路包，ack 取本端当前的 rx_expect（同时算作已回 ACK）；frame 为 NULL 时为纯 ACK */
+static void serial_arq_emit(serial_ctx_t *sc, uint8_t ctl, uint8_t seq, const uint8_t *frame, size_t len)
+{
+    serial_arq_t *a = &sc->arq;
+    uint8_t hdr[SERIAL_ARQ_HDR] = { ctl, a->epoch, seq, 0 };
+    xSemaphoreTake(a->lock, portMAX_DELAY);
+    hdr[3] = a->rx_expect;
+    a->ack_pending = false;
+    xSemaphoreGive(a->lock);
+    esprpc_iovec_t iov[2] = { { hdr, sizeof(hdr) }, { frame, len } };
+    serial_sendv_cobs(sc, iov, frame ? 2 : 1);
+}
+
+/** 重发窗口内全部帧（Go-Back-N） */
+static void serial_arq_resend(serial_ctx_t *sc)
+{
+    serial_arq_t *a = &sc->arq;
+    for (uint8_t i = 0; i < a->count; i++) {
+        const serial_arq_frame_t *f = &a->win[(a->head + i) % SERIAL_ARQ_WINDOW];
+        serial_arq_emit(sc, SERIAL_ARQ_DATA, (uint8_t)(a->base + i), f->buf, f->len);
+    }
+    sc->stats.arq_retransmits += a->count;
+    a->sent_at = xTaskGetTickCount();
+}
+
+/** 取下一个待发帧：应答队列优先 */
+static bool serial_arq_next(serial_arq_t *a, serial_arq_frame_t *f)
+{
+    bool got = false;
+    xSemaphoreTake(a->lock, portMAX_DELAY);
+    if (a->reply_count > 0) {
+        *f = a->reply[a->reply_head];
+        a->reply_head = (uint16_t)((a->reply_head + 1) % a->reply_cap);
+        a->reply_count--;
+        got = true;
+    }
+    xSemaphoreGive(a->lock);
+    return got || xQueueReceive(a->txq, f, 0) == pdTRUE;
+}
+
+/** 链路任务：唯一调用 tx_cb/txv_cb 的任务，负责滑动窗口、重传与回 ACK */
+static void serial_arq_task(void *arg)
+{
+    serial_ctx_t *sc = (serial_ctx_t *)arg;
+    serial_arq_t *a = &sc->arq;
+    TickType_t rto = pdMS_TO_TICKS(SERIAL_ARQ_RTO_MS);
+    uint8_t stalls = 0;
+    for (;;) {
+        TickType_t wait = portMAX_DELAY;
+        if (a->count > 0) {
+            TickType_t elapsed = xTaskGetTickCount() - a->sent_at;
+            wait = elapsed < rto ? rto - elapsed : 0;
+        }
+        uint8_t token;
+        xQueueReceive(a->wake, &token, wait);
+
+        xSemaphoreTake(a->lock, portMAX_DELAY);
+        bool reset = a->peer_reset;
+        bool rej = a->peer_rej;
+        uint8_t ack = a->peer_ack;
+        a->peer_reset = false;
+        a->peer_rej = false;
+        xSemaphoreGive(a->lock);
+
+        if (reset) {
+            /* 对端重启：未确认的帧按新会话从 seq 0 重新编号，随后的 ACK 即针对新编号 */
+            a->base = 0;
+            rto = pdMS_TO_TICKS(SERIAL_ARQ_RTO_MS);
+            stalls = 0;
+            if (a->count > 0) serial_arq_resend(sc);
+        }
+        uint8_t acked = (uint8_t)(ack - a->base);
+        if (acked > 0 && acked <= a->count) {
+            for (uint8_t i = 0; i < acked; i++) {
+                esprpc_buf_unref(a->win[a->head].buf);
+                a->head = (uint8_t)((a->head + 1) % SERIAL_ARQ_WINDOW);
+            }
+            a->count = (uint8_t)(a->count - acked);
+            a->base = ack;
+            a->sent_at = xTaskGetTickCount();
+            rto = pdMS_TO_TICKS(SERIAL_ARQ_RTO_MS);
+            stalls = 0;
+        }
+        if (a->count > 0 && rej && ack == a->base) {
+            sc->stats.arq_fast_retransmits++;
+            serial_arq_resend(sc);
+        } else if (a->count > 0 && xTaskGetTickCount() - a->sent_at >= rto) {
+            if (++stalls >= SERIAL_ARQ_STALLS) {
+                /* 长时间没有进展（对端不在或会话号碰撞）：换会话号，两个方向都从 seq 0 开始 */
+                ESP_LOGW(TAG, "ARQ link stalled, resync");
+                a->epoch = (uint8_t)(a->epoch + 1 + esp_random() % 255);
+                a->base = 0;
+                xSemaphoreTake(a->lock, portMAX_DELAY);
+                a->rx_expect = 0;
+                a->link_up = false;  /* 再收到对端之前，其他任务在发送队列满时丢帧而不是等待 */
+                xSemaphoreGive(a->lock);
+                stalls = 0;
+                rto = pdMS_TO_TICKS(SERIAL_ARQ_RTO_MS);
+            } else if (rto < pdMS_TO_TICKS(SERIAL_ARQ_RTO_MAX_MS)) {
+                rto *= 2;
+            }
+            serial_arq_resend(sc);
+        }
+
+        serial_arq_frame_t f;
+        while (a->count < SERIAL_ARQ_WINDOW && serial_arq_next(a, &f)) {
+            if (a->count == 0) a->sent_at = xTaskGetTickCount();
+            a->win[(a->head + a->count) % SERIAL_ARQ_WINDOW] = f;
+            serial_arq_emit(sc, SERIAL_ARQ_DATA, (uint8_t)(a->base + a->count), f.buf, f.len);
+            a->count++;
+        }
+
+        xSemaphoreTake(a->lock, portMAX_DELAY);
+        bool ack_pending = a->ack_pending;
+        bool rej_pending = a->rej_pending;
+        a->rej_pending = false;
+        xSemaphoreGive(a->lock);
+        if (rej_pending) serial_arq_emit(sc, SERIAL_ARQ_REJ, 0, NULL, 0);
+        else if (ack_pending) serial_arq_emit(sc, 0, 0, NULL, 0);
+    }
+}
+
+static void serial_arq_wake(serial_arq_t *a)
+{
+    uint8_t token = 0;
+    xQueueSend(a->wake, &token, 0);
+}
+
+/** 应答入队（持有 lock）：环满时加倍扩容，只在内存不足时失败 */
+static bool serial_arq_reply_push(serial_arq_t *a, const serial_arq_frame_t *f)
+{
+    if (a->reply_count == a->reply_cap) {
+        if (a->reply_cap > UINT16_MAX / 2) return false;
+        uint16_t cap = (uint16_t)(a->reply_cap * 2);
+        serial_arq_frame_t *r = (serial_arq_frame_t *)malloc(cap * sizeof(serial_arq_frame_t));
+        if (!r) return false;
+        for (uint16_t i = 0; i < a->reply_count; i++) r[i] = a->reply[(a->reply_head + i) % a->reply_cap];
+        free(a->reply);
+        a->reply = r;
+        a->reply_cap = cap;
+        a->reply_head = 0;
+    }
+    a->reply[(a->reply_head + a->reply_count) % a->reply_cap] = *f;
+    a->reply_count++;
+    return true;
+}
+
+static bool serial_arq_link_up(serial_arq_t *a)
+{
+    xSemaphoreTake(a->lock, portMAX_DELAY);
+    bool up = a->link_up;
+    xSemaphoreGive(a->lock);
+    return up;
+}
+
+/**
+ * 帧拷贝到引用计数帧缓冲后入队，由链路任务发送。背压在链路内完成，调用方不需要重试：
+ * - 收包任务（on_recv 内，如多页的分页响应）：进应答队列，不等待（ACK 也由该任务读入），队列按需扩容，
+ *   积压期间对端的新请求由 serial_arq_recv 推迟接收
+ * - 其他任务：发送队列满时等待窗口空出，每个 RTO 检查一次链路
+ * 仍会丢弃并计入 arq_dropped 的只有：链路断开（尚未收到过对端，或连续 SERIAL_ARQ_STALLS 次超时后重新同步、
+ * 此后未再收到对端）时其他任务遇到发送队列满（返回 ESP_ERR_INVALID_STATE），以及扩容应答队列时内存不足。
+ */
+static esp_err_t serial_arq_enqueue(serial_ctx_t *sc, const esprpc_iovec_t *iov, size_t iovcnt)
+{
+    serial_arq_t *a = &sc->arq;
+    if (!a->txq) return ESP_ERR_INVALID_STATE;
+    size_t n = 0;
+    for (size_t i = 0; i < iovcnt; i++) n += iov[i].len;
+    if (n < SERIAL_RPC_FRAME_HEADER || n > SERIAL_RPC_FRAME_HEADER + SERIAL_RPC_PAYLOAD_MAX) return ESP_ERR_INVALID_SIZE;
+    serial_arq_frame_t f = { (uint8_t *)esprpc_buf_alloc(n), n };
+    if (!f.buf) return ESP_ERR_NO_MEM;
+    size_t off = 0;
+    for (size_t i = 0; i < iovcnt; i++) {
+        if (iov[i].len) memcpy(f.buf + off, iov[i].base, iov[i].len);
+        off += iov[i].len;
+    }
+    esp_err_t err = ESP_OK;
+    if (xTaskGetCurrentTaskHandle() == a->rx_task) {
+        xSemaphoreTake(a->lock, portMAX_DELAY);
+        if (!serial_arq_reply_push(a, &f)) err = ESP_ERR_NO_MEM;
+        xSemaphoreGive(a->lock);
+    } else {
+        bool queued = xQueueSend(a->txq, &f, 0) == pdTRUE;
+        while (!queued && serial_arq_link_up(a)) {
+            serial_arq_wake(a);
+            queued = xQueueSend(a->txq, &f, pdMS_TO_TICKS(SERIAL_ARQ_RTO_MS)) == pdTRUE;
+        }
+        if (!queued) err = ESP_ERR_INVALID_STATE;
+    }
+    if (err != ESP_OK) {
+        esprpc_buf_unref(f.buf);
+        xSemaphoreTake(a->lock, portMAX_DELAY);
+        sc->stats.arq_dropped++;
+        xSemaphoreGive(a->lock);
+        return err;
+    }
+    serial_arq_wake(a);
+    return ESP_OK;
+}
+
+/** 创建队列与链路任务；重复 init 时沿用 */
+static esp_err_t serial_arq_init(serial_ctx_t *sc)
+{
+    serial_arq_t *a = &sc->arq;
+    a->epoch = (uint8_t)esp_random();
+    a->txq = xQueueCreate(SERIAL_ARQ_QUEUE_LEN, sizeof(serial_arq_frame_t));
+    a->reply_cap = SERIAL_ARQ_QUEUE_LEN;
+    a->reply = (serial_arq_frame_t *)malloc(a->reply_cap * sizeof(serial_arq_frame_t));
+    a->wake = xQueueCreate(1, sizeof(uint8_t));
+    a->lock = xSemaphoreCreateMutex();
+    if (!a->txq || !a->reply || !a->wake || !a->lock ||
+        xTaskCreatePinnedToCore(serial_arq_task, "esprpc_arq", 3072, sc, 5, NULL, tskNO_AFFINITY) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to start serial ARQ link task");
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+#endif /* CONFIG_ESPRPC_SERIAL_ARQ */
+
+#endif /* CONFIG_ESPRPC_SERIAL_COBS */
+
+/** 发送：prefix + iov + suffix。注册了 txv_cb 时直接分段交给应用，否则拼接一次后走 tx_cb */
+static esp_err_t serial_sendv_impl(serial_ctx_t *sc, const esprpc_iovec_t *iov, size_t iovcnt)
+{
+#if CONFIG_ESPRPC_SERIAL_ARQ
+    return serial_arq_enqueue(sc, iov, iovcnt);
+#elif CONFIG_ESPRPC_SERIAL_COBS
+    return serial_sendv_cobs(sc, iov, iovcnt);
+#else
+    if (sc->txv_cb && iovcnt + 2 <= SERIAL_IOV_MAX) {
+        esprpc_iovec_t v[SERIAL_IOV_MAX];
+        size_t n = 0;
+        if (sc->prefix_len) v[n++] = (esprpc_iovec_t){ sc->prefix_buf, sc->prefix_len };
+        for (size_t i = 0; i < iovcnt; i++) {
+            if (iov[i].len) v[n++] = iov[i];
+        }
+        if (sc->suffix_len) v[n++] = (esprpc_iovec_t){ sc->suffix_buf, sc->suffix_len };
+        if (n > 0) sc->txv_cb(v, n, sc->txv_cb_ctx);
+        return ESP_OK;
+    }
     if (!sc->tx_cb) return ESP_ERR_INVALID_STATE;
-    size_t total = sc->prefix_len + len + sc->suffix_len;
+    size_t total = sc->prefix_len + sc->suffix_len;
+    for (size_t i = 0; i < iovcnt; i++) total += iov[i].len;
     if (total == 0) return ESP_OK;
     uint8_t *buf = (uint8_t *)malloc(total);
     if (!buf) return ESP_ERR_NO_MEM;
@@ -79,19 +511,30 @@ static esp_err_t serial_send_impl(serial_ctx_t *sc, const uint8_t *data, size_t
         memcpy(buf + off, sc->prefix_buf, sc->prefix_len);
         off += sc->prefix_len;
     }
-    memcpy(buf + off, data, len);
-    off += len;
+    for (size_t i = 0; i < iovcnt; i++) {
+        if (iov[i].len) memcpy(buf + off, iov[i].base, iov[i].len);
+        off += iov[i].len;
+    }
     if (sc->suffix_len) memcpy(buf + off, sc->suffix_buf, sc->suffix_len);
     sc->tx_cb(buf, total, sc->tx_cb_ctx);
     free(buf);
     return ESP_OK;
+#endif
 }
 
 static esp_err_t serial_send(void *ctx, const uint8_t *data, size_t len)
 {
     serial_ctx_t *sc = (serial_ctx_t *)ctx;
     if (!sc) return ESP_ERR_INVALID_STATE;
-    return serial_send_impl(sc, data, len);
+    esprpc_iovec_t iov = { data, len };
+    return serial_sendv_impl(sc, &iov, 1);
+}
+
+static esp_err_t serial_sendv(void *ctx, const esprpc_iovec_t *iov, size_t iovcnt)
+{
+    serial_ctx_t *sc = (serial_ctx_t *)ctx;
+    if (!sc) return ESP_ERR_INVALID_STATE;
+    return serial_sendv_impl(sc, iov, iovcnt);
 }
 
 static esp_err_t serial_start(void *ctx, esprpc_transport_on_recv_fn on_recv, void *user_ctx)
@@ -111,6 +554,7 @@ static void serial_stop(void *ctx)
 
 static esprpc_transport_t s_serial_transport = {
     .send  = serial_send,
+    .sendv = serial_sendv,
     .start = serial_start,
     .stop  = serial_stop,
     .ctx   = &s_serial_ctx,
@@ -118,13 +562,24 @@ static esprpc_transport_t s_serial_transport = {
 
 esp_err_t esprpc_transport_serial_init(void)
 {
+#if CONFIG_ESPRPC_SERIAL_ARQ
+    if (s_serial_ctx.arq.txq) return ESP_OK;  /* 链路任务常驻，不重复初始化 */
+#endif
+    free(s_serial_ctx.rx_buf);
     memset(&s_serial_ctx, 0, sizeof(s_serial_ctx));
+#if CONFIG_ESPRPC_SERIAL_ARQ
+    ESP_LOGI(TAG, "Serial transport init (external only, COBS + CRC-16, ARQ window=%d)", SERIAL_ARQ_WINDOW);
+    return serial_arq_init(&s_serial_ctx);
+#elif CONFIG_ESPRPC_SERIAL_COBS
+    ESP_LOGI(TAG, "Serial transport init (external only, COBS + CRC-16)");
+#else
     s_serial_ctx.prefix_len = parse_packet_marker(CONFIG_ESPRPC_SERIAL_PREFIX,
                                                   s_serial_ctx.prefix_buf, SERIAL_PREFIX_SUFFIX_MAX);
     s_serial_ctx.suffix_len = parse_packet_marker(CONFIG_ESPRPC_SERIAL_SUFFIX,
                                                   s_serial_ctx.suffix_buf, SERIAL_PREFIX_SUFFIX_MAX);
     ESP_LOGI(TAG, "Serial transport init (external only, prefix=%zu suffix=%zu)",
              s_serial_ctx.prefix_len, s_serial_ctx.suffix_len);
+#endif
     return ESP_OK;
 }
 
@@ -150,8 +605,15 @@ void esprpc_serial_feed_packet(const uint8_t *data, size_t len)
 /* 外部管理时：接受带前后缀的原始包，内部按配置剥掉前后缀后交给 on_recv（无需调用方自己脱壳） */
 void esprpc_serial_feed_raw_packet(const uint8_t *data, size_t len)
 {
-    serial_ctx_t *sc = &s_serial_ctx;
     if (!data) return;
+#if CONFIG_ESPRPC_SERIAL_COBS
+    /* COBS 模式：data 为一个编码后的包（可带首尾 0x00），与 feed_bytes 共用解码状态 */
+    static const uint8_t delim = 0;
+    esprpc_serial_feed_bytes(&delim, 1);
+    esprpc_serial_feed_bytes(data, len);
+    esprpc_serial_feed_bytes(&delim, 1);
+#else
+    serial_ctx_t *sc = &s_serial_ctx;
     size_t pl = sc->prefix_len;
     size_t sl = sc->suffix_len;
     if (len < pl + SERIAL_RPC_FRAME_HEADER + sl) return;
@@ -166,6 +628,295 @@ void esprpc_serial_feed_raw_packet(const uint8_t *data, size_t len)
         ESP_LOGI(TAG, "RPC raw frame feed len=%zu methodId=%d", frame_len, frame[0]);
         sc->on_recv(frame, frame_len, sc->on_recv_ctx);
     }
+#endif
+}
+
+static void serial_deliver(serial_ctx_t *sc, const uint8_t *frame, size_t len, bool copied)
+{
+    sc->stats.frames++;
+    if (copied) sc->stats.frames_copied++;
+    if (sc->on_recv) {
+        ESP_LOGI(TAG, "RPC frame feed len=%zu methodId=%d", len, frame[0]);
+        sc->on_recv(frame, len, sc->on_recv_ctx);
+    }
+}
+
+#if CONFIG_ESPRPC_SERIAL_COBS
+
+/** 帧头中的负载长度与帧长一致 */
+static bool serial_frame_len_ok(const uint8_t *f, size_t len)
+{
+    return len >= SERIAL_RPC_FRAME_HEADER && SERIAL_RPC_FRAME_HEADER + ((size_t)f[3] | ((size_t)f[4] << 8)) == len;
+}
+
+#if CONFIG_ESPRPC_SERIAL_ARQ
+
+/** 处理一个通过 CRC 的链路包：记录对端 ACK 与会话，按序的 DATA 帧交给 on_recv；格式不符返回 false */
+static bool serial_arq_recv(serial_ctx_t *sc, const uint8_t *p, size_t len)
+{
+    serial_arq_t *a = &sc->arq;
+    if (len < SERIAL_ARQ_HDR) return false;
+    bool data = (p[0] & SERIAL_ARQ_DATA) != 0;
+    if (data ? !serial_frame_len_ok(p + SERIAL_ARQ_HDR, len - SERIAL_ARQ_HDR) : len != SERIAL_ARQ_HDR) return false;
+    bool deliver = false;
+    xSemaphoreTake(a->lock, portMAX_DELAY);
+    if (!a->peer_known || p[1] != a->peer_epoch) {
+        /* 首次收到对端：从 seq 0 接收；对端会话号变化（重启）时本端发送也重新编号 */
+        a->peer_reset = a->peer_known;
+        a->peer_known = true;
+        a->peer_epoch = p[1];
+        a->rx_expect = 0;
+        a->rej_sent = false;
+        a->peer_ack = 0;
+    }
+    a->link_up = true;
+    a->peer_ack = p[3];
+    if (p[0] & SERIAL_ARQ_REJ) a->peer_rej = true;
+    if (data) {
+        uint8_t ahead = (uint8_t)(p[2] - a->rx_expect);
+        /* 应答积压时不接收新请求，由对端超时后重发，应答队列因此只在单个请求的应答很多时扩容 */
+        if (ahead == 0 && a->reply_count * 2 < SERIAL_ARQ_QUEUE_LEN) {
+            a->rx_expect++;
+            a->rej_sent = false;
+            deliver = true;
+        } else {
+            sc->stats.arq_discarded++;
+            if (ahead != 0 && ahead < 128 && !a->rej_sent) a->rej_pending = a->rej_sent = true;
+        }
+        a->ack_pending = true;
+    }
+    xSemaphoreGive(a->lock);
+    if (deliver) serial_deliver(sc, p + SERIAL_ARQ_HDR, len - SERIAL_ARQ_HDR, true);
+    serial_arq_wake(a);
+    return true;
+}
+
+#endif /* CONFIG_ESPRPC_SERIAL_ARQ */
+
+/** 遇到 0x00：校验并交付当前包，复位解码状态 */
+static void serial_cobs_end(serial_ctx_t *sc)
+{
+    if (sc->rx_raw == 0) return;  /* 连续的 0x00 */
+    bool ok = !sc->rx_drop && sc->cobs_left == 0 && sc->rx_len > SERIAL_CRC_LEN;
+    size_t len = ok ? sc->rx_len - SERIAL_CRC_LEN : 0;
+    if (ok) {
+        const uint8_t *f = sc->rx_buf;
+        ok = serial_crc16(0xFFFF, f, len) == ((uint16_t)f[len] | ((uint16_t)f[len + 1] << 8));
+    }
+#if CONFIG_ESPRPC_SERIAL_ARQ
+    if (ok) ok = serial_arq_recv(sc, sc->rx_buf, len);
+#else
+    if (ok) ok = serial_frame_len_ok(sc->rx_buf, len);
+    if (ok) serial_deliver(sc, sc->rx_buf, len, true);
+#endif
+    if (!ok) {
+        sc->stats.frames_corrupt++;
+        sc->stats.bytes_skipped += (uint32_t)sc->rx_raw;
+    }
+    sc->rx_len = 0;
+    sc->rx_raw = 0;
+    sc->cobs_code = 0;
+    sc->cobs_left = 0;
+    sc->rx_drop = false;
+}
+
+/** 解码一段不含 0x00 的输入，数据块整块拷贝 */
+static void serial_cobs_put(serial_ctx_t *sc, const uint8_t *p, size_t n)
+{
+    sc->rx_raw += n;
+    while (n > 0 && !sc->rx_drop) {
+        if (sc->cobs_left == 0) {
+            /* 码字节：上一块不满 254 字节时，块尾隐含一个 0x00 */
+            if (sc->cobs_code != 0 && sc->cobs_code != 0xFF) {
+                if (sc->rx_len == sc->rx_cap) {
+                    sc->rx_drop = true;
+                    break;
+                }
+                sc->rx_buf[sc->rx_len++] = 0;
+            }
+            sc->cobs_code = *p++;
+            sc->cobs_left = (uint8_t)(sc->cobs_code - 1);
+            n--;
+            continue;
+        }
+        size_t k = sc->cobs_left < n ? sc->cobs_left : n;
+        if (k > sc->rx_cap - sc->rx_len) {
+            sc->rx_drop = true;
+            break;
+        }
+        memcpy(sc->rx_buf + sc->rx_len, p, k);
+        sc->rx_len += k;
+        sc->cobs_left = (uint8_t)(sc->cobs_left - k);
+        p += k;
+        n -= k;
+    }
+}
+
+#else
+
+/**
+ * 从 pos 起查找前缀：返回完整匹配的位置，或数据末尾处前缀的部分匹配位置；都没有时返回 n。
+ * 无前缀时每个位置都是候选。
+ */
+static size_t serial_find_prefix(const serial_ctx_t *sc, const uint8_t *p, size_t n, size_t pos)
+{
+    size_t pl = sc->prefix_len;
+    if (pl == 0) return pos;
+    while (pos < n) {
+        const uint8_t *q = (const uint8_t *)memchr(p + pos, sc->prefix_buf[0], n - pos);
+        if (!q) return n;
+        pos = (size_t)(q - p);
+        size_t k = n - pos < pl ? n - pos : pl;
+        if (memcmp(q + 1, sc->prefix_buf + 1, k - 1) == 0) return pos;
+        pos++;
+    }
+    return n;
+}
+
+/**
+ * 在 [p, p + n) 中解析尽可能多的包，返回已消费的字节数。
+ * 未消费的部分以一个不完整的候选包开头，*need 为它还缺的字节数。
+ */
+static size_t serial_scan(serial_ctx_t *sc, const uint8_t *p, size_t n, bool copied, size_t *need)
+{
+    size_t pl = sc->prefix_len;
+    size_t sl = sc->suffix_len;
+    size_t pos = 0;
+    *need = 0;
+    while (pos < n) {
+        size_t start = serial_find_prefix(sc, p, n, pos);
+        sc->stats.bytes_skipped += (uint32_t)(start - pos);
+        if (start == n) return n;
+        size_t avail = n - start;
+        if (avail < pl + SERIAL_RPC_FRAME_HEADER) {
+            *need = pl + SERIAL_RPC_FRAME_HEADER - avail;
+            return start;
+        }
+        const uint8_t *frame = p + start + pl;
+        size_t frame_len = SERIAL_RPC_FRAME_HEADER + ((size_t)frame[3] | ((size_t)frame[4] << 8));
+        if (frame_len > SERIAL_RPC_FRAME_HEADER + SERIAL_RPC_PAYLOAD_MAX) {
+            /* 假前缀或损坏的帧头：从下一字节重新找 */
+            sc->stats.resyncs++;
+            sc->stats.bytes_skipped++;
+            pos = start + 1;
+            continue;
+        }
+        size_t total = pl + frame_len + sl;
+        if (avail < total) {
+            *need = total - avail;
+            return start;
+        }
+        if (sl > 0 && memcmp(frame + frame_len, sc->suffix_buf, sl) != 0) {
+            sc->stats.resyncs++;
+            sc->stats.bytes_skipped++;
+            pos = start + 1;
+            continue;
+        }
+        serial_deliver(sc, frame, frame_len, copied);
+        pos = start + total;
+    }
+    return pos;
+}
+
+#endif /* CONFIG_ESPRPC_SERIAL_COBS */
+
+/**
+ * 半包超时：链路静默超过 SERIAL_RX_TIMEOUT_MS 仍未补齐的包不再等待。
+ * 前后缀模式下把候选包首字节当作假前缀丢弃，从下一字节重新解析缓冲（长度字段损坏时，被它吞进缓冲的
+ * 后续合法包由此送达），仍剩半包则重复，直到缓冲清空；COBS 模式下把静默当作包尾，CRC 不符即丢弃。
+ */
+static void serial_rx_expire(serial_ctx_t *sc)
+{
+#if CONFIG_ESPRPC_SERIAL_COBS
+    serial_cobs_end(sc);
+#else
+    size_t off = 0;
+    while (off < sc->rx_len) {
+        sc->stats.resyncs++;
+        sc->stats.bytes_skipped++;
+        off++;
+        off += serial_scan(sc, sc->rx_buf + off, sc->rx_len - off, true, &sc->rx_need);
+    }
+    sc->rx_len = 0;
+    sc->rx_need = 0;
+#endif
+}
+
+void esprpc_serial_feed_bytes(const uint8_t *data, size_t len)
+{
+    serial_ctx_t *sc = &s_serial_ctx;
+    if (!data && len > 0) return;
+#if CONFIG_ESPRPC_SERIAL_ARQ
+    sc->arq.rx_task = xTaskGetCurrentTaskHandle();
+#endif
+    TickType_t now = xTaskGetTickCount();
+#if CONFIG_ESPRPC_SERIAL_COBS
+    bool held = sc->rx_raw > 0;
+#else
+    bool held = sc->rx_len > 0;
+#endif
+    if (held && SERIAL_RX_TIMEOUT_MS > 0 && now - sc->rx_last >= pdMS_TO_TICKS(SERIAL_RX_TIMEOUT_MS)) {
+        serial_rx_expire(sc);
+    }
+    if (len == 0) return;
+    sc->rx_last = now;
+    if (!sc->rx_buf) {
+#if CONFIG_ESPRPC_SERIAL_COBS
+        sc->rx_cap = SERIAL_LINK_HDR + SERIAL_RPC_FRAME_HEADER + SERIAL_RPC_PAYLOAD_MAX + SERIAL_CRC_LEN;
+#else
+        sc->rx_cap = sc->prefix_len + SERIAL_RPC_FRAME_HEADER + SERIAL_RPC_PAYLOAD_MAX + sc->suffix_len;
+#endif
+        sc->rx_buf = (uint8_t *)malloc(sc->rx_cap);
+        if (!sc->rx_buf) {
+            ESP_LOGE(TAG, "Failed to alloc serial rx buffer (%zu)", sc->rx_cap);
+            return;
+        }
+    }
+#if CONFIG_ESPRPC_SERIAL_COBS
+    while (len > 0) {
+        const uint8_t *z = (const uint8_t *)memchr(data, 0, len);
+        size_t n = z ? (size_t)(z - data) : len;
+        serial_cobs_put(sc, data, n);
+        if (!z) return;
+        serial_cobs_end(sc);
+        data += n + 1;
+        len -= n + 1;
+    }
+#else
+    while (len > 0) {
+        size_t used;
+        if (sc->rx_len == 0) {
+            /* 直接在调用方数据上解析，剩下的半包（必然小于一个最大包）拷进缓冲 */
+            used = serial_scan(sc, data, len, false, &sc->rx_need);
+            data += used;
+            len -= used;
+            if (len > 0) {
+                memcpy(sc->rx_buf, data, len);
+                sc->rx_len = len;
+            }
+            return;
+        }
+        /* 缓冲中有半包：只补足它所需的字节，其余数据留给下一轮零拷贝解析 */
+        size_t k = sc->rx_need < len ? sc->rx_need : len;
+        if (k > sc->rx_cap - sc->rx_len) k = sc->rx_cap - sc->rx_len;
+        memcpy(sc->rx_buf + sc->rx_len, data, k);
+        sc->rx_len += k;
+        data += k;
+        len -= k;
+        used = serial_scan(sc, sc->rx_buf, sc->rx_len, true, &sc->rx_need);
+        if (used > 0) {
+            memmove(sc->rx_buf, sc->rx_buf + used, sc->rx_len - used);
+            sc->rx_len -= used;
+        }
+    }
+#endif
+}
+
+esp_err_t esprpc_serial_get_stats(esprpc_serial_stats_t *out)
+{
+    if (!out) return ESP_ERR_INVALID_ARG;
+    *out = s_serial_ctx.stats;
+    return ESP_OK;
 }
 
 void esprpc_serial_get_packet_marker(uint8_t *prefix_buf, size_t prefix_max, size_t *prefix_len,
@@ -192,6 +943,14 @@ esp_err_t esprpc_serial_set_tx_cb(void (*tx_fn)(const uint8_t *data, size_t len,
     return ESP_OK;
 }
 
+esp_err_t esprpc_serial_set_txv_cb(void (*txv_fn)(const esprpc_iovec_t *iov, size_t iovcnt, void *ctx), void *ctx)
+{
+    serial_ctx_t *sc = &s_serial_ctx;
+    sc->txv_cb = (serial_txv_fn_t)txv_fn;
+    sc->txv_cb_ctx = ctx;
+    return ESP_OK;
+}
+
 #else /* !CONFIG_ESPRPC_ENABLE_SERIAL */
 
 esp_err_t esprpc_transport_serial_init(void)
@@ -217,6 +976,18 @@ void esprpc_serial_feed_raw_packet(const uint8_t *data, size_t len)
     (void)len;
 }
 
+void esprpc_serial_feed_bytes(const uint8_t *data, size_t len)
+{
+    (void)data;
+    (void)len;
+}
+
+esp_err_t esprpc_serial_get_stats(esprpc_serial_stats_t *out)
+{
+    (void)out;
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
 void esprpc_serial_get_packet_marker(uint8_t *prefix_buf, size_t prefix_max, size_t *prefix_len,
                                      uint8_t *suffix_buf, size_t suffix_max, size_t *suffix_len)
 {
@@ -235,4 +1006,11 @@ esp_err_t esprpc_serial_set_tx_cb(void (*tx_fn)(const uint8_t *data, size_t len,
     return ESP_ERR_NOT_SUPPORTED;
 }
 
+esp_err_t esprpc_serial_set_txv_cb(void (*txv_fn)(const esprpc_iovec_t *iov, size_t iovcnt, void *ctx), void *ctx)
+{
+    (void)txv_fn;
+    (void)ctx;
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
 #endif /* CONFIG_ESPRPC_ENABLE_SERIAL */